@@ -33,11 +33,15 @@ function(add_dz_test TEST_NAME TEST_SRC)
 endfunction()
 # add_dz_test(DZ_ShaderReflect tests/ShaderReflect.cpp)
 # add_dz_test(DZ_Particle2D tests/Particle2D.cpp)
-# add_dz_test(DZ_AssetStream tests/AssetStream.cpp)
+add_dz_test(DZ_AssetStream tests/AssetStream.cpp)
 # add_dz_test(DZ_LineGrid tests/LineGrid.cpp)
 # add_dz_test(DZ_D7Stream tests/D7Stream.cpp)
 # add_dz_test(DZ_ImGuiTest tests/ImGui.cpp)
 add_dz_test(DZ_ECSTest tests/ECS.cpp)
+add_dz_test(DZ_ECSDeltaTest tests/ECSDelta.cpp)
+add_dz_test(DZ_StateAssetPackTest tests/StateAssetPack.cpp)
+add_dz_test(DZ_D7RecordingTest tests/D7Recording.cpp)
+add_dz_test(DZ_D7ProducersTest tests/D7Producers.cpp)
 file(COPY images/Suzuho-Ueda.bmp DESTINATION ${CMAKE_BINARY_DIR}/images)
 file(COPY images/hi.bmp DESTINATION ${CMAKE_BINARY_DIR}/images)
 file(COPY models/SaiyanOne.glb DESTINATION ${CMAKE_BINARY_DIR}/models)
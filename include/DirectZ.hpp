@@ -7,12 +7,18 @@
 #include <dz/Renderer.hpp>
 #include <filesystem>
 #include <dz/BufferGroup.hpp>
+#include <dz/Allocator.hpp>
 #include <dz/size_ptr.hpp>
 #include <dz/AssetPack.hpp>
+#include <dz/Transfer.hpp>
+#include <dz/GPUMemory.hpp>
+#include <dz/Hash.hpp>
+#include <dz/ThreadPool.hpp>
 #include <dz/Shader.hpp>
 #include <dz/Window.hpp>
 #include <dz/DrawListManager.hpp>
 #include <dz/math.hpp>
+#include <dz/BVH.hpp>
 #include <dz/FileHandle.hpp>
 #include <dz/internal/memory_stream.hpp>
 #include <dz/KeyValueStream.hpp>
@@ -27,6 +33,7 @@
 #include <dz/State.hpp>
 #include <dz/TypeLoader.hpp>
 #include <dz/Loaders/STB_Image_Loader.hpp>
+#include <dz/Loaders/KTX2_Loader.hpp>
 #include <dz/Loaders/Assimp_Loader.hpp>
 
 #ifdef _WIN32
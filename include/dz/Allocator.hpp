@@ -0,0 +1,166 @@
+/**
+ * @file Allocator.hpp
+ * @brief CPU side allocators: size class pools, an aligned large block allocator and frame scoped linear arenas
+ *
+ * Small allocations are served from fixed size class pools whose pages are kept and reused for the life of the
+ * program, so long sessions do not fragment the general heap. Anything bigger, or needing a wider alignment, goes
+ * to the large block allocator. Every path is counted, allocator_get_stats reports totals and per frame counts.
+ */
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+#define DZ_ALLOCATOR_DEFAULT_ALIGNMENT 16
+#define DZ_ALLOCATOR_LARGE_ALIGNMENT 64
+#define DZ_ALLOCATOR_POOL_MAX_SIZE 1024
+#define DZ_ALLOCATOR_POOL_PAGE_SIZE 65536
+#define DZ_FRAME_ARENA_BLOCK_SIZE (1024 * 1024)
+
+namespace dz
+{
+    struct FrameArena;
+
+    /**
+     * @brief Counters for one kind of allocation
+     */
+    struct AllocatorCounters
+    {
+        size_t allocation_count = 0;    /**< Allocations made since startup. */
+        size_t free_count = 0;          /**< Frees since startup, for arenas the number of resets. */
+        size_t bytes_in_use = 0;        /**< Bytes handed out and not yet returned. */
+        size_t peak_bytes_in_use = 0;
+        size_t bytes_reserved = 0;      /**< Bytes held from the system, pool pages, padded large blocks or arena blocks. */
+    };
+
+    /**
+     * @brief A snapshot of the allocator statistics
+     */
+    struct AllocatorStats
+    {
+        AllocatorCounters pool;
+        AllocatorCounters large;
+        AllocatorCounters arena;
+        size_t frame_index = 0;                 /**< Number of allocator_begin_frame calls. */
+        size_t frame_allocation_count = 0;      /**< Allocations of every kind made during the last completed frame. */
+        size_t frame_allocation_bytes = 0;
+        float pool_fragmentation = 0.f;         /**< Share of reserved pool bytes not in use. */
+    };
+
+    /**
+     * @brief Allocates size bytes, from a size class pool when small enough, otherwise from the large block allocator
+     *
+     * @note the same size and alignment must be passed to allocator_free
+     */
+    void* allocator_alloc(size_t size, size_t alignment = DZ_ALLOCATOR_DEFAULT_ALIGNMENT);
+
+    /**
+     * @brief Frees memory from allocator_alloc, size and alignment must match the allocation
+     */
+    void allocator_free(void* ptr, size_t size, size_t alignment = DZ_ALLOCATOR_DEFAULT_ALIGNMENT);
+
+    /**
+     * @brief Allocates an aligned block that records its own size, alignment must be a power of two
+     */
+    void* allocator_large_alloc(size_t size, size_t alignment = DZ_ALLOCATOR_LARGE_ALIGNMENT);
+
+    /**
+     * @brief Frees a block from allocator_large_alloc, nullptr is ignored
+     */
+    void allocator_large_free(void* ptr);
+
+    /**
+     * @brief returns the size requested for a block from allocator_large_alloc
+     */
+    size_t allocator_large_get_size(void* ptr);
+
+    /**
+     * @brief Marks the start of a frame, rolls the per frame counters and resets frame_arena_default
+     *
+     * @note called by windows_render, or window_render when rendering a single window
+     */
+    void allocator_begin_frame();
+
+    AllocatorStats allocator_get_stats();
+
+    /**
+     * @brief Creates a linear arena that grows in blocks of at least block_size bytes
+     *
+     * @note an arena is not thread-safe, use one per thread
+     */
+    FrameArena* frame_arena_create(size_t block_size = DZ_FRAME_ARENA_BLOCK_SIZE);
+
+    void frame_arena_free(FrameArena* arena);
+
+    /**
+     * @brief Bumps size bytes off the arena, the memory stays valid until the next frame_arena_reset
+     */
+    void* frame_arena_alloc(FrameArena* arena, size_t size, size_t alignment = DZ_ALLOCATOR_DEFAULT_ALIGNMENT);
+
+    /**
+     * @brief Releases everything allocated from the arena, a frame that spilled into several blocks is folded into one block
+     */
+    void frame_arena_reset(FrameArena* arena);
+
+    /**
+     * @brief returns the bytes allocated from the arena since its last reset
+     */
+    size_t frame_arena_get_used(FrameArena* arena);
+
+    /**
+     * @brief returns the main thread arena, it is reset at the start of every frame
+     */
+    FrameArena* frame_arena_default();
+
+    /**
+     * @brief Allocates count value initialized T from the arena, T must be trivially destructible as nothing is destroyed on reset
+     */
+    template<typename T>
+    T* frame_arena_alloc_array(FrameArena* arena, size_t count) {
+        static_assert(std::is_trivially_destructible_v<T>, "frame arena memory is released without running destructors");
+        auto ptr = (T*)frame_arena_alloc(arena, count * sizeof(T), (std::max)(alignof(T), size_t(DZ_ALLOCATOR_DEFAULT_ALIGNMENT)));
+        for (size_t i = 0; i < count; i++)
+            new (ptr + i) T();
+        return ptr;
+    }
+
+    /**
+     * @brief Standard allocator over allocator_alloc, for containers and shared_ptr control blocks
+     */
+    template<typename T>
+    struct PoolAllocator
+    {
+        using value_type = T;
+
+        PoolAllocator() = default;
+        template<typename U>
+        PoolAllocator(const PoolAllocator<U>&) {}
+
+        T* allocate(size_t count) {
+            return (T*)allocator_alloc(count * sizeof(T), (std::max)(alignof(T), size_t(DZ_ALLOCATOR_DEFAULT_ALIGNMENT)));
+        }
+        void deallocate(T* ptr, size_t count) {
+            allocator_free(ptr, count * sizeof(T), (std::max)(alignof(T), size_t(DZ_ALLOCATOR_DEFAULT_ALIGNMENT)));
+        }
+
+        template<typename U>
+        bool operator==(const PoolAllocator<U>&) const { return true; }
+        template<typename U>
+        bool operator!=(const PoolAllocator<U>&) const { return false; }
+    };
+
+    /**
+     * @brief Allocates byte_size bytes of CPU side storage owned by a shared_ptr, the control block comes from the pools too
+     */
+    template<typename T = uint8_t>
+    std::shared_ptr<T> allocator_make_shared_buffer(size_t byte_size, bool zeroed = true) {
+        auto ptr = allocator_alloc(byte_size);
+        if (zeroed)
+            memset(ptr, 0, byte_size);
+        return std::shared_ptr<T>((T*)ptr, [byte_size](T* p) { allocator_free((void*)p, byte_size); }, PoolAllocator<char>());
+    }
+}
@@ -5,6 +5,10 @@
 #pragma once
 #include "FileHandle.hpp"
 #include "size_ptr.hpp"
+#include <cstdint>
+#include <vector>
+
+#define DZ_ASSET_BLOCK_SIZE (256 * 1024)
 
 namespace dz
 {
@@ -15,6 +19,25 @@ namespace dz
      */
     using Asset = dz::size_ptr<char>;
 
+    /**
+     * @brief Codec applied to assets as they are added to a pack.
+     */
+    enum class AssetCompression : uint32_t
+    {
+        None = 0,   /**< Stored as is, mapped packs serve these without copying. */
+        Zlib = 1    /**< Split into independently deflated blocks. */
+    };
+
+    /**
+     * @brief Describes a stored asset without decoding it.
+     */
+    struct AssetInfo
+    {
+        std::string path;       /**< Path identifying the asset. */
+        uint64_t size;          /**< Uncompressed size of the source in bytes, without trailing bytes such as a null terminator. */
+        uint64_t content_hash;  /**< hash_bytes of those size bytes. */
+    };
+
     /**
      * @brief Creates an AssetPack using the provided file handle.
      * 
@@ -23,6 +46,17 @@ namespace dz
      */
     AssetPack* create_asset_pack(FileHandle& file_handle);
 
+    /**
+     * @brief Opens an existing pack read-only by memory mapping it, the index is built once here.
+     * 
+     * get_asset returns views directly into the mapping without copying, they remain valid until the pack is freed
+     * and must not be written to.
+     * 
+     * @param file_handle Reference to a PATH or ASSET file handle.
+     * @return Pointer to the opened AssetPack.
+     */
+    AssetPack* open_asset_pack(FileHandle& file_handle);
+
     /**
      * @brief Frees memory associated with the provided AssetPack.
      * 
@@ -35,7 +69,8 @@ namespace dz
      * 
      * @param asset_pack Pointer to the AssetPack.
      * @param path Path identifying the asset.
-     * @return Asset data as size_ptr<int8_t>.
+     * @param out Receives a copy of the asset, or a view into the mapping for packs opened with open_asset_pack.
+     * @return True if the asset was found.
      */
     bool get_asset(AssetPack* asset_pack, const std::string& path, Asset& out);
 
@@ -55,4 +90,92 @@ namespace dz
      * @param file_handle File handle to the asset source.
      */
     void add_asset(AssetPack* asset_pack, FileHandle& file_handle);
+
+    /**
+     * @brief Sets the codec used by subsequent add_asset calls.
+     * 
+     * Assets are split into block_size blocks that are compressed and decompressed in parallel on the default
+     * ThreadPool, and individually by get_asset_range. Assets that do not shrink are stored uncompressed.
+     * 
+     * @param asset_pack Pointer to the AssetPack.
+     * @param compression Codec for new assets.
+     * @param level Codec specific level, -1 selects the codec default.
+     * @param block_size Uncompressed bytes per independently compressed block.
+     */
+    void asset_pack_set_compression(AssetPack* asset_pack, AssetCompression compression, int level = -1, uint32_t block_size = DZ_ASSET_BLOCK_SIZE);
+
+    /**
+     * @brief Retrieves the uncompressed size of an asset without decoding it.
+     * 
+     * @return True if the asset was found.
+     */
+    bool get_asset_size(AssetPack* asset_pack, const std::string& path, size_t& out_size);
+
+    /**
+     * @brief Retrieves part of an asset, only the blocks overlapping the range are decompressed.
+     * 
+     * @param asset_pack Pointer to the AssetPack.
+     * @param path Path identifying the asset.
+     * @param offset First uncompressed byte to retrieve.
+     * @param size Number of bytes to retrieve, clamped to the end of the asset.
+     * @param out Receives the range, a view into the mapping for uncompressed assets in packs opened with open_asset_pack.
+     * @return True if the asset was found and offset lies within it.
+     */
+    bool get_asset_range(AssetPack* asset_pack, const std::string& path, size_t offset, size_t size, Asset& out);
+
+    /**
+     * @brief Reads a file into an Asset the way add_asset stores it, with a trailing null terminator.
+     */
+    Asset read_asset_file(FileHandle& file_handle);
+
+    /**
+     * @brief Encodes an asset into its stored form with the pack's current compression settings.
+     * 
+     * Safe to call concurrently for the same pack, the result is added with add_encoded_asset.
+     * 
+     * @param content_hash hash_bytes of the data without its trailing bytes, 0 computes it.
+     * @param trailing_size bytes at the end of data that are stored but are not part of the source, 1 for read_asset_file's terminator.
+     */
+    std::string encode_asset(AssetPack* asset_pack, const char* data, size_t size, uint64_t content_hash = 0, uint32_t trailing_size = 0);
+
+    /**
+     * @brief Encodes bytes into the stored form of a pack entry with explicit settings, for files that reuse the pack codec outside a pack.
+     *
+     * @note falls back to storing the bytes as is when compressing does not shrink them
+     */
+    std::string encode_asset_bytes(const char* data, size_t size, AssetCompression compression, int compression_level = -1, uint32_t block_size = DZ_ASSET_BLOCK_SIZE, uint64_t content_hash = 0, uint32_t trailing_size = 0);
+
+    /**
+     * @brief Decodes bytes produced by encode_asset_bytes or encode_asset into out.
+     *
+     * @return False if stored is not a valid entry or does not decode to exactly out_size bytes, throws on a corrupt block.
+     */
+    bool decode_asset_bytes(const char* stored, size_t stored_size, char* out, size_t out_size);
+
+    /**
+     * @brief Adds an asset previously produced by encode_asset.
+     */
+    void add_encoded_asset(AssetPack* asset_pack, const std::string& path, const std::string& encoded);
+
+    /**
+     * @brief Copies an asset's stored bytes from previous_pack without decoding if its content is unchanged.
+     * 
+     * @param content_hash hash_bytes of the current uncompressed asset.
+     * @return True if the entry was reused, false if it is missing, changed or was stored with different settings.
+     */
+    bool reuse_asset(AssetPack* asset_pack, AssetPack* previous_pack, const std::string& path, uint64_t content_hash);
+
+    /**
+     * @brief Checks whether reuse_asset would succeed without writing anything.
+     * 
+     * @note safe to call concurrently when previous_pack was opened with open_asset_pack
+     */
+    bool asset_is_reusable(AssetPack* asset_pack, AssetPack* previous_pack, const std::string& path, uint64_t content_hash);
+
+    /**
+     * @brief Lists every asset in the pack with its uncompressed size and content hash.
+     * 
+     * @note assets packed before content hashes were recorded are decoded and hashed here
+     */
+    std::vector<AssetInfo> get_asset_infos(AssetPack* asset_pack);
 }
\ No newline at end of file
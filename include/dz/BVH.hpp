@@ -0,0 +1,106 @@
+/**
+ * @file BVH.hpp
+ * @brief A dynamic bounding volume hierarchy for CPU side picking, culling and proximity queries
+ *
+ * Leaves hold a fat box (the real bounds grown by a margin) so small movements do not touch the tree,
+ * leaves that move out of their fat box are reinserted and the tree is rebalanced with rotations.
+ */
+#pragma once
+#include <cstddef>
+#include <functional>
+#include "math.hpp"
+
+#define DZ_BVH_NULL_NODE -1
+#define DZ_BVH_FAT_MARGIN 0.1f
+
+namespace dz
+{
+    struct BVH;
+
+    /**
+     * @brief Called for each leaf a query reaches with the leaf's user id, return false to stop the query
+     */
+    using BVHQueryCallback = std::function<bool(int user_id)>;
+
+    /**
+     * @brief Called for each leaf whose box the ray enters, with the entry distance of the box
+     *
+     * @return the exact hit distance, or a negative value if the ray misses what the leaf holds
+     */
+    using BVHRayCallback = std::function<float(int user_id, const Ray<float>& ray, float box_distance)>;
+
+    /**
+     * @brief Creates an empty BVH
+     *
+     * @param fat_margin amount the stored boxes are grown by on every side
+     */
+    BVH* bvh_create(float fat_margin = DZ_BVH_FAT_MARGIN);
+
+    /**
+     * @brief Frees the BVH
+     */
+    void bvh_free(BVH* bvh);
+
+    /**
+     * @brief Removes every proxy, keeping the allocated nodes
+     */
+    void bvh_clear(BVH* bvh);
+
+    /**
+     * @brief Inserts a leaf for bounds
+     *
+     * @returns the proxy id used to move or remove the leaf
+     */
+    int bvh_insert(BVH* bvh, const AABB<float, 3>& bounds, int user_id);
+
+    /**
+     * @brief Removes a leaf added with bvh_insert
+     */
+    void bvh_remove(BVH* bvh, int proxy);
+
+    /**
+     * @brief Updates the bounds of a leaf
+     *
+     * @returns true if the leaf left its fat box, or the fat box grew too loose, and was reinserted
+     */
+    bool bvh_move(BVH* bvh, int proxy, const AABB<float, 3>& bounds);
+
+    int bvh_get_user_id(BVH* bvh, int proxy);
+
+    /**
+     * @brief returns the fat box stored for a leaf
+     */
+    const AABB<float, 3>& bvh_get_fat_bounds(BVH* bvh, int proxy);
+
+    size_t bvh_get_proxy_count(BVH* bvh);
+
+    /**
+     * @brief returns the height of the tree, 0 when empty or holding a single leaf
+     */
+    int bvh_get_height(BVH* bvh);
+
+    /**
+     * @brief Reports every leaf whose fat box overlaps bounds
+     */
+    void bvh_query_aabb(BVH* bvh, const AABB<float, 3>& bounds, const BVHQueryCallback& callback);
+
+    /**
+     * @brief Reports every leaf whose fat box overlaps sphere
+     */
+    void bvh_query_sphere(BVH* bvh, const BoundingSphere<float>& sphere, const BVHQueryCallback& callback);
+
+    /**
+     * @brief Reports every leaf whose fat box may be inside frustum, subtrees fully inside are reported without further tests
+     */
+    void bvh_query_frustum(BVH* bvh, const Frustum<float>& frustum, const BVHQueryCallback& callback);
+
+    /**
+     * @brief Finds the closest leaf hit by ray, visiting nodes front to back and skipping those beyond the best hit so far
+     *
+     * @param t_max hits further than this are ignored
+     * @param out_distance receives the distance of the closest hit
+     * @param callback refines box hits into exact hits, when empty the box entry distance is used
+     * @returns the user id of the closest hit, or DZ_BVH_NULL_NODE
+     */
+    int bvh_raycast(BVH* bvh, const Ray<float>& ray, float t_max, float& out_distance, const BVHRayCallback& callback = {});
+}
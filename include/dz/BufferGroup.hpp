@@ -70,6 +70,17 @@ namespace dz
      */
     void buffer_group_set_buffer_element_count(BufferGroup* buffer_group, const std::string& buffer_name, uint32_t element_count);
 
+    /**
+     * @brief Sets the element counts of several named buffers at once, descriptor sets are updated once afterwards.
+     * 
+     * @param buffer_group Pointer to the BufferGroup.
+     * @param element_counts Buffer names paired with their new element counts.
+     * @param preserve_data Copy existing contents into resized buffers, pass false when they are about to be overwritten.
+     * 
+     * @note buffers already holding the requested count are left untouched
+     */
+    void buffer_group_set_buffer_element_counts(BufferGroup* buffer_group, const std::vector<std::pair<std::string, uint32_t>>& element_counts, bool preserve_data = true);
+
     /**
      * @brief Gets the number of elements in a named buffer.
      * 
@@ -102,4 +113,16 @@ namespace dz
      * @return Struct view object allowing reflection.
      */
     ReflectedStructView buffer_group_get_buffer_element_view(BufferGroup* buffer_group, const std::string& buffer_name, uint32_t index);
+
+    /**
+     * @brief Returns a view of every struct element in the named buffer.
+     *
+     * Resolve member handles or typed member views from it once and reuse them, per element access is then pointer arithmetic.
+     * The view is invalidated when the buffer's element count changes.
+     *
+     * @param buffer_group Pointer to the BufferGroup.
+     * @param buffer_name Name of the buffer.
+     * @return Buffer view object allowing reflection.
+     */
+    ReflectedBufferView buffer_group_get_buffer_view(BufferGroup* buffer_group, const std::string& buffer_name);
 }
\ No newline at end of file
@@ -8,6 +8,11 @@
 #include <array>
 #include <optional>
 #include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <functional>
 
 namespace dz {
     enum class D7Type : std::uint8_t
@@ -87,26 +92,118 @@ namespace dz {
     template<> constexpr size_t D7TypeToIndex<D7Type::u>() { return 5; }
     template<> constexpr size_t D7TypeToIndex<D7Type::a>() { return 6; }
 
+    using D7Slot = std::uint64_t;
+
+    /**
+    * @brief Slot value for "no point", returned by getCurrentSlot on an empty stream
+    */
+#define DZ_D7_INVALID_SLOT UINT64_MAX
+
+    /**
+    * @brief Removed points are kept as tombstones until at least this many have piled up
+    * and they make up half of the stored points, then the columns are compacted
+    */
+#define DZ_D7_COMPACT_MIN_DEAD 1024
+
+    /**
+    * @brief Number of points per block in a producer thread's pending queue
+    */
+#define DZ_D7_PENDING_BLOCK_SIZE 256
+
+    struct D7StreamProducer;
+
+    /**
+    * @brief Column (SoA) storage for a D7Stream, one entry per stored point in append order
+    *
+    * Removed points stay in the columns with alive = 0 until the stream compacts.
+    * slots is strictly increasing so a slot is found with a binary search.
+    */
+    struct D7StreamColumns {
+        std::vector<StreamScalar> xs;
+        std::vector<StreamScalar> ys;
+        std::vector<StreamScalar> zs;
+        std::vector<StreamTimestamp> timestamps;
+        std::vector<StreamIdentifier> Uids;
+        std::vector<StreamInteger> uids;
+        std::vector<std::uint32_t> action_ids;
+        std::vector<D7Slot> slots;
+        std::vector<std::uint8_t> alive;
+    };
+
     struct D7Stream {
 
-        std::vector<size_t*> stream_indexes;
-        std::vector<StreamPoint> stream_points;
+        D7Stream();
+        ~D7Stream();
+
+        D7StreamColumns columns;
+
+        /**
+        * @brief interned action strings, indexed by the ids stored in columns.action_ids
+        */
+        std::vector<StreamString> action_strings;
 
         /**
         * @brief adds a stream point to the History
+        *
+        * @returns a slot id that stays valid until the point is removed
+        */
+        D7Slot addStreamPoint(const StreamPoint& point);
+
+        /**
+        * @brief queues a stream point from any thread without blocking other producers
+        *
+        * Each thread appends to its own pending queue, only its first call on a stream takes a lock.
+        * Each thread caches the last stream it recorded into, and drops its queues of destroyed streams.
+        * Queued points are not part of the history until mergeRecordedPoints is called.
+        */
+        void recordStreamPoint(const StreamPoint& point);
+
+        /**
+        * @brief moves every queued point into the history in timestamp order
+        *
+        * Call from the thread that reads the stream (rewind, forward, find), typically once per frame.
+        * Points recorded while merging are picked up by the next merge.
+        *
+        * @returns the number of points merged
+        */
+        size_t mergeRecordedPoints();
+
+        /**
+        * @brief removes a streampoint from the history by its slot
+        * Has a O(log N) time complexity, removed points are compacted away in batches
+        */
+        bool removeStreamPoint(D7Slot slot);
+
+        /**
+        * @brief returns the stream point stored at slot, if it is still in the history
+        */
+        std::optional<StreamPoint> getStreamPoint(D7Slot slot) const;
+
+        /**
+        * @brief returns the slot the stream is currently positioned at, DZ_D7_INVALID_SLOT when empty
         */
-        size_t* addStreamPoint(const StreamPoint& point);
+        D7Slot getCurrentSlot() const;
 
         /**
-        * @brief removes a streampoint from the history at a specified index pointer
-        * Has a O(N-I) time complexity where N = stream_points.size & I = index
-        * ( this is due to updating the stream pointers )
+        * @brief returns the number of points in the history
         */
-        bool removeStreamPoint(size_t* index_ptr);
+        size_t size() const;
+
+        /**
+        * @brief returns the slots of every point matching the filter in history order
+        * Filtering by a, u or U reads the matching postings list instead of scanning the stream
+        */
+        std::vector<D7Slot> findStreamPoints(
+            D7Type filter = D7Type::Unset,
+            const StreamString& a_buff = "",
+            StreamInteger uid = 0,
+            StreamIdentifier Uid = 0
+        ) const;
 
         /**
         * @brief calling this function with just the first argument defined results in rewinding history in the stream at a global level
         * You can filter by D7Type, a_buff, uid & Uid
+        * The filtered search is a binary search into the postings list of the most selective key
         */
         bool rewindNPoints(
             size_t N = 1,
@@ -119,6 +216,7 @@ namespace dz {
         /**
         * @brief calling this function with just the first argument defined results in fastforwarding history in the stream at a global level
         * You can filter by D7Type, a_buff, uid & Uid
+        * The filtered search is a binary search into the postings list of the most selective key
         */
         bool forwardNPoints(
             size_t N = 1,
@@ -128,12 +226,137 @@ namespace dz {
             StreamIdentifier Uid = 0
         );
 
+        /**
+        * @brief drops removed points from the columns and postings lists
+        */
+        void compact();
+
         void printStreamPoints(D7Type filter = D7Type::Unset, const StreamString& a_buff = "", StreamInteger uid = 0, StreamIdentifier Uid = 0);
 
         D7Stream& operator << (const StreamPoint& point);
 
     private:
-        std::mutex stream_points_mutex;
-        size_t* current_point_index = 0;
+        struct PostingsQuery {
+            const std::vector<D7Slot>* postings = nullptr;
+            bool filter_a = false;
+            bool filter_u = false;
+            bool filter_U = false;
+            std::uint32_t action_id = 0;
+            StreamInteger uid = 0;
+            StreamIdentifier Uid = 0;
+            bool empty = false;
+        };
+
+        std::uint32_t internAction(const StreamString& action);
+        size_t findPosition(D7Slot slot) const;
+        bool isLive(D7Slot slot, size_t& position) const;
+        PostingsQuery makeQuery(D7Type filter, const StreamString& a_buff, StreamInteger uid, StreamIdentifier Uid) const;
+        bool matchesQuery(const PostingsQuery& query, size_t position) const;
+        D7Slot nextLiveSlot(size_t position) const;
+        D7Slot previousLiveSlot(size_t position) const;
+
+        std::unordered_map<StreamString, std::uint32_t> action_lookup;
+        std::vector<std::vector<D7Slot>> action_postings;
+        std::unordered_map<StreamInteger, std::vector<D7Slot>> uid_postings;
+        std::unordered_map<StreamIdentifier, std::vector<D7Slot>> Uid_postings;
+        size_t live_count = 0;
+        D7Slot first_live_slot = DZ_D7_INVALID_SLOT; // maintained on add, remove and compact so rewind and forward need no scan to find the ends
+        D7Slot last_live_slot = DZ_D7_INVALID_SLOT;
+        size_t dead_count = 0;
+        D7Slot next_slot = 0;
+        D7StreamProducer* getProducer();
+
+        std::uint64_t stream_id;
+        std::vector<std::shared_ptr<D7StreamProducer>> producers; // shared with each producer thread's cache
+        std::mutex producers_mutex;
+        D7Slot current_slot = DZ_D7_INVALID_SLOT;
     };
-}
+
+    struct D7Recording;
+    struct D7Playback;
+
+    /**
+    * @brief Number of points encoded into each segment of a recording file
+    */
+#define DZ_D7_SEGMENT_POINTS 4096
+
+    /**
+    * @brief A segment keeps a seek entry every this many points, so a time range query decodes at most this many extra points per block
+    */
+#define DZ_D7_SEEK_INTERVAL 256
+
+    /**
+    * @brief Creates a recording file at path, replacing any existing file
+    *
+    * Points are buffered and written out as self contained segments of DZ_D7_SEGMENT_POINTS points.
+    * Timestamps are delta encoded, ids are varints and action strings go through a per segment dictionary.
+    */
+    D7Recording* d7_recording_create(const std::string& path);
+
+    /**
+    * @brief Appends a point to the recording, writing a segment once enough points are buffered
+    */
+    void d7_recording_write(D7Recording* recording, const StreamPoint& point);
+
+    /**
+    * @brief Appends the points of stream with a slot at or after from_slot
+    *
+    * @returns the slot to pass next time to only write newer points
+    */
+    D7Slot d7_recording_write_stream(D7Recording* recording, const D7Stream& stream, D7Slot from_slot = 0);
+
+    /**
+    * @brief Writes the buffered points as a (possibly short) segment and flushes the file
+    */
+    void d7_recording_flush(D7Recording* recording);
+
+    /**
+    * @brief Flushes, writes the segment index and frees the D7Recording
+    *
+    * @note a file that was never closed can still be played back, its segments are found by walking their headers
+    */
+    void d7_recording_close(D7Recording* recording);
+
+    /**
+    * @brief Memory maps a recording file for playback
+    *
+    * Only the segment index is kept in memory, points are decoded from the mapping as they are queried.
+    */
+    D7Playback* d7_playback_open(const std::string& path);
+
+    /**
+    * @brief Unmaps and frees the D7Playback
+    */
+    void d7_playback_close(D7Playback* playback);
+
+    /**
+    * @brief returns the number of points in the recording
+    */
+    size_t d7_playback_get_point_count(D7Playback* playback);
+
+    /**
+    * @brief gets the earliest and latest timestamp in the recording, returns false if it is empty
+    */
+    bool d7_playback_get_time_range(D7Playback* playback, StreamTimestamp& first, StreamTimestamp& last);
+
+    /**
+    * @brief Calls callback for every point with begin <= timestamp < end, in recording order
+    *
+    * Segments and seek blocks outside the range are skipped without being decoded.
+    *
+    * @returns the number of points passed to callback
+    */
+    size_t d7_playback_query(
+        D7Playback* playback,
+        StreamTimestamp begin,
+        StreamTimestamp end,
+        const std::function<void(const StreamPoint&)>& callback
+    );
+
+    /**
+    * @brief Adds every point with begin <= timestamp < end to stream, for rewinding and filtering a window of a recording
+    *
+    * @returns the number of points added
+    */
+    size_t d7_playback_load(D7Playback* playback, StreamTimestamp begin, StreamTimestamp end, D7Stream& stream);
+}
\ No newline at end of file
@@ -142,13 +142,15 @@ namespace dz
                 auto visible_entity_indices = fn_get_visible_draws(buffer_group, camera_index);
                 auto visible_entity_indices_data = visible_entity_indices.data();
                 auto visible_entity_indices_size = visible_entity_indices.size();
+                if (!visible_entity_indices_size)
+                    continue;
+                auto draw_buffer_view = buffer_group_get_buffer_view(buffer_group, draw_key);
                 size_t vi = 0;
                 size_t i = 0;
                 for (; vi < visible_entity_indices_size;) {
                     i = visible_entity_indices_data[vi];
 
-                    auto element_view = buffer_group_get_buffer_element_view(buffer_group, draw_key, i);
-                    auto& element = element_view.template as_struct<DrawT>();
+                    auto& element = draw_buffer_view.element(i).template as_struct<DrawT>();
                     auto draw_tuple = fn_determine_DrawT_DrawTuple(buffer_group, element);
 
                     uint32_t run_start = static_cast<uint32_t>(i);
@@ -159,8 +161,7 @@ namespace dz
                     while (vj < visible_entity_indices_size)
                     {
                         j = visible_entity_indices_data[vj];
-                        auto next_element_view = buffer_group_get_buffer_element_view(buffer_group, draw_key, j);
-                        auto& next_element = next_element_view.template as_struct<DrawT>();
+                        auto& next_element = draw_buffer_view.element(j).template as_struct<DrawT>();
                         auto next_draw_tuple = fn_determine_DrawT_DrawTuple(buffer_group, next_element);
 
                         if (!drawTupleMatch(draw_tuple, next_draw_tuple))
@@ -23,6 +23,7 @@
 #include "ECS/HDRI.hpp"
 #include "ECS/SkyBox.hpp"
 #include "ImagePack.hpp"
+#include "BVH.hpp"
 #include <string>
 #include <vector>
 #include <functional>
@@ -33,6 +34,9 @@
 #include <mutex>
 #include <any>
 
+#define DZ_ECS_BUFFER_TOC_MARKER SIZE_MAX
+#define DZ_ECS_BUFFER_TOC_VERSION 1
+
 namespace dz {
 
     inline static std::string Cameras_Str = "Cameras";
@@ -137,6 +141,19 @@ namespace dz {
         std::map<int, RegisteredComponentEntry> registered_component_map; // !
         bool components_registered = false; // !
 
+        struct DeltaBufferBaseline {
+            std::vector<uint8_t> bytes;
+            uint32_t element_count = 0;
+            uint32_t element_size = 0;
+        };
+        struct DeltaGroupBaseline {
+            std::string name;
+            bool disabled = false;
+        };
+        std::map<std::string, DeltaBufferBaseline> delta_buffer_baselines; // !
+        std::unordered_map<size_t, DeltaGroupBaseline> delta_group_baselines; // !
+        bool delta_baseline_valid = false; // !
+
         using DrawProviderT = typename FirstMatchingOrDefault<IsDrawProvider, TProviders...>::type;
         using SubMeshProviderT = typename FirstMatchingOrDefault<IsSubMeshProvider, TProviders...>::type;
         using EntityProviderT = typename FirstMatchingOrDefault<IsEntityProvider, TProviders...>::type;
@@ -154,6 +171,11 @@ namespace dz {
         bool buffer_initialized = false; // !
         int buffer_size = 0; // !
         std::unordered_map<std::string, std::any> cpu_buffers; // Y
+
+        std::shared_ptr<BVH> entity_bvh; // !
+        std::vector<int> entity_bvh_proxies; // ! one proxy per entity index, DZ_BVH_NULL_NODE for entities without geometry
+        std::vector<AABB<float, 3>> entity_bounds; // ! world bounds per entity index as of the last UpdateEntityBounds
+        std::vector<AABB<float, 3>> mesh_local_bounds; // ! bounds of each mesh's positions, filled as meshes appear
         
         Shader* main_shader = nullptr; // !
         Shader* skybox_shader = nullptr; // !
@@ -575,19 +597,19 @@ namespace dz {
         bool RestoreBuffers(Serial& serial) {
             if (!buffer_group)
                 return false;
-            auto keys_size = buffer_keys.size();
+            size_t keys_size = 0;
             serial >> keys_size;
+            if (keys_size == DZ_ECS_BUFFER_TOC_MARKER)
+                return RestoreBuffersTOC(serial);
             for (size_t key_count = 1; key_count <= keys_size; ++key_count) {
                 std::string buffer_key;
                 serial >> buffer_key;
                 uint32_t element_count, element_size;
                 serial >> element_count >> element_size;
-                auto buffer_size = element_count * element_size;
+                auto buffer_size = size_t(element_count) * element_size;
                 auto r_key_it = std::find(buffer_keys.begin(), buffer_keys.end(), buffer_key);
                 if (r_key_it == buffer_keys.end()) {
-                    auto bytes = (char*)malloc(buffer_size);
-                    serial.readBytes((char*)bytes, buffer_size);
-                    free(bytes);
+                    state_skip_bytes(serial, buffer_size);
                     continue;
                 }
                 buffer_group_set_buffer_element_count(buffer_group, buffer_key, element_count);
@@ -595,23 +617,276 @@ namespace dz {
                 if (actual_element_size != element_size)
                     throw std::runtime_error("Incompatible buffer element sizes");
                 auto buffer_ptr = buffer_group_get_buffer_data_ptr(buffer_group, buffer_key);
-                serial.readBytes((char*)buffer_ptr.get(), buffer_size);
+                state_read_bytes(serial, buffer_ptr.get(), buffer_size);
+            }
+            return true;
+        }
+
+        /**
+        * @brief Restores buffers written with a table of contents, every buffer is sized in one step before its bytes are read in place
+        */
+        bool RestoreBuffersTOC(Serial& serial) {
+            uint32_t toc_version = 0;
+            size_t keys_size = 0;
+            serial >> toc_version >> keys_size;
+            if (toc_version != DZ_ECS_BUFFER_TOC_VERSION)
+                throw std::runtime_error("Unsupported ECS buffer table version");
+            struct BufferTOCEntry {
+                std::string key;
+                uint32_t element_count = 0;
+                uint32_t element_size = 0;
+                bool known = false;
+            };
+            std::vector<BufferTOCEntry> toc(keys_size);
+            std::vector<std::pair<std::string, uint32_t>> element_counts;
+            for (auto& entry : toc) {
+                serial >> entry.key >> entry.element_count >> entry.element_size;
+                entry.known = std::find(buffer_keys.begin(), buffer_keys.end(), entry.key) != buffer_keys.end();
+                if (!entry.known)
+                    continue;
+                if (buffer_group_get_buffer_element_size(buffer_group, entry.key) != entry.element_size)
+                    throw std::runtime_error("Incompatible buffer element sizes");
+                element_counts.push_back({entry.key, entry.element_count});
+            }
+            // contents are about to be overwritten, so resized buffers skip copying their old bytes
+            buffer_group_set_buffer_element_counts(buffer_group, element_counts, false);
+            for (auto& entry : toc) {
+                auto buffer_size = size_t(entry.element_count) * entry.element_size;
+                if (!entry.known) {
+                    state_skip_bytes(serial, buffer_size);
+                    continue;
+                }
+                auto buffer_ptr = buffer_group_get_buffer_data_ptr(buffer_group, entry.key);
+                state_read_bytes(serial, buffer_ptr.get(), buffer_size);
+            }
+            return true;
+        }
+
+        ReflectableGroup* FindGroupById(size_t id) {
+            for (auto& [pid, id_index_map] : pid_id_index_maps) {
+                auto index_it = id_index_map.find(id);
+                if (index_it == id_index_map.end())
+                    continue;
+                auto& vec = pid_reflectable_vecs[pid];
+                return index_it->second < vec.size() ? vec[index_it->second] : nullptr;
+            }
+            return nullptr;
+        }
+
+        void commit_delta_baseline() override {
+            std::lock_guard lock(e_mutex);
+            if (!buffer_group)
+                return;
+            delta_buffer_baselines.clear();
+            for (auto& buffer_key : buffer_keys) {
+                auto& baseline = delta_buffer_baselines[buffer_key];
+                baseline.element_count = buffer_group_get_buffer_element_count(buffer_group, buffer_key);
+                baseline.element_size = buffer_group_get_buffer_element_size(buffer_group, buffer_key);
+                auto buffer_ptr = buffer_group_get_buffer_data_ptr(buffer_group, buffer_key);
+                auto buffer_size = size_t(baseline.element_count) * baseline.element_size;
+                baseline.bytes.assign(buffer_ptr.get(), buffer_ptr.get() + buffer_size);
+            }
+            delta_group_baselines.clear();
+            for (auto& [pid, vec] : pid_reflectable_vecs)
+                for (auto group_ptr : vec)
+                    delta_group_baselines[group_ptr->id] = {group_ptr->GetName(), group_ptr->disabled};
+            delta_baseline_valid = true;
+        }
+
+        /**
+        * @brief Writes the element ranges and group properties changed since commit_delta_baseline
+        *
+        * @note buffers are described by the same table of contents BackupBuffers writes, followed by the changed runs of each
+        * @note returns false when groups were added or removed or a buffer was resized, those need a full backup
+        */
+        bool backup_delta(Serial& serial, bool reversible) override {
+            std::lock_guard lock(e_mutex);
+            if (!delta_baseline_valid || !buffer_group)
+                return false;
+            size_t group_count = 0;
+            for (auto& [pid, vec] : pid_reflectable_vecs) {
+                for (auto group_ptr : vec) {
+                    if (!delta_group_baselines.count(group_ptr->id))
+                        return false;
+                    group_count++;
+                }
+            }
+            if (group_count != delta_group_baselines.size())
+                return false;
+            for (auto& buffer_key : buffer_keys) {
+                auto& baseline = delta_buffer_baselines[buffer_key];
+                if (baseline.element_count != buffer_group_get_buffer_element_count(buffer_group, buffer_key) ||
+                    baseline.element_size != buffer_group_get_buffer_element_size(buffer_group, buffer_key))
+                    return false;
+            }
+
+            size_t toc_marker = DZ_ECS_BUFFER_TOC_MARKER;
+            uint32_t toc_version = DZ_ECS_BUFFER_TOC_VERSION;
+            auto keys_size = buffer_keys.size();
+            serial << toc_marker << toc_version << keys_size;
+            for (auto& buffer_key : buffer_keys) {
+                auto& baseline = delta_buffer_baselines[buffer_key];
+                serial << buffer_key << baseline.element_count << baseline.element_size;
+            }
+            for (auto& buffer_key : buffer_keys) {
+                auto& baseline = delta_buffer_baselines[buffer_key];
+                auto element_size = size_t(baseline.element_size);
+                auto current = buffer_group_get_buffer_data_ptr(buffer_group, buffer_key).get();
+                auto previous = baseline.bytes.data();
+                // runs of consecutive changed elements, the baseline is brought up to date as they are found
+                std::vector<std::pair<uint32_t, uint32_t>> runs;
+                for (uint32_t element = 0; element < baseline.element_count; element++) {
+                    auto offset = element * element_size;
+                    if (memcmp(current + offset, previous + offset, element_size) == 0)
+                        continue;
+                    if (!runs.empty() && runs.back().first + runs.back().second == element)
+                        runs.back().second++;
+                    else
+                        runs.push_back({element, 1});
+                }
+                auto runs_size = runs.size();
+                serial << runs_size;
+                for (auto& [first, count] : runs) {
+                    auto offset = first * element_size;
+                    auto size = count * element_size;
+                    serial << first << count;
+                    serial.writeBytes((const char*)current + offset, size);
+                    if (reversible)
+                        serial.writeBytes((const char*)previous + offset, size);
+                    memcpy(previous + offset, current + offset, size);
+                }
+            }
+
+            std::vector<ReflectableGroup*> changed_groups;
+            for (auto& [pid, vec] : pid_reflectable_vecs) {
+                for (auto group_ptr : vec) {
+                    auto& baseline = delta_group_baselines[group_ptr->id];
+                    if (baseline.name != group_ptr->GetName() || baseline.disabled != group_ptr->disabled)
+                        changed_groups.push_back(group_ptr);
+                }
+            }
+            auto changed_groups_size = changed_groups.size();
+            serial << changed_groups_size;
+            for (auto group_ptr : changed_groups) {
+                auto& baseline = delta_group_baselines[group_ptr->id];
+                serial << group_ptr->id << group_ptr->GetName() << group_ptr->disabled;
+                if (reversible)
+                    serial << baseline.name << baseline.disabled;
+                baseline = {group_ptr->GetName(), group_ptr->disabled};
+            }
+            return true;
+        }
+
+        /**
+        * @brief Applies a delta written by backup_delta, or undoes it when reverse is set and it was written reversible
+        *
+        * @note deltas written before the table of contents name each buffer ahead of its runs and are still accepted
+        */
+        bool restore_delta(Serial& serial, bool reversible, bool reverse) override {
+            std::lock_guard lock(e_mutex);
+            if (!buffer_group || (reverse && !reversible))
+                return false;
+            size_t keys_size = 0;
+            serial >> keys_size;
+            bool has_toc = keys_size == DZ_ECS_BUFFER_TOC_MARKER;
+            std::vector<std::string> toc_keys;
+            if (has_toc) {
+                uint32_t toc_version = 0;
+                serial >> toc_version >> keys_size;
+                if (toc_version != DZ_ECS_BUFFER_TOC_VERSION)
+                    throw std::runtime_error("Unsupported ECS buffer table version");
+                toc_keys.resize(keys_size);
+                for (auto& buffer_key : toc_keys) {
+                    uint32_t element_count = 0, element_size = 0;
+                    serial >> buffer_key >> element_count >> element_size;
+                    bool known_key = std::find(buffer_keys.begin(), buffer_keys.end(), buffer_key) != buffer_keys.end();
+                    if (!known_key || buffer_group_get_buffer_element_count(buffer_group, buffer_key) != element_count ||
+                        buffer_group_get_buffer_element_size(buffer_group, buffer_key) != element_size)
+                        throw std::runtime_error("State delta does not match buffer: " + buffer_key);
+                }
+            }
+            for (size_t key_index = 0; key_index < keys_size; ++key_index) {
+                std::string buffer_key;
+                size_t runs_size = 0;
+                if (has_toc)
+                    buffer_key = toc_keys[key_index];
+                else
+                    serial >> buffer_key;
+                serial >> runs_size;
+                bool known_key = std::find(buffer_keys.begin(), buffer_keys.end(), buffer_key) != buffer_keys.end();
+                auto element_count = known_key ? buffer_group_get_buffer_element_count(buffer_group, buffer_key) : 0;
+                auto element_size = known_key ? size_t(buffer_group_get_buffer_element_size(buffer_group, buffer_key)) : 0;
+                auto current = known_key ? buffer_group_get_buffer_data_ptr(buffer_group, buffer_key).get() : nullptr;
+                auto baseline_it = delta_buffer_baselines.find(buffer_key);
+                auto baseline = (delta_baseline_valid && baseline_it != delta_buffer_baselines.end() &&
+                    baseline_it->second.bytes.size() == element_count * element_size) ? baseline_it->second.bytes.data() : nullptr;
+                for (size_t run = 0; run < runs_size; run++) {
+                    uint32_t first = 0, count = 0;
+                    serial >> first >> count;
+                    if (!known_key || first + uint64_t(count) > element_count)
+                        throw std::runtime_error("State delta does not match buffer: " + buffer_key);
+                    auto offset = first * element_size;
+                    auto size = count * element_size;
+                    std::vector<char> skipped(reversible ? size : 0);
+                    if (reverse) {
+                        serial.readBytes(skipped.data(), size);
+                        serial.readBytes((char*)current + offset, size);
+                    }
+                    else {
+                        serial.readBytes((char*)current + offset, size);
+                        if (reversible)
+                            serial.readBytes(skipped.data(), size);
+                    }
+                    if (baseline)
+                        memcpy(baseline + offset, current + offset, size);
+                }
+            }
+            size_t changed_groups_size = 0;
+            serial >> changed_groups_size;
+            for (size_t group_count = 1; group_count <= changed_groups_size; ++group_count) {
+                size_t id = 0;
+                std::string name, previous_name;
+                bool disabled = false, previous_disabled = false;
+                serial >> id >> name >> disabled;
+                if (reversible)
+                    serial >> previous_name >> previous_disabled;
+                if (reverse) {
+                    name = previous_name;
+                    disabled = previous_disabled;
+                }
+                auto group_ptr = FindGroupById(id);
+                if (!group_ptr)
+                    throw std::runtime_error("State delta references a missing group");
+                group_ptr->disabled = disabled;
+                if (group_ptr->GetName() != name) {
+                    group_ptr->GetName() = name;
+                    group_ptr->NotifyNameChanged();
+                }
+                auto baseline_it = delta_group_baselines.find(id);
+                if (delta_baseline_valid && baseline_it != delta_group_baselines.end())
+                    baseline_it->second = {name, disabled};
             }
+            MarkDirty();
             return true;
         }
 
         bool BackupBuffers(Serial& serial) {
             if (!buffer_group)
                 return false;
+            size_t toc_marker = DZ_ECS_BUFFER_TOC_MARKER;
+            uint32_t toc_version = DZ_ECS_BUFFER_TOC_VERSION;
             auto keys_size = buffer_keys.size();
-            serial << keys_size;
+            serial << toc_marker << toc_version << keys_size;
+            for (auto& buffer_key : buffer_keys) {
+                auto element_count = buffer_group_get_buffer_element_count(buffer_group, buffer_key);
+                auto element_size = buffer_group_get_buffer_element_size(buffer_group, buffer_key);
+                serial << buffer_key << element_count << element_size;
+            }
             for (auto& buffer_key : buffer_keys) {
-                serial << buffer_key;
                 auto element_count = buffer_group_get_buffer_element_count(buffer_group, buffer_key);
                 auto element_size = buffer_group_get_buffer_element_size(buffer_group, buffer_key);
-                serial << element_count << element_size;
                 auto buffer_ptr = buffer_group_get_buffer_data_ptr(buffer_group, buffer_key);
-                serial.writeBytes((const char*)buffer_ptr.get(), element_count * element_size);
+                state_write_bytes(serial, buffer_ptr.get(), size_t(element_count) * element_size);
             }
             return true;
         }
@@ -758,8 +1033,10 @@ namespace dz {
 
             constexpr auto pid = TProvider::GetPID();
 
-            auto ecs_id = GlobalUID::GetNew("ECS:GID");
-            auto pro_id = GlobalUID::GetNew(("ECS:PID:" + std::to_string(pid)));
+            static const auto ecs_key = GlobalUID::GetKey("ECS:GID");
+            static const auto pro_key = GlobalUID::GetKey("ECS:PID:" + std::to_string(pid));
+            auto ecs_id = GlobalUID::GetNew(ecs_key);
+            auto pro_id = GlobalUID::GetNew(pro_key);
 
             std::lock_guard lock(e_mutex);
 
@@ -1021,6 +1298,86 @@ namespace dz {
             return mesh_id;
         }
 
+        /**
+        * @brief Adds many meshes at once, growing each vertex buffer a single time for the whole batch
+        *
+        * @note each element of meshes must provide name, material_index, positions, uv2s, normals, tangents and bitangents
+        * @returns the mesh ids, out_indexes receives the matching mesh indexes
+        */
+        template<typename TMeshes, typename... Args>
+        std::vector<int> AddMeshes(const TMeshes& meshes, std::vector<int>& out_indexes, const Args&... args) {
+            auto position_count = buffer_group_get_buffer_element_count(buffer_group, VertexPositions_Str);
+            auto uv2_count = buffer_group_get_buffer_element_count(buffer_group, VertexUV2s_Str);
+            auto normal_count = buffer_group_get_buffer_element_count(buffer_group, VertexNormals_Str);
+            auto tangent_count = buffer_group_get_buffer_element_count(buffer_group, VertexTangents_Str);
+            auto bitangent_count = buffer_group_get_buffer_element_count(buffer_group, VertexBitangents_Str);
+
+            std::vector<int> mesh_ids;
+            std::vector<MeshProviderT> mesh_datas;
+            mesh_ids.reserve(meshes.size());
+            mesh_datas.reserve(meshes.size());
+            out_indexes.clear();
+            out_indexes.reserve(meshes.size());
+
+            for (auto& mesh : meshes) {
+                MeshProviderT mesh_data;
+                if (!mesh.positions.empty()) {
+                    mesh_data.vertex_count = mesh.positions.size();
+                    mesh_data.position_offset = position_count;
+                    position_count += mesh.positions.size();
+                }
+                if (!mesh.uv2s.empty()) {
+                    mesh_data.uv2_offset = uv2_count;
+                    uv2_count += mesh.uv2s.size();
+                }
+                if (!mesh.normals.empty()) {
+                    mesh_data.normal_offset = normal_count;
+                    normal_count += mesh.normals.size();
+                }
+                if (!mesh.tangents.empty()) {
+                    mesh_data.tangent_offset = tangent_count;
+                    tangent_count += mesh.tangents.size();
+                }
+                if (!mesh.bitangents.empty()) {
+                    mesh_data.bitangent_offset = bitangent_count;
+                    bitangent_count += mesh.bitangents.size();
+                }
+
+                int out_index = -1;
+                auto mesh_id = AddProvider<MeshProviderT>(-1, mesh_data, mesh_group_vector, out_index, mesh.name, args...);
+                auto& mesh_group = GetGroupByID<MeshProviderT, typename MeshProviderT::ReflectableGroup>(mesh_id);
+                mesh_group.material_index = mesh.material_index;
+
+                mesh_ids.push_back(mesh_id);
+                mesh_datas.push_back(mesh_data);
+                out_indexes.push_back(out_index);
+            }
+
+            auto copy_stream = [&](const std::string& buffer_name, uint32_t element_count, auto offset_member, auto stream_member) {
+                if (element_count == buffer_group_get_buffer_element_count(buffer_group, buffer_name))
+                    return;
+                buffer_group_set_buffer_element_count(buffer_group, buffer_name, element_count);
+                auto data_sh_ptr = buffer_group_get_buffer_data_ptr(buffer_group, buffer_name);
+                for (size_t i = 0; i < mesh_datas.size(); i++) {
+                    auto offset = mesh_datas[i].*offset_member;
+                    if (offset == -1)
+                        continue;
+                    auto& stream = meshes[i].*stream_member;
+                    using TElement = typename std::decay_t<decltype(stream)>::value_type;
+                    memcpy((void*)&((TElement*)data_sh_ptr.get())[offset], stream.data(), stream.size() * sizeof(TElement));
+                }
+            };
+
+            using TMesh = std::decay_t<decltype(*std::begin(meshes))>;
+            copy_stream(VertexPositions_Str, position_count, &MeshProviderT::position_offset, &TMesh::positions);
+            copy_stream(VertexUV2s_Str, uv2_count, &MeshProviderT::uv2_offset, &TMesh::uv2s);
+            copy_stream(VertexNormals_Str, normal_count, &MeshProviderT::normal_offset, &TMesh::normals);
+            copy_stream(VertexTangents_Str, tangent_count, &MeshProviderT::tangent_offset, &TMesh::tangents);
+            copy_stream(VertexBitangents_Str, bitangent_count, &MeshProviderT::bitangent_offset, &TMesh::bitangents);
+
+            return mesh_ids;
+        }
+
         template <typename TLight, typename... Args>
         int AddLight(int parent_id, const TLight& light_data, const std::string& name, const Args&... args) {
             auto parent_group_ptr = FindParentGroupPtr(parent_id);
@@ -1994,6 +2351,202 @@ void main() {
             return true;
         }
 
+        /**
+        * @brief Recomputes entity world bounds from the model matrices written by the model compute shader and refits entity_bvh
+        *
+        * The Entitys buffer is host visible so this reads the matrices in place, call it once the frame that ran
+        * the model compute shader has finished. Entities without submeshes are left out of the tree.
+        */
+        void UpdateEntityBounds() {
+            std::lock_guard lock(e_mutex);
+            if (!entity_bvh)
+                entity_bvh = std::shared_ptr<BVH>(bvh_create(), bvh_free);
+
+            auto& mesh_groups = pid_reflectable_vecs[MeshProviderT::GetPID()];
+            if (mesh_local_bounds.size() < mesh_groups.size()) {
+                auto meshes = GetProviderData<MeshProviderT>(MeshProviderT::GetStructName() + "s");
+                auto positions = GetProviderData<vec<float, 4>>(VertexPositions_Str);
+                for (auto mesh_index = mesh_local_bounds.size(); mesh_index < mesh_groups.size(); mesh_index++) {
+                    auto& mesh = meshes[mesh_index];
+                    if (mesh.position_offset == -1 || !positions)
+                        mesh_local_bounds.push_back(AABB<float, 3>::empty());
+                    else
+                        mesh_local_bounds.push_back(aabb_from_positions(positions + mesh.position_offset, mesh.vertex_count));
+                }
+            }
+
+            auto& entity_groups = pid_reflectable_vecs[EntityProviderT::GetPID()];
+            auto entity_count = entity_groups.size();
+            for (auto entity_index = entity_count; entity_index < entity_bvh_proxies.size(); entity_index++)
+                if (entity_bvh_proxies[entity_index] != DZ_BVH_NULL_NODE)
+                    bvh_remove(entity_bvh.get(), entity_bvh_proxies[entity_index]);
+            entity_bvh_proxies.resize(entity_count, DZ_BVH_NULL_NODE);
+            entity_bounds.resize(entity_count, AABB<float, 3>::empty());
+            if (!entity_count)
+                return;
+
+            auto entities = GetProviderData<EntityProviderT>(EntityProviderT::GetStructName() + "s");
+            auto submeshes = GetProviderData<SubMeshProviderT>(SubMeshProviderT::GetStructName() + "s");
+            for (size_t entity_index = 0; entity_index < entity_count; entity_index++) {
+                auto local_bounds = AABB<float, 3>::empty();
+                auto e_group_ptr = dynamic_cast<EntityProviderT::ReflectableGroup*>(entity_groups[entity_index]);
+                if (e_group_ptr) {
+                    for (auto& child_sh_ptr : e_group_ptr->reflectable_children) {
+                        if (child_sh_ptr->cid != SubMeshProviderT::PID)
+                            continue;
+                        auto mesh_index = submeshes[child_sh_ptr->index].mesh_index;
+                        if (mesh_index >= 0 && mesh_index < int(mesh_local_bounds.size()) && !mesh_local_bounds[mesh_index].is_empty())
+                            local_bounds.merge(mesh_local_bounds[mesh_index]);
+                    }
+                }
+
+                auto& proxy = entity_bvh_proxies[entity_index];
+                auto& bounds = entity_bounds[entity_index];
+                if (local_bounds.is_empty()) {
+                    if (proxy != DZ_BVH_NULL_NODE)
+                        bvh_remove(entity_bvh.get(), proxy);
+                    proxy = DZ_BVH_NULL_NODE;
+                    bounds = local_bounds;
+                    continue;
+                }
+
+                bounds = transform_aabb(entities[entity_index].model, local_bounds);
+                if (proxy == DZ_BVH_NULL_NODE)
+                    proxy = bvh_insert(entity_bvh.get(), bounds, int(entity_index));
+                else
+                    bvh_move(entity_bvh.get(), proxy, bounds);
+            }
+        }
+
+        /**
+        * @brief Returns an entity's world bounds as of the last UpdateEntityBounds, empty if it has no geometry
+        */
+        AABB<float, 3> GetEntityBounds(size_t entity_id) {
+            std::lock_guard lock(e_mutex);
+            auto& entity_group = GetGroupByID<EntityProviderT, typename EntityProviderT::ReflectableGroup>(entity_id);
+            if (entity_group.index < 0 || entity_group.index >= int(entity_bounds.size()))
+                return AABB<float, 3>::empty();
+            return entity_bounds[entity_group.index];
+        }
+
+        /**
+        * @brief Returns the id of the entity whose triangles ray hits first, or -1
+        *
+        * Uses the bounds from the last UpdateEntityBounds, so no GPU readback is needed to pick.
+        */
+        int PickEntity(const Ray<float>& ray, float& out_distance, float max_distance = std::numeric_limits<float>::max()) {
+            std::lock_guard lock(e_mutex);
+            if (!entity_bvh)
+                return -1;
+            auto entities = GetProviderData<EntityProviderT>(EntityProviderT::GetStructName() + "s");
+            auto submeshes = GetProviderData<SubMeshProviderT>(SubMeshProviderT::GetStructName() + "s");
+            auto meshes = GetProviderData<MeshProviderT>(MeshProviderT::GetStructName() + "s");
+            auto positions = GetProviderData<vec<float, 4>>(VertexPositions_Str);
+            auto& entity_groups = pid_reflectable_vecs[EntityProviderT::GetPID()];
+
+            auto hit_triangles = [&](int entity_index, const Ray<float>& world_ray, float box_distance) -> float {
+                float limit;
+                if (!ray_intersects_aabb(world_ray, entity_bounds[entity_index], max_distance, limit))
+                    return -1.f;
+                // an affine transform keeps the ray parameter, so local hit distances are world hit distances
+                auto inverse_model = entities[entity_index].model.inverse();
+                vec<float, 3> local_origin = world_ray.origin;
+                vec<float, 4> local_direction(world_ray.direction[0], world_ray.direction[1], world_ray.direction[2], 0.f);
+                transform_points(inverse_model, &local_origin, &local_origin, 1);
+                transform_vectors(inverse_model, &local_direction, &local_direction, 1);
+                Ray<float> local_ray(local_origin, vec<float, 3>(local_direction[0], local_direction[1], local_direction[2]));
+
+                auto closest = -1.f;
+                limit = max_distance;
+                auto e_group_ptr = dynamic_cast<EntityProviderT::ReflectableGroup*>(entity_groups[entity_index]);
+                if (!e_group_ptr)
+                    return closest;
+                for (auto& child_sh_ptr : e_group_ptr->reflectable_children) {
+                    if (child_sh_ptr->cid != SubMeshProviderT::PID)
+                        continue;
+                    auto mesh_index = submeshes[child_sh_ptr->index].mesh_index;
+                    if (mesh_index < 0)
+                        continue;
+                    auto& mesh = meshes[mesh_index];
+                    if (mesh.position_offset == -1)
+                        continue;
+                    auto mesh_positions = positions + mesh.position_offset;
+                    for (int vertex = 0; vertex + 2 < mesh.vertex_count; vertex += 3) {
+                        auto& p0 = mesh_positions[vertex];
+                        auto& p1 = mesh_positions[vertex + 1];
+                        auto& p2 = mesh_positions[vertex + 2];
+                        float t;
+                        if (ray_intersects_triangle(local_ray,
+                            vec<float, 3>(p0[0], p0[1], p0[2]),
+                            vec<float, 3>(p1[0], p1[1], p1[2]),
+                            vec<float, 3>(p2[0], p2[1], p2[2]),
+                            limit, t)) {
+                            closest = t;
+                            limit = t;
+                        }
+                    }
+                }
+                return closest;
+            };
+
+            auto entity_index = bvh_raycast(entity_bvh.get(), ray, max_distance, out_distance, hit_triangles);
+            if (entity_index == DZ_BVH_NULL_NODE)
+                return -1;
+            return entity_groups[entity_index]->id;
+        }
+
+        /**
+        * @brief Picks the entity under a point of a camera's view given in normalized device coordinates
+        */
+        int PickEntity(size_t camera_id, float ndc_x, float ndc_y, float& out_distance) {
+            auto& camera = GetCamera(camera_id);
+            auto inverse_view_projection = (camera.projection * camera.view).inverse();
+            return PickEntity(ray_from_ndc(inverse_view_projection, ndc_x, ndc_y), out_distance);
+        }
+
+        /**
+        * @brief Returns the ids of the entities whose bounds may be inside frustum
+        */
+        std::vector<int> CullEntities(const Frustum<float>& frustum) {
+            std::lock_guard lock(e_mutex);
+            std::vector<int> visible;
+            if (!entity_bvh)
+                return visible;
+            auto& entity_groups = pid_reflectable_vecs[EntityProviderT::GetPID()];
+            bvh_query_frustum(entity_bvh.get(), frustum, [&](int entity_index) {
+                if (frustum.intersects(entity_bounds[entity_index]))
+                    visible.push_back(entity_groups[entity_index]->id);
+                return true;
+            });
+            return visible;
+        }
+
+        /**
+        * @brief Returns the ids of the entities whose bounds may be inside a camera's view
+        */
+        std::vector<int> CullEntities(size_t camera_id) {
+            auto& camera = GetCamera(camera_id);
+            return CullEntities(frustum_from_matrix(camera.projection * camera.view));
+        }
+
+        /**
+        * @brief Returns the ids of the entities whose bounds come within radius of center
+        */
+        std::vector<int> QueryEntitiesNear(const vec<float, 3>& center, float radius) {
+            std::lock_guard lock(e_mutex);
+            std::vector<int> nearby;
+            if (!entity_bvh)
+                return nearby;
+            auto& entity_groups = pid_reflectable_vecs[EntityProviderT::GetPID()];
+            BoundingSphere<float> sphere(center, radius);
+            bvh_query_sphere(entity_bvh.get(), sphere, [&](int entity_index) {
+                if (sphere.intersects(entity_bounds[entity_index]))
+                    nearby.push_back(entity_groups[entity_index]->id);
+                return true;
+            });
+            return nearby;
+        }
+
         void MarkDirty() {
             draw_mg.MarkDirty();
             skybox_mg.MarkDirty();
@@ -6,14 +6,55 @@
 #include "../Image.hpp"
 #include "../Loaders/STB_Image_Loader.hpp"
 
+#define DZ_HDRI_IRRADIANCE_DIVISOR 32
+#define DZ_HDRI_RADIANCE_OCTAHEDRAL_SIZE 512
+
 namespace dz::ecs {
 
     void set_radiance_control_block(Shader*, void*);
     struct RadianceControlBlock {
         float roughness;
         int mip;
+        int octahedral;
     };
 
+    struct HDRI;
+
+    /**
+     * @brief Sets the directory prefiltered irradiance and radiance images are cached in, an empty path disables the cache
+     *
+     * @note defaults to a DirectZ/ibl directory under the program data path
+     */
+    void hdri_set_ibl_cache_directory(const std::filesystem::path& directory);
+
+    /**
+     * @brief Computes the cache key of an HDRI's image based lighting from its source bytes and generation parameters
+     *
+     * @returns 0 if the source could not be read, which disables caching for it
+     */
+    uint64_t hdri_get_ibl_cache_key(const dz::loaders::STB_Image_Info& info, const HDRI& hdri, uint32_t radiance_mip_levels);
+
+    /**
+     * @brief Looks up a cached irradiance and radiance for key, on a hit the datas of both create infos point into the mapped cache file
+     *
+     * @param irradiance_info may be nullptr when the irradiance is not stored as an image
+     */
+    bool hdri_load_ibl_cache(uint64_t key, ImageCreateInfo* irradiance_info, ImageCreateInfo& radiance_info);
+
+    /**
+     * @brief Queues readbacks of generated irradiance and radiance images and writes them to the cache in the background once complete
+     *
+     * @param irradiance_image may be nullptr when the irradiance is not stored as an image
+     */
+    void hdri_store_ibl_cache(uint64_t key, Image* irradiance_image, Image* radiance_image);
+
+    /**
+     * @brief Projects the cosine convolved irradiance of an equirectangular image onto the first 9 spherical harmonics
+     *
+     * @note out_coefficients are stored rgb in xyz, ordered L00, L1-1, L10, L11, L2-2, L2-1, L20, L21, L22
+     */
+    void hdri_project_irradiance_sh(const ImageCreateInfo& info, vec<float, 4>* out_coefficients);
+
     struct HDRIIndexReflectable {
         int hdri_index = 0;
     };
@@ -22,6 +63,28 @@ namespace dz::ecs {
         vec<float, 4> hdri_atlas_pack = {-1.0f, -1.0f, -1.0f, -1.0f};
         vec<float, 4> irradiance_atlas_pack = {-1.0f, -1.0f, -1.0f, -1.0f};
         vec<float, 4> radiance_atlas_pack = {-1.0f, -1.0f, -1.0f, -1.0f};
+        vec<float, 4> irradiance_sh[9];
+        int irradiance_mode = IrradianceEquirect;
+        int radiance_mode = RadianceEquirect;
+        int padding1 = 0;
+        int padding2 = 0;
+
+        /**
+         * @brief irradiance is baked into an equirectangular image sampled through the IrradianceAtlas
+         */
+        inline static constexpr int IrradianceEquirect = 0;
+        /**
+         * @brief irradiance is projected onto 9 spherical harmonics coefficients stored in irradiance_sh, no image is generated
+         */
+        inline static constexpr int IrradianceSH = 1;
+        /**
+         * @brief radiance is prefiltered into an equirectangular image the size of the source HDRI
+         */
+        inline static constexpr int RadianceEquirect = 0;
+        /**
+         * @brief radiance is prefiltered into a DZ_HDRI_RADIANCE_OCTAHEDRAL_SIZE square octahedral map, uniform texel density with no polar seams
+         */
+        inline static constexpr int RadianceOctahedral = 1;
 
         inline static constexpr size_t PID = 11;
         inline static float Priority = 2.6f;
@@ -34,6 +97,11 @@ struct HDRI {
     vec4 hdri_atlas_pack;
     vec4 irradiance_atlas_pack;
     vec4 radiance_atlas_pack;
+    vec4 irradiance_sh[9];
+    int irradiance_mode;
+    int radiance_mode;
+    int padding1;
+    int padding2;
 };
 )";
         inline static std::unordered_map<ShaderModuleType, std::string> GLSLMethods = {
@@ -47,6 +115,26 @@ vec2 SampleSphericalMap(vec3 v) {
     uv += 0.5;
     return uv;
 }
+vec2 OctahedralEncode(vec3 v) {
+    vec3 n = v / (abs(v.x) + abs(v.y) + abs(v.z));
+    vec2 p = n.xy;
+    if (n.z < 0.0)
+        p = (1.0 - abs(p.yx)) * vec2(p.x >= 0.0 ? 1.0 : -1.0, p.y >= 0.0 ? 1.0 : -1.0);
+    return p * 0.5 + 0.5;
+}
+vec3 EvaluateIrradianceSH(in int hdri_index, vec3 n) {
+    vec4 sh[9] = HDRIs.data[hdri_index].irradiance_sh;
+    vec3 E = sh[0].rgb * 0.282095
+        + sh[1].rgb * 0.488603 * n.y
+        + sh[2].rgb * 0.488603 * n.z
+        + sh[3].rgb * 0.488603 * n.x
+        + sh[4].rgb * 1.092548 * n.x * n.y
+        + sh[5].rgb * 1.092548 * n.y * n.z
+        + sh[6].rgb * 0.315392 * (3.0 * n.z * n.z - 1.0)
+        + sh[7].rgb * 1.092548 * n.x * n.z
+        + sh[8].rgb * 0.546274 * (n.x * n.x - n.y * n.y);
+    return max(E, vec3(0.0));
+}
 vec4 SampleHDRI(in int hdri_index, in vec3 v) {
     vec2 image_size = HDRIs.data[hdri_index].hdri_atlas_pack.xy;
     if (image_size.x == -1.0)
@@ -55,6 +143,8 @@ vec4 SampleHDRI(in int hdri_index, in vec3 v) {
     return SampleAtlas(SampleSphericalMap(v), image_size, packed_rect, HDRIAtlas);
 }
 vec4 SampleIrradiance(in int hdri_index, in vec3 v) {
+    if (HDRIs.data[hdri_index].irradiance_mode == 1)
+        return vec4(EvaluateIrradianceSH(hdri_index, normalize(v)), 1.0);
     vec2 image_size = HDRIs.data[hdri_index].irradiance_atlas_pack.xy;
     if (image_size.x == -1.0)
         return vec4(0.0);
@@ -66,7 +156,8 @@ vec4 SampleRadiance(in int hdri_index, in vec3 v, float lod) {
     if (image_size.x == -1.0)
         return vec4(0.0);
     vec2 packed_rect = HDRIs.data[hdri_index].radiance_atlas_pack.zw;
-    return SampleAtlasLOD(SampleSphericalMap(v), image_size, packed_rect, RadianceAtlas, lod);
+    vec2 uv = HDRIs.data[hdri_index].radiance_mode == 1 ? OctahedralEncode(v) : SampleSphericalMap(v);
+    return SampleAtlasLOD(uv, image_size, packed_rect, RadianceAtlas, lod);
 }
 )" }
         };
@@ -202,7 +293,18 @@ layout(binding = @BINDING@) uniform sampler2D RadianceAtlas;
             void Initialize(TECS& ecs, HDRI& hdri, const dz::loaders::STB_Image_Info& hdri_image_info) {
                 hdri_path = hdri_image_info.path;
 
-                hdri_image = dz::loaders::STB_Image_Loader::Load(hdri_image_info);
+                bool sh_irradiance = hdri.irradiance_mode == HDRI::IrradianceSH;
+                bool octahedral_radiance = hdri.radiance_mode == HDRI::RadianceOctahedral;
+
+                if (sh_irradiance) {
+                    // the decoded pixels are needed on the CPU for the projection before they are uploaded
+                    auto hdri_create_info = dz::loaders::STB_Image_Loader::GetCreateInfo(
+                        dz::loaders::STB_Image_Loader::LoadAsync(hdri_image_info));
+                    hdri_project_irradiance_sh(hdri_create_info, hdri.irradiance_sh);
+                    hdri_image = image_create(hdri_create_info);
+                }
+                else
+                    hdri_image = dz::loaders::STB_Image_Loader::Load(hdri_image_info);
 
                 hdri_frame_image_ds = image_create_descriptor_set(hdri_image).second;
                 ecs.hdri_atlas_pack.addImage(hdri_image);
@@ -210,42 +312,56 @@ layout(binding = @BINDING@) uniform sampler2D RadianceAtlas;
                 auto hdri_width = image_get_width(hdri_image);
                 auto hdri_height = image_get_height(hdri_image);
 
-                // Setup irradiance image
-                irradiance_image = image_create({
-                    .width = hdri_width / 32,
-                    .height = hdri_height / 32,
+                // Setup irradiance and radiance images
+                uint32_t radiance_width = octahedral_radiance ? DZ_HDRI_RADIANCE_OCTAHEDRAL_SIZE : hdri_width;
+                uint32_t radiance_height = octahedral_radiance ? DZ_HDRI_RADIANCE_OCTAHEDRAL_SIZE : hdri_height;
+                uint32_t mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(radiance_width, radiance_height)))) + 1;
+                ImageCreateInfo irradiance_info{
+                    .width = hdri_width / DZ_HDRI_IRRADIANCE_DIVISOR,
+                    .height = hdri_height / DZ_HDRI_IRRADIANCE_DIVISOR,
                     .format = VK_FORMAT_R16G16B16A16_SFLOAT,
                     .usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT
-                });
-                // ds and atlas
-                irradiance_frame_image_ds = image_create_descriptor_set(irradiance_image).second;
-                ecs.irradiance_atlas_pack.addImage(irradiance_image);
-
-                // generate irradiance
-                auto irradianceGenerationShader = GetIrradianceGenerationShader(ecs);
-                transition_image_layout(irradiance_image, VK_IMAGE_LAYOUT_GENERAL);
-                shader_dispatch(
-                    irradianceGenerationShader,
-                    ceil(image_get_width(irradiance_image) / 8),
-                    ceil(image_get_height(irradiance_image) / 8),
-                    1
-                );
-                transition_image_layout(irradiance_image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-
-                // Setup radiance image
-                uint32_t mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(hdri_width, hdri_height)))) + 1;
-                radiance_image = image_create({
-                    .width = hdri_width,
-                    .height = hdri_height,
+                };
+                ImageCreateInfo radiance_info{
+                    .width = radiance_width,
+                    .height = radiance_height,
                     .format = VK_FORMAT_R16G16B16A16_SFLOAT,
                     .usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
                     .mip_levels = mipLevels
-                });
+                };
+
+                // identical sources with identical parameters reuse the previously generated results
+                auto ibl_cache_key = hdri_get_ibl_cache_key(hdri_image_info, hdri, mipLevels);
+                bool ibl_cached = ibl_cache_key && hdri_load_ibl_cache(ibl_cache_key, sh_irradiance ? nullptr : &irradiance_info, radiance_info);
+
+                if (!sh_irradiance) {
+                    irradiance_image = image_create(irradiance_info);
+                    // ds and atlas
+                    irradiance_frame_image_ds = image_create_descriptor_set(irradiance_image).second;
+                    ecs.irradiance_atlas_pack.addImage(irradiance_image);
+                }
+
+                radiance_image = image_create(radiance_info);
                 // ds and atlas
                 radiance_frame_image_ds = image_create_descriptor_set(radiance_image).second;
                 ecs.radiance_atlas_pack.addImage(radiance_image);
 
+                if (ibl_cached)
+                    return;
+
+                // generate irradiance
+                if (!sh_irradiance) {
+                    auto irradianceGenerationShader = GetIrradianceGenerationShader(ecs);
+                    transition_image_layout(irradiance_image, VK_IMAGE_LAYOUT_GENERAL);
+                    shader_dispatch(
+                        irradianceGenerationShader,
+                        ceil(image_get_width(irradiance_image) / 8),
+                        ceil(image_get_height(irradiance_image) / 8),
+                        1
+                    );
+                    transition_image_layout(irradiance_image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+                }
+
                 static RadianceControlBlock controlBlock;
                 
                 // generate radiance
@@ -253,11 +369,12 @@ layout(binding = @BINDING@) uniform sampler2D RadianceAtlas;
                 for (uint32_t mip = 0; mip < mipLevels; ++mip)
                 {
                     transition_image_layout(radiance_image, VK_IMAGE_LAYOUT_GENERAL, mip);
-                    uint32_t mipWidth = (std::max)(1u, hdri_width >> mip);
-                    uint32_t mipHeight = (std::max)(1u, hdri_height >> mip);
+                    uint32_t mipWidth = (std::max)(1u, radiance_width >> mip);
+                    uint32_t mipHeight = (std::max)(1u, radiance_height >> mip);
 
                     controlBlock.roughness = float(mip) / float(mipLevels - 1);
                     controlBlock.mip = mip;
+                    controlBlock.octahedral = octahedral_radiance ? 1 : 0;
 
                     uint32_t groupsX = (mipWidth + 7) / 8;
                     uint32_t groupsY = (mipHeight + 7) / 8;
@@ -273,7 +390,8 @@ layout(binding = @BINDING@) uniform sampler2D RadianceAtlas;
                     transition_image_layout(radiance_image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mip);
                 }
 
-                //
+                if (ibl_cache_key)
+                    hdri_store_ibl_cache(ibl_cache_key, irradiance_image, radiance_image);
             }
 
             static BufferGroup* GetIrradianceBufferGroup() {
@@ -486,6 +604,7 @@ layout(binding = @BINDING@) uniform sampler2D RadianceAtlas;
     layout (push_constant) uniform PushConstants {
         float roughness;
         int mip;
+        int octahedral;
     } push;
 
     const float PI = 3.14159265359;
@@ -523,6 +642,17 @@ layout(binding = @BINDING@) uniform sampler2D RadianceAtlas;
         return uv;
     }
 
+    // octahedral map texel to direction, the inverse of OctahedralEncode used when sampling
+    vec3 DirectionFromOctahedral(vec2 uv)
+    {
+        vec2 f = uv * 2.0 - 1.0;
+        vec3 n = vec3(f.x, f.y, 1.0 - abs(f.x) - abs(f.y));
+        float t = max(-n.z, 0.0);
+        n.x += n.x >= 0.0 ? -t : t;
+        n.y += n.y >= 0.0 ? -t : t;
+        return normalize(n);
+    }
+
     float DistributionGGX(vec3 N, vec3 H, float roughness)
     {
         float a = roughness * roughness;
@@ -562,7 +692,13 @@ layout(binding = @BINDING@) uniform sampler2D RadianceAtlas;
             return;
 
         vec2 uv = (vec2(pix) + 0.5) / vec2(size);
-        vec3 R = DirectionFromEquirect(uv);
+        vec3 R;
+        if (push.octahedral == 1) {
+            vec3 d = DirectionFromOctahedral(uv);
+            R = vec3(d.x, -d.y, d.z);
+        }
+        else
+            R = DirectionFromEquirect(uv);
         vec3 N = R;
 
         const uint SAMPLE_COUNT = 1024u;
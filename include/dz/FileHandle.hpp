@@ -9,6 +9,18 @@
 
 namespace dz
 {
+    /**
+     * @brief A read-only view of a file mapped into memory, unmapped when the last reference is released.
+     */
+    struct FileMapping
+    {
+        const char* data = nullptr;          /**< Start of the mapped bytes. */
+        size_t size = 0;                     /**< Number of mapped bytes. */
+        void* platform_handle = nullptr;     /**< Platform specific mapping handle. */
+
+        ~FileMapping();
+    };
+
     /**
      * @brief Represents a generalized file handle that can reference disk files, embedded assets, or memory streams.
      */
@@ -35,5 +47,12 @@ namespace dz
          * @return A shared pointer to a valid std::iostream instance.
          */
         std::shared_ptr<std::iostream> open(std::ios_base::openmode ios);
+
+        /**
+         * @brief Maps the file read-only into memory (mmap on POSIX, a file mapping on Windows).
+         * 
+         * @return The mapping, or nullptr for MEMORY handles which have nothing to map.
+         */
+        std::shared_ptr<const FileMapping> map() const;
     };
 }
\ No newline at end of file
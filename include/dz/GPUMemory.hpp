@@ -0,0 +1,63 @@
+/**
+ * @file GPUMemory.hpp
+ * @brief Statistics and maintenance for the device memory allocator shared by buffers, images and staging memory
+ *
+ * Resources are sub-allocated from large blocks per memory type with a buddy allocator, large images and
+ * framebuffer attachments get dedicated allocations.
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace dz
+{
+    /**
+     * @brief What an allocation backs, used to break statistics down
+     */
+    enum class GPUMemoryCategory : uint8_t
+    {
+        Buffer,         /**< BufferGroup storage and uniform buffers. */
+        Image,
+        Attachment,     /**< Framebuffer attachment images. */
+        Staging,        /**< Transfer staging memory. */
+        Indirect,       /**< Indirect draw and count buffers. */
+        Count
+    };
+
+    struct GPUMemoryCategoryStats
+    {
+        uint32_t allocation_count = 0;
+        uint64_t bytes = 0;             /**< Bytes requested by the resources. */
+    };
+
+    struct GPUMemoryHeapStats
+    {
+        uint64_t heap_size = 0;
+        bool device_local = false;
+        uint32_t block_count = 0;
+        uint32_t dedicated_count = 0;
+        uint64_t bytes_reserved = 0;    /**< Bytes allocated from the device, blocks plus dedicated allocations. */
+        uint64_t bytes_used = 0;        /**< Bytes requested by the resources placed in this heap. */
+    };
+
+    struct GPUMemoryStats
+    {
+        std::vector<GPUMemoryHeapStats> heaps;
+        GPUMemoryCategoryStats categories[size_t(GPUMemoryCategory::Count)];
+        uint32_t device_allocation_count = 0;       /**< Live vkAllocateMemory allocations. */
+        uint32_t max_device_allocation_count = 0;   /**< The device's maxMemoryAllocationCount. */
+    };
+
+    GPUMemoryStats gpu_memory_get_stats();
+
+    /**
+     * @brief Moves host visible BufferGroup buffers out of sparsely used blocks into fuller ones and releases emptied blocks
+     *
+     * @note waits for the device to go idle, call between frames, for example after a level load
+     * @note like a resize, moving a buffer invalidates pointers and views taken from it before the call
+     * @param max_bytes stop once this many bytes have been moved
+     * @returns the number of bytes moved
+     */
+    size_t gpu_memory_defragment(size_t max_bytes = SIZE_MAX);
+}
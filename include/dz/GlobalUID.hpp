@@ -3,66 +3,164 @@
  * @brief Provides a globally thread-safe monotonically incrementing UID generator.
  */
 #pragma once
+#include <atomic>
+#include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include <unordered_map>
+#include <vector>
 #include <string>
 #include "State.hpp"
 
 namespace dz
 {
+    /**
+     * @brief A counter owned by GlobalUID, the address stays valid for the life of the program.
+     */
+    struct GlobalUIDCounter
+    {
+        std::atomic<size_t> count = 0;
+        size_t index = 0; /**< Slot of this counter in the per-thread block tables. */
+    };
+
+    /**
+     * @brief Handle to an interned key, resolve it once with GlobalUID::GetKey and reuse it.
+     */
+    using GlobalUIDKey = GlobalUIDCounter*;
+
     /**
      * @brief Thread-safe UID generator that increments globally across the application.
+     *
+     * Counters are atomics so GetNew never takes a lock, keys are interned once into stable counters.
+     * A thread may reserve IDs in blocks with SetThreadBlockSize, IDs stay unique but are then only
+     * increasing per thread, and IDs left in a block when the thread exits are never handed out.
      */
     struct GlobalUID : StaticRestorable
     {
     private:
-        static inline size_t Count = 0;     /**< Global counter shared across threads. */
-        static inline std::unordered_map<std::string, size_t> KeyedCounts = {};
-        static inline std::mutex Mutex = {};/**< Mutex used for thread-safety. */
+        struct ThreadBlock
+        {
+            size_t next = 0;
+            size_t end = 0;
+            size_t generation = 0;
+        };
+
+        static inline GlobalUIDCounter Count = {};     /**< Global counter shared across threads. */
+        static inline std::unordered_map<std::string, std::unique_ptr<GlobalUIDCounter>> KeyedCounts = {};
+        static inline std::shared_mutex Mutex = {};    /**< Guards KeyedCounts, only written when a key is first seen. */
+        static inline std::atomic<size_t> Generation = 0; /**< Bumped on restore so reserved blocks are dropped. */
+
+        static inline thread_local size_t ThreadBlockSize = 1;
+        static inline thread_local std::vector<ThreadBlock> ThreadBlocks = {};
+
+        inline static size_t Next(GlobalUIDCounter& counter)
+        {
+            if (ThreadBlockSize <= 1)
+                return counter.count.fetch_add(1, std::memory_order_relaxed) + 1;
+            if (ThreadBlocks.size() <= counter.index)
+                ThreadBlocks.resize(counter.index + 1);
+            auto& block = ThreadBlocks[counter.index];
+            auto generation = Generation.load(std::memory_order_acquire);
+            if (block.next == block.end || block.generation != generation)
+            {
+                block.next = counter.count.fetch_add(ThreadBlockSize, std::memory_order_relaxed) + 1;
+                block.end = block.next + ThreadBlockSize;
+                block.generation = generation;
+            }
+            return block.next++;
+        }
 
     public:
         /**
          * @brief Returns a new unique identifier.
-         * 
+         *
          * @return A size_t representing a new unique ID.
          */
         inline static size_t GetNew()
         {
-            std::lock_guard lock(Mutex);
-            return ++Count;
+            return Next(Count);
+        }
+
+        /**
+         * @brief Returns the handle for key, creating its counter the first time the key is seen
+         */
+        inline static GlobalUIDKey GetKey(const std::string& key)
+        {
+            {
+                std::shared_lock lock(Mutex);
+                auto it = KeyedCounts.find(key);
+                if (it != KeyedCounts.end())
+                    return it->second.get();
+            }
+            std::unique_lock lock(Mutex);
+            auto& counter = KeyedCounts[key];
+            if (!counter)
+            {
+                counter = std::make_unique<GlobalUIDCounter>();
+                counter->index = KeyedCounts.size();
+            }
+            return counter.get();
+        }
+
+        /**
+         * @brief Returns a new unique identifier incrementing the given Keys count
+         *
+         * @return A size_t representing a new unique ID.
+         */
+        inline static size_t GetNew(GlobalUIDKey key)
+        {
+            return Next(*key);
         }
 
         /**
          * @brief Returns a new unique identifier incrementing the given Keys count
-         * 
+         *
+         * @note looks the key up on every call, prefer resolving a GlobalUIDKey once on hot paths
          * @return A size_t representing a new unique ID.
          */
         inline static size_t GetNew(const std::string& key)
         {
-            std::lock_guard lock(Mutex);
-            return ++KeyedCounts[key];
+            return Next(*GetKey(key));
+        }
+
+        /**
+         * @brief Makes the calling thread reserve IDs block_size at a time, 1 turns reservation off
+         *
+         * Useful for worker threads creating many entities, each block costs one atomic add.
+         */
+        inline static void SetThreadBlockSize(size_t block_size)
+        {
+            ThreadBlockSize = block_size ? block_size : 1;
+            ThreadBlocks.clear();
         }
 
         inline static int SID = 1;
         inline static std::function<bool(Serial&)> RestoreFunction = [](auto& serial) {
-            serial >> Count;
-            auto keyed_counts_size = KeyedCounts.size();
+            size_t global_count = 0;
+            serial >> global_count;
+            Count.count.store(global_count, std::memory_order_relaxed);
+            size_t keyed_counts_size = 0;
             serial >> keyed_counts_size;
             for (size_t count = 1; count <= keyed_counts_size; ++count) {
                 std::string key;
                 size_t key_count = 0;
                 serial >> key >> key_count;
-                KeyedCounts[key] = key_count;
+                GetKey(key)->count.store(key_count, std::memory_order_relaxed);
             }
+            Generation.fetch_add(1, std::memory_order_release);
             return true;
         };
         inline static std::function<bool(Serial&)> BackupFunction = [](auto& serial) {
-            serial << Count;
+            std::shared_lock lock(Mutex);
+            size_t global_count = Count.count.load(std::memory_order_relaxed);
+            serial << global_count;
             serial << KeyedCounts.size();
-            for (auto& [key, key_count] : KeyedCounts)
+            for (auto& [key, counter] : KeyedCounts) {
+                size_t key_count = counter->count.load(std::memory_order_relaxed);
                 serial << key << key_count;
+            }
             return true;
         };
 
     };
-} // namespace dz
\ No newline at end of file
+} // namespace dz
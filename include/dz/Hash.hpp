@@ -0,0 +1,23 @@
+/**
+ * @file Hash.hpp
+ * @brief Fast non-cryptographic content hashing used to key caches and deduplicate data
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace dz
+{
+    /**
+     * @brief Hashes size bytes into a 64 bit value, stable across runs and platforms of the same endianness
+     *
+     * @param seed chains hashes, pass a previous result to hash several buffers as one
+     */
+    uint64_t hash_bytes(const void* data, size_t size, uint64_t seed = 0);
+
+    /**
+     * @brief Formats a hash as 16 lowercase hex digits, suitable for cache file names
+     */
+    std::string hash_to_string(uint64_t hash);
+}
@@ -53,6 +53,7 @@ namespace dz
     *
     * @note if just image_ptr is provided, will upload whatever exists in CPU buffer
     * @note if data provided, data must contain the bytes in the correct format
+    * @note inside transfer_batch_begin/transfer_batch_end the upload is deferred to the batch submission
     */
     void image_upload_data(Image* image_ptr, uint32_t mip = 0, void* data = nullptr);
 
@@ -94,6 +95,13 @@ namespace dz
      */
     std::vector<float> format_get_channels_size_of_t(VkFormat format);
 
+    /**
+    * @brief Computes the byte size of a single mip level of the given extent, handling block compressed (BCn) formats
+    *
+    * @returns 0 if the format is unknown
+    */
+    size_t format_get_mip_byte_size(VkFormat format, uint32_t width, uint32_t height, uint32_t depth = 1);
+
     /**
     * @brief Gets the per channel sizes from an Image
     */
@@ -1,15 +1,27 @@
 /**
  * @file KeyValueStream.hpp
- * @brief Provides a templated key-value stream for binary serialization to file with in-place update and erase.
+ * @brief Provides a templated, log structured key-value stream for binary serialization to file.
+ *
+ * Values are only ever appended, an index of the live entries is appended on flush() and located through a
+ * fixed size commit record at the end of the file. A missing or torn commit is recovered by replaying the log.
+ * Streams opened in Mapped mode are read-only and serve values straight out of a memory mapping of the file.
  */
 #pragma once
 
 #include "FileHandle.hpp"
-#include "internal/vlen.hpp"
+#include "AssetPack.hpp"
+#include "Hash.hpp"
+#include "internal/memory_stream.hpp"
 #include <iostream>
 #include <vector>
 #include <unordered_map>
-#include <sstream>
+#include <filesystem>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+
+#define DZ_KVS_MAGIC "DZKV"
+#define DZ_KVS_VERSION 2
 
 namespace dz
 {
@@ -21,56 +33,81 @@ namespace dz
     template <typename KeyT, typename ValueT>
     class KeyValueStream {
     public:
+        /**
+         * @brief How the underlying file is accessed.
+         */
+        enum class Mode {
+            ReadWrite,  /**< Read and append through the file handle's stream. */
+            Mapped      /**< Read-only, the file is memory mapped once at open and values can be viewed in place. */
+        };
+
         /**
          * @brief Represents metadata for a key-value entry in the file.
          */
         struct HeaderEntry {
             KeyT key;               /**< Key associated with the value. */
-            uint64_t offset;        /**< Offset from the header end to the value. */
+            uint64_t offset;        /**< Absolute file offset of the value bytes. */
             uint64_t size;          /**< Size of the value data. */
         };
 
         /**
          * @brief Constructs a KeyValueStream with a reference to an existing file handle.
          * @param file_handle The file handle to operate on.
+         * @param mode Mapped requires a handle that can be mapped, see FileHandle::map.
          */
-        KeyValueStream(FileHandle& file_handle):
+        KeyValueStream(FileHandle& file_handle, Mode mode = Mode::ReadWrite):
             file_handle(file_handle),
-            m_append_stream_ptr(file_handle.open(std::ios::in | std::ios::out | std::ios::app | std::ios::binary)),
-            m_append_stream(*m_append_stream_ptr)
+            m_mode(mode)
         {
-            readHeader();
+            if (m_mode == Mode::Mapped) {
+                m_mapping = file_handle.map();
+                if (!m_mapping)
+                    throw std::runtime_error("KeyValueStream cannot map handle: " + file_handle.path);
+            }
+            else
+                openStream();
+            readIndex();
+        }
+
+        KeyValueStream(const KeyValueStream&) = delete;
+        KeyValueStream& operator=(const KeyValueStream&) = delete;
+
+        /**
+         * @brief Commits the index of any uncommitted writes.
+         */
+        ~KeyValueStream() {
+            try {
+                flush();
+            }
+            catch (const std::exception& e) {
+                std::cerr << "Failed to commit KeyValueStream index: " << e.what() << std::endl;
+            }
         }
 
         /**
-         * @brief Writes a key-value pair to the stream, replacing any existing value for the key.
+         * @brief Appends a key-value pair to the stream, replacing any existing value for the key.
+         * @note O(value), the index is only committed by flush(), compact() or destruction
          * @param key The key to write.
          * @param value The value to write.
          */
         void write(const KeyT& key, const ValueT& value) {
-            std::string buffer = serialize(value);
+            throwIfMapped();
+            std::string storage;
+            auto value_view = view_value(value, storage);
+            auto key_bytes = serialize_key(key);
+
+            auto payload_offset = appendRecord(RecordKind::Value, key_bytes, value_view);
+
+            HeaderEntry entry { key, payload_offset + key_bytes.size(), value_view.size() };
             auto it = m_keyToIndex.find(key);
             if (it != m_keyToIndex.end()) {
-                erase(key);
+                m_dead_bytes += m_entries[it->second].size;
+                m_entries[it->second] = entry;
             }
-
-            m_append_stream.clear();
-            m_append_stream.seekp(0, std::ios::end);
-            std::streampos pos = m_append_stream.tellp();
-            if (pos == std::streampos(-1)) {
-                throw std::runtime_error("Invalid tellp() after seekp to end");
+            else {
+                m_keyToIndex[key] = m_entries.size();
+                m_entries.push_back(entry);
             }
-
-            uint64_t offset = static_cast<uint64_t>(pos) - header_size;
-            size_t wrote_bytes = 0;
-            vlen::write_u64(m_append_stream, buffer.size() + sizeof(uint64_t), wrote_bytes);
-            m_append_stream.write(buffer.data(), buffer.size());
-            wrote_bytes += buffer.size();
-
-            HeaderEntry entry { key, offset, wrote_bytes };
-            m_keyToIndex[key] = m_entries.size();
-            m_entries.push_back(entry);
-            writeHeader();
         }
 
         /**
@@ -84,129 +121,451 @@ namespace dz
             if (it == m_keyToIndex.end()) return false;
 
             const HeaderEntry& entry = m_entries[it->second];
-            m_append_stream.clear();
-            m_append_stream.seekg(entry.offset + header_size);
-
-            size_t read_bytes = 0;
-            uint64_t size = 0;
-            if (!vlen::read_u64(m_append_stream, size, read_bytes))
+            std::vector<char> buf(entry.size);
+            if (!readAt(entry.offset, buf.data(), entry.size))
                 return false;
-            if (size != entry.size) return false;
 
-            std::vector<char> buf(size);
-            m_append_stream.read(buf.data(), size);
-            read_bytes += size;
+            out = deserialize(entry.size, buf);
+            return true;
+        }
 
-            out = deserialize(size, buf);
+        /**
+         * @brief Views the stored bytes of a value without copying, only available in Mapped mode.
+         * @note the view stays valid for as long as this stream or a copy of mapping() is alive
+         * @return True if the value was found, false if missing or not in Mapped mode.
+         */
+        bool view(const KeyT& key, std::string_view& out) const {
+            if (!m_mapping)
+                return false;
+            auto it = m_keyToIndex.find(key);
+            if (it == m_keyToIndex.end())
+                return false;
+            auto& entry = m_entries[it->second];
+            out = {m_mapping->data + entry.offset, size_t(entry.size)};
             return true;
         }
 
+        /**
+         * @brief Returns the mapping values are viewed from, nullptr unless in Mapped mode.
+         */
+        const std::shared_ptr<const FileMapping>& mapping() const {
+            return m_mapping;
+        }
+
         /**
          * @brief Removes a key-value pair from the stream.
+         * @note appends a small tombstone, the value bytes are reclaimed by compact()
          * @param key The key to erase.
          * @return True if erased successfully, false if the key did not exist.
          */
         bool erase(const KeyT& key) {
+            throwIfMapped();
             auto it = m_keyToIndex.find(key);
             if (it == m_keyToIndex.end()) return false;
 
+            auto key_bytes = serialize_key(key);
+            appendRecord(RecordKind::Erase, key_bytes, {});
+
+            // swap with the last entry so removal stays O(1)
             auto j = it->second;
-            auto entry_iter = m_entries.begin() + j;
-
-            auto offset = entry_iter->offset;
-            auto size = entry_iter->size;
-
-            std::string left, right;
-            left.resize(offset + header_size);
-            auto end_data = offset + header_size + size;
-            m_append_stream.seekg(0, std::ios::end);
-            size_t end = m_append_stream.tellg();
-            right.resize(end - end_data);
-            m_append_stream.seekg(0);
-            m_append_stream.read(left.data(), left.size());
-            m_append_stream.seekg(end_data);
-            m_append_stream.read(right.data(), right.size());
-            rewrite_stream(left, right);
-
-            for (uint64_t i = j + 1; i < m_entries.size(); i++)
-                m_entries[i].offset -= size;
-            m_entries.erase(entry_iter);
-            m_keyToIndex.clear();
-            for (uint64_t i = 0; i < m_entries.size(); ++i) {
-                m_keyToIndex[m_entries[i].key] = i;
+            m_dead_bytes += m_entries[j].size;
+            m_keyToIndex.erase(it);
+            if (j != m_entries.size() - 1) {
+                m_entries[j] = std::move(m_entries.back());
+                m_keyToIndex[m_entries[j].key] = j;
             }
-            writeHeader();
+            m_entries.pop_back();
             return true;
         }
 
+        /**
+         * @brief Returns true if a value is stored for key.
+         */
+        bool contains(const KeyT& key) const {
+            return m_keyToIndex.find(key) != m_keyToIndex.end();
+        }
+
+        /**
+         * @brief Returns the live entries, in no particular order.
+         */
+        const std::vector<HeaderEntry>& entries() const {
+            return m_entries;
+        }
+
+        /**
+         * @brief Returns the number of bytes held by overwritten and erased values, reclaimable with compact().
+         */
+        uint64_t dead_bytes() const {
+            return m_dead_bytes;
+        }
+
+        /**
+         * @brief Appends the index of every live entry followed by a commit record, then flushes the stream.
+         * @note a crash before the commit record lands leaves the previous commit in place, the log is replayed on open
+         * @note the stream is flushed but the file is not synced, a commit survives a process crash but may be lost to a power loss
+         */
+        void flush() {
+            if (m_mode == Mode::Mapped)
+                return;
+            if (m_index_dirty) {
+                std::string index;
+                uint64_t count = m_entries.size();
+                append_pod(index, count);
+                for (auto& e : m_entries) {
+                    auto key_bytes = serialize_key(e.key);
+                    append_pod(index, uint32_t(key_bytes.size()));
+                    index += key_bytes;
+                    append_pod(index, e.offset);
+                    append_pod(index, e.size);
+                }
+                auto index_offset = appendRecord(RecordKind::Index, {}, index) - sizeof(RecordHeader);
+                std::string commit;
+                append_pod(commit, index_offset);
+                append_pod(commit, m_dead_bytes);
+                appendRecord(RecordKind::Commit, {}, commit);
+                m_index_dirty = false;
+            }
+            m_stream_ptr->flush();
+        }
+
+        /**
+         * @brief Rewrites the file with only the live values and a fresh index, reclaiming dead bytes.
+         * @note file handles on disk are rewritten to a temporary file that replaces the original once complete
+         */
+        void compact() {
+            throwIfMapped();
+            std::string log;
+            log.append(DZ_KVS_MAGIC, sizeof(DZ_KVS_MAGIC) - 1);
+            append_pod(log, uint32_t(DZ_KVS_VERSION));
+            std::vector<HeaderEntry> entries;
+            entries.reserve(m_entries.size());
+            auto& stream = *m_stream_ptr;
+            std::vector<char> value;
+
+            auto compact_path = std::filesystem::path(file_handle.path);
+            compact_path += ".compact";
+            std::shared_ptr<std::ostream> out_ptr;
+            if (file_handle.location == FileHandle::PATH) {
+                FileHandle compact_handle{FileHandle::PATH, compact_path.string()};
+                out_ptr = compact_handle.open(std::ios::out | std::ios::trunc | std::ios::binary);
+                if (!*out_ptr)
+                    throw std::runtime_error("Failed to open " + compact_path.string() + " for compaction");
+            }
+            else
+                out_ptr = std::make_shared<memory_stream>(std::ios::out);
+            auto& out = *out_ptr;
+            out.write(log.data(), log.size());
+            uint64_t out_offset = log.size();
+
+            for (auto& e : m_entries) {
+                value.resize(e.size);
+                stream.clear();
+                stream.seekg(e.offset);
+                stream.read(value.data(), e.size);
+                if (!stream)
+                    throw std::runtime_error("Failed to read value during compaction");
+                auto key_bytes = serialize_key(e.key);
+                auto header = makeRecordHeader(RecordKind::Value, key_bytes, {value.data(), value.size()});
+                out.write((const char*)&header, sizeof(header));
+                out.write(key_bytes.data(), key_bytes.size());
+                out.write(value.data(), value.size());
+                entries.push_back({e.key, out_offset + sizeof(header) + key_bytes.size(), e.size});
+                out_offset += sizeof(header) + header.size;
+            }
+            out.flush();
+            if (!out)
+                throw std::runtime_error("Failed to write compacted KeyValueStream");
+
+            if (file_handle.location == FileHandle::PATH) {
+                out_ptr.reset();
+                m_stream_ptr.reset();
+                std::filesystem::rename(compact_path, file_handle.path);
+                openStream();
+            }
+            else {
+                auto memory = std::dynamic_pointer_cast<memory_stream>(out_ptr);
+                auto target = std::dynamic_pointer_cast<memory_stream>(m_stream_ptr);
+                if (!memory || !target)
+                    throw std::runtime_error("KeyValueStream can only compact file and memory handles");
+                target->str(memory->str());
+            }
+            m_end = out_offset;
+            m_entries = std::move(entries);
+            m_dead_bytes = 0;
+            m_index_dirty = true;
+            flush();
+        }
+
     private:
+        enum class RecordKind : uint32_t {
+            Value = 1,      /**< key bytes followed by value bytes. */
+            Erase = 2,      /**< key bytes of an erased entry. */
+            Index = 3,      /**< serialized index of every live entry. */
+            Commit = 4      /**< offset of the latest index record, always the last record of a committed file. */
+        };
+
+        struct RecordHeader {
+            uint32_t kind;
+            uint32_t key_size;
+            uint64_t size;          /**< payload bytes following the header, including the key. */
+            uint64_t hash;          /**< hash_bytes of the key bytes, chained into hash_bytes of the remaining payload. */
+        };
+
+        inline static constexpr uint64_t file_header_size = sizeof(DZ_KVS_MAGIC) - 1 + sizeof(uint32_t);
+        inline static constexpr uint64_t commit_payload_size = sizeof(uint64_t) * 2;
+
         FileHandle& file_handle;                                     /**< Underlying file handle. */
-        std::shared_ptr<std::iostream> m_append_stream_ptr;          /**< Shared stream pointer for read/write. */
-        std::iostream& m_append_stream;                               /**< Reference to the stream. */
+        Mode m_mode;                                                  /**< Access mode chosen at construction. */
+        std::shared_ptr<std::iostream> m_stream_ptr;                 /**< Shared stream pointer for read/write. */
+        std::shared_ptr<const FileMapping> m_mapping;                /**< Read-only mapping of the file in Mapped mode. */
         std::vector<HeaderEntry> m_entries;                           /**< Metadata for entries. */
         std::unordered_map<KeyT, uint64_t> m_keyToIndex;             /**< Mapping of key to entry index. */
-        size_t header_size = 0;                                       /**< Size of the current header. */
+        uint64_t m_end = 0;                                           /**< End of the last valid record, where the next record is appended. */
+        uint64_t m_dead_bytes = 0;                                    /**< Bytes of overwritten and erased values. */
+        bool m_index_dirty = false;                                   /**< True if records were appended since the last commit. */
+
+        template <typename T>
+        static void append_pod(std::string& out, const T& value) {
+            out.append((const char*)&value, sizeof(T));
+        }
+
+        template <typename T>
+        static bool take_pod(const char*& data, const char* end, T& value) {
+            if (size_t(end - data) < sizeof(T))
+                return false;
+            memcpy(&value, data, sizeof(T));
+            data += sizeof(T);
+            return true;
+        }
+
+        void openStream() {
+            m_stream_ptr = file_handle.open(std::ios::in | std::ios::out | std::ios::binary);
+            if (file_handle.location == FileHandle::PATH && !*m_stream_ptr)
+                m_stream_ptr = file_handle.open(std::ios::in | std::ios::out | std::ios::trunc | std::ios::binary);
+            if (!*m_stream_ptr)
+                throw std::runtime_error("Failed to open KeyValueStream: " + file_handle.path);
+        }
+
+        void throwIfMapped() const {
+            if (m_mode == Mode::Mapped)
+                throw std::runtime_error("KeyValueStream opened in Mapped mode is read-only: " + file_handle.path);
+        }
+
+        static uint64_t record_hash(const char* payload, size_t key_size, size_t size) {
+            return hash_bytes(payload + key_size, size - key_size, hash_bytes(payload, key_size));
+        }
 
-        void readHeader() {
-            m_append_stream.clear();
+        static RecordHeader makeRecordHeader(RecordKind kind, std::string_view key_bytes, std::string_view data) {
+            auto hash = hash_bytes(data.data(), data.size(), hash_bytes(key_bytes.data(), key_bytes.size()));
+            return {uint32_t(kind), uint32_t(key_bytes.size()), key_bytes.size() + data.size(), hash};
+        }
+
+        /**
+         * @brief Appends a record of key_bytes followed by data at the end of the log.
+         * @return The file offset of the record payload.
+         */
+        uint64_t appendRecord(RecordKind kind, std::string_view key_bytes, std::string_view data) {
+            auto header = makeRecordHeader(kind, key_bytes, data);
+            auto& stream = *m_stream_ptr;
+            stream.clear();
+            stream.seekp(m_end);
+            stream.write((const char*)&header, sizeof(header));
+            stream.write(key_bytes.data(), key_bytes.size());
+            stream.write(data.data(), data.size());
+            if (!stream)
+                throw std::runtime_error("Failed to append to KeyValueStream: " + file_handle.path);
+            auto payload_offset = m_end + sizeof(header);
+            m_end = payload_offset + header.size;
+            m_index_dirty = true;
+            return payload_offset;
+        }
 
-            m_append_stream.seekg(0, std::ios::end);
-            auto end = m_append_stream.tellg();
-            if (!end)
+        bool readAt(uint64_t offset, void* data, size_t size) {
+            if (m_mapping) {
+                if (offset > m_mapping->size || size > m_mapping->size - offset)
+                    return false;
+                memcpy(data, m_mapping->data + offset, size);
+                return true;
+            }
+            auto& stream = *m_stream_ptr;
+            stream.clear();
+            stream.seekg(offset);
+            stream.read((char*)data, size);
+            return bool(stream);
+        }
+
+        uint64_t fileSize() {
+            if (m_mapping)
+                return m_mapping->size;
+            auto& stream = *m_stream_ptr;
+            stream.clear();
+            stream.seekg(0, std::ios::end);
+            auto end_pos = stream.tellg();
+            return end_pos == std::streampos(-1) ? 0 : uint64_t(end_pos);
+        }
+
+        void readIndex() {
+            uint64_t file_size = fileSize();
+            if (file_size == 0 && m_mapping)
+                return;
+            if (file_size == 0) {
+                auto& stream = *m_stream_ptr;
+                std::string header;
+                header.append(DZ_KVS_MAGIC, sizeof(DZ_KVS_MAGIC) - 1);
+                append_pod(header, uint32_t(DZ_KVS_VERSION));
+                stream.clear();
+                stream.seekp(0);
+                stream.write(header.data(), header.size());
+                m_end = header.size();
                 return;
+            }
 
-            m_append_stream.seekg(0);
-            if (!m_append_stream.good()) return;
+            char magic[sizeof(DZ_KVS_MAGIC) - 1];
+            uint32_t version = 0;
+            if (file_size < file_header_size || !readAt(0, magic, sizeof(magic)) || !readAt(sizeof(magic), &version, sizeof(version)) ||
+                memcmp(magic, DZ_KVS_MAGIC, sizeof(magic)) != 0 || version != DZ_KVS_VERSION)
+                throw std::runtime_error("Not a KeyValueStream or unsupported version: " + file_handle.path);
+
+            if (!readCommittedIndex(file_size))
+                replayLog(file_size);
+        }
 
-            size_t read_bytes = 0;
+        bool readCommittedIndex(uint64_t file_size) {
+            auto commit_record_size = sizeof(RecordHeader) + commit_payload_size;
+            if (file_size < file_header_size + commit_record_size)
+                return false;
+            RecordHeader commit_header;
+            char commit[commit_payload_size];
+            auto commit_offset = file_size - commit_record_size;
+            if (!readAt(commit_offset, &commit_header, sizeof(commit_header)) || !readAt(commit_offset + sizeof(commit_header), commit, sizeof(commit)))
+                return false;
+            if (commit_header.kind != uint32_t(RecordKind::Commit) || commit_header.size != commit_payload_size ||
+                commit_header.hash != record_hash(commit, 0, sizeof(commit)))
+                return false;
+            uint64_t index_offset, dead_bytes;
+            memcpy(&index_offset, commit, sizeof(index_offset));
+            memcpy(&dead_bytes, commit + sizeof(index_offset), sizeof(dead_bytes));
+
+            RecordHeader index_header;
+            if (index_offset < file_header_size || index_offset + sizeof(index_header) > commit_offset ||
+                !readAt(index_offset, &index_header, sizeof(index_header)) ||
+                index_header.kind != uint32_t(RecordKind::Index) || index_header.size > commit_offset - index_offset - sizeof(index_header))
+                return false;
+            std::string index(index_header.size, '\0');
+            if (!readAt(index_offset + sizeof(index_header), index.data(), index.size()) ||
+                index_header.hash != record_hash(index.data(), 0, index.size()))
+                return false;
+
+            std::vector<HeaderEntry> entries;
+            const char* data = index.data();
+            const char* end = data + index.size();
             uint64_t count = 0;
-            if (!vlen::read_u64(m_append_stream, count, read_bytes))
-                return;
+            if (!take_pod(data, end, count))
+                return false;
+            entries.reserve(count);
             for (uint64_t i = 0; i < count; ++i) {
+                uint32_t key_size = 0;
                 HeaderEntry e;
-                e.key = deserialize_key(m_append_stream, read_bytes);
-                if (!vlen::read_u64(m_append_stream, e.offset, read_bytes))
-                    return;
-                if (!vlen::read_u64(m_append_stream, e.size, read_bytes))
-                    return;
-                m_entries.push_back(e);
-                m_keyToIndex[e.key] = i;
+                if (!take_pod(data, end, key_size) || size_t(end - data) < key_size)
+                    return false;
+                e.key = deserialize_key(data, key_size);
+                data += key_size;
+                if (!take_pod(data, end, e.offset) || !take_pod(data, end, e.size))
+                    return false;
+                entries.push_back(std::move(e));
             }
 
-            header_size = read_bytes;
+            m_entries = std::move(entries);
+            m_keyToIndex.clear();
+            m_keyToIndex.reserve(m_entries.size());
+            for (uint64_t i = 0; i < m_entries.size(); ++i)
+                m_keyToIndex[m_entries[i].key] = i;
+            m_end = file_size;
+            m_dead_bytes = dead_bytes;
+            m_index_dirty = false;
+            return true;
         }
 
-        void rewrite_stream(const std::string& left, const std::string& right)
-        {
-            auto trunc_stream_ptr = file_handle.open(std::ios::in | std::ios::out | std::ios::trunc | std::ios::binary);
-            auto& trunc_stream = *trunc_stream_ptr;
-            trunc_stream.seekp(0);
-            trunc_stream.write(left.data(), left.size());
-            trunc_stream.write(right.data(), right.size());
+        /**
+         * @brief Rebuilds the index from every intact record, dropping a torn tail left by an interrupted write.
+         */
+        void replayLog(uint64_t file_size) {
+            uint64_t offset = file_header_size;
+            std::string payload;
+            m_entries.clear();
+            m_keyToIndex.clear();
+            m_dead_bytes = 0;
+            auto remove = [&](const KeyT& key) {
+                auto it = m_keyToIndex.find(key);
+                if (it == m_keyToIndex.end())
+                    return;
+                auto j = it->second;
+                m_dead_bytes += m_entries[j].size;
+                m_keyToIndex.erase(it);
+                if (j != m_entries.size() - 1) {
+                    m_entries[j] = std::move(m_entries.back());
+                    m_keyToIndex[m_entries[j].key] = j;
+                }
+                m_entries.pop_back();
+            };
+            while (offset + sizeof(RecordHeader) <= file_size) {
+                RecordHeader header;
+                if (!readAt(offset, &header, sizeof(header)) || header.size > file_size - offset - sizeof(header) || header.key_size > header.size)
+                    break;
+                payload.resize(header.size);
+                if (!readAt(offset + sizeof(header), payload.data(), payload.size()) || header.hash != record_hash(payload.data(), header.key_size, payload.size()))
+                    break;
+                auto payload_offset = offset + sizeof(header);
+                if (header.kind == uint32_t(RecordKind::Value)) {
+                    auto key = deserialize_key(payload.data(), header.key_size);
+                    remove(key);
+                    m_keyToIndex[key] = m_entries.size();
+                    m_entries.push_back({key, payload_offset + header.key_size, header.size - header.key_size});
+                }
+                else if (header.kind == uint32_t(RecordKind::Erase))
+                    remove(deserialize_key(payload.data(), header.key_size));
+                else if (header.kind != uint32_t(RecordKind::Index) && header.kind != uint32_t(RecordKind::Commit))
+                    break;
+                offset = payload_offset + header.size;
+            }
+            m_end = offset;
+            if (m_end < file_size && !m_mapping)
+                truncate(m_end);
+            m_index_dirty = true;
         }
 
-        void writeHeader() {
-            size_t wrote_bytes = 0;
-            std::stringstream ss;
-            vlen::write_u64(ss, m_entries.size(), wrote_bytes);
-            for (const auto& e : m_entries) {
-                serialize_key(ss, e.key, wrote_bytes);
-                vlen::write_u64(ss, e.offset, wrote_bytes);
-                vlen::write_u64(ss, e.size, wrote_bytes);
+        void truncate(uint64_t size) {
+            if (file_handle.location == FileHandle::PATH) {
+                m_stream_ptr.reset();
+                std::filesystem::resize_file(file_handle.path, size);
+                openStream();
             }
-            std::string h = ss.str();
-
-            m_append_stream.seekg(0, std::ios::end);
-            size_t end = m_append_stream.tellg();
-            size_t data_size = end - header_size;
-            std::string v;
-            v.resize(data_size);
-            m_append_stream.seekg(header_size);
-            m_append_stream.read(v.data(), data_size);
-
-            rewrite_stream(h, v);
+            else if (auto memory = std::dynamic_pointer_cast<memory_stream>(m_stream_ptr)) {
+                memory->str(memory->str().substr(0, size));
+            }
+        }
 
-            header_size = wrote_bytes;
+        /**
+         * @brief Views the bytes of a value, serializing into storage when the value is not contiguous.
+         */
+        std::string_view view_value(const ValueT& val, std::string& storage) {
+            if constexpr (std::is_same_v<ValueT, std::string>)
+            {
+                return val;
+            }
+            else if constexpr (std::is_same_v<ValueT, Asset>)
+            {
+                return {val.ptr, val.get_size()};
+            }
+            else if constexpr (std::is_trivially_copyable_v<ValueT>)
+            {
+                return {(const char*)&val, sizeof(ValueT)};
+            }
+            else
+            {
+                storage = serialize(val);
+                return storage;
+            }
         }
 
         /**
@@ -232,8 +591,8 @@ namespace dz
             else if constexpr (std::is_same_v<ValueT, Asset>)
             {
                 std::string str;
-                str.resize(*val.size);
-                memcpy(str.data(), val.ptr, *val.size);
+                str.resize(val.get_size());
+                memcpy(str.data(), val.ptr, val.get_size());
                 return str;
             }
             else if constexpr (std::is_trivially_copyable_v<ValueT>)
@@ -265,14 +624,14 @@ namespace dz
             }
             else if constexpr (std::is_same_v<ValueT, Asset>)
             {
-                ValueT asset((char*)malloc(size), size, &default_free_deleter::call);
+                auto asset = ValueT::allocate(size, false);
                 memcpy(asset.ptr, buf.data(), size);
                 return asset;
             }
             else if constexpr (std::is_trivially_copyable_v<ValueT>)
             {
                 ValueT val;
-                memcpy(&val, buf.data(), size);
+                memcpy(&val, buf.data(), (std::min)(size, sizeof(ValueT)));
                 return val;
             }
             else
@@ -282,53 +641,43 @@ namespace dz
         }
 
         /**
-         * @brief Serializes a key to a stream.
-         * @param stream Output stream.
+         * @brief Serializes a key to its stored bytes.
          * @param key Key to serialize.
-         * @param wrote_bytes Byte counter updated during write.
+         * @return The key bytes, length prefixed by the record or index entry that holds them.
          */
-        void serialize_key(std::ostream& stream, const KeyT& key, size_t& wrote_bytes)
+        std::string serialize_key(const KeyT& key)
         {
-            if constexpr (std::is_trivially_copyable_v<KeyT>)
+            if constexpr (std::is_same_v<KeyT, std::string>)
             {
-                KeyT key;
-                stream.write((const char*)&key, sizeof(KeyT));
-                wrote_bytes += sizeof(KeyT);
+                return key;
+            }
+            else if constexpr (std::is_trivially_copyable_v<KeyT>)
+            {
+                return std::string((const char*)&key, sizeof(KeyT));
             }
-            else if constexpr (std::is_same_v<KeyT, std::string>)
+            else
             {
-                auto size = key.size();
-                vlen::write_u64(stream, size, wrote_bytes);
-                stream.write(key.data(), size);
-                wrote_bytes += size;
+                throw std::runtime_error("Unsupported KeyT for serialization");
             }
         }
 
         /**
-         * @brief Deserializes a key from a stream.
-         * @param stream Stream to read from.
-         * @param read_bytes Byte counter updated during read.
+         * @brief Deserializes a key from its stored bytes.
+         * @param data Start of the key bytes.
+         * @param size Number of key bytes.
          * @return The deserialized key.
          */
-        KeyT deserialize_key(std::istream& stream, size_t& read_bytes)
+        KeyT deserialize_key(const char* data, size_t size)
         {
-            if constexpr (std::is_trivially_copyable_v<KeyT>)
+            if constexpr (std::is_same_v<KeyT, std::string>)
             {
-                KeyT key;
-                stream.read((char*)&key, sizeof(KeyT));
-                read_bytes += sizeof(KeyT);
-                return key;
+                return KeyT(data, size);
             }
-            else if constexpr (std::is_same_v<KeyT, std::string>)
+            else if constexpr (std::is_trivially_copyable_v<KeyT>)
             {
-                KeyT str;
-                uint64_t size;
-                if (!vlen::read_u64(stream, size, read_bytes))
-                    return str;
-                str.resize(size);
-                stream.read(str.data(), size);
-                read_bytes += size;
-                return str;
+                KeyT key{};
+                memcpy(&key, data, (std::min)(size, sizeof(KeyT)));
+                return key;
             }
             else
             {
@@ -336,4 +685,4 @@ namespace dz
             }
         }
     };
-}
\ No newline at end of file
+}
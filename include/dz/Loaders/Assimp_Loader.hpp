@@ -8,6 +8,8 @@
 #include <dz/math.hpp>
 #include <dz/Image.hpp>
 #include <dz/ImagePack.hpp>
+#include <dz/FileHandle.hpp>
+#include <dz/AssetPack.hpp>
 
 namespace dz::loaders {
     using MeshPair = std::pair<size_t, int>;
@@ -57,15 +59,53 @@ namespace dz::loaders {
         const std::vector<TTangent>&,
         const std::vector<TBitangent>&
     )>;
+    /**
+     * @brief Vertex streams built for a single mesh during import
+     */
+    struct Assimp_Mesh {
+        std::string name;
+        MaterialIndex material_index = -1;
+        std::vector<TPosition> positions;
+        std::vector<TUV2> uv2s;
+        std::vector<TNormal> normals;
+        std::vector<TTangent> tangents;
+        std::vector<TBitangent> bitangents;
+    };
+    using AddMeshesFunction = std::function<std::vector<MeshPair>(
+        const std::vector<Assimp_Mesh>&
+    )>;
+    /**
+     * @brief Stages of an import in the order they run, only Commit touches the callbacks that add to the scene
+     */
+    enum class Assimp_Stage {
+        Parse,
+        Build,
+        Decode,
+        Commit
+    };
+    /**
+     * @brief Called on the loading thread with the current stage and its progress in [0, 1], return false to cancel
+     */
+    using ProgressFunction = std::function<bool(Assimp_Stage, float)>;
+    /**
+     * @brief Thrown by Assimp_Loader::Load when progress_function cancels, nothing has been added when it is thrown
+     */
+    struct Assimp_Cancelled : std::runtime_error {
+        using std::runtime_error::runtime_error;
+    };
     struct Assimp_Info {
         ParentID parent_id = -1;
         AddSceneFunction add_scene_function;
         AddEntityFunction add_entity_function;
         AddMeshFunction add_mesh_function;
         AddMaterialFunction add_material_function;
+        AddMeshesFunction add_meshes_function; // optional, preferred over add_mesh_function so vertex buffers grow once per import
+        ProgressFunction progress_function; // optional
         std::filesystem::path path;
         std::shared_ptr<char> bytes;
         size_t bytes_length = 0;
+        std::shared_ptr<const FileMapping> mapping; // read in place when set, path (if any) supplies the format hint
+        std::filesystem::path cache_directory; // when set, cooked models are written here on first import and reused while the source is unchanged
         TPosition root_position = TPosition(0.0, 0.0, 0.0, 1.0);
         TRotation root_rotation = TRotation(0.0, 0.0, 0.0, 1.0);
         TScale root_scale = TScale(1.0, 1.0, 1.0, 1.0);
@@ -73,6 +113,17 @@ namespace dz::loaders {
     struct Assimp_Loader {
         using value_type = SceneID;
         using info_type = Assimp_Info;
+        /**
+         * @brief Imports a scene, a path ending in .dzm is read as a cooked model without running Assimp
+         */
         static value_type Load(const info_type& info);
+        /**
+         * @brief Imports info and writes the result as a cooked model (.dzm) holding ready to upload vertex streams, decoded textures, materials and the node hierarchy
+         *
+         * @note no callbacks are used and no GPU work is done, so this may run in offline tools
+         * @note textures are queued for decoding one material ahead of the writer and freed once written
+         * @param compression Zlib stores texture payloads in compressed blocks like an AssetPack, they are inflated on load instead of mapped
+         */
+        static void Cook(const info_type& info, const std::filesystem::path& out_path, AssetCompression compression = AssetCompression::None, int level = -1, uint32_t block_size = DZ_ASSET_BLOCK_SIZE);
     };
 }
\ No newline at end of file
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "../Image.hpp"
+#include "../FileHandle.hpp"
+#include <filesystem>
+#include <memory>
+
+namespace dz::loaders {
+    struct KTX2_Info {
+        std::filesystem::path path;
+        std::shared_ptr<const FileMapping> mapping; // preferred, mip levels are uploaded straight out of the mapping
+        std::shared_ptr<char> bytes;
+        size_t bytes_length = 0;
+    };
+    /**
+     * @brief Loads pre-encoded (e.g. BCn) KTX2 textures without decoding them on the CPU
+     *
+     * @note only supercompressionScheme 0 with a single layer and face is supported
+     */
+    struct KTX2_Loader {
+        using value_type = Image*;
+        using info_type = KTX2_Info;
+        static value_type Load(const info_type& info);
+        /**
+         * @brief returns true if the bytes begin with the KTX2 file identifier
+         */
+        static bool IsKTX2(const char* bytes, size_t bytes_length);
+    };
+}
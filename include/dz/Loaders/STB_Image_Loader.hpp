@@ -1,19 +1,72 @@
 #pragma once
 
 #include "../Image.hpp"
+#include "../FileHandle.hpp"
 #include <filesystem>
 #include <memory>
+#include <vector>
 
 namespace dz::loaders {
     struct STB_Image_Info {
         std::filesystem::path path;
         std::shared_ptr<char> bytes;
         size_t bytes_length = 0;
+        std::shared_ptr<const FileMapping> mapping; // decoded in place when set, see FileHandle::map
         bool load_float = 0; // false loads UNORM, true loads SFLOAT
     };
+    /**
+     * @brief Handle to an image being decoded on the loader thread pool
+     */
+    struct STB_Image_Request;
+    using STB_Image_Future = std::shared_ptr<STB_Image_Request>;
     struct STB_Image_Loader {
         using value_type = Image*;
         using info_type = STB_Image_Info;
         static value_type Load(const info_type& info);
+        /**
+         * @brief Queues info to be decoded on thread_pool_default()
+         *
+         * @note info.bytes and info.mapping are kept alive by the request until decoding has finished
+         * @note a request that does not fit the budget waits in a queue until earlier pixels are handed off or freed
+         */
+        static STB_Image_Future LoadAsync(const info_type& info);
+        /**
+         * @brief returns true once the request has finished decoding (successfully or not)
+         */
+        static bool IsReady(const STB_Image_Future& future);
+        /**
+         * @brief Waits for the request to finish decoding without creating an Image, rethrows decoding errors
+         */
+        static void Wait(const STB_Image_Future& future);
+        /**
+         * @brief Takes a request still queued for budget out of the queue without decoding it
+         *
+         * @returns false if the request already reached a worker, Wait on it to let it finish
+         * @note waiting on a cancelled request throws
+         */
+        static bool Cancel(const STB_Image_Future& future);
+        /**
+         * @brief Waits for decoding and returns the ImageCreateInfo describing the decoded pixels without creating an Image
+         *
+         * @note safe to call from any thread, the pixels stay alive for as long as the returned datas are referenced
+         * @note handing the pixels off returns their share of the budget
+         */
+        static ImageCreateInfo GetCreateInfo(const STB_Image_Future& future);
+        /**
+         * @brief Waits for decoding and creates an Image from the decoded pixels
+         *
+         * @note must be called on the thread that owns the GPU, may be called more than once per request
+         */
+        static value_type Get(const STB_Image_Future& future);
+        /**
+         * @brief Waits for every request and creates their Images, uploading them in a single transfer batch
+         */
+        static std::vector<value_type> GetAll(const std::vector<STB_Image_Future>& futures);
+        /**
+         * @brief Sets the maximum number of decoded bytes held by requests at once, requests over it are queued before reaching a worker
+         *
+         * @note a queued request being waited on is decoded on the waiting thread regardless of the budget
+         */
+        static void SetMaxBytesInFlight(size_t max_bytes);
     };
-}
\ No newline at end of file
+}
@@ -30,6 +30,14 @@ enum class ReflectableTypeHint {
 struct Reflectable {
     virtual ~Reflectable() = default;
 
+    /**
+    * @brief Returns a new id from the shared "Reflectable" GlobalUID key, the key is resolved once
+    */
+    inline static size_t NewUID() {
+        static const auto key = dz::GlobalUID::GetKey("Reflectable");
+        return dz::GlobalUID::GetNew(key);
+    }
+
     virtual int GetID() = 0;
     virtual std::string& GetName() = 0;
     virtual ReflectableTypeHint GetTypeHint() {
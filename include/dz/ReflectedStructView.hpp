@@ -3,9 +3,66 @@
  * @brief A reflected view of a buffer offset allowing access to struct members 
  */
 #pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
 #include <string>
 namespace dz {
     struct ReflectedStruct;
+
+    /**
+    * @brief A struct member resolved once by name, reuse it to reach the member in any element without lookups
+    */
+    struct MemberHandle {
+        uint32_t offset = 0;  /**< Byte offset of the member within an element. */
+        uint32_t size = 0;    /**< Reflected size of the member in bytes. */
+        uint32_t type_op = 0; /**< SpvOp of the member type, e.g. SpvOpTypeFloat, SpvOpTypeVector or SpvOpTypeStruct. */
+    };
+
+    /**
+    * @brief Typed view of one member, or of whole elements, across every element of a buffer
+    *
+    * Indexing is base + index * stride, the view is invalidated when the buffer is resized.
+    */
+    template <typename T>
+    struct StridedView {
+        uint8_t* base_ptr = nullptr;
+        size_t stride = 0;
+        size_t count = 0;
+
+        struct iterator {
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = T;
+            using difference_type = std::ptrdiff_t;
+            using pointer = T*;
+            using reference = T&;
+
+            uint8_t* ptr;
+            size_t stride;
+
+            T& operator*() const { return *(T*)ptr; }
+            T* operator->() const { return (T*)ptr; }
+            iterator& operator++() { ptr += stride; return *this; }
+            iterator operator++(int) { auto copy = *this; ptr += stride; return copy; }
+            bool operator==(const iterator& other) const { return ptr == other.ptr; }
+            bool operator!=(const iterator& other) const { return ptr != other.ptr; }
+        };
+
+        T& operator[](size_t index) const {
+            return *(T*)(base_ptr + index * stride);
+        }
+        size_t size() const {
+            return count;
+        }
+        iterator begin() const {
+            return {base_ptr, stride};
+        }
+        iterator end() const {
+            return {base_ptr + count * stride, stride};
+        }
+    };
     class ReflectedStructView {
     public:
         /**
@@ -58,8 +115,118 @@ namespace dz {
         {
             return *(T*)m_base_ptr;
         }
+
+        /**
+        * @brief Resolves a member by name, throws if the struct has no such member
+        */
+        MemberHandle get_member_handle(const std::string& member_name) const;
+
+        /**
+        * @brief Resolves a member by name, throws if it is missing or its reflected size differs from sizeof(T)
+        */
+        template <typename T>
+        MemberHandle get_member_handle(const std::string& member_name) const
+        {
+            return get_member_handle(member_name, sizeof(T));
+        }
+
+        MemberHandle get_member_handle(const std::string& member_name, size_t data_size_bytes) const;
+
+        /**
+        * @brief Sets a member through a resolved handle, the size is checked once when the handle is resolved
+        */
+        template<typename T>
+        void set_member(const MemberHandle& member, const T& value)
+        {
+            set_member(member, &value, sizeof(value));
+        }
+
+        void set_member(const MemberHandle& member, const void* data_ptr, size_t data_size_bytes)
+        {
+            assert(member.size == data_size_bytes);
+            memcpy(m_base_ptr + member.offset, data_ptr, member.size);
+        }
+
+        template <typename T>
+        T& get_member(const MemberHandle& member)
+        {
+            assert(member.size == sizeof(T));
+            return *(T*)(m_base_ptr + member.offset);
+        }
     private:
         uint8_t* m_base_ptr;          // Pointer to the start of the current struct element in memory
         const ReflectedStruct& m_struct_def; // Reference to the struct's reflection definition
     };
-}
\ No newline at end of file
+
+    /**
+    * @brief A reflected view of every element of a buffer, obtained once and reused across frames
+    *
+    * The canonical struct is resolved when the view is made so element and member access is pointer arithmetic.
+    * The view is invalidated when the buffer is resized.
+    */
+    class ReflectedBufferView {
+    public:
+        ReflectedBufferView(uint8_t* base_ptr, size_t stride, size_t count, const ReflectedStruct& struct_def);
+
+        size_t size() const
+        {
+            return m_count;
+        }
+
+        size_t stride() const
+        {
+            return m_stride;
+        }
+
+        /**
+        * @brief Returns a view of the element at index, throws std::out_of_range past the element count
+        */
+        ReflectedStructView element(size_t index) const;
+
+        MemberHandle get_member_handle(const std::string& member_name) const;
+
+        template <typename T>
+        MemberHandle get_member_handle(const std::string& member_name) const
+        {
+            return get_member_handle(member_name, sizeof(T));
+        }
+
+        MemberHandle get_member_handle(const std::string& member_name, size_t data_size_bytes) const;
+
+        /**
+        * @brief Returns a typed view of one member in every element
+        */
+        template <typename T>
+        StridedView<T> member_view(const MemberHandle& member) const
+        {
+            assert(member.size == sizeof(T));
+            return {m_base_ptr + member.offset, m_stride, m_count};
+        }
+
+        template <typename T>
+        StridedView<T> member_view(const std::string& member_name) const
+        {
+            return member_view<T>(get_member_handle<T>(member_name));
+        }
+
+        /**
+        * @brief Returns every element viewed as T, T must match the shader's layout
+        */
+        template <typename T>
+        StridedView<T> as_structs() const
+        {
+            return {m_base_ptr, m_stride, m_count};
+        }
+
+        template <typename T>
+        T& as_struct(size_t index) const
+        {
+            return *(T*)(m_base_ptr + index * m_stride);
+        }
+    private:
+        uint8_t* m_base_ptr;
+        size_t m_stride;
+        size_t m_count;
+        const ReflectedStruct* m_struct_def;
+    };
+}
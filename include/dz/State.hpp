@@ -6,6 +6,7 @@
 
 #define CID_WINDOW 1
 #define CID_MIN 2
+#define DZ_STATE_COMPRESSION_LEVEL 1
 
 namespace dz {
     struct WINDOW;
@@ -66,6 +67,24 @@ namespace dz {
         * @brief virtual method for reading the Restorable data
         */
         virtual bool restore(Serial& serial) { return true; }
+
+        /**
+        * @brief virtual method for recording the current data as the base later deltas are taken against
+        */
+        virtual void commit_delta_baseline() { }
+
+        /**
+        * @brief virtual method for writing the changes made since commit_delta_baseline, then committing them
+        *
+        * @param reversible also write the previous values so the delta can be undone
+        * @returns false when the changes cannot be expressed as a delta and a full save_state is required
+        */
+        virtual bool backup_delta(Serial& serial, bool reversible) { return true; }
+
+        /**
+        * @brief virtual method for applying a delta written by backup_delta, or undoing it when reverse is set
+        */
+        virtual bool restore_delta(Serial& serial, bool reversible, bool reverse) { return true; }
     };
 
     /**
@@ -83,6 +102,37 @@ namespace dz {
     */
     void set_state_ostream(std::ostream& ostream);
 
+    /**
+    * @brief Sets the zlib level State files are compressed with, 0 stores them uncompressed
+    *
+    * @note defaults to DZ_STATE_COMPRESSION_LEVEL, favouring save speed
+    */
+    void set_state_compression_level(int level);
+
+    /**
+    * @brief Lets save_state reference assets in an AssetPack instead of embedding identical bytes
+    *
+    * @note the pack is reopened by this path when the State is loaded, so it must stay in place
+    */
+    void state_reference_asset_pack(const std::filesystem::path& pack_path);
+
+    /**
+    * @brief Writes a block of bytes to a State Serial, during save_state identical blocks are stored once
+    *
+    * @note outside of save_state this is serial.writeBytes, read the bytes back with state_read_bytes
+    */
+    void state_write_bytes(Serial& serial, const void* data, size_t size);
+
+    /**
+    * @brief Reads a block of bytes written with state_write_bytes, size must match the written size
+    */
+    void state_read_bytes(Serial& serial, void* data, size_t size);
+
+    /**
+    * @brief Skips a block of bytes written with state_write_bytes without decoding it
+    */
+    void state_skip_bytes(Serial& serial, size_t size);
+
     /**
     * @brief Registers a constructor function such that State can accurately restore
     */
@@ -113,9 +163,31 @@ namespace dz {
     * @brief Saves the state to file or ostream
     *
     * @note Typically you would call this inside a window_register_free_callback (root window) 
+    * @note equivalent to save_state_async() followed by state_wait_saved()
     */
     bool save_state();
 
+    /**
+    * @brief Captures the state and returns without waiting for it to be written
+    *
+    * @note Restorables are backed up on the calling thread into compressed chunks, Image data is read back without stalling the GPU
+    * @note the file (or ostream) is written on the ThreadPool once every readback has landed, a file is replaced atomically
+    * @note the ostream set by set_state_ostream must remain valid until state_wait_saved returns
+    */
+    bool save_state_async();
+
+    /**
+    * @brief Blocks until the most recent save_state_async has been written
+    *
+    * @returns bool value indicating the write succeeded, true if nothing was pending
+    */
+    bool state_wait_saved();
+
+    /**
+    * @brief returns true while a save_state_async is still being captured or written
+    */
+    bool is_state_saving();
+
     /**
     * @brief Loads the State from file or istream
     *
@@ -124,6 +196,29 @@ namespace dz {
     */
     bool load_state();
 
+    /**
+    * @brief Enables delta tracking, the current state of every tracked Restorable becomes the delta baseline
+    *
+    * @note the baseline is moved forward by save_state, load_state, save_state_delta and apply_state_delta
+    */
+    void state_track_deltas(bool enable = true);
+
+    /**
+    * @brief Writes only what changed since the delta baseline, for autosave, undo/redo and replication
+    *
+    * @param reversible also writes the previous values so apply_state_delta can undo the delta
+    * @returns false when a Restorable changed in a way a delta cannot express, call save_state instead
+    * @note requires state_track_deltas, Restorables without delta support contribute nothing
+    */
+    bool save_state_delta(std::ostream& ostream, bool reversible = false);
+
+    /**
+    * @brief Applies a delta written by save_state_delta onto the tracked Restorables
+    *
+    * @param reverse undoes the delta instead, it must have been written reversible
+    */
+    bool apply_state_delta(std::istream& istream, bool reverse = false);
+
     /**
     * @brief Frees any Restorables that are owned by the StateHolder
     */
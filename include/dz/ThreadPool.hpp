@@ -0,0 +1,61 @@
+/**
+ * @file ThreadPool.hpp
+ * @brief A fixed size pool of worker threads for CPU side loading and processing work
+ */
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <type_traits>
+
+namespace dz
+{
+    struct ThreadPool;
+
+    /**
+     * @brief Creates a ThreadPool
+     *
+     * @param thread_count number of workers, 0 uses the hardware concurrency minus the calling thread
+     */
+    ThreadPool* thread_pool_create(size_t thread_count = 0);
+
+    /**
+     * @brief Finishes queued tasks, joins the workers and frees the ThreadPool
+     */
+    void thread_pool_free(ThreadPool* pool);
+
+    /**
+     * @brief returns the process wide ThreadPool shared by the loaders
+     */
+    ThreadPool* thread_pool_default();
+
+    /**
+     * @brief returns the number of worker threads in the pool
+     */
+    size_t thread_pool_get_thread_count(ThreadPool* pool);
+
+    /**
+     * @brief Queues a task to be run on a worker thread
+     */
+    void thread_pool_enqueue(ThreadPool* pool, std::function<void()> task);
+
+    /**
+     * @brief Runs fn(index) for every index in [0, count) across the pool and the calling thread, returns once all have run
+     *
+     * @note safe to call from a worker thread, the caller always makes progress itself
+     */
+    void thread_pool_parallel_for(ThreadPool* pool, size_t count, const std::function<void(size_t)>& fn);
+
+    /**
+     * @brief Queues a callable and returns a future for its result
+     */
+    template<typename TFunction>
+    auto thread_pool_submit(ThreadPool* pool, TFunction&& function) -> std::future<std::invoke_result_t<std::decay_t<TFunction>>> {
+        using TResult = std::invoke_result_t<std::decay_t<TFunction>>;
+        auto task = std::make_shared<std::packaged_task<TResult()>>(std::forward<TFunction>(function));
+        auto future = task->get_future();
+        thread_pool_enqueue(pool, [task]() { (*task)(); });
+        return future;
+    }
+}
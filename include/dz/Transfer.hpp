@@ -0,0 +1,75 @@
+/**
+ * @file Transfer.hpp
+ * @brief Batched staging uploads and readbacks between CPU memory and GPU Images
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace dz
+{
+    struct Image;
+
+    /**
+     * @brief Called once a queued upload has completed on the GPU
+     */
+    using TransferUploadCallback = std::function<void()>;
+
+    /**
+     * @brief Called once a queued readback has completed, data points into staging memory and is only valid during the call
+     */
+    using TransferReadbackCallback = std::function<void(void* data, size_t size)>;
+
+    /**
+     * @brief Opens a transfer batch, uploads and readbacks issued until the matching transfer_batch_end are recorded into a single submission
+     *
+     * @note batches may be nested, only the outermost transfer_batch_end submits and waits
+     */
+    void transfer_batch_begin();
+
+    /**
+     * @brief Closes a transfer batch, submitting every queued request and waiting on a single fence for completion
+     */
+    void transfer_batch_end();
+
+    /**
+     * @brief Queues an upload of data into the given mip level of an Image
+     *
+     * @note data is copied into the staging ring immediately so it may be released once this returns
+     * @note queued requests are submitted by transfer_flush, which is called before each frame and compute dispatch
+     */
+    void image_upload_data_async(Image* image_ptr, uint32_t mip, const void* data, TransferUploadCallback on_complete = {});
+
+    /**
+     * @brief Queues a readback of the given mip level of an Image, on_complete is invoked from transfer_poll once finished
+     */
+    void image_get_data_async(Image* image_ptr, int mip, TransferReadbackCallback on_complete);
+
+    /**
+     * @brief Submits every queued upload and readback without waiting for them
+     */
+    void transfer_flush();
+
+    /**
+     * @brief Retires completed submissions and invokes their callbacks, never blocks
+     */
+    void transfer_poll();
+
+    /**
+     * @brief Submits queued requests and blocks until every in flight transfer has completed
+     */
+    void transfer_wait_idle();
+
+    /**
+     * @brief Sets the capacity in bytes of the persistent staging ring
+     *
+     * @note must be called before the first transfer, requests larger than the ring use a dedicated staging buffer
+     */
+    void transfer_set_staging_size(size_t size);
+
+    /**
+     * @brief returns true if the device exposes a queue family dedicated to transfers and uploads use it
+     */
+    bool transfer_has_dedicated_queue();
+}
@@ -0,0 +1,419 @@
+/**
+ * @file math_simd.hpp
+ * @brief 4 wide float kernels backing the vec<float, 4>, quat<float>, mat<float, 4, 4> and AABB batch paths in math.hpp
+ *
+ * SSE is used on x86 and NEON on AArch64, define DZ_MATH_NO_SIMD to fall back to the scalar templates.
+ * The kernels work on plain float arrays so the vec and mat layouts are untouched.
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+#if !defined(DZ_MATH_NO_SIMD)
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define DZ_MATH_SSE 1
+#include <xmmintrin.h>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DZ_MATH_SSE2 1
+#include <emmintrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define DZ_MATH_NEON 1
+#include <arm_neon.h>
+#endif
+#endif
+
+#if defined(DZ_MATH_SSE) || defined(DZ_MATH_NEON)
+#define DZ_MATH_SIMD 1
+#endif
+
+namespace dz::simd
+{
+#if defined(DZ_MATH_SIMD)
+    inline constexpr bool enabled = true;
+#else
+    inline constexpr bool enabled = false;
+#endif
+
+#if defined(DZ_MATH_SSE)
+    using f4 = __m128;
+
+    inline f4 load(const float* p) { return _mm_loadu_ps(p); }
+    inline void store(float* p, f4 v) { _mm_storeu_ps(p, v); }
+    inline f4 splat(float v) { return _mm_set1_ps(v); }
+    inline f4 set(float x, float y, float z, float w) { return _mm_setr_ps(x, y, z, w); }
+    inline f4 add(f4 a, f4 b) { return _mm_add_ps(a, b); }
+    inline f4 sub(f4 a, f4 b) { return _mm_sub_ps(a, b); }
+    inline f4 mul(f4 a, f4 b) { return _mm_mul_ps(a, b); }
+    inline f4 div(f4 a, f4 b) { return _mm_div_ps(a, b); }
+    inline f4 sqrt(f4 a) { return _mm_sqrt_ps(a); }
+    inline f4 min(f4 a, f4 b) { return _mm_min_ps(a, b); }
+    inline f4 max(f4 a, f4 b) { return _mm_max_ps(a, b); }
+    inline f4 abs(f4 a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+    inline void transpose(f4& r0, f4& r1, f4& r2, f4& r3) { _MM_TRANSPOSE4_PS(r0, r1, r2, r3); }
+#elif defined(DZ_MATH_NEON)
+    using f4 = float32x4_t;
+
+    inline f4 load(const float* p) { return vld1q_f32(p); }
+    inline void store(float* p, f4 v) { vst1q_f32(p, v); }
+    inline f4 splat(float v) { return vdupq_n_f32(v); }
+    inline f4 set(float x, float y, float z, float w) { const float v[4] = {x, y, z, w}; return vld1q_f32(v); }
+    inline f4 add(f4 a, f4 b) { return vaddq_f32(a, b); }
+    inline f4 sub(f4 a, f4 b) { return vsubq_f32(a, b); }
+    inline f4 mul(f4 a, f4 b) { return vmulq_f32(a, b); }
+    inline f4 div(f4 a, f4 b) { return vdivq_f32(a, b); }
+    inline f4 sqrt(f4 a) { return vsqrtq_f32(a); }
+    inline f4 min(f4 a, f4 b) { return vminq_f32(a, b); }
+    inline f4 max(f4 a, f4 b) { return vmaxq_f32(a, b); }
+    inline f4 abs(f4 a) { return vabsq_f32(a); }
+    inline void transpose(f4& r0, f4& r1, f4& r2, f4& r3)
+    {
+        auto t01 = vtrnq_f32(r0, r1);
+        auto t23 = vtrnq_f32(r2, r3);
+        r0 = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+        r1 = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+        r2 = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+        r3 = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+    }
+#else
+    struct f4 { float v[4]; };
+
+    inline f4 load(const float* p) { f4 r; memcpy(r.v, p, sizeof(r.v)); return r; }
+    inline void store(float* p, f4 a) { memcpy(p, a.v, sizeof(a.v)); }
+    inline f4 splat(float v) { return {{v, v, v, v}}; }
+    inline f4 set(float x, float y, float z, float w) { return {{x, y, z, w}}; }
+    inline f4 add(f4 a, f4 b) { return {{a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]}}; }
+    inline f4 sub(f4 a, f4 b) { return {{a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3]}}; }
+    inline f4 mul(f4 a, f4 b) { return {{a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3]}}; }
+    inline f4 div(f4 a, f4 b) { return {{a.v[0] / b.v[0], a.v[1] / b.v[1], a.v[2] / b.v[2], a.v[3] / b.v[3]}}; }
+    inline f4 sqrt(f4 a) { return {{std::sqrt(a.v[0]), std::sqrt(a.v[1]), std::sqrt(a.v[2]), std::sqrt(a.v[3])}}; }
+    inline f4 min(f4 a, f4 b) { return {{std::fmin(a.v[0], b.v[0]), std::fmin(a.v[1], b.v[1]), std::fmin(a.v[2], b.v[2]), std::fmin(a.v[3], b.v[3])}}; }
+    inline f4 max(f4 a, f4 b) { return {{std::fmax(a.v[0], b.v[0]), std::fmax(a.v[1], b.v[1]), std::fmax(a.v[2], b.v[2]), std::fmax(a.v[3], b.v[3])}}; }
+    inline f4 abs(f4 a) { return {{std::fabs(a.v[0]), std::fabs(a.v[1]), std::fabs(a.v[2]), std::fabs(a.v[3])}}; }
+    inline void transpose(f4& r0, f4& r1, f4& r2, f4& r3)
+    {
+        f4 c0 = {{r0.v[0], r1.v[0], r2.v[0], r3.v[0]}};
+        f4 c1 = {{r0.v[1], r1.v[1], r2.v[1], r3.v[1]}};
+        f4 c2 = {{r0.v[2], r1.v[2], r2.v[2], r3.v[2]}};
+        f4 c3 = {{r0.v[3], r1.v[3], r2.v[3], r3.v[3]}};
+        r0 = c0; r1 = c1; r2 = c2; r3 = c3;
+    }
+#endif
+
+    inline void add4(float* out, const float* a, const float* b) { store(out, add(load(a), load(b))); }
+    inline void sub4(float* out, const float* a, const float* b) { store(out, sub(load(a), load(b))); }
+    inline void mul4(float* out, const float* a, const float* b) { store(out, mul(load(a), load(b))); }
+    inline void div4(float* out, const float* a, const float* b) { store(out, div(load(a), load(b))); }
+    inline void add4(float* out, const float* a, float b) { store(out, add(load(a), splat(b))); }
+    inline void sub4(float* out, const float* a, float b) { store(out, sub(load(a), splat(b))); }
+    inline void mul4(float* out, const float* a, float b) { store(out, mul(load(a), splat(b))); }
+    inline void div4(float* out, const float* a, float b) { store(out, div(load(a), splat(b))); }
+
+    /**
+    * @brief column-major 4x4 product out = a * b, out may alias a or b
+    *
+    * Each output column accumulates a's columns in k order, the same order as the scalar loop.
+    */
+    inline void mat4_mul(float* out, const float* a, const float* b)
+    {
+        f4 a0 = load(a), a1 = load(a + 4), a2 = load(a + 8), a3 = load(a + 12);
+        f4 columns[4];
+        for (size_t c = 0; c < 4; ++c)
+        {
+            const float* bc = b + c * 4;
+            f4 sum = mul(a0, splat(bc[0]));
+            sum = add(sum, mul(a1, splat(bc[1])));
+            sum = add(sum, mul(a2, splat(bc[2])));
+            sum = add(sum, mul(a3, splat(bc[3])));
+            columns[c] = sum;
+        }
+        for (size_t c = 0; c < 4; ++c)
+            store(out + c * 4, columns[c]);
+    }
+
+    /**
+    * @brief out = m * (x, y, z, w) for a column-major 4x4 m
+    */
+    inline f4 mat4_transform(f4 m0, f4 m1, f4 m2, f4 m3, float x, float y, float z, float w)
+    {
+        f4 sum = mul(m0, splat(x));
+        sum = add(sum, mul(m1, splat(y)));
+        sum = add(sum, mul(m2, splat(z)));
+        return add(sum, mul(m3, splat(w)));
+    }
+
+    /**
+    * @brief transforms count xyz points (w = 1) by m, in and out may be the same array
+    */
+    inline void mat4_transform_points(const float* m, const float* in, float* out, size_t count)
+    {
+        f4 m0 = load(m), m1 = load(m + 4), m2 = load(m + 8), m3 = load(m + 12);
+        float result[4];
+        for (size_t i = 0; i < count; ++i, in += 3, out += 3)
+        {
+            store(result, mat4_transform(m0, m1, m2, m3, in[0], in[1], in[2], 1.0f));
+            memcpy(out, result, sizeof(float) * 3);
+        }
+    }
+
+    /**
+    * @brief transforms count xyzw vectors by m, in and out may be the same array
+    */
+    inline void mat4_transform_vec4s(const float* m, const float* in, float* out, size_t count)
+    {
+        f4 m0 = load(m), m1 = load(m + 4), m2 = load(m + 8), m3 = load(m + 12);
+        for (size_t i = 0; i < count; ++i, in += 4, out += 4)
+            store(out, mat4_transform(m0, m1, m2, m3, in[0], in[1], in[2], in[3]));
+    }
+
+    /**
+    * @brief rotation matrix of a unit quaternion stored (w, x, y, z), laid out like quat_to_mat4
+    */
+    inline void quat_to_mat4(const float* q, float* out)
+    {
+        float w = q[0], x = q[1], y = q[2], z = q[3];
+        f4 two = splat(2.0f);
+        // (yy, xy, xz) + (zz, -wz, wy) and friends, then 1 - 2(..) on the diagonal and 2(..) elsewhere
+        f4 c0 = add(mul(set(y, x, x, 0), set(y, y, z, 0)), mul(set(z, -w, w, 0), set(z, z, y, 0)));
+        f4 c1 = add(mul(set(x, x, y, 0), set(y, x, z, 0)), mul(set(w, z, -w, 0), set(z, z, x, 0)));
+        f4 c2 = add(mul(set(x, y, x, 0), set(z, z, x, 0)), mul(set(-w, w, y, 0), set(y, x, y, 0)));
+        c0 = mul(c0, two);
+        c1 = mul(c1, two);
+        c2 = mul(c2, two);
+        store(out, sub(set(1, 0, 0, 0), mul(c0, set(1, -1, -1, 0))));
+        store(out + 4, sub(set(0, 1, 0, 0), mul(c1, set(-1, 1, -1, 0))));
+        store(out + 8, sub(set(0, 0, 1, 0), mul(c2, set(-1, -1, 1, 0))));
+        store(out + 12, set(0, 0, 0, 1));
+    }
+
+    /**
+    * @brief lengths of the xyz parts of the first three columns of a column-major 4x4
+    */
+    inline void mat4_column_lengths3(const float* m, float* lengths)
+    {
+        f4 r0 = load(m), r1 = load(m + 4), r2 = load(m + 8), r3 = load(m + 12);
+        transpose(r0, r1, r2, r3);
+        // the rows now hold the x, y and z of every column, summed in the same order as vec::length
+        f4 sum = add(add(mul(r0, r0), mul(r1, r1)), mul(r2, r2));
+        float result[4];
+        store(result, sqrt(sum));
+        memcpy(lengths, result, sizeof(float) * 3);
+    }
+
+    /**
+    * @brief transforms count boxes stored (min xyz, max xyz) by a column-major 4x4, in and out may be the same array
+    *
+    * Works on the centre and half extent, the new half extent is the old one taken through |m|.
+    */
+    inline void aabb_transform(const float* m, const float* in, float* out, size_t count)
+    {
+        f4 m0 = load(m), m1 = load(m + 4), m2 = load(m + 8), m3 = load(m + 12);
+        f4 a0 = abs(m0), a1 = abs(m1), a2 = abs(m2);
+        float lo[4], hi[4];
+        for (size_t i = 0; i < count; ++i, in += 6, out += 6)
+        {
+            float cx = (in[0] + in[3]) * 0.5f, cy = (in[1] + in[4]) * 0.5f, cz = (in[2] + in[5]) * 0.5f;
+            float ex = (in[3] - in[0]) * 0.5f, ey = (in[4] - in[1]) * 0.5f, ez = (in[5] - in[2]) * 0.5f;
+            f4 center = mat4_transform(m0, m1, m2, m3, cx, cy, cz, 1.0f);
+            f4 extent = add(add(mul(a0, splat(ex)), mul(a1, splat(ey))), mul(a2, splat(ez)));
+            store(lo, sub(center, extent));
+            store(hi, add(center, extent));
+            memcpy(out, lo, sizeof(float) * 3);
+            memcpy(out + 3, hi, sizeof(float) * 3);
+        }
+    }
+
+    /**
+    * @brief bounds (min xyz, max xyz) of count xyzw positions, w is ignored
+    */
+    inline void positions_bounds(const float* positions, size_t count, float* out)
+    {
+        if (!count)
+            return;
+        f4 lo = load(positions), hi = lo;
+        for (size_t i = 1; i < count; ++i)
+        {
+            f4 p = load(positions + i * 4);
+            lo = min(lo, p);
+            hi = max(hi, p);
+        }
+        float result[4];
+        store(result, lo);
+        memcpy(out, result, sizeof(float) * 3);
+        store(result, hi);
+        memcpy(out + 3, result, sizeof(float) * 3);
+    }
+
+    /**
+    * @brief loads four boxes (min xyz, max xyz) as six lanes of x, y and z, repeating the first box past count
+    */
+    inline void gather_boxes4(const float* boxes, size_t count, f4 lanes[6])
+    {
+        alignas(16) float soa[6][4];
+        for (size_t l = 0; l < 4; ++l)
+        {
+            const float* box = boxes + (l < count ? l : 0) * 6;
+            for (size_t k = 0; k < 6; ++k)
+                soa[k][l] = box[k];
+        }
+        for (size_t k = 0; k < 6; ++k)
+            lanes[k] = load(soa[k]);
+    }
+
+    /**
+    * @brief slab test of one ray against count boxes (min xyz, max xyz), four boxes per step
+    *
+    * hits[i] receives the entry distance (0 when the origin is inside) or -1 when box i is missed or entered past t_max.
+    */
+    inline void aabbs_ray_test(const float* boxes, size_t count, const float* origin, const float* inv_direction, float t_max, float* hits)
+    {
+        f4 ox = splat(origin[0]), oy = splat(origin[1]), oz = splat(origin[2]);
+        f4 ix = splat(inv_direction[0]), iy = splat(inv_direction[1]), iz = splat(inv_direction[2]);
+        f4 zero = splat(0.0f), limit = splat(t_max);
+        f4 b[6];
+        float near_t[4], far_t[4];
+        for (size_t i = 0; i < count; i += 4, boxes += 24)
+        {
+            size_t lanes = count - i < 4 ? count - i : 4;
+            gather_boxes4(boxes, lanes, b);
+            f4 x0 = mul(sub(b[0], ox), ix), x1 = mul(sub(b[3], ox), ix);
+            f4 y0 = mul(sub(b[1], oy), iy), y1 = mul(sub(b[4], oy), iy);
+            f4 z0 = mul(sub(b[2], oz), iz), z1 = mul(sub(b[5], oz), iz);
+            f4 t_near = max(max(min(x0, x1), min(y0, y1)), max(min(z0, z1), zero));
+            f4 t_far = min(min(max(x0, x1), max(y0, y1)), min(max(z0, z1), limit));
+            store(near_t, t_near);
+            store(far_t, t_far);
+            for (size_t l = 0; l < lanes; ++l)
+                hits[i + l] = near_t[l] <= far_t[l] ? near_t[l] : -1.0f;
+        }
+    }
+
+    /**
+    * @brief tests count boxes (min xyz, max xyz) against six inward facing planes (xyz normal, w distance)
+    *
+    * visible[i] is 0 when box i lies fully behind one of the planes, 1 otherwise.
+    */
+    inline void aabbs_frustum_test(const float* planes, const float* boxes, size_t count, uint8_t* visible)
+    {
+        f4 b[6];
+        float distances[4];
+        for (size_t i = 0; i < count; i += 4, boxes += 24)
+        {
+            size_t lanes = count - i < 4 ? count - i : 4;
+            gather_boxes4(boxes, lanes, b);
+            f4 nearest;
+            for (size_t p = 0; p < 6; ++p)
+            {
+                const float* plane = planes + p * 4;
+                // the corner furthest along the plane normal
+                f4 px = plane[0] >= 0.0f ? b[3] : b[0];
+                f4 py = plane[1] >= 0.0f ? b[4] : b[1];
+                f4 pz = plane[2] >= 0.0f ? b[5] : b[2];
+                f4 distance = add(add(add(mul(px, splat(plane[0])), mul(py, splat(plane[1]))), mul(pz, splat(plane[2]))), splat(plane[3]));
+                nearest = p ? min(nearest, distance) : distance;
+            }
+            store(distances, nearest);
+            for (size_t l = 0; l < lanes; ++l)
+                visible[i + l] = distances[l] >= 0.0f;
+        }
+    }
+
+#if defined(DZ_MATH_SSE2)
+    using u4 = __m128i;
+
+    inline void store(uint32_t* p, u4 v) { _mm_storeu_si128((__m128i*)p, v); }
+    inline u4 add(u4 a, u4 b) { return _mm_add_epi32(a, b); }
+    inline u4 bit_xor(u4 a, u4 b) { return _mm_xor_si128(a, b); }
+    inline u4 bit_or(u4 a, u4 b) { return _mm_or_si128(a, b); }
+    template <int N> inline u4 shl(u4 a) { return _mm_slli_epi32(a, N); }
+    template <int N> inline u4 shr(u4 a) { return _mm_srli_epi32(a, N); }
+    /** @brief the top 24 bits of each lane as a float in [0, 1) */
+    inline f4 unit(u4 a) { return mul(_mm_cvtepi32_ps(shr<8>(a)), splat(1.0f / 16777216.0f)); }
+#elif defined(DZ_MATH_NEON)
+    using u4 = uint32x4_t;
+
+    inline void store(uint32_t* p, u4 v) { vst1q_u32(p, v); }
+    inline u4 add(u4 a, u4 b) { return vaddq_u32(a, b); }
+    inline u4 bit_xor(u4 a, u4 b) { return veorq_u32(a, b); }
+    inline u4 bit_or(u4 a, u4 b) { return vorrq_u32(a, b); }
+    template <int N> inline u4 shl(u4 a) { return vshlq_n_u32(a, N); }
+    template <int N> inline u4 shr(u4 a) { return vshrq_n_u32(a, N); }
+    inline f4 unit(u4 a) { return mul(vcvtq_f32_u32(shr<8>(a)), splat(1.0f / 16777216.0f)); }
+#else
+    struct u4 { uint32_t v[4]; };
+
+    inline void store(uint32_t* p, u4 a) { memcpy(p, a.v, sizeof(a.v)); }
+    inline u4 add(u4 a, u4 b) { return {{a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]}}; }
+    inline u4 bit_xor(u4 a, u4 b) { return {{a.v[0] ^ b.v[0], a.v[1] ^ b.v[1], a.v[2] ^ b.v[2], a.v[3] ^ b.v[3]}}; }
+    inline u4 bit_or(u4 a, u4 b) { return {{a.v[0] | b.v[0], a.v[1] | b.v[1], a.v[2] | b.v[2], a.v[3] | b.v[3]}}; }
+    template <int N> inline u4 shl(u4 a) { return {{a.v[0] << N, a.v[1] << N, a.v[2] << N, a.v[3] << N}}; }
+    template <int N> inline u4 shr(u4 a) { return {{a.v[0] >> N, a.v[1] >> N, a.v[2] >> N, a.v[3] >> N}}; }
+    inline f4 unit(u4 a)
+    {
+        const float k = 1.0f / 16777216.0f;
+        return set(float(a.v[0] >> 8) * k, float(a.v[1] >> 8) * k, float(a.v[2] >> 8) * k, float(a.v[3] >> 8) * k);
+    }
+#endif
+
+    template <int N> inline u4 rotl(u4 a) { return bit_or(shl<N>(a), shr<32 - N>(a)); }
+
+    /**
+    * @brief four independent xoshiro128** generators, one per lane
+    */
+    struct RandomLanes
+    {
+        u4 s[4];
+    };
+
+    inline u4 next(RandomLanes& lanes)
+    {
+        u4 s1 = lanes.s[1];
+        // * 5 and * 9 as shift + add, 32 bit lane multiplies need SSE4.1
+        u4 result = rotl<7>(add(shl<2>(s1), s1));
+        result = add(shl<3>(result), result);
+        u4 t = shl<9>(s1);
+        lanes.s[2] = bit_xor(lanes.s[2], lanes.s[0]);
+        lanes.s[3] = bit_xor(lanes.s[3], lanes.s[1]);
+        lanes.s[1] = bit_xor(lanes.s[1], lanes.s[2]);
+        lanes.s[0] = bit_xor(lanes.s[0], lanes.s[3]);
+        lanes.s[2] = bit_xor(lanes.s[2], t);
+        lanes.s[3] = rotl<11>(lanes.s[3]);
+        return result;
+    }
+
+    /**
+    * @brief fills out with floats in [min, max) using 24 random bits each
+    */
+    inline void fill_uniform(RandomLanes& lanes, float* out, size_t count, float min, float max)
+    {
+        f4 low = splat(min);
+        f4 range = splat(max - min);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+            store(out + i, add(low, mul(unit(next(lanes)), range)));
+        if (i < count)
+        {
+            float tail[4];
+            store(tail, add(low, mul(unit(next(lanes)), range)));
+            memcpy(out + i, tail, (count - i) * sizeof(float));
+        }
+    }
+
+    /**
+    * @brief fills out with uniformly random 32 bit values
+    */
+    inline void fill_bits(RandomLanes& lanes, uint32_t* out, size_t count)
+    {
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+            store(out + i, next(lanes));
+        if (i < count)
+        {
+            uint32_t tail[4];
+            store(tail, next(lanes));
+            memcpy(out + i, tail, (count - i) * sizeof(uint32_t));
+        }
+    }
+}
\ No newline at end of file
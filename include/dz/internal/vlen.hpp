@@ -13,4 +13,40 @@ namespace vlen {
         read_bytes += sizeof(result);
         return true;
     }
-}
\ No newline at end of file
+
+    /**
+     * @brief appends value as a LEB128 varint, 7 bits per byte with the high bit marking a continuation
+     */
+    inline void write_varint(std::vector<char>& out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(char((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(char(value));
+    }
+
+    /**
+     * @brief reads a LEB128 varint at cursor and advances it, returns false if it runs past end
+     */
+    inline bool read_varint(const char*& cursor, const char* end, uint64_t& result) {
+        result = 0;
+        for (uint32_t shift = 0; shift < 64 && cursor < end; shift += 7) {
+            auto byte = uint8_t(*cursor++);
+            result |= uint64_t(byte & 0x7F) << shift;
+            if (!(byte & 0x80))
+                return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief maps signed values to unsigned so small magnitudes of either sign stay short as varints
+     */
+    inline uint64_t zigzag_encode(int64_t value) {
+        return (uint64_t(value) << 1) ^ uint64_t(value >> 63);
+    }
+
+    inline int64_t zigzag_decode(uint64_t value) {
+        return int64_t(value >> 1) ^ -int64_t(value & 1);
+    }
+}
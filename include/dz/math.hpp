@@ -5,14 +5,19 @@
 #pragma once
 #include <cassert>
 #include <cmath>
+#include <limits>
+#include <algorithm>
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 #include <random>
 #include <chrono>
+#include <span>
+#include <thread>
 #include <stdexcept>
 #include <string.h>
 #include "Renderer.hpp"
+#include "internal/math_simd.hpp"
 namespace dz
 {
     /**
@@ -178,14 +183,21 @@ namespace dz
         template <typename O>
         vec& operator*=(const O& other)
         {
-            for (size_t i = 0; i < N; ++i)
+            if constexpr (simd::enabled && std::is_same_v<T, float> && N == 4 && std::is_same_v<O, T>)
+                simd::mul4(data, data, other);
+            else if constexpr (simd::enabled && std::is_same_v<T, float> && N == 4 && std::is_same_v<O, vec<T, N>>)
+                simd::mul4(data, data, other.data);
+            else
             {
-                if constexpr (std::is_same_v<O, T>)
-                    data[i] *= other;
-                else if constexpr (std::is_same_v<O, vec<T, N>>)
-                    data[i] *= other.data[i];
-                else
-                    throw std::runtime_error("Unsupported O type");
+                for (size_t i = 0; i < N; ++i)
+                {
+                    if constexpr (std::is_same_v<O, T>)
+                        data[i] *= other;
+                    else if constexpr (std::is_same_v<O, vec<T, N>>)
+                        data[i] *= other.data[i];
+                    else
+                        throw std::runtime_error("Unsupported O type");
+                }
             }
             return *this;
         }
@@ -204,14 +216,21 @@ namespace dz
         template <typename O>
         vec& operator/=(const O& other)
         {
-            for (size_t i = 0; i < N; ++i)
+            if constexpr (simd::enabled && std::is_same_v<T, float> && N == 4 && std::is_same_v<O, T>)
+                simd::div4(data, data, other);
+            else if constexpr (simd::enabled && std::is_same_v<T, float> && N == 4 && std::is_same_v<O, vec<T, N>>)
+                simd::div4(data, data, other.data);
+            else
             {
-                if constexpr (std::is_same_v<O, T>)
-                    data[i] /= other;
-                else if constexpr (std::is_same_v<O, vec<T, N>>)
-                    data[i] /= other.data[i];
-                else
-                    throw std::runtime_error("Unsupported O type");
+                for (size_t i = 0; i < N; ++i)
+                {
+                    if constexpr (std::is_same_v<O, T>)
+                        data[i] /= other;
+                    else if constexpr (std::is_same_v<O, vec<T, N>>)
+                        data[i] /= other.data[i];
+                    else
+                        throw std::runtime_error("Unsupported O type");
+                }
             }
             return *this;
         }
@@ -230,14 +249,21 @@ namespace dz
         template <typename O>
         vec& operator+=(const O& other)
         {
-            for (size_t i = 0; i < N; ++i)
+            if constexpr (simd::enabled && std::is_same_v<T, float> && N == 4 && std::is_same_v<O, T>)
+                simd::add4(data, data, other);
+            else if constexpr (simd::enabled && std::is_same_v<T, float> && N == 4 && std::is_same_v<O, vec<T, N>>)
+                simd::add4(data, data, other.data);
+            else
             {
-                if constexpr (std::is_same_v<O, T>)
-                    data[i] += other;
-                else if constexpr (std::is_same_v<O, vec<T, N>>)
-                    data[i] += other.data[i];
-                else
-                    throw std::runtime_error("Unsupported O type");
+                for (size_t i = 0; i < N; ++i)
+                {
+                    if constexpr (std::is_same_v<O, T>)
+                        data[i] += other;
+                    else if constexpr (std::is_same_v<O, vec<T, N>>)
+                        data[i] += other.data[i];
+                    else
+                        throw std::runtime_error("Unsupported O type");
+                }
             }
             return *this;
         }
@@ -256,14 +282,21 @@ namespace dz
         template <typename O>
         vec& operator-=(const O& other)
         {
-            for (size_t i = 0; i < N; ++i)
+            if constexpr (simd::enabled && std::is_same_v<T, float> && N == 4 && std::is_same_v<O, T>)
+                simd::sub4(data, data, other);
+            else if constexpr (simd::enabled && std::is_same_v<T, float> && N == 4 && std::is_same_v<O, vec<T, N>>)
+                simd::sub4(data, data, other.data);
+            else
             {
-                if constexpr (std::is_same_v<O, T>)
-                    data[i] -= other;
-                else if constexpr (std::is_same_v<O, vec<T, N>>)
-                    data[i] -= other.data[i];
-                else
-                    throw std::runtime_error("Unsupported O type");
+                for (size_t i = 0; i < N; ++i)
+                {
+                    if constexpr (std::is_same_v<O, T>)
+                        data[i] -= other;
+                    else if constexpr (std::is_same_v<O, vec<T, N>>)
+                        data[i] -= other.data[i];
+                    else
+                        throw std::runtime_error("Unsupported O type");
+                }
             }
             return *this;
         }
@@ -1022,6 +1055,12 @@ namespace dz
         {
             static_assert(C == R2, "Matrix multiplication dimension mismatch");
 
+            if constexpr (simd::enabled && std::is_same_v<T, float> && C == 4 && R == 4 && C2 == 4)
+            {
+                simd::mat4_mul(&matrix[0][0], &matrix[0][0], &rhs.matrix[0][0]);
+                return *this;
+            }
+
             // Temporary storage for results
             T temp[C2][R];
 
@@ -1084,9 +1123,14 @@ namespace dz
             vec<float, 3> col1 = vec<float, 3>{ m[1][0], m[1][1], m[1][2] };
             vec<float, 3> col2 = vec<float, 3>{ m[2][0], m[2][1], m[2][2] };
 
-            scale[0] = col0.length();
-            scale[1] = col1.length();
-            scale[2] = col2.length();
+            if constexpr (simd::enabled && std::is_same_v<T, float> && C == 4 && R == 4)
+                simd::mat4_column_lengths3(&matrix[0][0], scale.data);
+            else
+            {
+                scale[0] = col0.length();
+                scale[1] = col1.length();
+                scale[2] = col2.length();
+            }
             scale[3] = 1.0f;
 
             if (scale[0] == 0.0f || scale[1] == 0.0f || scale[2] == 0.0f)
@@ -1481,102 +1525,205 @@ namespace dz
 		return radians * T(57.295779513082320876798154814105);
 	}
 
+    /**
+    * @brief xoshiro256** generator, 32 bytes of state and usable with the std distributions.
+    *
+    * Seeding expands a single 64-bit value through splitmix64 so nearby seeds give unrelated streams.
+    */
+    struct RandomEngine
+    {
+        using result_type = std::uint64_t;
+
+        std::uint64_t state[4];
+
+        explicit RandomEngine(std::uint64_t seed = 0)
+        {
+            this->seed(seed);
+        }
+
+        void seed(std::uint64_t seed)
+        {
+            for (auto& word : state)
+            {
+                seed += 0x9E3779B97F4A7C15ull;
+                std::uint64_t z = seed;
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+                word = z ^ (z >> 31);
+            }
+        }
+
+        static constexpr result_type min() { return 0; }
+        static constexpr result_type max() { return UINT64_MAX; }
+
+        result_type operator()()
+        {
+            auto rotl = [](std::uint64_t x, int k) { return (x << k) | (x >> (64 - k)); };
+            std::uint64_t result = rotl(state[1] * 5, 7) * 9;
+            std::uint64_t t = state[1] << 17;
+            state[2] ^= state[0];
+            state[3] ^= state[1];
+            state[1] ^= state[2];
+            state[0] ^= state[3];
+            state[2] ^= t;
+            state[3] = rotl(state[3], 45);
+            return result;
+        }
+
+        /**
+        * @brief returns a uniformly distributed value in [0, bound) without modulo bias
+        */
+        std::uint64_t bounded(std::uint64_t bound)
+        {
+            if (bound <= UINT32_MAX)
+            {
+                // Lemire's multiply and reject, the reject branch is rarely taken
+                auto range = std::uint32_t(bound);
+                std::uint64_t m = ((*this)() >> 32) * range;
+                if (std::uint32_t(m) < range)
+                {
+                    std::uint32_t threshold = std::uint32_t(0u - range) % range;
+                    while (std::uint32_t(m) < threshold)
+                        m = ((*this)() >> 32) * range;
+                }
+                return m >> 32;
+            }
+            std::uint64_t limit = UINT64_MAX - UINT64_MAX % bound;
+            std::uint64_t x;
+            do
+                x = (*this)();
+            while (x >= limit);
+            return x % bound;
+        }
+    };
+
     /**
     * @brief Utility class for generating random values with optional seeding and support for multiple numeric types.
     *
     * Provides static methods to generate uniformly distributed random numbers for integral and floating-point types.
+    * Unseeded calls draw from a per thread RandomEngine seeded once, so they are thread safe and do not reseed.
     * Supports generating random values within a specified range, optionally with a user-provided seed or external random engine.
-    * Also supports choosing random values from multiple ranges.
+    * Also supports choosing random values from multiple ranges and filling whole arrays.
     */
     struct Random
     {
     private:
 
         /**
-        * @brief Random device used to seed the default Mersenne Twister engine.
+        * @brief Seed for a new thread's engine, mixes the random device, the clock and the thread id.
         */
-        inline static std::random_device _randomDevice = {};
+        static std::uint64_t thread_seed()
+        {
+            std::random_device device;
+            auto nanos = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+            auto thread_hash = std::hash<std::thread::id>()(std::this_thread::get_id());
+            return ((std::uint64_t(device()) << 32) | device()) ^ std::uint64_t(nanos) ^ (std::uint64_t(thread_hash) * 0x9E3779B97F4A7C15ull);
+        }
 
-        /**
-        * @brief Default Mersenne Twister random number generator initialized with _randomDevice.
-        */
-        inline static std::mt19937 _mt19937 = std::mt19937(_randomDevice());
+        template <typename T>
+        static void fill_values(T* values, size_t count, T min, T max, RandomEngine& engine)
+        {
+            if constexpr (std::is_same_v<T, float> || std::is_same_v<T, std::int32_t> || std::is_same_v<T, std::uint32_t>)
+            {
+                simd::RandomLanes lanes;
+                std::uint64_t words[8];
+                for (auto& word : words)
+                    word = engine();
+                memcpy(&lanes, words, sizeof(lanes));
+                if constexpr (std::is_same_v<T, float>)
+                    simd::fill_uniform(lanes, values, count, min, max);
+                else
+                {
+                    auto bits = (std::uint32_t*)values;
+                    simd::fill_bits(lanes, bits, count);
+                    std::uint64_t range = std::uint64_t(std::int64_t(max) - std::int64_t(min)) + 1;
+                    if (range > UINT32_MAX)
+                        return;
+                    // map the raw lanes with Lemire's multiply, redrawing the rare biased ones from the engine
+                    auto bound = std::uint32_t(range);
+                    std::uint32_t threshold = std::uint32_t(0u - bound) % bound;
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        std::uint64_t m = std::uint64_t(bits[i]) * bound;
+                        while (std::uint32_t(m) < threshold)
+                            m = (engine() >> 32) * bound;
+                        values[i] = T(std::int64_t(min) + std::int64_t(m >> 32));
+                    }
+                }
+            }
+            else
+            {
+                for (size_t i = 0; i < count; ++i)
+                    values[i] = value(min, max, engine);
+            }
+        }
+
+    public:
 
         /**
-        * @brief Helper function to reseed the default mt19937 engine using current high-resolution time.
-        *
-        * This improves randomness by using a time-based seed instead of fixed or device-based seed.
+        * @brief returns the calling thread's engine, seeded on first use
         */
-        inline static void reseed_mt19937_with_current_time()
+        static RandomEngine& engine()
         {
-            auto now = std::chrono::high_resolution_clock::now();
-            auto duration = now.time_since_epoch();
-            auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
-            std::uint32_t new_seed = static_cast<std::uint32_t>(nanos & 0xFFFFFFFF);
-            _mt19937.seed(new_seed);
+            thread_local RandomEngine engine(thread_seed());
+            return engine;
         }
 
-    public:
-
         /**
         * @brief Generate a uniformly distributed random value in [min, max].
         *
-        * If a seed is provided (not the default max size_t), a new temporary mt19937 engine is created and seeded with the given seed.
-        * Otherwise, the internal static mt19937 engine is reseeded with the current time and used.
+        * If a seed is provided (not the default max size_t), a temporary RandomEngine seeded with it is used,
+        * so the same seed always gives the same value. Otherwise the calling thread's engine is used.
         *
         * Supports floating point and integral types. Throws std::runtime_error if called with unsupported type.
         *
         * @tparam T Numeric type for the random value (must be integral or floating point).
         * @param min Minimum value of the random range (inclusive).
         * @param max Maximum value of the random range (inclusive for integral, [min,max) for floating point).
-        * @param seed Optional seed to create a temporary mt19937 engine. Default is max size_t (no seed).
+        * @param seed Optional seed for a temporary engine. Default is max size_t (no seed).
         * @return Randomly generated value of type T.
         * @throws std::runtime_error if T is not supported.
         */
         template <typename T>
         static const T value(const T min, const T max, const size_t seed = (std::numeric_limits<size_t>::max)())
         {
-            std::mt19937* mt19937Pointer = nullptr;
-
             if (seed != (std::numeric_limits<size_t>::max)())
             {
-                // Create a temporary engine with the provided seed
-                mt19937Pointer = new std::mt19937(seed);
-            }
-            else
-            {
-                // Reseed static engine with current time and use it
-                reseed_mt19937_with_current_time();
-                mt19937Pointer = &Random::_mt19937;
+                RandomEngine seeded(seed);
+                return value(min, max, seeded);
             }
+            return value(min, max, engine());
+        };
 
-            if constexpr (std::is_floating_point<T>::value)
-            {
-                std::uniform_real_distribution<T> distrib(min, max);
-                auto value = distrib(*mt19937Pointer);
-
-                if (seed != (std::numeric_limits<size_t>::max)())
-                {
-                    delete mt19937Pointer;
-                    mt19937Pointer = nullptr;
-                }
-
-                return value;
-            }
+        /**
+        * @brief Generate a uniformly distributed random value in [min, max] using a provided RandomEngine.
+        *
+        * @tparam T Numeric type for the random value.
+        * @param min Minimum value of the random range (inclusive).
+        * @param max Maximum value of the random range (inclusive for integral, [min,max) for floating point).
+        * @param engine The engine to draw from.
+        * @return Randomly generated value of type T.
+        * @throws std::runtime_error if T is not supported.
+        */
+        template <typename T>
+        static const T value(const T min, const T max, RandomEngine& engine)
+        {
+            if constexpr (std::is_same_v<T, float>)
+                return min + float(engine() >> 40) * (1.0f / 16777216.0f) * (max - min);
+            else if constexpr (std::is_floating_point<T>::value)
+                return min + T(double(engine() >> 11) * (1.0 / 9007199254740992.0)) * (max - min);
             else if constexpr (std::is_integral<T>::value)
             {
-                std::uniform_int_distribution<T> distrib(min, max);
-                auto value = distrib(*mt19937Pointer);
-
-                if (seed != (std::numeric_limits<size_t>::max)())
+                if constexpr (std::is_same_v<T, bool>)
+                    return min == max ? min : bool(engine() >> 63);
+                else
                 {
-                    delete mt19937Pointer;
-                    mt19937Pointer = nullptr;
+                    auto range = std::uint64_t(max) - std::uint64_t(min);
+                    if (range == UINT64_MAX)
+                        return T(engine());
+                    return T(std::uint64_t(min) + engine.bounded(range + 1));
                 }
-
-                return value;
             }
-
             throw std::runtime_error("Type is not supported by Random::value");
         };
 
@@ -1612,26 +1759,38 @@ namespace dz
         * @brief Generate a uniformly distributed random value from multiple specified ranges.
         *
         * Selects one range at random, then generates a random value within that range.
-        * Optionally accepts a seed to create a temporary mt19937 engine, otherwise uses internal engine reseeded with current time.
+        * Optionally accepts a seed for a temporary engine, otherwise uses the calling thread's engine.
         *
         * @tparam T Numeric type for the random value.
         * @param ranges Vector of pairs representing inclusive ranges [first, second].
-        * @param seed Optional seed to create a temporary mt19937 engine. Default is max size_t (no seed).
+        * @param seed Optional seed for a temporary engine. Default is max size_t (no seed).
         * @return Randomly generated value of type T from one of the specified ranges.
         */
         template <typename T>
         static const T valueFromRandomRange(const std::vector<std::pair<T, T>>& ranges,
                                         const size_t seed = (std::numeric_limits<size_t>::max)())
         {
-            auto rangesSize = ranges.size();
-            auto rangesData = ranges.data();
-
-            // Select a random index to pick a range
-            size_t rangeIndex = Random::value<size_t>(0, rangesSize - 1, seed);
+            if (seed != (std::numeric_limits<size_t>::max)())
+            {
+                RandomEngine seeded(seed);
+                return valueFromRandomRange(ranges, seeded);
+            }
+            return valueFromRandomRange(ranges, engine());
+        };
 
-            // Generate random value from the selected range
-            auto& range = rangesData[rangeIndex];
-            return Random::value(range.first, range.second, seed);
+        /**
+        * @brief Generate a uniformly distributed random value from multiple specified ranges using a provided RandomEngine.
+        *
+        * @tparam T Numeric type for the random value.
+        * @param ranges Vector of pairs representing inclusive ranges [first, second].
+        * @param engine The engine to draw from.
+        * @return Randomly generated value of type T from one of the specified ranges.
+        */
+        template <typename T>
+        static const T valueFromRandomRange(const std::vector<std::pair<T, T>>& ranges, RandomEngine& engine)
+        {
+            auto& range = ranges[engine.bounded(ranges.size())];
+            return Random::value(range.first, range.second, engine);
         };
 
         /**
@@ -1657,6 +1816,30 @@ namespace dz
             auto& range = rangesData[rangeIndex];
             return Random::value(range.first, range.second, mt19937);
         };
+
+        /**
+        * @brief Fills values with uniformly distributed numbers in [min, max) using the calling thread's engine.
+        *
+        * Floats are generated four at a time by SIMD xoshiro128** lanes seeded from the engine.
+        */
+        static void fill(std::span<float> values, float min, float max) { fill_values(values.data(), values.size(), min, max, engine()); }
+
+        /**
+        * @brief Fills values with uniformly distributed integers in [min, max], four random words at a time.
+        */
+        static void fill(std::span<std::int32_t> values, std::int32_t min, std::int32_t max) { fill_values(values.data(), values.size(), min, max, engine()); }
+        static void fill(std::span<std::uint32_t> values, std::uint32_t min, std::uint32_t max) { fill_values(values.data(), values.size(), min, max, engine()); }
+
+        /**
+        * @brief Fills values with uniformly distributed numbers in [min, max).
+        */
+        static void fill(std::span<double> values, double min, double max) { fill_values(values.data(), values.size(), min, max, engine()); }
+
+        /**
+        * @brief Same as the fill overloads above but drawing from the provided engine.
+        */
+        template <typename T>
+        static void fill(std::span<T> values, T min, T max, RandomEngine& engine) { fill_values(values.data(), values.size(), min, max, engine); }
     };
 
     /**
@@ -1690,6 +1873,137 @@ namespace dz
             : min(min)
             , max(max)
         {}
+
+        /**
+        * @brief Returns an inverted box which the first expand or merge replaces.
+        */
+        static AABB empty()
+        {
+            AABB result;
+            for (size_t i = 0; i < N; ++i)
+            {
+                result.min[i] = std::numeric_limits<T>::max();
+                result.max[i] = std::numeric_limits<T>::lowest();
+            }
+            return result;
+        }
+
+        /**
+        * @brief Returns true if min exceeds max on any axis, e.g. a box from empty() that was never expanded.
+        */
+        bool is_empty() const
+        {
+            for (size_t i = 0; i < N; ++i)
+                if (min[i] > max[i])
+                    return true;
+            return false;
+        }
+
+        /**
+        * @brief Grows the box to include point.
+        */
+        void expand(const vec<T, N>& point)
+        {
+            for (size_t i = 0; i < N; ++i)
+            {
+                min[i] = std::min(min[i], point[i]);
+                max[i] = std::max(max[i], point[i]);
+            }
+        }
+
+        /**
+        * @brief Grows the box to include other.
+        */
+        void merge(const AABB& other)
+        {
+            for (size_t i = 0; i < N; ++i)
+            {
+                min[i] = std::min(min[i], other.min[i]);
+                max[i] = std::max(max[i], other.max[i]);
+            }
+        }
+
+        /**
+        * @brief Returns the smallest box containing both this box and other.
+        */
+        AABB merged(const AABB& other) const
+        {
+            AABB result = *this;
+            result.merge(other);
+            return result;
+        }
+
+        /**
+        * @brief Returns the box grown by margin on every side.
+        */
+        AABB inflated(T margin) const
+        {
+            AABB result = *this;
+            for (size_t i = 0; i < N; ++i)
+            {
+                result.min[i] -= margin;
+                result.max[i] += margin;
+            }
+            return result;
+        }
+
+        vec<T, N> center() const
+        {
+            vec<T, N> result;
+            for (size_t i = 0; i < N; ++i)
+                result[i] = (min[i] + max[i]) * T(0.5);
+            return result;
+        }
+
+        /**
+        * @brief Returns the half size of the box along each axis.
+        */
+        vec<T, N> extents() const
+        {
+            vec<T, N> result;
+            for (size_t i = 0; i < N; ++i)
+                result[i] = (max[i] - min[i]) * T(0.5);
+            return result;
+        }
+
+        bool contains(const vec<T, N>& point) const
+        {
+            for (size_t i = 0; i < N; ++i)
+                if (point[i] < min[i] || point[i] > max[i])
+                    return false;
+            return true;
+        }
+
+        bool contains(const AABB& other) const
+        {
+            for (size_t i = 0; i < N; ++i)
+                if (other.min[i] < min[i] || other.max[i] > max[i])
+                    return false;
+            return true;
+        }
+
+        bool intersects(const AABB& other) const
+        {
+            for (size_t i = 0; i < N; ++i)
+                if (other.max[i] < min[i] || other.min[i] > max[i])
+                    return false;
+            return true;
+        }
+
+        /**
+        * @brief Surface area of a 3D box, or the perimeter of a 2D one, used as the cost of a node when building trees.
+        */
+        T surface_area() const
+        {
+            static_assert(N == 2 || N == 3, "surface_area requires a 2D or 3D AABB");
+            vec<T, N> size;
+            for (size_t i = 0; i < N; ++i)
+                size[i] = max[i] - min[i];
+            if constexpr (N == 2)
+                return T(2) * (size[0] + size[1]);
+            else
+                return T(2) * (size[0] * size[1] + size[1] * size[2] + size[2] * size[0]);
+        }
     };
 
 
@@ -1701,6 +2015,12 @@ namespace dz
     template<typename T>
     mat<T, 4, 4> quat_to_mat4(const quat<T>& quat)
     {
+        if constexpr (simd::enabled && std::is_same_v<T, float>)
+        {
+            mat<T, 4, 4> m;
+            simd::quat_to_mat4(quat.data, &m.matrix[0][0]);
+            return m;
+        }
         T w = quat[0], x = quat[1], y = quat[2], z = quat[3];
         T xx = x * x, yy = y * y, zz = z * z;
         T xy = x * y, xz = x * z, yz = y * z;
@@ -1848,4 +2168,519 @@ namespace dz
 
         return vec<T, 4>(pitch, yaw, roll, T(1.0));
     }
-}
\ No newline at end of file
+
+    /**
+    * @brief Transforms an array of points (w = 1) by m.
+    *
+    * @param in Points to transform.
+    * @param out Receives the transformed points, may be the same array as in.
+    * @param count Number of points.
+    */
+    template <typename T>
+    void transform_points(const mat<T, 4, 4>& m, const vec<T, 3>* in, vec<T, 3>* out, size_t count)
+    {
+        if constexpr (std::is_same_v<T, float>)
+            simd::mat4_transform_points(&m.matrix[0][0], (const float*)in, (float*)out, count);
+        else
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                vec<T, 3> p = in[i];
+                for (size_t r = 0; r < 3; ++r)
+                    out[i][r] = m.matrix[0][r] * p[0] + m.matrix[1][r] * p[1] + m.matrix[2][r] * p[2] + m.matrix[3][r];
+            }
+        }
+    }
+
+    /**
+    * @brief Transforms an array of 4 component vectors by m.
+    *
+    * @param in Vectors to transform.
+    * @param out Receives the transformed vectors, may be the same array as in.
+    * @param count Number of vectors.
+    */
+    template <typename T>
+    void transform_vectors(const mat<T, 4, 4>& m, const vec<T, 4>* in, vec<T, 4>* out, size_t count)
+    {
+        if constexpr (std::is_same_v<T, float>)
+            simd::mat4_transform_vec4s(&m.matrix[0][0], (const float*)in, (float*)out, count);
+        else
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                vec<T, 4> v = in[i];
+                for (size_t r = 0; r < 4; ++r)
+                    out[i][r] = m.matrix[0][r] * v[0] + m.matrix[1][r] * v[1] + m.matrix[2][r] * v[2] + m.matrix[3][r] * v[3];
+            }
+        }
+    }
+
+    /**
+    * @brief Computes out[i] = lhs * in[i] for an array of matrices, e.g. parent * local transforms.
+    *
+    * @param in Right hand matrices.
+    * @param out Receives the products, may be the same array as in.
+    * @param count Number of matrices.
+    */
+    template <typename T>
+    void multiply_matrices(const mat<T, 4, 4>& lhs, const mat<T, 4, 4>* in, mat<T, 4, 4>* out, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            if constexpr (std::is_same_v<T, float>)
+                simd::mat4_mul(&out[i].matrix[0][0], &lhs.matrix[0][0], &in[i].matrix[0][0]);
+            else
+                out[i] = lhs * in[i];
+        }
+    }
+
+    /**
+    * @brief Sphere defined by a center point and radius.
+    *
+    * @tparam T The numeric type of the sphere (e.g., float, double).
+    */
+    template <typename T>
+    struct BoundingSphere
+    {
+        vec<T, 3> center; /**< Center of the sphere. */
+        T radius;         /**< Radius of the sphere. */
+
+        BoundingSphere() = default;
+
+        BoundingSphere(vec<T, 3> center, T radius)
+            : center(center)
+            , radius(radius)
+        {}
+
+        bool contains(const vec<T, 3>& point) const
+        {
+            T distance2 = T(0);
+            for (size_t i = 0; i < 3; ++i)
+                distance2 += (point[i] - center[i]) * (point[i] - center[i]);
+            return distance2 <= radius * radius;
+        }
+
+        bool intersects(const BoundingSphere& other) const
+        {
+            T distance2 = T(0);
+            for (size_t i = 0; i < 3; ++i)
+                distance2 += (other.center[i] - center[i]) * (other.center[i] - center[i]);
+            T reach = radius + other.radius;
+            return distance2 <= reach * reach;
+        }
+
+        /**
+        * @brief Tests the sphere against a box using the point of the box closest to the center.
+        */
+        bool intersects(const AABB<T, 3>& box) const
+        {
+            T distance2 = T(0);
+            for (size_t i = 0; i < 3; ++i)
+            {
+                T closest = std::clamp(center[i], box.min[i], box.max[i]);
+                distance2 += (center[i] - closest) * (center[i] - closest);
+            }
+            return distance2 <= radius * radius;
+        }
+
+        /**
+        * @brief Grows the sphere to enclose other.
+        */
+        void merge(const BoundingSphere& other)
+        {
+            vec<T, 3> offset;
+            T distance2 = T(0);
+            for (size_t i = 0; i < 3; ++i)
+            {
+                offset[i] = other.center[i] - center[i];
+                distance2 += offset[i] * offset[i];
+            }
+            T distance = std::sqrt(distance2);
+            if (distance + other.radius <= radius)
+                return;
+            if (distance + radius <= other.radius)
+            {
+                *this = other;
+                return;
+            }
+            T new_radius = (distance + radius + other.radius) * T(0.5);
+            T shift = (new_radius - radius) / distance;
+            for (size_t i = 0; i < 3; ++i)
+                center[i] += offset[i] * shift;
+            radius = new_radius;
+        }
+    };
+
+    /**
+    * @brief Returns the sphere passing through the corners of box.
+    */
+    template <typename T>
+    BoundingSphere<T> bounding_sphere_from_aabb(const AABB<T, 3>& box)
+    {
+        auto extents = box.extents();
+        T radius = std::sqrt(extents[0] * extents[0] + extents[1] * extents[1] + extents[2] * extents[2]);
+        return BoundingSphere<T>(box.center(), radius);
+    }
+
+    /**
+    * @brief Half line from origin along direction, keeps the reciprocal of the direction for slab tests.
+    *
+    * The direction is not normalized, so hit distances are in units of its length.
+    */
+    template <typename T>
+    struct Ray
+    {
+        vec<T, 3> origin;
+        vec<T, 3> direction;
+        vec<T, 3> inv_direction; /**< 1 / direction per axis, infinite on axes the ray does not move along. */
+
+        Ray() = default;
+
+        Ray(vec<T, 3> origin, vec<T, 3> direction)
+            : origin(origin)
+            , direction(direction)
+        {
+            for (size_t i = 0; i < 3; ++i)
+                inv_direction[i] = T(1) / direction[i];
+        }
+
+        vec<T, 3> at(T t) const
+        {
+            vec<T, 3> result;
+            for (size_t i = 0; i < 3; ++i)
+                result[i] = origin[i] + direction[i] * t;
+            return result;
+        }
+    };
+
+    /**
+    * @brief Slab test of ray against box.
+    *
+    * @param t_max Hits entering the box beyond this distance are ignored.
+    * @param t_hit Receives the entry distance, 0 when the origin is inside the box.
+    */
+    template <typename T>
+    bool ray_intersects_aabb(const Ray<T>& ray, const AABB<T, 3>& box, T t_max, T& t_hit)
+    {
+        T t_near = T(0);
+        T t_far = t_max;
+        for (size_t i = 0; i < 3; ++i)
+        {
+            T t0 = (box.min[i] - ray.origin[i]) * ray.inv_direction[i];
+            T t1 = (box.max[i] - ray.origin[i]) * ray.inv_direction[i];
+            t_near = std::max(t_near, std::min(t0, t1));
+            t_far = std::min(t_far, std::max(t0, t1));
+        }
+        if (t_near > t_far)
+            return false;
+        t_hit = t_near;
+        return true;
+    }
+
+    /**
+    * @brief Intersects ray with a sphere, a ray starting inside the sphere hits at distance 0.
+    */
+    template <typename T>
+    bool ray_intersects_sphere(const Ray<T>& ray, const BoundingSphere<T>& sphere, T t_max, T& t_hit)
+    {
+        vec<T, 3> offset;
+        for (size_t i = 0; i < 3; ++i)
+            offset[i] = ray.origin[i] - sphere.center[i];
+        T a = T(0), b = T(0), c = -sphere.radius * sphere.radius;
+        for (size_t i = 0; i < 3; ++i)
+        {
+            a += ray.direction[i] * ray.direction[i];
+            b += offset[i] * ray.direction[i];
+            c += offset[i] * offset[i];
+        }
+        if (c <= T(0))
+        {
+            t_hit = T(0);
+            return true;
+        }
+        T discriminant = b * b - a * c;
+        if (b > T(0) || discriminant < T(0))
+            return false;
+        T t = (-b - std::sqrt(discriminant)) / a;
+        if (t > t_max)
+            return false;
+        t_hit = t;
+        return true;
+    }
+
+    /**
+    * @brief Moller-Trumbore intersection of ray with the triangle (v0, v1, v2), both windings hit.
+    */
+    template <typename T>
+    bool ray_intersects_triangle(const Ray<T>& ray, const vec<T, 3>& v0, const vec<T, 3>& v1, const vec<T, 3>& v2, T t_max, T& t_hit)
+    {
+        vec<T, 3> edge1, edge2, s;
+        for (size_t i = 0; i < 3; ++i)
+        {
+            edge1[i] = v1[i] - v0[i];
+            edge2[i] = v2[i] - v0[i];
+            s[i] = ray.origin[i] - v0[i];
+        }
+        auto cross = [](const vec<T, 3>& a, const vec<T, 3>& b) {
+            vec<T, 3> result;
+            result[0] = a[1] * b[2] - a[2] * b[1];
+            result[1] = a[2] * b[0] - a[0] * b[2];
+            result[2] = a[0] * b[1] - a[1] * b[0];
+            return result;
+        };
+        auto dot = [](const vec<T, 3>& a, const vec<T, 3>& b) {
+            return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+        };
+        auto p = cross(ray.direction, edge2);
+        T determinant = dot(edge1, p);
+        if (std::abs(determinant) <= std::numeric_limits<T>::epsilon())
+            return false;
+        T inv_determinant = T(1) / determinant;
+        T u = dot(s, p) * inv_determinant;
+        if (u < T(0) || u > T(1))
+            return false;
+        auto q = cross(s, edge1);
+        T v = dot(ray.direction, q) * inv_determinant;
+        if (v < T(0) || u + v > T(1))
+            return false;
+        T t = dot(edge2, q) * inv_determinant;
+        if (t < T(0) || t > t_max)
+            return false;
+        t_hit = t;
+        return true;
+    }
+
+    /**
+    * @brief Returns the ray through a point in normalized device coordinates, running from the near plane towards the far plane.
+    *
+    * @param inverse_view_projection Inverse of projection * view.
+    */
+    template <typename T>
+    Ray<T> ray_from_ndc(const mat<T, 4, 4>& inverse_view_projection, T x, T y)
+    {
+#if defined(RENDERER_GL)
+        const T near_z = T(-1);
+#else
+        const T near_z = T(0);
+#endif
+        auto unproject = [&](T z) {
+            vec<T, 3> result;
+            T w = inverse_view_projection[0][3] * x + inverse_view_projection[1][3] * y + inverse_view_projection[2][3] * z + inverse_view_projection[3][3];
+            for (size_t r = 0; r < 3; ++r)
+                result[r] = (inverse_view_projection[0][r] * x + inverse_view_projection[1][r] * y + inverse_view_projection[2][r] * z + inverse_view_projection[3][r]) / w;
+            return result;
+        };
+        auto near_point = unproject(near_z);
+        auto far_point = unproject(T(1));
+        vec<T, 3> direction;
+        for (size_t i = 0; i < 3; ++i)
+            direction[i] = far_point[i] - near_point[i];
+        return Ray<T>(near_point, direction.normalize());
+    }
+
+    /**
+    * @brief Six inward facing planes, each stored as (normal xyz, distance w) so that dot(normal, p) + w >= 0 inside.
+    *
+    * Planes are ordered left, right, bottom, top, near, far.
+    */
+    template <typename T>
+    struct Frustum
+    {
+        vec<T, 4> planes[6];
+
+        bool contains(const vec<T, 3>& point) const
+        {
+            for (auto& plane : planes)
+                if (plane[0] * point[0] + plane[1] * point[1] + plane[2] * point[2] + plane[3] < T(0))
+                    return false;
+            return true;
+        }
+
+        /**
+        * @brief Conservative test, a box near a frustum corner may report true while lying outside.
+        */
+        bool intersects(const AABB<T, 3>& box) const
+        {
+            for (auto& plane : planes)
+            {
+                T distance = plane[3];
+                for (size_t i = 0; i < 3; ++i)
+                    distance += plane[i] * (plane[i] >= T(0) ? box.max[i] : box.min[i]);
+                if (distance < T(0))
+                    return false;
+            }
+            return true;
+        }
+
+        bool intersects(const BoundingSphere<T>& sphere) const
+        {
+            for (auto& plane : planes)
+                if (plane[0] * sphere.center[0] + plane[1] * sphere.center[1] + plane[2] * sphere.center[2] + plane[3] < -sphere.radius)
+                    return false;
+            return true;
+        }
+
+        /**
+        * @brief Returns true if box lies inside every plane, letting tree queries accept a whole subtree at once.
+        */
+        bool contains(const AABB<T, 3>& box) const
+        {
+            for (auto& plane : planes)
+            {
+                T distance = plane[3];
+                for (size_t i = 0; i < 3; ++i)
+                    distance += plane[i] * (plane[i] >= T(0) ? box.min[i] : box.max[i]);
+                if (distance < T(0))
+                    return false;
+            }
+            return true;
+        }
+    };
+
+    /**
+    * @brief Extracts the normalized frustum planes of a view projection matrix (Gribb-Hartmann).
+    *
+    * @param view_projection projection * view, for the renderer's clip space depth range.
+    */
+    template <typename T>
+    Frustum<T> frustum_from_matrix(const mat<T, 4, 4>& view_projection)
+    {
+        auto row = [&](size_t r) {
+            return vec<T, 4>(view_projection[0][r], view_projection[1][r], view_projection[2][r], view_projection[3][r]);
+        };
+        auto r0 = row(0), r1 = row(1), r2 = row(2), r3 = row(3);
+        Frustum<T> frustum;
+        for (size_t i = 0; i < 4; ++i)
+        {
+            frustum.planes[0][i] = r3[i] + r0[i];
+            frustum.planes[1][i] = r3[i] - r0[i];
+            frustum.planes[2][i] = r3[i] + r1[i];
+            frustum.planes[3][i] = r3[i] - r1[i];
+#if defined(RENDERER_GL)
+            frustum.planes[4][i] = r3[i] + r2[i];
+#else
+            frustum.planes[4][i] = r2[i];
+#endif
+            frustum.planes[5][i] = r3[i] - r2[i];
+        }
+        for (auto& plane : frustum.planes)
+        {
+            T length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+            if (length > T(0))
+                for (size_t i = 0; i < 4; ++i)
+                    plane[i] /= length;
+        }
+        return frustum;
+    }
+
+    /**
+    * @brief Returns the bounds of count points.
+    */
+    template <typename T, size_t N>
+    AABB<T, N> aabb_from_points(const vec<T, N>* points, size_t count)
+    {
+        auto result = AABB<T, N>::empty();
+        for (size_t i = 0; i < count; ++i)
+            result.expand(points[i]);
+        return result;
+    }
+
+    /**
+    * @brief Returns the xyz bounds of count 4 component positions such as the VertexPositions buffer, w is ignored.
+    */
+    template <typename T>
+    AABB<T, 3> aabb_from_positions(const vec<T, 4>* positions, size_t count)
+    {
+        auto result = AABB<T, 3>::empty();
+        if constexpr (std::is_same_v<T, float>)
+        {
+            if (count)
+                simd::positions_bounds((const float*)positions, count, &result.min[0]);
+        }
+        else
+        {
+            for (size_t i = 0; i < count; ++i)
+                result.expand(vec<T, 3>(positions[i][0], positions[i][1], positions[i][2]));
+        }
+        return result;
+    }
+
+    /**
+    * @brief Transforms an array of boxes by m, each result is the box around the transformed corners.
+    *
+    * @param in Boxes to transform, must not be empty.
+    * @param out Receives the transformed boxes, may be the same array as in.
+    * @param count Number of boxes.
+    */
+    template <typename T>
+    void transform_aabbs(const mat<T, 4, 4>& m, const AABB<T, 3>* in, AABB<T, 3>* out, size_t count)
+    {
+        if constexpr (std::is_same_v<T, float>)
+            simd::aabb_transform(&m.matrix[0][0], (const float*)in, (float*)out, count);
+        else
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                auto center = in[i].center();
+                auto extents = in[i].extents();
+                AABB<T, 3> result;
+                for (size_t r = 0; r < 3; ++r)
+                {
+                    T c = m.matrix[3][r];
+                    T e = T(0);
+                    for (size_t k = 0; k < 3; ++k)
+                    {
+                        c += m.matrix[k][r] * center[k];
+                        e += std::abs(m.matrix[k][r]) * extents[k];
+                    }
+                    result.min[r] = c - e;
+                    result.max[r] = c + e;
+                }
+                out[i] = result;
+            }
+        }
+    }
+
+    template <typename T>
+    AABB<T, 3> transform_aabb(const mat<T, 4, 4>& m, const AABB<T, 3>& box)
+    {
+        AABB<T, 3> result;
+        transform_aabbs(m, &box, &result, 1);
+        return result;
+    }
+
+    /**
+    * @brief Tests one ray against an array of boxes.
+    *
+    * @param hits Receives the entry distance per box, or -1 when the box is missed or entered past t_max.
+    */
+    template <typename T>
+    void ray_test_aabbs(const Ray<T>& ray, const AABB<T, 3>* boxes, size_t count, T t_max, T* hits)
+    {
+        if constexpr (std::is_same_v<T, float>)
+            simd::aabbs_ray_test((const float*)boxes, count, &ray.origin[0], &ray.inv_direction[0], t_max, hits);
+        else
+        {
+            for (size_t i = 0; i < count; ++i)
+                if (!ray_intersects_aabb(ray, boxes[i], t_max, hits[i]))
+                    hits[i] = T(-1);
+        }
+    }
+
+    /**
+    * @brief Tests an array of boxes against frustum.
+    *
+    * @param visible Receives 1 for every box that may be inside the frustum and 0 for the rest.
+    */
+    template <typename T>
+    void frustum_test_aabbs(const Frustum<T>& frustum, const AABB<T, 3>* boxes, size_t count, uint8_t* visible)
+    {
+        if constexpr (std::is_same_v<T, float>)
+            simd::aabbs_frustum_test((const float*)frustum.planes, (const float*)boxes, count, visible);
+        else
+        {
+            for (size_t i = 0; i < count; ++i)
+                visible[i] = frustum.intersects(boxes[i]);
+        }
+    }
+}
@@ -6,7 +6,11 @@
 
 #include <cstddef>
 #include <cstdlib>
+#include <cstring>
 #include <functional>
+#include <new>
+#include <type_traits>
+#include "Allocator.hpp"
 
 namespace dz
 {
@@ -44,6 +48,25 @@ namespace dz
         static void call(void* p) { free(p); }
     };
 
+    /**
+     * @brief Default deleter for memory from allocator_large_alloc.
+     */
+    struct default_allocator_deleter
+    {
+        static void call(void* p) { allocator_large_free(p); }
+    };
+
+    /**
+     * @brief Shared state of a size_ptr, allocated once per owned buffer.
+     */
+    struct size_ptr_control
+    {
+        size_t size = 0;                    /**< Number of elements. */
+        size_t ref_c = 1;                   /**< Reference count shared among copies. */
+        void(*deleter)(void*) = nullptr;    /**< Deleter called on the data, unused when the data follows the control block. */
+        size_t block_size = 0;              /**< Bytes of the combined control and data block, 0 if the data is separate. */
+    };
+
     /**
      * @brief A reference-counted smart pointer with associated size and custom deleter.
      *
@@ -52,10 +75,8 @@ namespace dz
     template <typename T>
     struct size_ptr
     {
-        T* ptr = nullptr;                   /**< Raw pointer to the data. */
-        size_t* size = nullptr;             /**< Shared pointer to the size of the data. */
-        size_t* ref_c = nullptr;            /**< Reference count shared among copies. */
-        void(*deleter)(void*) = nullptr;    /**< Function pointer to the deleter function. */
+        T* ptr = nullptr;                       /**< Raw pointer to the data. */
+        size_ptr_control* control = nullptr;    /**< Size, reference count and deleter shared among copies. */
 
         /**
          * @brief Default constructor.
@@ -71,12 +92,30 @@ namespace dz
          */
         size_ptr(T* ptr, size_t size = 1, void(*deleter)(void*) = &default_delete_single::call<T>) :
             ptr(ptr),
-            size(new size_t(size)),
-            ref_c(new size_t(1)),
-            deleter(deleter)
+            control(new (allocator_alloc(sizeof(size_ptr_control))) size_ptr_control{size, 1, deleter, 0})
         {
         }
 
+        /**
+         * @brief Allocates size elements together with the control block in a single allocator block.
+         *
+         * @param size Number of elements.
+         * @param zeroed Whether the elements are zero filled.
+         */
+        static size_ptr allocate(size_t size, bool zeroed = true)
+        {
+            static_assert(std::is_trivially_copyable_v<T>, "size_ptr::allocate only holds trivially copyable data");
+            constexpr size_t data_offset = (sizeof(size_ptr_control) + alignof(T) - 1) / alignof(T) * alignof(T);
+            size_t block_size = data_offset + size * sizeof(T);
+            auto block = (char*)allocator_alloc(block_size);
+            size_ptr result;
+            result.control = new (block) size_ptr_control{size, 1, nullptr, block_size};
+            result.ptr = (T*)(block + data_offset);
+            if (zeroed)
+                memset((void*)result.ptr, 0, size * sizeof(T));
+            return result;
+        }
+
         /**
          * @brief Copy constructor (increments reference count).
          *
@@ -84,11 +123,23 @@ namespace dz
          */
         size_ptr(const size_ptr& other) :
             ptr(other.ptr),
-            size(other.size),
-            ref_c(other.ref_c),
-            deleter(other.deleter)
+            control(other.control)
+        {
+            if (control)
+                control->ref_c++;
+        }
+
+        /**
+         * @brief Move constructor, takes the reference of other.
+         *
+         * @param other Another size_ptr to move from.
+         */
+        size_ptr(size_ptr&& other) noexcept :
+            ptr(other.ptr),
+            control(other.control)
         {
-            (*ref_c)++;
+            other.ptr = nullptr;
+            other.control = nullptr;
         }
 
         /**
@@ -98,15 +149,35 @@ namespace dz
          * @return Reference to this.
          */
         size_ptr& operator=(const size_ptr& other)
+        {
+            if (this != &other)
+            {
+                if (other.control)
+                    other.control->ref_c++;
+                auto other_ptr = other.ptr;
+                auto other_control = other.control;
+                reset();
+                ptr = other_ptr;
+                control = other_control;
+            }
+            return *this;
+        }
+
+        /**
+         * @brief Move assignment operator.
+         *
+         * @param other Another size_ptr to move from.
+         * @return Reference to this.
+         */
+        size_ptr& operator=(size_ptr&& other) noexcept
         {
             if (this != &other)
             {
                 reset();
                 ptr = other.ptr;
-                size = other.size;
-                ref_c = other.ref_c;
-                deleter = other.deleter;
-                (*ref_c)++;
+                control = other.control;
+                other.ptr = nullptr;
+                other.control = nullptr;
             }
             return *this;
         }
@@ -124,20 +195,22 @@ namespace dz
          */
         void reset()
         {
-            if (ref_c)
+            if (control)
             {
-                (*ref_c)--;
-                if (!(*ref_c))
+                control->ref_c--;
+                if (!control->ref_c)
                 {
-                    if (deleter) deleter(static_cast<void*>(ptr));
-                    delete size;
-                    delete ref_c;
+                    if (control->block_size)
+                        allocator_free(control, control->block_size);
+                    else
+                    {
+                        if (control->deleter) control->deleter(static_cast<void*>(ptr));
+                        allocator_free(control, sizeof(size_ptr_control));
+                    }
                 }
             }
             ptr = nullptr;
-            size = nullptr;
-            ref_c = nullptr;
-            deleter = nullptr;
+            control = nullptr;
         }
 
         /**
@@ -161,11 +234,18 @@ namespace dz
          */
         const T* get() const { return ptr; }
 
+        /**
+         * @brief Whether the data is a view owned elsewhere, true when constructed with default_noop.
+         *
+         * @return True if releasing the last reference leaves the data untouched.
+         */
+        bool is_borrowed() const { return control && !control->block_size && control->deleter == &default_noop::call; }
+
         /**
          * @brief Gets the number of elements pointed to.
          *
          * @return Size in elements.
          */
-        size_t get_size() const { return size ? *size : 0; }
+        size_t get_size() const { return control ? control->size : 0; }
     };
 } // namespace dz
@@ -1,15 +1,20 @@
 #pragma once
 #include <cstring>
+#include "Allocator.hpp"
 namespace dz
 {
+    /**
+     * @brief Allocates size copies of value from the allocator pools, pair with zfree
+     */
     template<typename T>
     T* zmalloc(size_t size, const T& value)
     {
-        auto ptr = (T*)calloc(size, sizeof(T));
+        auto ptr = (T*)allocator_alloc(size * sizeof(T), (std::max)(alignof(T), size_t(DZ_ALLOCATOR_DEFAULT_ALIGNMENT)));
         if (ptr == nullptr)
         {
             return nullptr;
         }
+        memset((void*)ptr, 0, size * sizeof(T));
         for (size_t i = 0; i < size; i++)
         {
             new (ptr + i) T(value);
@@ -27,6 +32,6 @@ namespace dz
         {
             ptr[i].~T();
         }
-        free(ptr);
+        allocator_free(ptr, size * sizeof(T), (std::max)(alignof(T), size_t(DZ_ALLOCATOR_DEFAULT_ALIGNMENT)));
     }
-}
\ No newline at end of file
+}
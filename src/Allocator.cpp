@@ -0,0 +1,309 @@
+#include <dz/Allocator.hpp>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace dz {
+    struct AllocatorAtomicCounters
+    {
+        std::atomic<size_t> allocation_count = 0;
+        std::atomic<size_t> free_count = 0;
+        std::atomic<size_t> bytes_in_use = 0;
+        std::atomic<size_t> peak_bytes_in_use = 0;
+        std::atomic<size_t> bytes_reserved = 0;
+    };
+
+    static constexpr size_t allocator_pool_sizes[] = {
+        16, 32, 48, 64, 80, 96, 112, 128, 192, 256, 384, 512, 768, 1024
+    };
+    static constexpr size_t allocator_pool_count = sizeof(allocator_pool_sizes) / sizeof(allocator_pool_sizes[0]);
+    static_assert(allocator_pool_sizes[allocator_pool_count - 1] == DZ_ALLOCATOR_POOL_MAX_SIZE);
+
+    struct AllocatorPool
+    {
+        std::mutex mutex;
+        void* free_list = nullptr;
+        size_t block_size = 0;
+    };
+
+    struct AllocatorState
+    {
+        AllocatorPool pools[allocator_pool_count];
+        AllocatorAtomicCounters pool;
+        AllocatorAtomicCounters large;
+        AllocatorAtomicCounters arena;
+        std::atomic<size_t> frame_index = 0;
+        std::atomic<size_t> frame_allocation_count = 0;
+        std::atomic<size_t> frame_allocation_bytes = 0;
+        std::atomic<size_t> last_frame_allocation_count = 0;
+        std::atomic<size_t> last_frame_allocation_bytes = 0;
+    };
+
+    struct FrameArenaBlock
+    {
+        uint8_t* data = nullptr;
+        size_t size = 0;
+    };
+
+    struct FrameArena
+    {
+        size_t block_size = DZ_FRAME_ARENA_BLOCK_SIZE;
+        std::vector<FrameArenaBlock> blocks;
+        size_t block_index = 0;
+        size_t offset = 0;
+        size_t used = 0;
+    };
+
+    /**
+     * @brief Stored in front of every block from the large allocator
+     */
+    struct AllocatorLargeHeader
+    {
+        size_t size = 0;
+        size_t offset = 0;      /**< Distance back to the pointer malloc returned. */
+        size_t reserved = 0;
+    };
+
+    AllocatorState& allocator_state() {
+        // never destroyed, memory may still be returned while other statics are torn down
+        static auto state = []() {
+            auto state = new AllocatorState;
+            for (size_t index = 0; index < allocator_pool_count; index++)
+                state->pools[index].block_size = allocator_pool_sizes[index];
+            return state;
+        }();
+        return *state;
+    }
+
+    void allocator_counters_add(AllocatorAtomicCounters& counters, size_t bytes) {
+        auto& state = allocator_state();
+        counters.allocation_count.fetch_add(1, std::memory_order_relaxed);
+        auto in_use = counters.bytes_in_use.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        auto peak = counters.peak_bytes_in_use.load(std::memory_order_relaxed);
+        while (in_use > peak && !counters.peak_bytes_in_use.compare_exchange_weak(peak, in_use, std::memory_order_relaxed)) {}
+        state.frame_allocation_count.fetch_add(1, std::memory_order_relaxed);
+        state.frame_allocation_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    void allocator_counters_remove(AllocatorAtomicCounters& counters, size_t bytes) {
+        counters.free_count.fetch_add(1, std::memory_order_relaxed);
+        counters.bytes_in_use.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    AllocatorCounters allocator_counters_load(const AllocatorAtomicCounters& counters) {
+        AllocatorCounters result;
+        result.allocation_count = counters.allocation_count.load(std::memory_order_relaxed);
+        result.free_count = counters.free_count.load(std::memory_order_relaxed);
+        result.bytes_in_use = counters.bytes_in_use.load(std::memory_order_relaxed);
+        result.peak_bytes_in_use = counters.peak_bytes_in_use.load(std::memory_order_relaxed);
+        result.bytes_reserved = counters.bytes_reserved.load(std::memory_order_relaxed);
+        return result;
+    }
+
+    /**
+     * @brief Allocates an aligned block with a header in front, reserved receives the bytes taken from malloc
+     */
+    void* allocator_aligned_block_alloc(size_t size, size_t alignment, size_t& reserved) {
+        if (alignment < alignof(AllocatorLargeHeader) || (alignment & (alignment - 1)))
+            throw std::runtime_error("allocator: alignment must be a power of two");
+        reserved = size + alignment + sizeof(AllocatorLargeHeader);
+        auto raw = (uint8_t*)malloc(reserved);
+        if (!raw)
+            throw std::bad_alloc();
+        auto address = (uintptr_t(raw) + sizeof(AllocatorLargeHeader) + alignment - 1) & ~uintptr_t(alignment - 1);
+        auto header = (AllocatorLargeHeader*)(address - sizeof(AllocatorLargeHeader));
+        header->size = size;
+        header->offset = address - uintptr_t(raw);
+        header->reserved = reserved;
+        return (void*)address;
+    }
+
+    AllocatorLargeHeader* allocator_aligned_block_header(void* ptr) {
+        return (AllocatorLargeHeader*)((uint8_t*)ptr - sizeof(AllocatorLargeHeader));
+    }
+
+    size_t allocator_aligned_block_free(void* ptr) {
+        auto header = allocator_aligned_block_header(ptr);
+        auto reserved = header->reserved;
+        free((uint8_t*)ptr - header->offset);
+        return reserved;
+    }
+
+    size_t allocator_pool_index(size_t size) {
+        if (size <= 128)
+            return size ? (size + 15) / 16 - 1 : 0;
+        size_t index = 8;
+        while (allocator_pool_sizes[index] < size)
+            index++;
+        return index;
+    }
+
+    void allocator_pool_grow(AllocatorPool& pool) {
+        auto& state = allocator_state();
+        size_t reserved = 0;
+        auto page = (uint8_t*)allocator_aligned_block_alloc(DZ_ALLOCATOR_POOL_PAGE_SIZE, DZ_ALLOCATOR_LARGE_ALIGNMENT, reserved);
+        state.pool.bytes_reserved.fetch_add(reserved, std::memory_order_relaxed);
+        // link back to front so blocks are handed out in address order
+        auto block_count = DZ_ALLOCATOR_POOL_PAGE_SIZE / pool.block_size;
+        for (size_t index = block_count; index-- > 0;) {
+            auto block = page + index * pool.block_size;
+            *(void**)block = pool.free_list;
+            pool.free_list = block;
+        }
+    }
+
+    void* allocator_alloc(size_t size, size_t alignment) {
+        if (alignment > DZ_ALLOCATOR_DEFAULT_ALIGNMENT || size > DZ_ALLOCATOR_POOL_MAX_SIZE)
+            return allocator_large_alloc(size, (std::max)(alignment, size_t(DZ_ALLOCATOR_DEFAULT_ALIGNMENT)));
+        auto& state = allocator_state();
+        auto& pool = state.pools[allocator_pool_index(size)];
+        void* block = nullptr;
+        {
+            std::lock_guard lock(pool.mutex);
+            if (!pool.free_list)
+                allocator_pool_grow(pool);
+            block = pool.free_list;
+            pool.free_list = *(void**)block;
+        }
+        allocator_counters_add(state.pool, pool.block_size);
+        return block;
+    }
+
+    void allocator_free(void* ptr, size_t size, size_t alignment) {
+        if (!ptr)
+            return;
+        if (alignment > DZ_ALLOCATOR_DEFAULT_ALIGNMENT || size > DZ_ALLOCATOR_POOL_MAX_SIZE) {
+            allocator_large_free(ptr);
+            return;
+        }
+        auto& state = allocator_state();
+        auto& pool = state.pools[allocator_pool_index(size)];
+        {
+            std::lock_guard lock(pool.mutex);
+            *(void**)ptr = pool.free_list;
+            pool.free_list = ptr;
+        }
+        allocator_counters_remove(state.pool, pool.block_size);
+    }
+
+    void* allocator_large_alloc(size_t size, size_t alignment) {
+        auto& state = allocator_state();
+        size_t reserved = 0;
+        auto ptr = allocator_aligned_block_alloc(size, alignment, reserved);
+        state.large.bytes_reserved.fetch_add(reserved, std::memory_order_relaxed);
+        allocator_counters_add(state.large, size);
+        return ptr;
+    }
+
+    void allocator_large_free(void* ptr) {
+        if (!ptr)
+            return;
+        auto& state = allocator_state();
+        auto size = allocator_aligned_block_header(ptr)->size;
+        auto reserved = allocator_aligned_block_free(ptr);
+        state.large.bytes_reserved.fetch_sub(reserved, std::memory_order_relaxed);
+        allocator_counters_remove(state.large, size);
+    }
+
+    size_t allocator_large_get_size(void* ptr) {
+        return ptr ? allocator_aligned_block_header(ptr)->size : 0;
+    }
+
+    void allocator_begin_frame() {
+        auto& state = allocator_state();
+        state.last_frame_allocation_count.store(state.frame_allocation_count.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+        state.last_frame_allocation_bytes.store(state.frame_allocation_bytes.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+        state.frame_index.fetch_add(1, std::memory_order_relaxed);
+        frame_arena_reset(frame_arena_default());
+    }
+
+    AllocatorStats allocator_get_stats() {
+        auto& state = allocator_state();
+        AllocatorStats stats;
+        stats.pool = allocator_counters_load(state.pool);
+        stats.large = allocator_counters_load(state.large);
+        stats.arena = allocator_counters_load(state.arena);
+        stats.frame_index = state.frame_index.load(std::memory_order_relaxed);
+        stats.frame_allocation_count = state.last_frame_allocation_count.load(std::memory_order_relaxed);
+        stats.frame_allocation_bytes = state.last_frame_allocation_bytes.load(std::memory_order_relaxed);
+        if (stats.pool.bytes_reserved)
+            stats.pool_fragmentation = 1.f - float(double(stats.pool.bytes_in_use) / double(stats.pool.bytes_reserved));
+        return stats;
+    }
+
+    void frame_arena_push_block(FrameArena* arena, size_t size) {
+        auto& state = allocator_state();
+        size_t reserved = 0;
+        auto data = (uint8_t*)allocator_aligned_block_alloc(size, DZ_ALLOCATOR_LARGE_ALIGNMENT, reserved);
+        state.arena.bytes_reserved.fetch_add(reserved, std::memory_order_relaxed);
+        arena->blocks.push_back({data, size});
+    }
+
+    void frame_arena_release_blocks(FrameArena* arena) {
+        auto& state = allocator_state();
+        for (auto& block : arena->blocks)
+            state.arena.bytes_reserved.fetch_sub(allocator_aligned_block_free(block.data), std::memory_order_relaxed);
+        arena->blocks.clear();
+    }
+
+    FrameArena* frame_arena_create(size_t block_size) {
+        auto arena = new FrameArena;
+        arena->block_size = block_size ? block_size : DZ_FRAME_ARENA_BLOCK_SIZE;
+        return arena;
+    }
+
+    void frame_arena_free(FrameArena* arena) {
+        if (!arena)
+            return;
+        allocator_state().arena.bytes_in_use.fetch_sub(arena->used, std::memory_order_relaxed);
+        frame_arena_release_blocks(arena);
+        delete arena;
+    }
+
+    void* frame_arena_alloc(FrameArena* arena, size_t size, size_t alignment) {
+        if (alignment & (alignment - 1))
+            throw std::runtime_error("frame_arena_alloc: alignment must be a power of two");
+        while (true) {
+            if (arena->block_index == arena->blocks.size())
+                frame_arena_push_block(arena, (std::max)(arena->block_size, size + alignment));
+            auto& block = arena->blocks[arena->block_index];
+            auto begin = uintptr_t(block.data);
+            auto address = (begin + arena->offset + alignment - 1) & ~uintptr_t(alignment - 1);
+            if (address + size <= begin + block.size) {
+                arena->offset = address + size - begin;
+                arena->used += size;
+                allocator_counters_add(allocator_state().arena, size);
+                return (void*)address;
+            }
+            arena->block_index++;
+            arena->offset = 0;
+        }
+    }
+
+    void frame_arena_reset(FrameArena* arena) {
+        auto& state = allocator_state();
+        state.arena.free_count.fetch_add(1, std::memory_order_relaxed);
+        state.arena.bytes_in_use.fetch_sub(arena->used, std::memory_order_relaxed);
+        if (arena->blocks.size() > 1) {
+            size_t total_size = 0;
+            for (auto& block : arena->blocks)
+                total_size += block.size;
+            frame_arena_release_blocks(arena);
+            frame_arena_push_block(arena, total_size);
+        }
+        arena->block_index = 0;
+        arena->offset = 0;
+        arena->used = 0;
+    }
+
+    size_t frame_arena_get_used(FrameArena* arena) {
+        return arena->used;
+    }
+
+    FrameArena* frame_arena_default() {
+        static auto arena = frame_arena_create();
+        return arena;
+    }
+}
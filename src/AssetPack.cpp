@@ -1,40 +1,346 @@
 #include <dz/AssetPack.hpp>
 #include <dz/KeyValueStream.hpp>
+#include <dz/ThreadPool.hpp>
+#include <dz/Hash.hpp>
+#include <zlib.h>
+
+#define DZ_ASSET_ENTRY_MAGIC "DZAE"
 
 namespace dz {
+    using AssetStream = KeyValueStream<std::string, Asset>;
+
     struct AssetPack
     {
-        KeyValueStream<std::string, Asset> asset_stream;
+        AssetStream asset_stream;
+        AssetCompression compression = AssetCompression::None;
+        int compression_level = -1;
+        uint32_t block_size = DZ_ASSET_BLOCK_SIZE;
+
+        AssetPack(FileHandle& file_handle, AssetStream::Mode mode):
+            asset_stream(file_handle, mode)
+        {}
+    };
+
+    /**
+     * @brief Prefixes every stored asset, compressed assets follow it with block_count + 1 offsets into the block data.
+     */
+    struct AssetEntryHeader
+    {
+        char magic[4];
+        uint32_t compression;
+        uint64_t raw_size;
+        uint32_t block_size;
+        uint32_t block_count;
+        uint64_t content_hash;          /**< hash_bytes of the uncompressed asset, without its trailing bytes. */
+        uint32_t requested_compression; /**< codec the pack was set to, differs from compression when the asset did not shrink. */
+        uint32_t trailing_size;         /**< bytes stored after the source, such as the null terminator added by read_asset_file. */
+    };
+
+    /**
+     * @brief A stored asset split into its header, block table and payload, pointing into the stored bytes.
+     */
+    struct AssetEntry
+    {
+        AssetEntryHeader header{};
+        const char* offsets = nullptr;
+        const char* payload = nullptr;
+        size_t payload_size = 0;
+
+        uint64_t block_offset(uint32_t block) const
+        {
+            uint64_t offset;
+            memcpy(&offset, offsets + block * sizeof(uint64_t), sizeof(offset));
+            return offset;
+        }
     };
+
+    bool parse_asset_entry(const char* data, size_t size, AssetEntry& entry)
+    {
+        // values without the entry magic were packed before compression existed and are stored as is
+        if (size < sizeof(AssetEntryHeader) || memcmp(data, DZ_ASSET_ENTRY_MAGIC, 4) != 0)
+        {
+            entry.header.compression = uint32_t(AssetCompression::None);
+            entry.header.raw_size = size;
+            entry.payload = data;
+            entry.payload_size = size;
+            return true;
+        }
+        memcpy(&entry.header, data, sizeof(AssetEntryHeader));
+        data += sizeof(AssetEntryHeader);
+        size -= sizeof(AssetEntryHeader);
+        if (entry.header.compression == uint32_t(AssetCompression::None))
+        {
+            if (size < entry.header.raw_size)
+                return false;
+            entry.payload = data;
+            entry.payload_size = entry.header.raw_size;
+            return true;
+        }
+        if (entry.header.compression != uint32_t(AssetCompression::Zlib) || !entry.header.block_size)
+            return false;
+        auto table_size = (uint64_t(entry.header.block_count) + 1) * sizeof(uint64_t);
+        if (size < table_size)
+            return false;
+        entry.offsets = data;
+        entry.payload = data + table_size;
+        entry.payload_size = size - table_size;
+        if (entry.block_offset(entry.header.block_count) > entry.payload_size)
+            return false;
+        return true;
+    }
+
+    void decompress_asset_blocks(const AssetEntry& entry, uint32_t first_block, uint32_t last_block, char* out)
+    {
+        auto& header = entry.header;
+        thread_pool_parallel_for(thread_pool_default(), last_block - first_block, [&](size_t index) {
+            auto block = first_block + uint32_t(index);
+            auto begin = entry.block_offset(block);
+            auto end = entry.block_offset(block + 1);
+            auto raw_offset = uint64_t(block) * header.block_size;
+            uLongf raw_size = uLongf((std::min)(uint64_t(header.block_size), header.raw_size - raw_offset));
+            auto expected = raw_size;
+            if (end < begin ||
+                uncompress((Bytef*)(out + (raw_offset - uint64_t(first_block) * header.block_size)), &raw_size, (const Bytef*)(entry.payload + begin), uLong(end - begin)) != Z_OK ||
+                raw_size != expected)
+                throw std::runtime_error("Corrupt compressed asset block");
+        });
+    }
+
+    std::string encode_asset_bytes(const char* data, size_t size, AssetCompression compression, int compression_level, uint32_t block_size, uint64_t content_hash, uint32_t trailing_size)
+    {
+        if (trailing_size > size)
+            throw std::runtime_error("Asset trailing bytes exceed its size");
+        AssetEntryHeader header{};
+        memcpy(header.magic, DZ_ASSET_ENTRY_MAGIC, 4);
+        header.raw_size = size;
+        header.trailing_size = trailing_size;
+        header.content_hash = content_hash ? content_hash : hash_bytes(data, size - trailing_size);
+        header.block_size = block_size ? block_size : DZ_ASSET_BLOCK_SIZE;
+        header.requested_compression = uint32_t(compression);
+        std::string encoded;
+
+        if (compression == AssetCompression::Zlib && size)
+        {
+            header.compression = uint32_t(AssetCompression::Zlib);
+            header.block_count = uint32_t((size + header.block_size - 1) / header.block_size);
+            std::vector<std::string> blocks(header.block_count);
+            auto level = compression_level < 0 ? Z_DEFAULT_COMPRESSION : compression_level;
+            thread_pool_parallel_for(thread_pool_default(), header.block_count, [&](size_t block) {
+                auto raw_offset = block * header.block_size;
+                auto raw_size = (std::min)(size_t(header.block_size), size - raw_offset);
+                auto& compressed = blocks[block];
+                uLongf compressed_size = compressBound(uLong(raw_size));
+                compressed.resize(compressed_size);
+                if (compress2((Bytef*)compressed.data(), &compressed_size, (const Bytef*)(data + raw_offset), uLong(raw_size), level) != Z_OK)
+                    throw std::runtime_error("Failed to compress asset block");
+                compressed.resize(compressed_size);
+            });
+            size_t payload_size = 0;
+            for (auto& block : blocks)
+                payload_size += block.size();
+            auto table_size = (size_t(header.block_count) + 1) * sizeof(uint64_t);
+            if (sizeof(header) + table_size + payload_size < size)
+            {
+                encoded.reserve(sizeof(header) + table_size + payload_size);
+                encoded.append((const char*)&header, sizeof(header));
+                uint64_t offset = 0;
+                for (auto& block : blocks)
+                {
+                    encoded.append((const char*)&offset, sizeof(offset));
+                    offset += block.size();
+                }
+                encoded.append((const char*)&offset, sizeof(offset));
+                for (auto& block : blocks)
+                    encoded += block;
+                return encoded;
+            }
+        }
+
+        header.compression = uint32_t(AssetCompression::None);
+        header.block_count = 0;
+        encoded.reserve(sizeof(header) + size);
+        encoded.append((const char*)&header, sizeof(header));
+        encoded.append(data, size);
+        return encoded;
+    }
+
+    std::string encode_asset(AssetPack* asset_pack, const char* data, size_t size, uint64_t content_hash, uint32_t trailing_size)
+    {
+        return encode_asset_bytes(data, size, asset_pack->compression, asset_pack->compression_level, asset_pack->block_size, content_hash, trailing_size);
+    }
+
+    bool decode_asset_bytes(const char* stored, size_t stored_size, char* out, size_t out_size)
+    {
+        AssetEntry entry;
+        if (!parse_asset_entry(stored, stored_size, entry) || entry.header.raw_size != out_size)
+            return false;
+        if (entry.header.compression == uint32_t(AssetCompression::None))
+            memcpy(out, entry.payload, out_size);
+        else
+            decompress_asset_blocks(entry, 0, entry.header.block_count, out);
+        return true;
+    }
+
+    /**
+     * @brief Looks up the stored bytes of an asset, viewing the mapping when possible and otherwise reading into storage.
+     */
+    bool find_asset_entry(AssetPack* asset_pack, const std::string& path, Asset& storage, AssetEntry& entry)
+    {
+        std::string_view view;
+        if (!asset_pack->asset_stream.view(path, view))
+        {
+            if (!asset_pack->asset_stream.read(path, storage))
+                return false;
+            view = {storage.get(), storage.get_size()};
+        }
+        if (!parse_asset_entry(view.data(), view.size(), entry))
+            throw std::runtime_error("Corrupt asset entry: " + path);
+        return true;
+    }
+
     AssetPack* create_asset_pack(FileHandle& file_handle)
     {
-        return new AssetPack{
-            .asset_stream = {file_handle}
-        };
+        return new AssetPack(file_handle, AssetStream::Mode::ReadWrite);
+    }
+    AssetPack* open_asset_pack(FileHandle& file_handle)
+    {
+        return new AssetPack(file_handle, AssetStream::Mode::Mapped);
     }
     void free_asset_pack(AssetPack* asset_pack)
     {
         delete asset_pack;
     }
+    void asset_pack_set_compression(AssetPack* asset_pack, AssetCompression compression, int level, uint32_t block_size)
+    {
+        asset_pack->compression = compression;
+        asset_pack->compression_level = level;
+        asset_pack->block_size = block_size ? block_size : DZ_ASSET_BLOCK_SIZE;
+    }
+    bool get_asset_size(AssetPack* asset_pack, const std::string& path, size_t& out_size)
+    {
+        Asset storage;
+        AssetEntry entry;
+        if (!find_asset_entry(asset_pack, path, storage, entry))
+            return false;
+        out_size = size_t(entry.header.raw_size);
+        return true;
+    }
+    bool get_asset_range(AssetPack* asset_pack, const std::string& path, size_t offset, size_t size, Asset& out)
+    {
+        Asset storage;
+        AssetEntry entry;
+        if (!find_asset_entry(asset_pack, path, storage, entry))
+            return false;
+        auto raw_size = size_t(entry.header.raw_size);
+        if (offset > raw_size)
+            return false;
+        size = (std::min)(size, raw_size - offset);
+
+        if (entry.header.compression == uint32_t(AssetCompression::None))
+        {
+            if (!storage.get())
+            {
+                // the mapping outlives the asset for as long as the pack is open, nothing to free
+                out = Asset((char*)entry.payload + offset, size, &default_noop::call);
+                return true;
+            }
+            out = Asset::allocate(size, false);
+            memcpy(out.ptr, entry.payload + offset, size);
+            return true;
+        }
+
+        auto block_size = size_t(entry.header.block_size);
+        auto first_block = uint32_t(offset / block_size);
+        auto last_block = size ? uint32_t((offset + size + block_size - 1) / block_size) : first_block;
+        auto decoded_begin = size_t(first_block) * block_size;
+        auto decoded_size = (std::min)(size_t(last_block) * block_size, raw_size) - decoded_begin;
+        auto decoded = Asset::allocate(decoded_size, false);
+        decompress_asset_blocks(entry, first_block, last_block, decoded.ptr);
+        if (offset != decoded_begin)
+            memmove(decoded.ptr, decoded.ptr + (offset - decoded_begin), size);
+        decoded.control->size = size;
+        out = std::move(decoded);
+        return true;
+    }
     bool get_asset(AssetPack* asset_pack, const std::string& path, Asset& out)
     {
-        return asset_pack->asset_stream.read(path, out);
+        return get_asset_range(asset_pack, path, 0, SIZE_MAX, out);
+    }
+    void add_encoded_asset(AssetPack* asset_pack, const std::string& path, const std::string& encoded)
+    {
+        Asset encoded_asset((char*)encoded.data(), encoded.size(), &default_noop::call);
+        asset_pack->asset_stream.write(path, encoded_asset);
     }
     void add_asset(AssetPack* asset_pack, const std::string& path, const Asset& asset)
     {
-
+        add_encoded_asset(asset_pack, path, encode_asset(asset_pack, asset.get(), asset.get_size()));
     }
-    void add_asset(AssetPack* asset_pack, FileHandle& file_handle)
+    Asset read_asset_file(FileHandle& file_handle)
     {
         auto stream_ptr = file_handle.open(std::ios::in | std::ios::binary);
         auto& stream = *stream_ptr;
+        if (!stream)
+            throw std::runtime_error("Failed to open asset source: " + file_handle.path);
         stream.seekg(0, std::ios::end);
         auto size = (size_t)stream.tellg();
         stream.seekg(0);
-        auto mem = (char*)malloc(size + 1);
-        memset(mem, 0, size + 1);
-        Asset asset(mem, size + 1, &default_free_deleter::call);
+        auto asset = Asset::allocate(size + 1);
         stream.read(asset.ptr, size);
-        asset_pack->asset_stream.write(file_handle.path, asset);
+        return asset;
+    }
+    void add_asset(AssetPack* asset_pack, FileHandle& file_handle)
+    {
+        auto asset = read_asset_file(file_handle);
+        add_encoded_asset(asset_pack, file_handle.path, encode_asset(asset_pack, asset.get(), asset.get_size(), 0, 1));
+    }
+    bool find_reusable_asset(AssetPack* asset_pack, AssetPack* previous_pack, const std::string& path, uint64_t content_hash, std::string_view& stored, Asset& storage)
+    {
+        if (!previous_pack->asset_stream.view(path, stored))
+        {
+            if (!previous_pack->asset_stream.read(path, storage))
+                return false;
+            stored = {storage.get(), storage.get_size()};
+        }
+        // only entries written with a header carry a hash, and they must match the codec the new pack would use
+        AssetEntryHeader header;
+        if (stored.size() < sizeof(header) || memcmp(stored.data(), DZ_ASSET_ENTRY_MAGIC, 4) != 0)
+            return false;
+        memcpy(&header, stored.data(), sizeof(header));
+        if (header.content_hash != content_hash)
+            return false;
+        return AssetCompression(header.requested_compression) == asset_pack->compression &&
+            (asset_pack->compression == AssetCompression::None || header.block_size == asset_pack->block_size);
+    }
+    bool asset_is_reusable(AssetPack* asset_pack, AssetPack* previous_pack, const std::string& path, uint64_t content_hash)
+    {
+        std::string_view stored;
+        Asset storage;
+        return find_reusable_asset(asset_pack, previous_pack, path, content_hash, stored, storage);
+    }
+    bool reuse_asset(AssetPack* asset_pack, AssetPack* previous_pack, const std::string& path, uint64_t content_hash)
+    {
+        std::string_view stored;
+        Asset storage;
+        if (!find_reusable_asset(asset_pack, previous_pack, path, content_hash, stored, storage))
+            return false;
+        Asset stored_asset((char*)stored.data(), stored.size(), &default_noop::call);
+        asset_pack->asset_stream.write(path, stored_asset);
+        return true;
+    }
+    std::vector<AssetInfo> get_asset_infos(AssetPack* asset_pack)
+    {
+        std::vector<AssetInfo> infos;
+        for (auto& header_entry : asset_pack->asset_stream.entries())
+        {
+            Asset storage;
+            AssetEntry entry;
+            if (!find_asset_entry(asset_pack, header_entry.key, storage, entry))
+                continue;
+            auto content_hash = entry.header.content_hash;
+            if (memcmp(entry.header.magic, DZ_ASSET_ENTRY_MAGIC, 4) != 0)
+                content_hash = hash_bytes(entry.payload, entry.payload_size);
+            infos.push_back({header_entry.key, entry.header.raw_size - entry.header.trailing_size, content_hash});
+        }
+        return infos;
     }
-}
\ No newline at end of file
+}
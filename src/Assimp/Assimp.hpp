@@ -1,5 +1,6 @@
 #pragma once
 #include <assimp/Importer.hpp>
+#include <assimp/ProgressHandler.hpp>
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
 #include <dz/math.hpp>
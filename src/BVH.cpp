@@ -0,0 +1,391 @@
+#include <dz/BVH.hpp>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+namespace dz {
+    struct BVHNode
+    {
+        AABB<float, 3> bounds;
+        int parent = DZ_BVH_NULL_NODE; // next free node while on the free list
+        int left = DZ_BVH_NULL_NODE;
+        int right = DZ_BVH_NULL_NODE;
+        int height = -1; // 0 for leaves, -1 for free nodes
+        int user_id = -1;
+
+        bool IsLeaf() const {
+            return left == DZ_BVH_NULL_NODE;
+        }
+    };
+
+    struct BVH
+    {
+        std::vector<BVHNode> nodes;
+        int root = DZ_BVH_NULL_NODE;
+        int free_list = DZ_BVH_NULL_NODE;
+        size_t proxy_count = 0;
+        float fat_margin = DZ_BVH_FAT_MARGIN;
+    };
+
+    int bvh_allocate_node(BVH* bvh) {
+        if (bvh->free_list == DZ_BVH_NULL_NODE) {
+            bvh->nodes.emplace_back();
+            bvh->nodes.back().height = 0;
+            return int(bvh->nodes.size() - 1);
+        }
+        auto node_index = bvh->free_list;
+        auto& node = bvh->nodes[node_index];
+        bvh->free_list = node.parent;
+        node = BVHNode{};
+        node.height = 0;
+        return node_index;
+    }
+
+    void bvh_free_node(BVH* bvh, int node_index) {
+        auto& node = bvh->nodes[node_index];
+        node.parent = bvh->free_list;
+        node.height = -1;
+        bvh->free_list = node_index;
+    }
+
+    BVHNode& bvh_get_leaf(BVH* bvh, int proxy) {
+        if (proxy < 0 || proxy >= int(bvh->nodes.size()) || bvh->nodes[proxy].height != 0)
+            throw std::runtime_error("Invalid BVH proxy");
+        return bvh->nodes[proxy];
+    }
+
+    void bvh_refit_node(BVH* bvh, int node_index) {
+        auto& node = bvh->nodes[node_index];
+        auto& left = bvh->nodes[node.left];
+        auto& right = bvh->nodes[node.right];
+        node.bounds = left.bounds.merged(right.bounds);
+        node.height = 1 + std::max(left.height, right.height);
+    }
+
+    /**
+     * @brief Rotates the taller grandchild of a up when a's children differ in height by more than one
+     *
+     * @returns the node now at a's place in the tree
+     */
+    int bvh_balance(BVH* bvh, int a_index) {
+        auto& nodes = bvh->nodes;
+        auto& a = nodes[a_index];
+        if (a.IsLeaf() || a.height < 2)
+            return a_index;
+
+        auto b_index = a.left;
+        auto c_index = a.right;
+        auto balance = nodes[c_index].height - nodes[b_index].height;
+
+        auto rotate_up = [&](int up_index, bool up_is_right) {
+            auto& up = nodes[up_index];
+            auto f_index = up.left;
+            auto g_index = up.right;
+            auto other_index = up_is_right ? b_index : c_index;
+
+            up.left = a_index;
+            up.parent = a.parent;
+            a.parent = up_index;
+
+            if (up.parent != DZ_BVH_NULL_NODE) {
+                auto& up_parent = nodes[up.parent];
+                if (up_parent.left == a_index)
+                    up_parent.left = up_index;
+                else
+                    up_parent.right = up_index;
+            }
+            else
+                bvh->root = up_index;
+
+            // the taller grandchild stays under up, the shorter one moves down to a
+            auto keep_index = nodes[f_index].height > nodes[g_index].height ? f_index : g_index;
+            auto move_index = keep_index == f_index ? g_index : f_index;
+            up.right = keep_index;
+            if (up_is_right)
+                a.right = move_index;
+            else
+                a.left = move_index;
+            nodes[move_index].parent = a_index;
+
+            a.bounds = nodes[other_index].bounds.merged(nodes[move_index].bounds);
+            a.height = 1 + std::max(nodes[other_index].height, nodes[move_index].height);
+            up.bounds = a.bounds.merged(nodes[keep_index].bounds);
+            up.height = 1 + std::max(a.height, nodes[keep_index].height);
+            return up_index;
+        };
+
+        if (balance > 1)
+            return rotate_up(c_index, true);
+        if (balance < -1)
+            return rotate_up(b_index, false);
+        return a_index;
+    }
+
+    void bvh_refit_ancestors(BVH* bvh, int node_index) {
+        while (node_index != DZ_BVH_NULL_NODE) {
+            node_index = bvh_balance(bvh, node_index);
+            bvh_refit_node(bvh, node_index);
+            node_index = bvh->nodes[node_index].parent;
+        }
+    }
+
+    void bvh_insert_leaf(BVH* bvh, int leaf_index) {
+        auto& nodes = bvh->nodes;
+        if (bvh->root == DZ_BVH_NULL_NODE) {
+            bvh->root = leaf_index;
+            nodes[leaf_index].parent = DZ_BVH_NULL_NODE;
+            return;
+        }
+
+        // walk down picking the child with the lowest surface area cost, stopping when a new parent here is cheaper
+        auto leaf_bounds = nodes[leaf_index].bounds;
+        auto index = bvh->root;
+        while (!nodes[index].IsLeaf()) {
+            auto& node = nodes[index];
+            auto area = node.bounds.surface_area();
+            auto combined_area = node.bounds.merged(leaf_bounds).surface_area();
+            auto cost = 2.0f * combined_area;
+            auto inheritance_cost = 2.0f * (combined_area - area);
+
+            auto child_cost = [&](int child_index) {
+                auto& child = nodes[child_index];
+                auto merged_area = child.bounds.merged(leaf_bounds).surface_area();
+                if (child.IsLeaf())
+                    return merged_area + inheritance_cost;
+                return merged_area - child.bounds.surface_area() + inheritance_cost;
+            };
+            auto left_cost = child_cost(node.left);
+            auto right_cost = child_cost(node.right);
+
+            if (cost < left_cost && cost < right_cost)
+                break;
+            index = left_cost < right_cost ? node.left : node.right;
+        }
+
+        auto sibling_index = index;
+        auto new_parent_index = bvh_allocate_node(bvh);
+        auto old_parent_index = nodes[sibling_index].parent;
+        auto& new_parent = nodes[new_parent_index];
+        new_parent.parent = old_parent_index;
+        new_parent.bounds = leaf_bounds.merged(nodes[sibling_index].bounds);
+        new_parent.height = nodes[sibling_index].height + 1;
+        new_parent.left = sibling_index;
+        new_parent.right = leaf_index;
+        nodes[sibling_index].parent = new_parent_index;
+        nodes[leaf_index].parent = new_parent_index;
+
+        if (old_parent_index != DZ_BVH_NULL_NODE) {
+            auto& old_parent = nodes[old_parent_index];
+            if (old_parent.left == sibling_index)
+                old_parent.left = new_parent_index;
+            else
+                old_parent.right = new_parent_index;
+        }
+        else
+            bvh->root = new_parent_index;
+
+        bvh_refit_ancestors(bvh, new_parent_index);
+    }
+
+    void bvh_remove_leaf(BVH* bvh, int leaf_index) {
+        auto& nodes = bvh->nodes;
+        if (leaf_index == bvh->root) {
+            bvh->root = DZ_BVH_NULL_NODE;
+            return;
+        }
+
+        auto parent_index = nodes[leaf_index].parent;
+        auto grand_parent_index = nodes[parent_index].parent;
+        auto sibling_index = nodes[parent_index].left == leaf_index ? nodes[parent_index].right : nodes[parent_index].left;
+
+        bvh_free_node(bvh, parent_index);
+        nodes[leaf_index].parent = DZ_BVH_NULL_NODE;
+
+        if (grand_parent_index == DZ_BVH_NULL_NODE) {
+            bvh->root = sibling_index;
+            nodes[sibling_index].parent = DZ_BVH_NULL_NODE;
+            return;
+        }
+
+        auto& grand_parent = nodes[grand_parent_index];
+        if (grand_parent.left == parent_index)
+            grand_parent.left = sibling_index;
+        else
+            grand_parent.right = sibling_index;
+        nodes[sibling_index].parent = grand_parent_index;
+
+        bvh_refit_ancestors(bvh, grand_parent_index);
+    }
+
+    BVH* bvh_create(float fat_margin) {
+        auto bvh = new BVH;
+        bvh->fat_margin = fat_margin;
+        return bvh;
+    }
+
+    void bvh_free(BVH* bvh) {
+        delete bvh;
+    }
+
+    void bvh_clear(BVH* bvh) {
+        bvh->root = DZ_BVH_NULL_NODE;
+        bvh->free_list = DZ_BVH_NULL_NODE;
+        bvh->proxy_count = 0;
+        for (int node_index = int(bvh->nodes.size()) - 1; node_index >= 0; node_index--)
+            bvh_free_node(bvh, node_index);
+    }
+
+    int bvh_insert(BVH* bvh, const AABB<float, 3>& bounds, int user_id) {
+        auto proxy = bvh_allocate_node(bvh);
+        auto& leaf = bvh->nodes[proxy];
+        leaf.bounds = bounds.inflated(bvh->fat_margin);
+        leaf.user_id = user_id;
+        bvh_insert_leaf(bvh, proxy);
+        bvh->proxy_count++;
+        return proxy;
+    }
+
+    void bvh_remove(BVH* bvh, int proxy) {
+        bvh_get_leaf(bvh, proxy);
+        bvh_remove_leaf(bvh, proxy);
+        bvh_free_node(bvh, proxy);
+        bvh->proxy_count--;
+    }
+
+    bool bvh_move(BVH* bvh, int proxy, const AABB<float, 3>& bounds) {
+        auto& leaf = bvh_get_leaf(bvh, proxy);
+        // keep the leaf while it still fits its fat box and that box is not much larger than needed
+        if (leaf.bounds.contains(bounds) && bounds.inflated(4.0f * bvh->fat_margin).contains(leaf.bounds))
+            return false;
+        bvh_remove_leaf(bvh, proxy);
+        bvh->nodes[proxy].bounds = bounds.inflated(bvh->fat_margin);
+        bvh_insert_leaf(bvh, proxy);
+        return true;
+    }
+
+    int bvh_get_user_id(BVH* bvh, int proxy) {
+        return bvh_get_leaf(bvh, proxy).user_id;
+    }
+
+    const AABB<float, 3>& bvh_get_fat_bounds(BVH* bvh, int proxy) {
+        return bvh_get_leaf(bvh, proxy).bounds;
+    }
+
+    size_t bvh_get_proxy_count(BVH* bvh) {
+        return bvh->proxy_count;
+    }
+
+    int bvh_get_height(BVH* bvh) {
+        if (bvh->root == DZ_BVH_NULL_NODE)
+            return 0;
+        return bvh->nodes[bvh->root].height;
+    }
+
+    /**
+     * @brief depth first walk reporting the leaves of every node overlap accepts
+     *
+     * The stacks are local so a callback may run further queries on the same BVH.
+     */
+    template <typename TOverlap>
+    void bvh_query(BVH* bvh, const TOverlap& overlap, const BVHQueryCallback& callback) {
+        if (bvh->root == DZ_BVH_NULL_NODE)
+            return;
+        std::vector<int> stack{bvh->root};
+        while (!stack.empty()) {
+            auto& node = bvh->nodes[stack.back()];
+            stack.pop_back();
+            if (!overlap(node.bounds))
+                continue;
+            if (node.IsLeaf()) {
+                if (!callback(node.user_id))
+                    return;
+                continue;
+            }
+            stack.push_back(node.left);
+            stack.push_back(node.right);
+        }
+    }
+
+    void bvh_query_aabb(BVH* bvh, const AABB<float, 3>& bounds, const BVHQueryCallback& callback) {
+        bvh_query(bvh, [&](const AABB<float, 3>& node_bounds) { return node_bounds.intersects(bounds); }, callback);
+    }
+
+    void bvh_query_sphere(BVH* bvh, const BoundingSphere<float>& sphere, const BVHQueryCallback& callback) {
+        bvh_query(bvh, [&](const AABB<float, 3>& node_bounds) { return sphere.intersects(node_bounds); }, callback);
+    }
+
+    void bvh_query_frustum(BVH* bvh, const Frustum<float>& frustum, const BVHQueryCallback& callback) {
+        if (bvh->root == DZ_BVH_NULL_NODE)
+            return;
+        std::vector<int> stack{bvh->root};
+        // subtrees already known to be inside the frustum, drained first so their leaves are reported without plane tests
+        std::vector<int> inside;
+        while (!stack.empty() || !inside.empty()) {
+            if (!inside.empty()) {
+                auto& node = bvh->nodes[inside.back()];
+                inside.pop_back();
+                if (node.IsLeaf()) {
+                    if (!callback(node.user_id))
+                        return;
+                    continue;
+                }
+                inside.push_back(node.left);
+                inside.push_back(node.right);
+                continue;
+            }
+            auto node_index = stack.back();
+            auto& node = bvh->nodes[node_index];
+            stack.pop_back();
+            if (!frustum.intersects(node.bounds))
+                continue;
+            if (node.IsLeaf() || frustum.contains(node.bounds)) {
+                inside.push_back(node_index);
+                continue;
+            }
+            stack.push_back(node.left);
+            stack.push_back(node.right);
+        }
+    }
+
+    int bvh_raycast(BVH* bvh, const Ray<float>& ray, float t_max, float& out_distance, const BVHRayCallback& callback) {
+        int closest_user_id = DZ_BVH_NULL_NODE;
+        if (bvh->root == DZ_BVH_NULL_NODE)
+            return closest_user_id;
+
+        float box_distance;
+        if (!ray_intersects_aabb(ray, bvh->nodes[bvh->root].bounds, t_max, box_distance))
+            return closest_user_id;
+
+        // stack of (node, entry distance) so nodes entered beyond the best hit can be skipped once it shrinks
+        std::vector<std::pair<int, float>> stack;
+        stack.emplace_back(bvh->root, box_distance);
+        while (!stack.empty()) {
+            auto [node_index, node_distance] = stack.back();
+            stack.pop_back();
+            if (node_distance > t_max)
+                continue;
+            auto& node = bvh->nodes[node_index];
+            if (node.IsLeaf()) {
+                auto hit_distance = callback ? callback(node.user_id, ray, node_distance) : node_distance;
+                if (hit_distance >= 0.0f && hit_distance <= t_max) {
+                    t_max = hit_distance;
+                    closest_user_id = node.user_id;
+                }
+                continue;
+            }
+            AABB<float, 3> children[2] = {bvh->nodes[node.left].bounds, bvh->nodes[node.right].bounds};
+            float hits[2];
+            ray_test_aabbs(ray, children, 2, t_max, hits);
+            // push the further child first so the nearer one is visited next
+            bool left_first = hits[0] >= 0.0f && (hits[1] < 0.0f || hits[0] <= hits[1]);
+            int order[2] = {left_first ? 1 : 0, left_first ? 0 : 1};
+            for (auto child : order) {
+                if (hits[child] >= 0.0f)
+                    stack.emplace_back(child ? node.right : node.left, hits[child]);
+            }
+        }
+        if (closest_user_id != DZ_BVH_NULL_NODE)
+            out_distance = t_max;
+        return closest_user_id;
+    }
+}
@@ -98,24 +98,18 @@ namespace dz {
     }
 
     /**
-    * @brief For dynamic SSBOs, sets the number of elements the buffer should hold.
-    * This MUST be called before shader_create_resources().
-    * This function also allocates the initial CPU-side staging buffer.
-    *
-    * @param shader The shader object.
-    * @param buffer_name The GLSL variable name of the buffer.
-    * @param element_count The number of elements to allocate space for.
+    * @brief Resizes a dynamic buffer without touching descriptor sets, returns true if they need updating
     */
-    void buffer_group_set_buffer_element_count(BufferGroup* buffer_group, const std::string& buffer_name, uint32_t element_count) {
+    bool buffer_group_resize_buffer(BufferGroup* buffer_group, const std::string& buffer_name, uint32_t element_count, bool preserve_data) {
         if (buffer_group->buffers.find(buffer_name) == buffer_group->buffers.end()) {
             std::cerr << "Warning: Cannot set element count for buffer '" << buffer_name << "'. It was not found in reflection." << std::endl;
-            return;
+            return false;
         }
 
         auto& buffer = buffer_group->buffers.at(buffer_name);
         if (!buffer.is_dynamic_sized) {
             std::cerr << "Warning: Buffer '" << buffer_name << "' is not a dynamic, runtime-sized buffer." << std::endl;
-            return;
+            return false;
         }
 
         auto old_element_count = buffer.element_count;
@@ -126,24 +120,54 @@ namespace dz {
         size_t new_size = buffer.element_count * buffer.element_stride;
 
         if (buffer.data_ptr && !buffer.gpu_buffer.mapped_memory) {
-            auto new_buffer = std::shared_ptr<uint8_t>(new uint8_t[new_size], std::default_delete<uint8_t[]>());
-            memset(new_buffer.get(), 0, new_size);
-            memcpy(new_buffer.get(), buffer.data_ptr.get(), (std::min)(old_size, new_size));
+            auto new_buffer = allocator_make_shared_buffer(new_size);
+            if (preserve_data)
+                memcpy(new_buffer.get(), buffer.data_ptr.get(), (std::min)(old_size, new_size));
             buffer.data_ptr = new_buffer;
         
             std::cout << "Resized dynamic CPU buffer '" << buffer_name << "' to hold " << element_count << " elements (" << new_size << " bytes)." << std::endl;
         }
         else if (!buffer.gpu_buffer.mapped_memory) {
-            // Allocate the initial CPU-side buffer. Use a custom deleter for array `new[]`.
-            buffer.data_ptr = std::shared_ptr<uint8_t>(new uint8_t[new_size], std::default_delete<uint8_t[]>());
-            memset(buffer.data_ptr.get(), 0, new_size);
+            // Allocate the initial CPU-side buffer, zero filled by the allocator.
+            buffer.data_ptr = allocator_make_shared_buffer(new_size);
             std::cout << "Set dynamic CPU buffer '" << buffer_name << "' to hold " << element_count << " elements (" << new_size << " bytes). CPU staging buffer created." << std::endl;
         }
         else {
-            buffer_group_resize_gpu_buffer(buffer_name, buffer);
-            for (auto& [shader, _] : buffer_group->shaders)
-                shader_update_descriptor_sets(shader);
+            buffer_group_resize_gpu_buffer(buffer_name, buffer, preserve_data);
+            return true;
         }
+        return false;
+    }
+
+    /**
+    * @brief For dynamic SSBOs, sets the number of elements the buffer should hold.
+    * This MUST be called before shader_create_resources().
+    * This function also allocates the initial CPU-side staging buffer.
+    *
+    * @param shader The shader object.
+    * @param buffer_name The GLSL variable name of the buffer.
+    * @param element_count The number of elements to allocate space for.
+    */
+    void buffer_group_set_buffer_element_count(BufferGroup* buffer_group, const std::string& buffer_name, uint32_t element_count) {
+        if (!buffer_group_resize_buffer(buffer_group, buffer_name, element_count, true))
+            return;
+        for (auto& [shader, _] : buffer_group->shaders)
+            shader_update_descriptor_sets(shader);
+    }
+
+    void buffer_group_set_buffer_element_counts(BufferGroup* buffer_group, const std::vector<std::pair<std::string, uint32_t>>& element_counts, bool preserve_data) {
+        bool update_descriptor_sets = false;
+        for (auto& [buffer_name, element_count] : element_counts) {
+            auto buffer_it = buffer_group->buffers.find(buffer_name);
+            // buffers that already hold the requested count keep their allocation
+            if (buffer_it != buffer_group->buffers.end() && buffer_it->second.data_ptr && buffer_it->second.element_count == element_count)
+                continue;
+            update_descriptor_sets |= buffer_group_resize_buffer(buffer_group, buffer_name, element_count, preserve_data);
+        }
+        if (!update_descriptor_sets)
+            return;
+        for (auto& [shader, _] : buffer_group->shaders)
+            shader_update_descriptor_sets(shader);
     }
 
     uint32_t buffer_group_get_buffer_element_count(BufferGroup* buffer_group, const std::string& buffer_name) {
@@ -189,27 +213,16 @@ namespace dz {
 
         // If this is a fixed-size buffer and the data hasn't been allocated yet, do it now.
         if (!buffer.data_ptr && !buffer.is_dynamic_sized) {
-            buffer.data_ptr = std::shared_ptr<uint8_t>(new uint8_t[buffer.static_size], std::default_delete<uint8_t[]>());
+            buffer.data_ptr = allocator_make_shared_buffer(buffer.static_size, false);
         }
 
         return buffer.data_ptr;
     }
 
     /**
-    * @brief Gets a reflected view of a specific struct element within a shader buffer.
-    * This view allows updating individual members of the struct by name, handling
-    * memory layout differences (padding, alignment) automatically.
-    *
-    * This function is intended for buffers whose `element_type` is a struct (e.g., UBOs, SSBOs of structs).
-    *
-    * @param shader The shader object.
-    * @param buffer_name The GLSL variable name of the buffer (e.g., "ubo_scene", "particles").
-    * @param index The 0-based index of the element to view (for SSBOs). For UBOs, this is usually 0.
-    * @return A ReflectedStructView object.
-    * @throws std::runtime_error if the buffer/element is not found, data_ptr is null,
-    * index is out of bounds, or the element type is not a struct.
+    * @brief Finds the named buffer for a view, allocating CPU-side storage for fixed-size buffers on first access
     */
-    ReflectedStructView buffer_group_get_buffer_element_view(BufferGroup* buffer_group, const std::string& buffer_name, uint32_t index) {
+    ShaderBuffer& buffer_group_get_view_buffer(BufferGroup* buffer_group, const std::string& buffer_name) {
         // Find the ShaderBuffer
         auto it = buffer_group->buffers.find(buffer_name);
         if (it == buffer_group->buffers.end()) {
@@ -221,22 +234,22 @@ namespace dz {
         if (!buffer.data_ptr) {
             // If it's a fixed-size buffer and data isn't allocated, attempt to allocate it now.
             if (!buffer.is_dynamic_sized && buffer.static_size > 0) {
-                buffer.data_ptr = std::shared_ptr<uint8_t>(new uint8_t[buffer.static_size], std::default_delete<uint8_t[]>());
+                buffer.data_ptr = allocator_make_shared_buffer(buffer.static_size, false);
                 std::cout << "Info: Allocating CPU-side buffer for fixed-size buffer '" << buffer_name << "' on first view access." << std::endl;
             } else {
                 throw std::runtime_error("shader_get_buffer_element_view: Buffer data_ptr is null for '" + buffer_name + "'. "
                                         "Ensure shader_set_buffer_element_count() was called for dynamic buffers, or it's mapped/allocated.");
             }
         }
+        return buffer;
+    }
 
-        // Validate index for dynamic buffers
-        if (index >= buffer.element_count) {
-            throw std::out_of_range("shader_get_buffer_element_view: Index " + std::to_string(index) +
-                                    " is out of bounds for buffer '" + buffer_name + "' (element count: " + std::to_string(buffer.element_count) + ").");
-        }
-
-        // Calculate the base address of the desired element within the buffer's data_ptr
-        uint8_t* element_base_ptr = buffer.data_ptr.get() + (index * buffer.element_stride);
+    /**
+    * @brief Returns the ReflectedStruct of a buffer's element type, resolved from the group's shaders once and cached on the buffer
+    */
+    const ReflectedStruct& buffer_group_get_canonical_struct(BufferGroup* buffer_group, const std::string& buffer_name, ShaderBuffer& buffer) {
+        if (buffer.canonical_struct)
+            return *buffer.canonical_struct;
 
         // Get the ReflectedStruct definition for the element type
         if (buffer.element_type.type_kind != "struct") {
@@ -246,21 +259,55 @@ namespace dz {
         for (auto& shader_pair : buffer_group->shaders) {
             auto shader = shader_pair.first;
             for (auto& shaderModulePair : shader->module_map) {
-                const ReflectedStruct& reflected_struct_def = getCanonicalStruct(shaderModulePair.second.reflection, buffer.element_type);
-                // Return the ReflectedStructView
-                return ReflectedStructView(element_base_ptr, reflected_struct_def);
+                buffer.canonical_struct = &getCanonicalStruct(shaderModulePair.second.reflection, buffer.element_type);
+                return *buffer.canonical_struct;
             }
         }
         throw std::runtime_error("Could not get ReflectedStruct");
     }
 
+    /**
+    * @brief Gets a reflected view of a specific struct element within a shader buffer.
+    * This view allows updating individual members of the struct by name, handling
+    * memory layout differences (padding, alignment) automatically.
+    *
+    * This function is intended for buffers whose `element_type` is a struct (e.g., UBOs, SSBOs of structs).
+    *
+    * @param shader The shader object.
+    * @param buffer_name The GLSL variable name of the buffer (e.g., "ubo_scene", "particles").
+    * @param index The 0-based index of the element to view (for SSBOs). For UBOs, this is usually 0.
+    * @return A ReflectedStructView object.
+    * @throws std::runtime_error if the buffer/element is not found, data_ptr is null,
+    * index is out of bounds, or the element type is not a struct.
+    */
+    ReflectedStructView buffer_group_get_buffer_element_view(BufferGroup* buffer_group, const std::string& buffer_name, uint32_t index) {
+        auto& buffer = buffer_group_get_view_buffer(buffer_group, buffer_name);
+
+        // Validate index for dynamic buffers
+        if (index >= buffer.element_count) {
+            throw std::out_of_range("shader_get_buffer_element_view: Index " + std::to_string(index) +
+                                    " is out of bounds for buffer '" + buffer_name + "' (element count: " + std::to_string(buffer.element_count) + ").");
+        }
+
+        // Calculate the base address of the desired element within the buffer's data_ptr
+        uint8_t* element_base_ptr = buffer.data_ptr.get() + (index * buffer.element_stride);
+
+        return ReflectedStructView(element_base_ptr, buffer_group_get_canonical_struct(buffer_group, buffer_name, buffer));
+    }
+
+    ReflectedBufferView buffer_group_get_buffer_view(BufferGroup* buffer_group, const std::string& buffer_name) {
+        auto& buffer = buffer_group_get_view_buffer(buffer_group, buffer_name);
+        auto& reflected_struct_def = buffer_group_get_canonical_struct(buffer_group, buffer_name, buffer);
+        return ReflectedBufferView(buffer.data_ptr.get(), buffer.element_stride, buffer.element_count, reflected_struct_def);
+    }
+
     void buffer_group_destroy(BufferGroup* buffer_group) {
         auto& device = dr.device;
         if (device == VK_NULL_HANDLE)
             return;
         for (auto& bufferPair : buffer_group->buffers) {
             vkDestroyBuffer(device, bufferPair.second.gpu_buffer.buffer, 0);
-            vkFreeMemory(device, bufferPair.second.gpu_buffer.memory, 0);
+            gpu_memory_free(bufferPair.second.gpu_buffer.allocation);
         }
     }
 
@@ -276,44 +323,73 @@ namespace dz {
         }
     }
 
-    void buffer_group_make_gpu_buffer(const std::string& name, ShaderBuffer& buffer) {
-        VkDeviceSize buffer_size = ensure_buffer_size(name, buffer);
-
-        if (buffer_size == 0) {
-            std::cerr << "Warning: Skipping buffer '" << name << "' with zero size." << std::endl;
-            return;
-        }
-
-        // Create the GpuBuffer
+    /**
+    * @brief Creates a VkBuffer of size bytes for buffer in host visible memory, taking the memory from a fuller block than relocate_from's when given
+    */
+    bool buffer_group_create_gpu_buffer(const std::string& name, ShaderBuffer& buffer, VkDeviceSize size, GpuBuffer& out, const GPUAllocation* relocate_from = nullptr) {
         VkBufferUsageFlags usage = (buffer.descriptor_type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
             ? VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT
             : VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
-        
+
         VkBufferCreateInfo buffer_info{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
-        buffer_info.size = buffer_size;
+        buffer_info.size = size;
         buffer_info.usage = usage;
         buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-        if (vkCreateBuffer(dr.device, &buffer_info, nullptr, &buffer.gpu_buffer.buffer) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to create buffer for " + name);
+        out = {};
+        if (vkCreateBuffer(dr.device, &buffer_info, nullptr, &out.buffer) != VK_SUCCESS) {
+            std::cerr << "Failed to create buffer for " << name << std::endl;
+            return false;
         }
 
         VkMemoryRequirements mem_reqs;
-        vkGetBufferMemoryRequirements(dr.device, buffer.gpu_buffer.buffer, &mem_reqs);
-        
-        VkMemoryAllocateInfo alloc_info{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
-        alloc_info.allocationSize = mem_reqs.size;
-        alloc_info.memoryTypeIndex = FindMemoryType(dr.physicalDevice, mem_reqs.memoryTypeBits, 
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+        vkGetBufferMemoryRequirements(dr.device, out.buffer, &mem_reqs);
+
+        try {
+            if (relocate_from) {
+                if (!gpu_memory_relocate(mem_reqs, *relocate_from, out.allocation)) {
+                    vkDestroyBuffer(dr.device, out.buffer, nullptr);
+                    out = {};
+                    return false;
+                }
+            }
+            else
+                out.allocation = gpu_memory_allocate(mem_reqs,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+                    GPUMemoryCategory::Buffer, true);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Failed to allocate memory for buffer " << name << ": " << e.what() << std::endl;
+            vkDestroyBuffer(dr.device, out.buffer, nullptr);
+            out = {};
+            return false;
+        }
 
-        if (vkAllocateMemory(dr.device, &alloc_info, nullptr, &buffer.gpu_buffer.memory) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to allocate memory for buffer " + name);
+        if (vkBindBufferMemory(dr.device, out.buffer, out.allocation.memory, out.allocation.offset) != VK_SUCCESS) {
+            std::cerr << "Failed to bind buffer memory: " << name << std::endl;
+            vkDestroyBuffer(dr.device, out.buffer, nullptr);
+            gpu_memory_free(out.allocation);
+            out = {};
+            return false;
         }
-        vkBindBufferMemory(dr.device, buffer.gpu_buffer.buffer, buffer.gpu_buffer.memory, 0);
 
-        // Persistently map the memory
-        vkMapMemory(dr.device, buffer.gpu_buffer.memory, 0, buffer_size, 0, &buffer.gpu_buffer.mapped_memory);
-        buffer.gpu_buffer.size = buffer_size;
+        // host visible blocks are persistently mapped by the allocator
+        out.mapped_memory = out.allocation.mapped;
+        out.size = size;
+        return true;
+    }
+
+    void buffer_group_make_gpu_buffer(const std::string& name, ShaderBuffer& buffer) {
+        VkDeviceSize buffer_size = ensure_buffer_size(name, buffer);
+
+        if (buffer_size == 0) {
+            std::cerr << "Warning: Skipping buffer '" << name << "' with zero size." << std::endl;
+            return;
+        }
+
+        if (!buffer_group_create_gpu_buffer(name, buffer, buffer_size, buffer.gpu_buffer)) {
+            throw std::runtime_error("Failed to create GPU buffer for " + name);
+        }
 
         // Copy from CPU staging pointer to mapped GPU pointer
         if (buffer.data_ptr) {
@@ -325,7 +401,7 @@ namespace dz {
         std::cout << "Remapped data_ptr for '" << name << "' to point directly to GPU memory." << std::endl;
     }
 
-    bool buffer_group_resize_gpu_buffer(const std::string& name, ShaderBuffer& buffer) {
+    bool buffer_group_resize_gpu_buffer(const std::string& name, ShaderBuffer& buffer, bool preserve_data) {
         VkDeviceSize old_size = buffer.gpu_buffer.size;
         VkDeviceSize new_size = ensure_buffer_size(name, buffer);
 
@@ -339,69 +415,45 @@ namespace dz {
             return false;
         }
 
-        VkBufferUsageFlags usage = (buffer.descriptor_type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
-            ? VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT
-            : VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
-
-        VkBufferCreateInfo buffer_info{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
-        buffer_info.size = new_size;
-        buffer_info.usage = usage;
-        buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-        VkBuffer new_buffer;
-        if (vkCreateBuffer(dr.device, &buffer_info, nullptr, &new_buffer) != VK_SUCCESS) {
-            std::cerr << "Failed to create new buffer for resize: " << name << std::endl;
-            return false;
-        }
-
-        VkMemoryRequirements mem_reqs;
-        vkGetBufferMemoryRequirements(dr.device, new_buffer, &mem_reqs);
-
-        VkMemoryAllocateInfo alloc_info{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
-        alloc_info.allocationSize = mem_reqs.size;
-        alloc_info.memoryTypeIndex = FindMemoryType(dr.physicalDevice, mem_reqs.memoryTypeBits,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
-
-        VkDeviceMemory new_memory;
-        if (vkAllocateMemory(dr.device, &alloc_info, nullptr, &new_memory) != VK_SUCCESS) {
-            std::cerr << "Failed to allocate memory for new buffer: " << name << std::endl;
-            vkDestroyBuffer(dr.device, new_buffer, nullptr);
+        GpuBuffer new_gpu_buffer;
+        if (!buffer_group_create_gpu_buffer(name, buffer, new_size, new_gpu_buffer))
             return false;
-        }
 
-        if (vkBindBufferMemory(dr.device, new_buffer, new_memory, 0) != VK_SUCCESS) {
-            std::cerr << "Failed to bind new buffer memory: " << name << std::endl;
-            vkDestroyBuffer(dr.device, new_buffer, nullptr);
-            vkFreeMemory(dr.device, new_memory, nullptr);
-            return false;
-        }
-
-        void* new_mapped_memory;
-        if (vkMapMemory(dr.device, new_memory, 0, new_size, 0, &new_mapped_memory) != VK_SUCCESS) {
-            std::cerr << "Failed to map new memory for buffer: " << name << std::endl;
-            vkDestroyBuffer(dr.device, new_buffer, nullptr);
-            vkFreeMemory(dr.device, new_memory, nullptr);
-            return false;
-        }
-
-        if (buffer.gpu_buffer.mapped_memory && old_size > 0) {
-            memcpy(new_mapped_memory, buffer.gpu_buffer.mapped_memory, (std::min)(old_size, new_size));
+        if (preserve_data && buffer.gpu_buffer.mapped_memory && old_size > 0) {
+            memcpy(new_gpu_buffer.mapped_memory, buffer.gpu_buffer.mapped_memory, (std::min)(old_size, new_size));
             std::cout << "Copied " << old_size << " bytes from old to new buffer for '" << name << "'." << std::endl;
         }
 
-        vkUnmapMemory(dr.device, buffer.gpu_buffer.memory);
         vkDestroyBuffer(dr.device, buffer.gpu_buffer.buffer, nullptr);
-        vkFreeMemory(dr.device, buffer.gpu_buffer.memory, nullptr);
+        gpu_memory_free(buffer.gpu_buffer.allocation);
 
-        buffer.gpu_buffer.buffer = new_buffer;
-        buffer.gpu_buffer.memory = new_memory;
-        buffer.gpu_buffer.mapped_memory = new_mapped_memory;
-        buffer.gpu_buffer.size = new_size;
+        buffer.gpu_buffer = new_gpu_buffer;
 
-        buffer.data_ptr.reset(static_cast<uint8_t*>(new_mapped_memory), [](uint8_t*){ /* Do nothing */ });
+        buffer.data_ptr.reset(static_cast<uint8_t*>(buffer.gpu_buffer.mapped_memory), [](uint8_t*){ /* Do nothing */ });
         std::cout << "Successfully resized GPU buffer for '" << name << "' to size " << new_size << "." << std::endl;
 
         return true;
     }
 
-}
\ No newline at end of file
+    bool buffer_group_defragment(BufferGroup* buffer_group, size_t max_bytes, size_t& moved_bytes) {
+        bool moved = false;
+        for (auto& [name, buffer] : buffer_group->buffers) {
+            if (moved_bytes >= max_bytes)
+                break;
+            if (!buffer.gpu_buffer.buffer || !gpu_memory_should_relocate(buffer.gpu_buffer.allocation))
+                continue;
+            GpuBuffer new_gpu_buffer;
+            if (!buffer_group_create_gpu_buffer(name, buffer, buffer.gpu_buffer.size, new_gpu_buffer, &buffer.gpu_buffer.allocation))
+                continue;
+            memcpy(new_gpu_buffer.mapped_memory, buffer.gpu_buffer.mapped_memory, buffer.gpu_buffer.size);
+            vkDestroyBuffer(dr.device, buffer.gpu_buffer.buffer, nullptr);
+            gpu_memory_free(buffer.gpu_buffer.allocation);
+            buffer.gpu_buffer = new_gpu_buffer;
+            buffer.data_ptr.reset(static_cast<uint8_t*>(buffer.gpu_buffer.mapped_memory), [](uint8_t*){ /* Do nothing */ });
+            moved_bytes += buffer.gpu_buffer.size;
+            moved = true;
+        }
+        return moved;
+    }
+
+}
@@ -7,5 +7,14 @@ namespace dz {
 
     VkImageUsageFlags infer_image_usage_flags(const std::unordered_map<Shader*, VkDescriptorType>& types);
 
-    bool buffer_group_resize_gpu_buffer(const std::string& name, ShaderBuffer& buffer);
+    bool buffer_group_resize_gpu_buffer(const std::string& name, ShaderBuffer& buffer, bool preserve_data = true);
+
+    bool buffer_group_resize_buffer(BufferGroup* buffer_group, const std::string& buffer_name, uint32_t element_count, bool preserve_data);
+
+    /**
+    * @brief Moves the group's buffers that sit in sparse memory blocks into fuller ones, returns true if any moved
+    *
+    * @note the device must be idle, descriptor sets of the group's shaders need updating afterwards
+    */
+    bool buffer_group_defragment(BufferGroup* buffer_group, size_t max_bytes, size_t& moved_bytes);
 }
\ No newline at end of file
@@ -1,135 +1,858 @@
 #include <dz/D7Stream.hpp>
+#include <dz/FileHandle.hpp>
+#include <dz/internal/vlen.hpp>
+#include <fstream>
+#include <string_view>
+#include <cstring>
+#include <memory>
 
 namespace dz {
-    size_t* D7Stream::addStreamPoint(const StreamPoint& point)
+    struct D7PendingBlock {
+        StreamPoint points[DZ_D7_PENDING_BLOCK_SIZE];
+        std::atomic<size_t> count = 0;
+        std::atomic<D7PendingBlock*> next = nullptr;
+    };
+
+    /**
+    * @brief single producer single consumer queue of blocks, one per recording thread
+    *
+    * The producer fills tail and publishes each point through count.
+    * The consumer drains head and frees a block only once the producer has linked its successor.
+    */
+    struct D7StreamProducer {
+        D7PendingBlock* head = nullptr;
+        size_t read_index = 0;
+        D7PendingBlock* tail = nullptr;
+        size_t write_index = 0;
+        std::atomic<bool> retired = false; // set once the stream is destroyed, the thread's cache then drops it
+    };
+
+    /**
+    * @brief the producers a thread has recorded into, keyed by stream id
+    *
+    * Stream ids are never reused, so last_stream_id can only hit a live stream.
+    * generation trails d7_retired_generation, the entries of destroyed streams are dropped when it moves.
+    */
+    struct D7ThreadProducers {
+        std::uint64_t last_stream_id = 0;
+        D7StreamProducer* last_producer = nullptr;
+        std::uint64_t generation = 0;
+        std::vector<std::pair<std::uint64_t, std::shared_ptr<D7StreamProducer>>> entries;
+    };
+
+    static std::atomic<std::uint64_t> d7_next_stream_id = 1;
+    static std::atomic<std::uint64_t> d7_retired_generation = 0;
+
+    D7Stream::D7Stream():
+        stream_id(d7_next_stream_id.fetch_add(1))
+    {}
+
+    D7Stream::~D7Stream()
     {
-        auto index_ptr = new size_t(stream_points.size());
-        stream_points.push_back(point);
-        stream_indexes.push_back(index_ptr);
-        current_point_index = index_ptr;
-        return index_ptr;
+        for (auto& producer : producers) {
+            auto block = producer->head;
+            while (block) {
+                auto next = block->next.load();
+                delete block;
+                block = next;
+            }
+            producer->head = producer->tail = nullptr;
+            producer->retired.store(true, std::memory_order_release);
+        }
+        if (!producers.empty())
+            d7_retired_generation.fetch_add(1, std::memory_order_release);
     }
 
-    bool D7Stream::removeStreamPoint(size_t* index_ptr) {
-        if (!index_ptr)
-            return false;
-        if (current_point_index == index_ptr) {
-            if (stream_indexes.size() > 1) {
-                if (*index_ptr > 0) {
-                    current_point_index = stream_indexes[(*index_ptr) - 1];
-                }
-                else {
-                    current_point_index = stream_indexes[(*index_ptr)];
-                }
+    D7StreamProducer* D7Stream::getProducer()
+    {
+        thread_local D7ThreadProducers thread_producers;
+        if (thread_producers.last_stream_id == stream_id)
+            return thread_producers.last_producer;
+        auto& entries = thread_producers.entries;
+        auto generation = d7_retired_generation.load(std::memory_order_acquire);
+        if (thread_producers.generation != generation) {
+            thread_producers.generation = generation;
+            std::erase_if(entries, [](auto& entry) { return entry.second->retired.load(std::memory_order_acquire); });
+        }
+        D7StreamProducer* producer = nullptr;
+        for (auto& [id, entry_producer] : entries)
+            if (id == stream_id) {
+                producer = entry_producer.get();
+                break;
             }
-            else {
-                current_point_index = 0;
+        if (!producer) {
+            auto created = std::make_shared<D7StreamProducer>();
+            created->head = created->tail = new D7PendingBlock;
+            {
+                std::lock_guard lock(producers_mutex);
+                producers.push_back(created);
             }
+            entries.emplace_back(stream_id, created);
+            producer = created.get();
         }
-        stream_points.erase(stream_points.begin() + *index_ptr);
-        stream_indexes.erase(stream_indexes.begin() + *index_ptr);
-        auto stream_points_size = stream_points.size();
-        for (auto i = (*index_ptr); i < stream_points_size; i++)
+        thread_producers.last_stream_id = stream_id;
+        thread_producers.last_producer = producer;
+        return producer;
+    }
+
+    void D7Stream::recordStreamPoint(const StreamPoint& point)
+    {
+        auto producer = getProducer();
+        if (producer->write_index == DZ_D7_PENDING_BLOCK_SIZE) {
+            auto block = new D7PendingBlock;
+            producer->tail->next.store(block, std::memory_order_release);
+            producer->tail = block;
+            producer->write_index = 0;
+        }
+        producer->tail->points[producer->write_index] = point;
+        producer->tail->count.store(++producer->write_index, std::memory_order_release);
+    }
+
+    size_t D7Stream::mergeRecordedPoints()
+    {
+        std::vector<std::shared_ptr<D7StreamProducer>> current_producers;
         {
-            --(*stream_indexes[i]);
+            std::lock_guard lock(producers_mutex);
+            current_producers = producers;
         }
-        delete index_ptr;
-        return true;
+        std::vector<StreamPoint> pending;
+        for (auto& producer : current_producers) {
+            while (true) {
+                auto block = producer->head;
+                auto count = block->count.load(std::memory_order_acquire);
+                for (; producer->read_index < count; ++producer->read_index)
+                    pending.push_back(std::move(block->points[producer->read_index]));
+                if (producer->read_index < DZ_D7_PENDING_BLOCK_SIZE)
+                    break;
+                auto next = block->next.load(std::memory_order_acquire);
+                if (!next)
+                    break;
+                producer->head = next;
+                producer->read_index = 0;
+                delete block;
+            }
+        }
+        // each producer's points are already in order, merge them into one timeline
+        std::stable_sort(pending.begin(), pending.end(), [](const StreamPoint& a, const StreamPoint& b) {
+            return std::get<D7TypeToIndex<D7Type::T>()>(a) < std::get<D7TypeToIndex<D7Type::T>()>(b);
+        });
+        for (auto& point : pending)
+            addStreamPoint(point);
+        return pending.size();
     }
 
-    bool D7Stream::rewindNPoints(size_t N, D7Type filter, const StreamString& a_buff, StreamInteger uid, StreamIdentifier Uid)
+    std::uint32_t D7Stream::internAction(const StreamString& action)
     {
-        if (!current_point_index || *current_point_index == 0)
+        auto it = action_lookup.find(action);
+        if (it != action_lookup.end())
+            return it->second;
+        auto action_id = std::uint32_t(action_strings.size());
+        action_strings.push_back(action);
+        action_postings.emplace_back();
+        action_lookup.emplace(action, action_id);
+        return action_id;
+    }
+
+    size_t D7Stream::findPosition(D7Slot slot) const
+    {
+        auto& slots = columns.slots;
+        auto it = std::lower_bound(slots.begin(), slots.end(), slot);
+        if (it == slots.end() || *it != slot)
+            return SIZE_MAX;
+        return size_t(it - slots.begin());
+    }
+
+    bool D7Stream::isLive(D7Slot slot, size_t& position) const
+    {
+        position = findPosition(slot);
+        return position != SIZE_MAX && columns.alive[position];
+    }
+
+    D7Slot D7Stream::nextLiveSlot(size_t position) const
+    {
+        auto count = columns.slots.size();
+        for (size_t i = position + 1; i < count; ++i)
+            if (columns.alive[i])
+                return columns.slots[i];
+        return DZ_D7_INVALID_SLOT;
+    }
+
+    D7Slot D7Stream::previousLiveSlot(size_t position) const
+    {
+        for (size_t i = position; i > 0; --i)
+            if (columns.alive[i - 1])
+                return columns.slots[i - 1];
+        return DZ_D7_INVALID_SLOT;
+    }
+
+    D7Slot D7Stream::addStreamPoint(const StreamPoint& point)
+    {
+        auto slot = next_slot++;
+        auto action_id = internAction(std::get<D7TypeToIndex<D7Type::a>()>(point));
+        auto uid = std::get<D7TypeToIndex<D7Type::u>()>(point);
+        auto Uid = std::get<D7TypeToIndex<D7Type::U>()>(point);
+        columns.xs.push_back(std::get<D7TypeToIndex<D7Type::X>()>(point));
+        columns.ys.push_back(std::get<D7TypeToIndex<D7Type::Y>()>(point));
+        columns.zs.push_back(std::get<D7TypeToIndex<D7Type::Z>()>(point));
+        columns.timestamps.push_back(std::get<D7TypeToIndex<D7Type::T>()>(point));
+        columns.Uids.push_back(Uid);
+        columns.uids.push_back(uid);
+        columns.action_ids.push_back(action_id);
+        columns.slots.push_back(slot);
+        columns.alive.push_back(1);
+        action_postings[action_id].push_back(slot);
+        uid_postings[uid].push_back(slot);
+        Uid_postings[Uid].push_back(slot);
+        if (!live_count++)
+            first_live_slot = slot;
+        last_live_slot = slot;
+        current_slot = slot;
+        return slot;
+    }
+
+    bool D7Stream::removeStreamPoint(D7Slot slot) {
+        size_t position;
+        if (!isLive(slot, position))
             return false;
+        columns.alive[position] = 0;
+        --live_count;
+        ++dead_count;
+        // the scans only cross tombstones, which compaction bounds to half the columns
+        if (first_live_slot == slot)
+            first_live_slot = nextLiveSlot(position);
+        if (last_live_slot == slot)
+            last_live_slot = previousLiveSlot(position);
+        if (current_slot == slot) {
+            // step back to the previous point, or forward if the first point was removed
+            if (first_live_slot == DZ_D7_INVALID_SLOT || first_live_slot > slot)
+                current_slot = first_live_slot;
+            else
+                current_slot = previousLiveSlot(position);
+        }
+        if (dead_count >= DZ_D7_COMPACT_MIN_DEAD && dead_count * 2 >= columns.slots.size())
+            compact();
+        return true;
+    }
 
-        size_t current = *current_point_index;
-        size_t moved = 0;
+    std::optional<StreamPoint> D7Stream::getStreamPoint(D7Slot slot) const
+    {
+        size_t position;
+        if (!isLive(slot, position))
+            return std::nullopt;
+        return std::make_tuple(
+            columns.xs[position],
+            columns.ys[position],
+            columns.zs[position],
+            columns.timestamps[position],
+            columns.Uids[position],
+            columns.uids[position],
+            action_strings[columns.action_ids[position]]
+        );
+    }
 
-        while (current > 0 && moved < N)
-        {
-            --current;
-            const auto& point = stream_points[current];
-            bool match = true;
+    D7Slot D7Stream::getCurrentSlot() const
+    {
+        return current_slot;
+    }
 
-            if ((filter & D7Type::a) && std::get<D7TypeToIndex<D7Type::a>()>(point) != a_buff)
-                match = false;
-            if ((filter & D7Type::u) && std::get<D7TypeToIndex<D7Type::u>()>(point) != uid)
-                match = false;
-            if ((filter & D7Type::U) && std::get<D7TypeToIndex<D7Type::U>()>(point) != Uid)
-                match = false;
+    size_t D7Stream::size() const
+    {
+        return live_count;
+    }
+
+    void D7Stream::compact()
+    {
+        if (!dead_count)
+            return;
+        std::vector<D7Slot> dead_slots;
+        dead_slots.reserve(dead_count);
+        auto count = columns.slots.size();
+        size_t write = 0;
+        for (size_t read = 0; read < count; ++read) {
+            if (!columns.alive[read]) {
+                dead_slots.push_back(columns.slots[read]);
+                continue;
+            }
+            if (write != read) {
+                columns.xs[write] = columns.xs[read];
+                columns.ys[write] = columns.ys[read];
+                columns.zs[write] = columns.zs[read];
+                columns.timestamps[write] = columns.timestamps[read];
+                columns.Uids[write] = columns.Uids[read];
+                columns.uids[write] = columns.uids[read];
+                columns.action_ids[write] = columns.action_ids[read];
+                columns.slots[write] = columns.slots[read];
+                columns.alive[write] = 1;
+            }
+            ++write;
+        }
+        columns.xs.resize(write);
+        columns.ys.resize(write);
+        columns.zs.resize(write);
+        columns.timestamps.resize(write);
+        columns.Uids.resize(write);
+        columns.uids.resize(write);
+        columns.action_ids.resize(write);
+        columns.slots.resize(write);
+        columns.alive.resize(write);
+        dead_count = 0;
+        first_live_slot = write ? columns.slots.front() : DZ_D7_INVALID_SLOT;
+        last_live_slot = write ? columns.slots.back() : DZ_D7_INVALID_SLOT;
+
+        // dead_slots is sorted because the columns are in slot order
+        auto prune = [&](std::vector<D7Slot>& postings) {
+            postings.erase(std::remove_if(postings.begin(), postings.end(), [&](D7Slot slot) {
+                return std::binary_search(dead_slots.begin(), dead_slots.end(), slot);
+            }), postings.end());
+        };
+        for (auto& postings : action_postings)
+            prune(postings);
+        for (auto it = uid_postings.begin(); it != uid_postings.end();) {
+            prune(it->second);
+            it = it->second.empty() ? uid_postings.erase(it) : std::next(it);
+        }
+        for (auto it = Uid_postings.begin(); it != Uid_postings.end();) {
+            prune(it->second);
+            it = it->second.empty() ? Uid_postings.erase(it) : std::next(it);
+        }
+    }
 
-            if (match)
-                ++moved;
+    D7Stream::PostingsQuery D7Stream::makeQuery(D7Type filter, const StreamString& a_buff, StreamInteger uid, StreamIdentifier Uid) const
+    {
+        PostingsQuery query;
+        query.filter_a = filter & D7Type::a;
+        query.filter_u = filter & D7Type::u;
+        query.filter_U = filter & D7Type::U;
+        query.uid = uid;
+        query.Uid = Uid;
+        // walk the shortest postings list and check the remaining keys against the columns
+        auto consider = [&](const std::vector<D7Slot>* postings) {
+            if (!postings) {
+                query.empty = true;
+                return;
+            }
+            if (!query.postings || postings->size() < query.postings->size())
+                query.postings = postings;
+        };
+        if (query.filter_a) {
+            auto it = action_lookup.find(a_buff);
+            if (it != action_lookup.end()) {
+                query.action_id = it->second;
+                consider(&action_postings[it->second]);
+            }
+            else
+                consider(nullptr);
         }
+        if (query.filter_u) {
+            auto it = uid_postings.find(uid);
+            consider(it != uid_postings.end() ? &it->second : nullptr);
+        }
+        if (query.filter_U) {
+            auto it = Uid_postings.find(Uid);
+            consider(it != Uid_postings.end() ? &it->second : nullptr);
+        }
+        return query;
+    }
 
-        current_point_index = stream_indexes[current];
+    bool D7Stream::matchesQuery(const PostingsQuery& query, size_t position) const
+    {
+        if (query.filter_a && columns.action_ids[position] != query.action_id)
+            return false;
+        if (query.filter_u && columns.uids[position] != query.uid)
+            return false;
+        if (query.filter_U && columns.Uids[position] != query.Uid)
+            return false;
         return true;
     }
 
-    bool D7Stream::forwardNPoints(size_t N, D7Type filter, const StreamString& a_buff, StreamInteger uid, StreamIdentifier Uid)
+    std::vector<D7Slot> D7Stream::findStreamPoints(D7Type filter, const StreamString& a_buff, StreamInteger uid, StreamIdentifier Uid) const
+    {
+        std::vector<D7Slot> result;
+        auto query = makeQuery(filter, a_buff, uid, Uid);
+        if (query.empty)
+            return result;
+        if (!query.postings) {
+            result.reserve(live_count);
+            auto count = columns.slots.size();
+            for (size_t i = 0; i < count; ++i)
+                if (columns.alive[i])
+                    result.push_back(columns.slots[i]);
+            return result;
+        }
+        for (auto slot : *query.postings) {
+            size_t position;
+            if (isLive(slot, position) && matchesQuery(query, position))
+                result.push_back(slot);
+        }
+        return result;
+    }
+
+    bool D7Stream::rewindNPoints(size_t N, D7Type filter, const StreamString& a_buff, StreamInteger uid, StreamIdentifier Uid)
     {
-        if (!current_point_index || *current_point_index >= stream_points.size() - 1)
+        if (current_slot == DZ_D7_INVALID_SLOT || current_slot == first_live_slot)
             return false;
 
-        size_t current = *current_point_index;
+        auto query = makeQuery(filter, a_buff, uid, Uid);
         size_t moved = 0;
-        const size_t max_index = stream_points.size() - 1;
+        auto target = current_slot;
 
-        while (current < max_index && moved < N)
-        {
-            ++current;
-            const auto& point = stream_points[current];
-            bool match = true;
+        if (!query.postings && !query.empty) {
+            for (size_t i = findPosition(current_slot); i > 0 && moved < N; --i) {
+                if (columns.alive[i - 1]) {
+                    target = columns.slots[i - 1];
+                    ++moved;
+                }
+            }
+        }
+        else if (query.postings) {
+            auto& postings = *query.postings;
+            auto it = std::lower_bound(postings.begin(), postings.end(), current_slot);
+            while (it != postings.begin() && moved < N) {
+                --it;
+                size_t position;
+                if (isLive(*it, position) && matchesQuery(query, position)) {
+                    target = *it;
+                    ++moved;
+                }
+            }
+        }
 
-            if ((filter & D7Type::a) && std::get<D7TypeToIndex<D7Type::a>()>(point) != a_buff)
-                match = false;
-            if ((filter & D7Type::u) && std::get<D7TypeToIndex<D7Type::u>()>(point) != uid)
-                match = false;
-            if ((filter & D7Type::U) && std::get<D7TypeToIndex<D7Type::U>()>(point) != Uid)
-                match = false;
+        // like the unfiltered walk, running out of matches stops at the start of the history
+        current_slot = moved < N ? first_live_slot : target;
+        return true;
+    }
+
+    bool D7Stream::forwardNPoints(size_t N, D7Type filter, const StreamString& a_buff, StreamInteger uid, StreamIdentifier Uid)
+    {
+        if (current_slot == DZ_D7_INVALID_SLOT || current_slot == last_live_slot)
+            return false;
 
-            if (match)
-                ++moved;
+        auto query = makeQuery(filter, a_buff, uid, Uid);
+        size_t moved = 0;
+        auto target = current_slot;
+
+        if (!query.postings && !query.empty) {
+            auto count = columns.slots.size();
+            for (size_t i = findPosition(current_slot) + 1; i < count && moved < N; ++i) {
+                if (columns.alive[i]) {
+                    target = columns.slots[i];
+                    ++moved;
+                }
+            }
+        }
+        else if (query.postings) {
+            auto& postings = *query.postings;
+            auto it = std::upper_bound(postings.begin(), postings.end(), current_slot);
+            for (; it != postings.end() && moved < N; ++it) {
+                size_t position;
+                if (isLive(*it, position) && matchesQuery(query, position)) {
+                    target = *it;
+                    ++moved;
+                }
+            }
         }
 
-        current_point_index = stream_indexes[current];
+        // like the unfiltered walk, running out of matches stops at the end of the history
+        current_slot = moved < N ? last_live_slot : target;
         return true;
     }
 
     void D7Stream::printStreamPoints(D7Type filter, const StreamString& a_buff, StreamInteger uid, StreamIdentifier Uid)
     {
         std::cout << "\n=== Filtered Stream Output ===\n";
-        for (size_t i = 0; i < stream_points.size(); ++i)
+        for (auto slot : findStreamPoints(filter, a_buff, uid, Uid))
         {
-            const auto& point = stream_points[i];
-            bool match = true;
+            auto position = findPosition(slot);
+            std::cout << std::fixed << std::setprecision(2)
+                    << "[" << slot << "] Pos(" << columns.xs[position] << ", " << columns.ys[position] << ", " << columns.zs[position] << ") "
+                    << "UID: " << columns.Uids[position] << " uid: " << columns.uids[position]
+                    << " action: " << action_strings[columns.action_ids[position]] << "\n";
+        }
+    }
+
+    D7Stream& D7Stream::operator<<(const StreamPoint& point) {
+        addStreamPoint(point);
+        return *this;
+    }
+
+#define DZ_D7_FILE_MAGIC "D7SF"
+#define DZ_D7_SEGMENT_MAGIC "D7SG"
+#define DZ_D7_INDEX_MAGIC "D7SI"
+#define DZ_D7_FILE_VERSION 1
+
+    struct D7FileHeader
+    {
+        char magic[4];
+        uint32_t version;
+    };
+
+    /**
+    * @brief precedes every segment, the payload holds the action dictionary, the seek entries and then the points
+    */
+    struct D7SegmentHeader
+    {
+        char magic[4];
+        uint32_t point_count;
+        uint32_t dictionary_count;
+        uint32_t seek_count;
+        uint64_t payload_size;
+        int64_t min_time;
+        int64_t max_time;
+    };
+
+    /**
+    * @brief the first point of a seek block stores its timestamp as a delta from time, byte_offset is relative to the point data
+    */
+    struct D7SeekEntry
+    {
+        int64_t time;
+        int64_t min_time;
+        int64_t max_time;
+        uint32_t point_index;
+        uint32_t byte_offset;
+    };
+
+    struct D7SegmentIndexEntry
+    {
+        uint64_t offset;
+        int64_t min_time;
+        int64_t max_time;
+        uint32_t point_count;
+        uint32_t padding;
+    };
+
+    struct D7FileTrailer
+    {
+        uint64_t index_offset;
+        uint64_t segment_count;
+        char magic[4];
+        uint32_t version;
+    };
+
+    struct D7Recording
+    {
+        std::string path;
+        std::ofstream stream;
+        uint64_t offset = 0;
+        std::vector<StreamPoint> pending;
+        std::vector<D7SegmentIndexEntry> segments;
+        std::vector<char> scratch;
+    };
+
+    struct D7Playback
+    {
+        std::shared_ptr<const FileMapping> mapping;
+        std::vector<D7SegmentIndexEntry> segments;
+        size_t point_count = 0;
+    };
+
+    inline int64_t d7_timestamp_to_ns(StreamTimestamp timestamp)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(timestamp.time_since_epoch()).count();
+    }
+
+    inline StreamTimestamp d7_ns_to_timestamp(int64_t ns)
+    {
+        return StreamTimestamp(std::chrono::duration_cast<StreamTimestamp::duration>(std::chrono::nanoseconds(ns)));
+    }
+
+    void d7_recording_write_segment(D7Recording* recording)
+    {
+        auto& pending = recording->pending;
+        if (pending.empty())
+            return;
+
+        std::vector<std::string_view> dictionary;
+        std::unordered_map<std::string_view, uint32_t> dictionary_lookup;
+        std::vector<D7SeekEntry> seeks;
+        auto& points = recording->scratch;
+        points.clear();
+
+        D7SegmentHeader header{};
+        memcpy(header.magic, DZ_D7_SEGMENT_MAGIC, 4);
+        header.point_count = uint32_t(pending.size());
+        header.min_time = INT64_MAX;
+        header.max_time = INT64_MIN;
+
+        int64_t previous_time = 0;
+        for (size_t i = 0; i < pending.size(); ++i) {
+            auto& point = pending[i];
+            auto time = d7_timestamp_to_ns(std::get<D7TypeToIndex<D7Type::T>()>(point));
+            if (i % DZ_D7_SEEK_INTERVAL == 0) {
+                seeks.push_back({time, time, time, uint32_t(i), uint32_t(points.size())});
+                previous_time = time;
+            }
+            auto& seek = seeks.back();
+            seek.min_time = (std::min)(seek.min_time, time);
+            seek.max_time = (std::max)(seek.max_time, time);
+            header.min_time = (std::min)(header.min_time, time);
+            header.max_time = (std::max)(header.max_time, time);
+
+            const auto& action = std::get<D7TypeToIndex<D7Type::a>()>(point);
+            auto [it, inserted] = dictionary_lookup.emplace(std::string_view(action), uint32_t(dictionary.size()));
+            if (inserted)
+                dictionary.push_back(action);
+
+            vlen::write_varint(points, vlen::zigzag_encode(time - previous_time));
+            previous_time = time;
+            StreamScalar position[3] = {
+                std::get<D7TypeToIndex<D7Type::X>()>(point),
+                std::get<D7TypeToIndex<D7Type::Y>()>(point),
+                std::get<D7TypeToIndex<D7Type::Z>()>(point)
+            };
+            points.insert(points.end(), (const char*)position, (const char*)position + sizeof(position));
+            vlen::write_varint(points, std::get<D7TypeToIndex<D7Type::U>()>(point));
+            vlen::write_varint(points, vlen::zigzag_encode(std::get<D7TypeToIndex<D7Type::u>()>(point)));
+            vlen::write_varint(points, it->second);
+        }
+
+        std::vector<char> dictionary_bytes;
+        for (auto& action : dictionary) {
+            vlen::write_varint(dictionary_bytes, action.size());
+            dictionary_bytes.insert(dictionary_bytes.end(), action.begin(), action.end());
+        }
+        header.dictionary_count = uint32_t(dictionary.size());
+        header.seek_count = uint32_t(seeks.size());
+        header.payload_size = dictionary_bytes.size() + seeks.size() * sizeof(D7SeekEntry) + points.size();
+
+        auto& stream = recording->stream;
+        stream.write((const char*)&header, sizeof(header));
+        stream.write(dictionary_bytes.data(), dictionary_bytes.size());
+        stream.write((const char*)seeks.data(), seeks.size() * sizeof(D7SeekEntry));
+        stream.write(points.data(), points.size());
+        if (!stream)
+            throw std::runtime_error("Failed to write D7Stream recording: " + recording->path);
+
+        recording->segments.push_back({recording->offset, header.min_time, header.max_time, header.point_count, 0});
+        recording->offset += sizeof(header) + header.payload_size;
+        pending.clear();
+    }
+
+    D7Recording* d7_recording_create(const std::string& path)
+    {
+        auto recording = std::make_unique<D7Recording>();
+        recording->path = path;
+        recording->stream.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!recording->stream)
+            throw std::runtime_error("Failed to create D7Stream recording: " + path);
+        D7FileHeader header{};
+        memcpy(header.magic, DZ_D7_FILE_MAGIC, 4);
+        header.version = DZ_D7_FILE_VERSION;
+        recording->stream.write((const char*)&header, sizeof(header));
+        recording->offset = sizeof(header);
+        recording->pending.reserve(DZ_D7_SEGMENT_POINTS);
+        return recording.release();
+    }
+
+    void d7_recording_write(D7Recording* recording, const StreamPoint& point)
+    {
+        recording->pending.push_back(point);
+        if (recording->pending.size() == DZ_D7_SEGMENT_POINTS)
+            d7_recording_write_segment(recording);
+    }
+
+    D7Slot d7_recording_write_stream(D7Recording* recording, const D7Stream& stream, D7Slot from_slot)
+    {
+        auto& columns = stream.columns;
+        auto begin = std::lower_bound(columns.slots.begin(), columns.slots.end(), from_slot) - columns.slots.begin();
+        auto count = columns.slots.size();
+        for (size_t i = begin; i < count; ++i) {
+            if (!columns.alive[i])
+                continue;
+            d7_recording_write(recording, std::make_tuple(
+                columns.xs[i],
+                columns.ys[i],
+                columns.zs[i],
+                columns.timestamps[i],
+                columns.Uids[i],
+                columns.uids[i],
+                stream.action_strings[columns.action_ids[i]]
+            ));
+        }
+        return count ? (std::max)(from_slot, columns.slots[count - 1] + 1) : from_slot;
+    }
+
+    void d7_recording_flush(D7Recording* recording)
+    {
+        d7_recording_write_segment(recording);
+        recording->stream.flush();
+    }
+
+    void d7_recording_close(D7Recording* recording)
+    {
+        if (!recording)
+            return;
+        std::unique_ptr<D7Recording> owned(recording);
+        d7_recording_write_segment(recording);
+        auto& stream = recording->stream;
+        D7FileTrailer trailer{};
+        trailer.index_offset = recording->offset;
+        trailer.segment_count = recording->segments.size();
+        memcpy(trailer.magic, DZ_D7_INDEX_MAGIC, 4);
+        trailer.version = DZ_D7_FILE_VERSION;
+        stream.write((const char*)recording->segments.data(), recording->segments.size() * sizeof(D7SegmentIndexEntry));
+        stream.write((const char*)&trailer, sizeof(trailer));
+        stream.close();
+    }
+
+    bool d7_playback_read_trailer(D7Playback* playback)
+    {
+        auto data = playback->mapping->data;
+        auto size = playback->mapping->size;
+        if (size < sizeof(D7FileHeader) + sizeof(D7FileTrailer))
+            return false;
+        D7FileTrailer trailer;
+        memcpy(&trailer, data + size - sizeof(trailer), sizeof(trailer));
+        if (memcmp(trailer.magic, DZ_D7_INDEX_MAGIC, 4) != 0 || trailer.version != DZ_D7_FILE_VERSION)
+            return false;
+        auto index_size = trailer.segment_count * sizeof(D7SegmentIndexEntry);
+        if (trailer.index_offset > size - sizeof(trailer) || index_size != size - sizeof(trailer) - trailer.index_offset)
+            return false;
+        playback->segments.resize(trailer.segment_count);
+        memcpy(playback->segments.data(), data + trailer.index_offset, index_size);
+        return true;
+    }
+
+    void d7_playback_walk_segments(D7Playback* playback)
+    {
+        // an unclosed recording has no index, every complete segment is still found through its header
+        auto data = playback->mapping->data;
+        auto size = playback->mapping->size;
+        uint64_t offset = sizeof(D7FileHeader);
+        while (offset + sizeof(D7SegmentHeader) <= size) {
+            D7SegmentHeader header;
+            memcpy(&header, data + offset, sizeof(header));
+            if (memcmp(header.magic, DZ_D7_SEGMENT_MAGIC, 4) != 0 || header.payload_size > size - offset - sizeof(header))
+                break;
+            playback->segments.push_back({offset, header.min_time, header.max_time, header.point_count, 0});
+            offset += sizeof(header) + header.payload_size;
+        }
+    }
 
-            if ((filter & D7Type::a) && std::get<D7TypeToIndex<D7Type::a>()>(point) != a_buff)
-                match = false;
-            if ((filter & D7Type::u) && std::get<D7TypeToIndex<D7Type::u>()>(point) != uid)
-                match = false;
-            if ((filter & D7Type::U) && std::get<D7TypeToIndex<D7Type::U>()>(point) != Uid)
-                match = false;
+    D7Playback* d7_playback_open(const std::string& path)
+    {
+        // owned until fully opened, map() and the segment walk may throw
+        auto playback = std::make_unique<D7Playback>();
+        playback->mapping = FileHandle{FileHandle::PATH, path}.map();
+        D7FileHeader header{};
+        if (playback->mapping->size >= sizeof(header))
+            memcpy(&header, playback->mapping->data, sizeof(header));
+        if (memcmp(header.magic, DZ_D7_FILE_MAGIC, 4) != 0 || header.version != DZ_D7_FILE_VERSION)
+            throw std::runtime_error("Not a D7Stream recording: " + path);
+        if (!d7_playback_read_trailer(playback.get()))
+            d7_playback_walk_segments(playback.get());
+        for (auto& segment : playback->segments)
+            playback->point_count += segment.point_count;
+        return playback.release();
+    }
+
+    void d7_playback_close(D7Playback* playback)
+    {
+        delete playback;
+    }
+
+    size_t d7_playback_get_point_count(D7Playback* playback)
+    {
+        return playback->point_count;
+    }
+
+    bool d7_playback_get_time_range(D7Playback* playback, StreamTimestamp& first, StreamTimestamp& last)
+    {
+        if (playback->segments.empty())
+            return false;
+        auto min_time = INT64_MAX;
+        auto max_time = INT64_MIN;
+        for (auto& segment : playback->segments) {
+            min_time = (std::min)(min_time, segment.min_time);
+            max_time = (std::max)(max_time, segment.max_time);
+        }
+        first = d7_ns_to_timestamp(min_time);
+        last = d7_ns_to_timestamp(max_time);
+        return true;
+    }
+
+    size_t d7_playback_query(D7Playback* playback, StreamTimestamp begin, StreamTimestamp end, const std::function<void(const StreamPoint&)>& callback)
+    {
+        auto begin_ns = d7_timestamp_to_ns(begin);
+        auto end_ns = d7_timestamp_to_ns(end);
+        auto data = playback->mapping ? playback->mapping->data : nullptr;
+        auto corrupt = []() { throw std::runtime_error("Corrupt D7Stream recording segment"); };
+        size_t matched = 0;
+        std::vector<std::string> dictionary;
+        StreamPoint point;
 
-            if (!match)
+        for (auto& segment : playback->segments) {
+            if (segment.max_time < begin_ns || segment.min_time >= end_ns)
                 continue;
+            D7SegmentHeader header;
+            if (segment.offset + sizeof(header) > playback->mapping->size)
+                corrupt();
+            memcpy(&header, data + segment.offset, sizeof(header));
+            if (memcmp(header.magic, DZ_D7_SEGMENT_MAGIC, 4) != 0 || header.payload_size > playback->mapping->size - segment.offset - sizeof(header))
+                corrupt();
+            auto cursor = data + segment.offset + sizeof(header);
+            auto payload_end = cursor + header.payload_size;
 
-            auto x = std::get<D7TypeToIndex<D7Type::X>()>(point);
-            auto y = std::get<D7TypeToIndex<D7Type::Y>()>(point);
-            auto z = std::get<D7TypeToIndex<D7Type::Z>()>(point);
-            auto t = std::get<D7TypeToIndex<D7Type::T>()>(point);
-            auto uidVal = std::get<D7TypeToIndex<D7Type::u>()>(point);
-            auto UidVal = std::get<D7TypeToIndex<D7Type::U>()>(point);
-            auto a = std::get<D7TypeToIndex<D7Type::a>()>(point);
+            // every dictionary entry takes at least its length byte
+            if (header.dictionary_count > header.payload_size)
+                corrupt();
+            dictionary.resize(header.dictionary_count);
+            for (auto& action : dictionary) {
+                uint64_t length;
+                if (!vlen::read_varint(cursor, payload_end, length) || length > uint64_t(payload_end - cursor))
+                    corrupt();
+                action.assign(cursor, length);
+                cursor += length;
+            }
+            if (header.seek_count * sizeof(D7SeekEntry) > size_t(payload_end - cursor))
+                corrupt();
+            auto seeks = cursor;
+            auto points = seeks + header.seek_count * sizeof(D7SeekEntry);
 
-            std::cout << std::fixed << std::setprecision(2)
-                    << "[" << i << "] Pos(" << x << ", " << y << ", " << z << ") "
-                    << "UID: " << UidVal << " uid: " << uidVal << " action: " << a << "\n";
+            for (uint32_t s = 0; s < header.seek_count; ++s) {
+                D7SeekEntry seek;
+                memcpy(&seek, seeks + s * sizeof(D7SeekEntry), sizeof(seek));
+                if (seek.max_time < begin_ns || seek.min_time >= end_ns)
+                    continue;
+                if (seek.byte_offset > uint64_t(payload_end - points) || seek.point_index >= header.point_count)
+                    corrupt();
+                auto block_end = (std::min)(seek.point_index + DZ_D7_SEEK_INTERVAL, header.point_count);
+                auto point_cursor = points + seek.byte_offset;
+                auto time = seek.time;
+                for (auto i = seek.point_index; i < block_end; ++i) {
+                    uint64_t delta, Uid, uid, action_id;
+                    StreamScalar position[3];
+                    if (!vlen::read_varint(point_cursor, payload_end, delta) || size_t(payload_end - point_cursor) < sizeof(position))
+                        corrupt();
+                    memcpy(position, point_cursor, sizeof(position));
+                    point_cursor += sizeof(position);
+                    if (!vlen::read_varint(point_cursor, payload_end, Uid) ||
+                        !vlen::read_varint(point_cursor, payload_end, uid) ||
+                        !vlen::read_varint(point_cursor, payload_end, action_id) ||
+                        action_id >= dictionary.size())
+                        corrupt();
+                    time += vlen::zigzag_decode(delta);
+                    if (time < begin_ns || time >= end_ns)
+                        continue;
+                    point = std::make_tuple(
+                        position[0], position[1], position[2],
+                        d7_ns_to_timestamp(time),
+                        StreamIdentifier(Uid),
+                        StreamInteger(vlen::zigzag_decode(uid)),
+                        dictionary[action_id]
+                    );
+                    callback(point);
+                    ++matched;
+                }
+            }
         }
+        return matched;
     }
 
-    D7Stream& D7Stream::operator<<(const StreamPoint& point) {
-        addStreamPoint(point);
-        return *this;
+    size_t d7_playback_load(D7Playback* playback, StreamTimestamp begin, StreamTimestamp end, D7Stream& stream)
+    {
+        return d7_playback_query(playback, begin, end, [&](const StreamPoint& point) {
+            stream.addStreamPoint(point);
+        });
     }
 }
\ No newline at end of file
@@ -1,7 +1,32 @@
 #include <DirectZ.hpp>
+#include <cctype>
+#include <chrono>
+#include <deque>
+#include <iomanip>
 
 void print_help();
 
+struct PackJob
+{
+    std::string path;
+    size_t raw_size = 0;
+    uint64_t content_hash = 0;
+    bool reused = false;
+    std::string encoded;
+    double milliseconds = 0;
+};
+
+struct CompressionSettings
+{
+    bool requested = false;
+    AssetCompression compression = AssetCompression::None;
+    int level = -1;
+    uint32_t block_size = DZ_ASSET_BLOCK_SIZE;
+};
+
+bool parse_compression(ProgramArgs& args, CompressionSettings& settings);
+int build_pack(ProgramArgs& args, const std::string& o);
+
 int main(int argc, char** argv)
 {
     ProgramArgs args(argc, argv);
@@ -12,18 +37,178 @@ int main(int argc, char** argv)
         return 0;
     }
     auto& o = o_iter->second;
-    FileHandle asset_handle{FileHandle::PATH, o};
+    auto cook_iter = args.options.find("cook");
+    if (cook_iter != args.options.end())
+    {
+        loaders::Assimp_Info info;
+        info.path = cook_iter->second;
+        CompressionSettings settings;
+        if (!parse_compression(args, settings))
+            return 1;
+        loaders::Assimp_Loader::Cook(info, o, settings.compression, settings.level, settings.block_size);
+        return 0;
+    }
+    return build_pack(args, o);
+}
+
+bool parse_compression(ProgramArgs& args, CompressionSettings& settings)
+{
+    auto z_iter = args.options.find("z");
+    if (z_iter == args.options.end())
+        return true;
+    settings.requested = true;
+    if (z_iter->second == "zlib")
+        settings.compression = AssetCompression::Zlib;
+    else if (z_iter->second != "none")
+    {
+        std::cerr << "Unknown compression: " << z_iter->second << std::endl;
+        print_help();
+        return false;
+    }
+    auto level_iter = args.options.find("level");
+    auto block_iter = args.options.find("block");
+    try
+    {
+        size_t end = 0;
+        if (level_iter != args.options.end())
+        {
+            settings.level = std::stoi(level_iter->second, &end);
+            if (end != level_iter->second.size() || settings.level < 0 || settings.level > 9)
+                throw std::out_of_range("level must be between 0 and 9");
+        }
+        if (block_iter != args.options.end())
+        {
+            auto value = std::stoull(block_iter->second, &end);
+            if (end != block_iter->second.size() || !std::isdigit((unsigned char)block_iter->second[0]) || value == 0 || value > UINT32_MAX)
+                throw std::out_of_range("block must be between 1 and 4294967295 bytes");
+            settings.block_size = uint32_t(value);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Invalid compression setting: " << e.what() << std::endl;
+        print_help();
+        return false;
+    }
+    return true;
+}
+
+int build_pack(ProgramArgs& args, const std::string& o)
+{
+    auto build_start = std::chrono::steady_clock::now();
+
+    // compression settings are validated before any pack is touched
+    CompressionSettings settings;
+    if (!parse_compression(args, settings))
+        return 1;
+
+    // unchanged entries are copied verbatim from the pack being replaced
+    AssetPack* previous_pack = nullptr;
+    FileHandle previous_handle{FileHandle::PATH, o};
+    std::error_code ec;
+    if (std::filesystem::exists(o, ec))
+    {
+        try
+        {
+            previous_pack = open_asset_pack(previous_handle);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Ignoring existing pack " << o << ": " << e.what() << std::endl;
+        }
+    }
+
+    // the new pack is streamed into a temporary file that replaces the output once complete
+    auto temp_path = o + ".tmp";
+    std::filesystem::remove(temp_path, ec);
+    FileHandle asset_handle{FileHandle::PATH, temp_path};
     auto asset_pack = create_asset_pack(asset_handle);
-    for (auto& input_file_name : args.arguments)
+    if (settings.requested)
+        asset_pack_set_compression(asset_pack, settings.compression, settings.level, settings.block_size);
+
+    // inputs are read, hashed and encoded on the pool while this thread appends finished entries in order
+    auto pool = thread_pool_default();
+    auto window = thread_pool_get_thread_count(pool) * 2 + 1;
+    std::deque<std::future<PackJob>> in_flight;
+    std::vector<PackJob> report;
+    report.reserve(args.arguments.size());
+    int result = 0;
+
+    auto retire = [&]()
+    {
+        auto job = in_flight.front().get();
+        in_flight.pop_front();
+        if (job.reused && !reuse_asset(asset_pack, previous_pack, job.path, job.content_hash))
+            throw std::runtime_error("Failed to reuse " + job.path);
+        if (!job.reused)
+            add_encoded_asset(asset_pack, job.path, job.encoded);
+        job.encoded.clear();
+        job.encoded.shrink_to_fit();
+        report.push_back(std::move(job));
+    };
+
+    try
+    {
+        for (auto& input_file_name : args.arguments)
+        {
+            in_flight.push_back(thread_pool_submit(pool, [asset_pack, previous_pack, input_file_name]()
+            {
+                auto start = std::chrono::steady_clock::now();
+                PackJob job;
+                job.path = input_file_name;
+                FileHandle file_handle{FileHandle::PATH, input_file_name};
+                // the null terminator read_asset_file appends is stored but left out of the recorded size and hash
+                auto asset = read_asset_file(file_handle);
+                job.raw_size = asset.get_size() - 1;
+                job.content_hash = hash_bytes(asset.get(), job.raw_size);
+                job.reused = previous_pack && asset_is_reusable(asset_pack, previous_pack, job.path, job.content_hash);
+                if (!job.reused)
+                    job.encoded = encode_asset(asset_pack, asset.get(), asset.get_size(), job.content_hash, 1);
+                job.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                return job;
+            }));
+            if (in_flight.size() >= window)
+                retire();
+        }
+        while (!in_flight.empty())
+            retire();
+    }
+    catch (const std::exception& e)
     {
-        FileHandle file_handle{FileHandle::PATH, input_file_name};
-        add_asset(asset_pack, file_handle);
+        std::cerr << "Failed to build " << o << ": " << e.what() << std::endl;
+        // let queued tasks finish before the packs they reference are freed
+        for (auto& future : in_flight)
+            future.wait();
+        result = 1;
     }
+
     free_asset_pack(asset_pack);
+    free_asset_pack(previous_pack);
+    if (result)
+    {
+        std::filesystem::remove(temp_path, ec);
+        return result;
+    }
+    std::filesystem::rename(temp_path, o);
+
+    size_t reused_count = 0;
+    for (auto& job : report)
+    {
+        std::cout << std::setw(8) << std::fixed << std::setprecision(2) << job.milliseconds << " ms  "
+                  << (job.reused ? "reused " : "encoded") << "  " << std::setw(12) << job.raw_size << " B  " << job.path << std::endl;
+        reused_count += job.reused;
+    }
+    auto total = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - build_start).count();
+    std::cout << "Packed " << report.size() << " assets (" << reused_count << " reused) into " << o
+              << " in " << std::fixed << std::setprecision(2) << total << " ms" << std::endl;
     return 0;
 }
 
 void print_help()
 {
     std::cout << "DZP Usage: \"dzp -o outpack.bin infile.txt ifile2.txt\"" << std::endl;
-}
\ No newline at end of file
+    std::cout << "           \"dzp -z zlib -level 9 -block 262144 -o outpack.bin infile.png\" compresses each asset in blocks" << std::endl;
+    std::cout << "           -level is 0 to 9, -block is the block size in bytes and must be non-zero" << std::endl;
+    std::cout << "           \"dzp -cook model.glb -o model.dzm\" cooks a model for Assimp_Loader, -z zlib compresses its textures the same way" << std::endl;
+    std::cout << "           rebuilding an existing pack reuses entries whose content and settings are unchanged" << std::endl;
+}
@@ -37,6 +37,8 @@ namespace dz
         dr.uid_shader_map.clear();
         if (dr.device)
         {
+            transfer_destroy();
+            gpu_memory_destroy();
             vkDestroyCommandPool(dr.device, dr.commandPool, 0);
             vkDestroyRenderPass(dr.device, dr.surfaceRenderPass, 0);
             vkDestroyDevice(dr.device, 0);
@@ -61,11 +63,17 @@ namespace dz
 #include "env.cpp"
 #include "path.cpp"
 
+#include "Allocator.cpp"
+#include "Hash.cpp"
+#include "ThreadPool.cpp"
+#include "BVH.cpp"
 #include "FileHandle.cpp"
 #include "AssetPack.cpp"
 #include "Renderer.cpp"
 #include "Window.cpp"
 #include "Image.cpp"
+#include "Transfer.cpp"
+#include "GPUMemory.cpp"
 #include "Framebuffer.cpp"
 #include "Shader.cpp"
 #include "BufferGroup.cpp"
@@ -88,6 +96,7 @@ namespace dz
 #include "ImagePack.cpp"
 
 #include "Loaders/STB_Image_Loader.cpp"
+#include "Loaders/KTX2_Loader.cpp"
 #include "Loaders/Assimp_Loader.cpp"
 
 #include "runtime.cpp"
@@ -16,6 +16,7 @@
 #include <chrono>
 #include <set>
 #include <queue>
+#include <deque>
 #include <dz/GlobalUID.hpp>
 #include <spirv_reflect.h>
 #include <shaderc/shaderc.hpp>
@@ -39,8 +40,10 @@
 #endif
 #undef min
 #undef max
+#include "GPUMemoryImpl.hpp"
 #include "WindowImpl.hpp"
 #include "RendererImpl.hpp"
+#include "TransferImpl.hpp"
 namespace dz {
     /**
     * @brief Creates a Window given a Serial interface
@@ -58,6 +61,30 @@ namespace dz {
     std::filesystem::path getProgramDirectoryPath();
     std::filesystem::path getProgramDataPath();
     std::filesystem::path getExecutableName();
+
+    struct StateSnapshot;
+    struct StateChunkReader;
+    struct StateAssetPack;
+
+    /**
+    * @brief returns the snapshot being captured when serial is the one save_state writes to, otherwise nullptr
+    */
+    StateSnapshot* state_get_capturing(Serial& serial);
+
+    /**
+    * @brief returns the chunked State file being loaded when serial is the one load_state reads from, otherwise nullptr
+    */
+    StateChunkReader* state_get_restoring(Serial& serial);
+
+    /**
+    * @brief Queues a readback of an Image mip into the capturing snapshot, returns the blob id written in its place
+    */
+    uint64_t state_snapshot_capture_image_mip(StateSnapshot& snapshot, Image* image_ptr, int mip);
+
+    /**
+    * @brief Decodes a blob from the State file being loaded into out, size must match the captured size
+    */
+    bool state_reader_read_blob(StateChunkReader& reader, uint64_t blob_id, void* out, size_t size);
 }
 static std::unordered_map<ShaderModuleType, shaderc_shader_kind> stageEShaderc = {
 	{ShaderModuleType::Vertex, shaderc_vertex_shader},
@@ -92,6 +119,12 @@ struct StateHolder {
         { GlobalUID::SID, GlobalUID::BackupFunction }
     };
     bool loaded = false;
+    std::shared_ptr<StateSnapshot> capturing;
+    std::shared_ptr<StateSnapshot> saving;
+    StateChunkReader* restoring = nullptr;
+    int compression_level = DZ_STATE_COMPRESSION_LEVEL;
+    bool track_deltas = false;
+    std::vector<std::shared_ptr<StateAssetPack>> asset_packs;
 };
 
 struct FormatsSupported {
@@ -123,8 +156,10 @@ struct DirectRegistry
     VkQueue computeQueue;
     VkQueue presentQueue;
     VkQueue copyQueue;
+    VkQueue transferQueue = VK_NULL_HANDLE;
     int32_t graphicsAndComputeFamily = -1;
     int32_t presentFamily = -1;
+    int32_t transferFamily = -1;
     Renderer* currentRenderer = 0;
     VkCommandPool commandPool = VK_NULL_HANDLE;
     VkCommandBuffer* commandBuffer = 0;
@@ -151,6 +186,8 @@ struct DirectRegistry
     std::vector<std::tuple<Image*, VkImageLayout, int>> copySrcImages;
     std::vector<std::tuple<Image*, VkImageLayout, int>> copyDstImages;
     ColorSpace preferredColorSpace = ColorSpace::SRGB;
+    TransferRegistry transfer;
+    GPUMemoryRegistry gpu_memory;
 #ifdef _WIN32
     HWND hwnd_root;
 #endif
@@ -200,6 +237,7 @@ namespace dz
 	uint32_t rate_device_suitability(DirectRegistry* direct_registry, Renderer* renderer, VkPhysicalDevice device);
 	bool is_device_suitable(DirectRegistry* direct_registry, Renderer* renderer, VkPhysicalDevice device);
 	QueueFamilyIndices find_queue_families(DirectRegistry* direct_registry, Renderer* renderer, VkPhysicalDevice device);
+	int32_t find_transfer_queue_family(VkPhysicalDevice device);
 	void direct_registry_ensure_logical_device(DirectRegistry* direct_registry, Renderer* renderer);
 	SwapChainSupportDetails query_swap_chain_support(Renderer* renderer, VkPhysicalDevice device);
 	VkSurfaceFormatKHR choose_swap_surface_format(const std::vector<VkSurfaceFormatKHR>& availableFormats);
@@ -218,7 +256,7 @@ namespace dz
 	void destroy_swap_chain(Renderer* renderer);
 	void createBuffer(Renderer* renderer,
 		VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
-		VkBuffer& buffer, VkDeviceMemory& bufferMemory);
+		VkBuffer& buffer, GPUAllocation& allocation, GPUMemoryCategory category);
 }
 extern "C" DirectRegistry* dr_ptr;
 extern "C" DirectRegistry& dr;
\ No newline at end of file
@@ -24,7 +24,7 @@ dz::ecs::Camera::CameraMetaReflectable::CameraMetaReflectable(
 ):
     get_camera_function(get_camera_function),
     reset_reflectables_function(reset_reflectables_function),
-    uid(int(GlobalUID::GetNew("Reflectable"))),
+    uid(int(Reflectable::NewUID())),
     name("Camera Meta")
 {}
 
@@ -63,7 +63,7 @@ void dz::ecs::Camera::CameraMetaReflectable::NotifyChange(int prop_index) {
 
 dz::ecs::Camera::CameraViewReflectable::CameraViewReflectable(const std::function<Camera*()>& get_camera_function):
     get_camera_function(get_camera_function),
-    uid(int(GlobalUID::GetNew("Reflectable"))),
+    uid(int(Reflectable::NewUID())),
     name("View Transform")
 {}
 
@@ -110,7 +110,7 @@ void dz::ecs::Camera::CameraViewReflectable::NotifyChange(int prop_index) {
 
 dz::ecs::Camera::CameraPerspectiveReflectable::CameraPerspectiveReflectable(const std::function<Camera*()>& get_camera_function):
     get_camera_function(get_camera_function),
-    uid(int(GlobalUID::GetNew("Reflectable"))),
+    uid(int(Reflectable::NewUID())),
     name("Perspective")
 {}
 
@@ -147,7 +147,7 @@ void dz::ecs::Camera::CameraPerspectiveReflectable::NotifyChange(int prop_index)
 
 dz::ecs::Camera::CameraOrthographicReflectable::CameraOrthographicReflectable(const std::function<Camera*()>& get_camera_function):
     get_camera_function(get_camera_function),
-    uid(int(GlobalUID::GetNew("Reflectable"))),
+    uid(int(Reflectable::NewUID())),
     name("Orthographic")
 {}
 
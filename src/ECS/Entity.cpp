@@ -4,7 +4,7 @@
 
 dz::ecs::Entity::EntityTransformReflectable::EntityTransformReflectable(const std::function<Entity*()>& get_entity_function):
     get_entity_function(get_entity_function),
-    uid(int(GlobalUID::GetNew("Reflectable"))),
+    uid(int(Reflectable::NewUID())),
     name("Transform")
 {}
 
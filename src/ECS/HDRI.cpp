@@ -1,17 +1,25 @@
 #include <dz/ECS/HDRI.hpp>
 #include <dz/GlobalUID.hpp>
+#include <dz/Hash.hpp>
+#include <dz/ThreadPool.hpp>
+#include <dz/Transfer.hpp>
+#include "../Directz.cpp.hpp"
+#include "../Image.cpp.hpp"
+#include <fstream>
+#include <array>
 
 void dz::ecs::set_radiance_control_block(Shader* shader, void* user_data) {
     RadianceControlBlock& controlBlock = *(RadianceControlBlock*)user_data;
     shader_update_push_constant(shader, 0, (void*)&controlBlock.roughness, sizeof(float));
     shader_update_push_constant(shader, 1, (void*)&controlBlock.mip, sizeof(int));
+    shader_update_push_constant(shader, 2, (void*)&controlBlock.octahedral, sizeof(int));
     shader_ensure_push_constants(shader);
 
 }
 
 dz::ecs::HDRI::HDRIReflectable::HDRIReflectable(const std::function<HDRI*()>& get_hdri_function):
     get_hdri_function(get_hdri_function),
-    uid(int(GlobalUID::GetNew("Reflectable"))),
+    uid(int(Reflectable::NewUID())),
     name("HDRI")
 {}
 
@@ -32,4 +40,272 @@ void* dz::ecs::HDRI::HDRIReflectable::GetVoidPropertyByIndex(int prop_index) {
     }
 }
 
-void dz::ecs::HDRI::HDRIReflectable::NotifyChange(int prop_index) {}
\ No newline at end of file
+void dz::ecs::HDRI::HDRIReflectable::NotifyChange(int prop_index) {}
+#define DZ_HDRI_IBL_CACHE_MAGIC "DZIBL"
+// bump whenever the generation shaders change so stale results are not reused
+#define DZ_HDRI_IBL_CACHE_VERSION 2
+#define DZ_HDRI_IBL_CACHE_ALIGNMENT 16
+
+namespace dz::ecs {
+    struct IBLCacheHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t radiance_mip_levels;
+        uint64_t key;
+        uint32_t irradiance_width;
+        uint32_t irradiance_height;
+        uint32_t radiance_width;
+        uint32_t radiance_height;
+    };
+
+    std::filesystem::path& hdri_ibl_cache_directory() {
+        static std::filesystem::path directory = getProgramDataPath() / "DirectZ" / "ibl";
+        return directory;
+    }
+
+    void hdri_set_ibl_cache_directory(const std::filesystem::path& directory) {
+        hdri_ibl_cache_directory() = directory;
+    }
+
+    std::filesystem::path hdri_ibl_cache_path(uint64_t key) {
+        return hdri_ibl_cache_directory() / (hash_to_string(key) + ".dzibl");
+    }
+
+    size_t hdri_ibl_cache_align(size_t offset) {
+        return (offset + DZ_HDRI_IBL_CACHE_ALIGNMENT - 1) & ~size_t(DZ_HDRI_IBL_CACHE_ALIGNMENT - 1);
+    }
+
+    uint64_t hdri_get_ibl_cache_key(const dz::loaders::STB_Image_Info& info, const HDRI& hdri, uint32_t radiance_mip_levels) {
+        if (hdri_ibl_cache_directory().empty())
+            return 0;
+        std::shared_ptr<const FileMapping> mapping = info.mapping;
+        if (!mapping && !info.path.empty()) {
+            FileHandle handle{FileHandle::PATH, info.path.string()};
+            try {
+                mapping = handle.map();
+            }
+            catch (...) {
+                return 0;
+            }
+        }
+        const char* data = mapping ? mapping->data : info.bytes.get();
+        size_t size = mapping ? mapping->size : (info.bytes ? info.bytes_length : 0);
+        if (!data || !size)
+            return 0;
+        uint32_t parameters[] = {
+            DZ_HDRI_IBL_CACHE_VERSION,
+            DZ_HDRI_IRRADIANCE_DIVISOR,
+            DZ_HDRI_RADIANCE_OCTAHEDRAL_SIZE,
+            radiance_mip_levels,
+            uint32_t(hdri.irradiance_mode),
+            uint32_t(hdri.radiance_mode),
+            uint32_t(info.load_float)
+        };
+        auto key = hash_bytes(parameters, sizeof(parameters));
+        key = hash_bytes(data, size, key);
+        return key ? key : 1;
+    }
+
+    bool hdri_load_ibl_cache(uint64_t key, ImageCreateInfo* irradiance_info, ImageCreateInfo& radiance_info) {
+        auto path = hdri_ibl_cache_path(key);
+        std::error_code ec;
+        if (!std::filesystem::exists(path, ec))
+            return false;
+        FileHandle handle{FileHandle::PATH, path.string()};
+        std::shared_ptr<const FileMapping> mapping;
+        try {
+            mapping = handle.map();
+        }
+        catch (...) {
+            return false;
+        }
+        if (!mapping || mapping->size < sizeof(IBLCacheHeader))
+            return false;
+        IBLCacheHeader header;
+        memcpy(&header, mapping->data, sizeof(header));
+        if (memcmp(header.magic, DZ_HDRI_IBL_CACHE_MAGIC, sizeof(DZ_HDRI_IBL_CACHE_MAGIC)) != 0 ||
+            header.version != DZ_HDRI_IBL_CACHE_VERSION ||
+            header.key != key ||
+            header.irradiance_width != (irradiance_info ? irradiance_info->width : 0) ||
+            header.irradiance_height != (irradiance_info ? irradiance_info->height : 0) ||
+            header.radiance_width != radiance_info.width ||
+            header.radiance_height != radiance_info.height ||
+            header.radiance_mip_levels != radiance_info.mip_levels)
+            return false;
+
+        // validate every level fits before handing any of them out
+        std::vector<std::shared_ptr<void>> irradiance_datas;
+        std::vector<std::shared_ptr<void>> radiance_datas;
+        auto owner = std::const_pointer_cast<FileMapping>(mapping);
+        size_t offset = hdri_ibl_cache_align(sizeof(IBLCacheHeader));
+        auto take = [&](const ImageCreateInfo& info, uint32_t mip, std::vector<std::shared_ptr<void>>& datas) {
+            auto size = format_get_mip_byte_size(info.format,
+                (std::max)(1u, info.width >> mip),
+                (std::max)(1u, info.height >> mip),
+                (std::max)(1u, info.depth >> mip));
+            if (offset > mapping->size || size > mapping->size - offset)
+                return false;
+            datas.push_back(std::shared_ptr<void>(owner, (void*)(mapping->data + offset)));
+            offset = hdri_ibl_cache_align(offset + size);
+            return true;
+        };
+        if (irradiance_info && !take(*irradiance_info, 0, irradiance_datas))
+            return false;
+        for (uint32_t mip = 0; mip < radiance_info.mip_levels; mip++)
+            if (!take(radiance_info, mip, radiance_datas))
+                return false;
+        if (irradiance_info)
+            irradiance_info->datas = std::move(irradiance_datas);
+        radiance_info.datas = std::move(radiance_datas);
+        return true;
+    }
+
+    void hdri_store_ibl_cache(uint64_t key, Image* irradiance_image, Image* radiance_image) {
+        struct PendingIBLCache {
+            IBLCacheHeader header{};
+            std::vector<std::vector<char>> levels;
+            size_t remaining = 0;
+        };
+        auto pending = std::make_shared<PendingIBLCache>();
+        auto& header = pending->header;
+        memcpy(header.magic, DZ_HDRI_IBL_CACHE_MAGIC, sizeof(DZ_HDRI_IBL_CACHE_MAGIC));
+        header.version = DZ_HDRI_IBL_CACHE_VERSION;
+        header.key = key;
+        header.irradiance_width = irradiance_image ? image_get_width(irradiance_image) : 0;
+        header.irradiance_height = irradiance_image ? image_get_height(irradiance_image) : 0;
+        header.radiance_width = image_get_width(radiance_image);
+        header.radiance_height = image_get_height(radiance_image);
+        header.radiance_mip_levels = radiance_image->mip_levels;
+        size_t first_radiance_level = irradiance_image ? 1 : 0;
+        pending->levels.resize(first_radiance_level + radiance_image->mip_levels);
+        pending->remaining = pending->levels.size();
+
+        auto path = hdri_ibl_cache_path(key);
+        auto on_level = [pending, path](size_t level) {
+            return [pending, path, level](void* data, size_t size) {
+                pending->levels[level].assign((char*)data, (char*)data + size);
+                if (--pending->remaining)
+                    return;
+                // every level has been read back, write the file off the render thread
+                thread_pool_enqueue(thread_pool_default(), [pending, path]() {
+                    try {
+                        std::filesystem::create_directories(path.parent_path());
+                        auto temp_path = path;
+                        temp_path += ".tmp";
+                        {
+                            std::ofstream stream(temp_path, std::ios::binary | std::ios::trunc);
+                            static const char zeros[DZ_HDRI_IBL_CACHE_ALIGNMENT] = {};
+                            size_t offset = 0;
+                            auto write = [&](const char* bytes, size_t size) {
+                                stream.write(bytes, size);
+                                offset += size;
+                                auto aligned = hdri_ibl_cache_align(offset);
+                                stream.write(zeros, aligned - offset);
+                                offset = aligned;
+                            };
+                            write((const char*)&pending->header, sizeof(IBLCacheHeader));
+                            for (auto& level : pending->levels)
+                                write(level.data(), level.size());
+                            if (!stream)
+                                throw std::runtime_error("write failed");
+                        }
+                        std::filesystem::rename(temp_path, path);
+                    }
+                    catch (const std::exception& e) {
+                        std::cerr << "Failed to cache image based lighting " << path << ": " << e.what() << std::endl;
+                    }
+                });
+            };
+        };
+        if (irradiance_image)
+            image_get_data_async(irradiance_image, 0, on_level(0));
+        for (uint32_t mip = 0; mip < radiance_image->mip_levels; mip++)
+            image_get_data_async(radiance_image, mip, on_level(first_radiance_level + mip));
+    }
+
+    void hdri_project_irradiance_sh(const ImageCreateInfo& info, vec<float, 4>* out_coefficients) {
+        for (size_t index = 0; index < 9; index++)
+            out_coefficients[index] = vec<float, 4>(0.0f);
+        if (info.datas.empty() || !info.datas[0] || !info.width || !info.height)
+            return;
+        auto channel_sizes = format_get_channels_size_of_t(info.format);
+        auto channel_count = channel_sizes.size();
+        // stb hands back 32 bit float channels for HDR sources and 8 bit unorm otherwise
+        bool is_float = !channel_sizes.empty() && channel_sizes[0] == sizeof(float);
+        if (channel_count == 0)
+            return;
+        auto width = info.width;
+        auto height = info.height;
+        auto pixel_size = format_get_mip_byte_size(info.format, 1, 1);
+        auto pixels = (const char*)info.datas[0].get();
+
+        // rows are split into chunks, each summed into its own slot so no locking is needed
+        auto pool = thread_pool_default();
+        size_t chunk_count = (std::min)(size_t(height), (thread_pool_get_thread_count(pool) + 1) * 4);
+        size_t rows_per_chunk = (height + chunk_count - 1) / chunk_count;
+        std::vector<std::array<double, 27>> partials(chunk_count);
+        const double pi = 3.14159265358979323846;
+        double d_phi = 2.0 * pi / double(width);
+        double d_theta = pi / double(height);
+        thread_pool_parallel_for(pool, chunk_count, [&](size_t chunk) {
+            auto& sum = partials[chunk];
+            sum.fill(0.0);
+            auto row_end = (std::min)(size_t(height), (chunk + 1) * rows_per_chunk);
+            for (size_t row = chunk * rows_per_chunk; row < row_end; row++) {
+                double theta = pi * (double(row) + 0.5) / double(height);
+                double sin_theta = std::sin(theta);
+                double y = std::cos(theta);
+                double weight = d_phi * d_theta * sin_theta;
+                auto row_pixels = pixels + row * width * pixel_size;
+                for (size_t column = 0; column < width; column++) {
+                    double phi = 2.0 * pi * (double(column) + 0.5) / double(width);
+                    double x = sin_theta * std::cos(phi);
+                    double z = sin_theta * std::sin(phi);
+                    double color[3];
+                    auto pixel = row_pixels + column * pixel_size;
+                    for (size_t channel = 0; channel < 3; channel++) {
+                        auto source_channel = (std::min)(channel, channel_count - 1);
+                        color[channel] = is_float ?
+                            double(((const float*)pixel)[source_channel]) :
+                            double(((const uint8_t*)pixel)[source_channel]) / 255.0;
+                    }
+                    double basis[9] = {
+                        0.282095,
+                        0.488603 * y,
+                        0.488603 * z,
+                        0.488603 * x,
+                        1.092548 * x * y,
+                        1.092548 * y * z,
+                        0.315392 * (3.0 * z * z - 1.0),
+                        1.092548 * x * z,
+                        0.546274 * (x * x - y * y)
+                    };
+                    for (size_t coefficient = 0; coefficient < 9; coefficient++) {
+                        auto scale = basis[coefficient] * weight;
+                        sum[coefficient * 3 + 0] += color[0] * scale;
+                        sum[coefficient * 3 + 1] += color[1] * scale;
+                        sum[coefficient * 3 + 2] += color[2] * scale;
+                    }
+                }
+            }
+        });
+
+        // convolving with the clamped cosine lobe scales each band, pi, 2pi/3 and pi/4
+        const double band_scale[9] = {
+            pi,
+            2.0 * pi / 3.0, 2.0 * pi / 3.0, 2.0 * pi / 3.0,
+            pi / 4.0, pi / 4.0, pi / 4.0, pi / 4.0, pi / 4.0
+        };
+        for (size_t coefficient = 0; coefficient < 9; coefficient++) {
+            double total[3] = {};
+            for (auto& sum : partials)
+                for (size_t channel = 0; channel < 3; channel++)
+                    total[channel] += sum[coefficient * 3 + channel];
+            out_coefficients[coefficient] = vec<float, 4>(
+                float(total[0] * band_scale[coefficient]),
+                float(total[1] * band_scale[coefficient]),
+                float(total[2] * band_scale[coefficient]),
+                0.0f);
+        }
+    }
+}
@@ -5,7 +5,7 @@ dz::ecs::Light::LightMetaReflectable::LightMetaReflectable(
     const std::function<Light*()>& get_light_function
 ):
     get_light_function(get_light_function),
-    uid(int(GlobalUID::GetNew("Reflectable"))),
+    uid(int(Reflectable::NewUID())),
     name("Light Meta")
 {}
 
@@ -3,7 +3,7 @@
 
 dz::ecs::Material::MaterialReflectable::MaterialReflectable(const std::function<Material*()>& get_material_function):
     get_material_function(get_material_function),
-    uid(int(GlobalUID::GetNew("Reflectable"))),
+    uid(int(Reflectable::NewUID())),
     name("Material")
 {}
 
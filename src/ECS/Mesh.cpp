@@ -4,7 +4,7 @@
 
 dz::ecs::Mesh::MeshReflectable::MeshReflectable(const std::function<Mesh*()>& get_mesh_function):
     get_mesh_function(get_mesh_function),
-    uid(int(GlobalUID::GetNew("Reflectable"))),
+    uid(int(Reflectable::NewUID())),
     name("Mesh")
 {}
 
@@ -4,7 +4,7 @@
 
 dz::ecs::Scene::SceneTransformReflectable::SceneTransformReflectable(const std::function<Scene*()>& get_scene_function):
     get_scene_function(get_scene_function),
-    uid(int(GlobalUID::GetNew("Reflectable"))),
+    uid(int(Reflectable::NewUID())),
     name("Transform")
 {}
 
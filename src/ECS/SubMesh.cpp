@@ -3,7 +3,7 @@
 
 dz::ecs::SubMesh::SubMeshReflectable::SubMeshReflectable(const std::function<SubMesh*()>& get_submesh_function):
     get_submesh_function(get_submesh_function),
-    uid(int(GlobalUID::GetNew("Reflectable"))),
+    uid(int(Reflectable::NewUID())),
     name("SubMesh")
 {}
 
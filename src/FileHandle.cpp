@@ -1,6 +1,109 @@
 #include <dz/FileHandle.hpp>
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 namespace dz {
+    FileMapping::~FileMapping()
+    {
+    #if defined(_WIN32)
+        if (data)
+            UnmapViewOfFile(data);
+        if (platform_handle)
+            CloseHandle((HANDLE)platform_handle);
+    #else
+    #if defined(ANDROID)
+        if (platform_handle)
+        {
+            AAsset_close((AAsset*)platform_handle);
+            return;
+        }
+    #endif
+        if (data)
+            munmap((void*)data, size);
+    #endif
+    }
+
+    std::shared_ptr<const FileMapping> map_file_path(const std::string& final_path)
+    {
+        auto mapping = std::make_shared<FileMapping>();
+    #if defined(_WIN32)
+        HANDLE file = CreateFileA(final_path.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+        if (file == INVALID_HANDLE_VALUE)
+            throw std::runtime_error("Failed to open file for mapping: " + final_path);
+        LARGE_INTEGER file_size{};
+        GetFileSizeEx(file, &file_size);
+        mapping->size = size_t(file_size.QuadPart);
+        if (mapping->size)
+        {
+            HANDLE mapping_handle = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+            CloseHandle(file);
+            if (!mapping_handle)
+                throw std::runtime_error("Failed to map file: " + final_path);
+            mapping->platform_handle = mapping_handle;
+            mapping->data = (const char*)MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+            if (!mapping->data)
+                throw std::runtime_error("Failed to map file: " + final_path);
+        }
+        else
+            CloseHandle(file);
+    #else
+        int fd = ::open(final_path.c_str(), O_RDONLY);
+        if (fd == -1)
+            throw std::runtime_error("Failed to open file for mapping: " + final_path);
+        struct stat file_stat{};
+        if (fstat(fd, &file_stat) == -1)
+        {
+            ::close(fd);
+            throw std::runtime_error("Failed to stat file for mapping: " + final_path);
+        }
+        mapping->size = size_t(file_stat.st_size);
+        if (mapping->size)
+        {
+            auto data = mmap(nullptr, mapping->size, PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (data == MAP_FAILED)
+                throw std::runtime_error("Failed to map file: " + final_path);
+            mapping->data = (const char*)data;
+        }
+        else
+            ::close(fd);
+    #endif
+        return mapping;
+    }
+
+    std::shared_ptr<const FileMapping> FileHandle::map() const
+    {
+        auto final_path = path;
+        switch (location)
+        {
+            case ASSET:
+            {
+            #if defined(ANDROID)
+                AAsset* asset = AAssetManager_open(dr.android_asset_manager, final_path.c_str(), AASSET_MODE_BUFFER);
+                if (!asset)
+                    throw std::runtime_error("Failed to open asset: " + final_path);
+                auto mapping = std::make_shared<FileMapping>();
+                mapping->platform_handle = asset;
+                mapping->data = (const char*)AAsset_getBuffer(asset);
+                mapping->size = size_t(AAsset_getLength(asset));
+                return mapping;
+            #else
+                final_path = (getProgramDirectoryPath() / "assets" / path).string();
+                [[fallthrough]];
+            #endif
+            }
+            case PATH:
+                return map_file_path(final_path);
+            case MEMORY:
+                return nullptr;
+        }
+        throw std::runtime_error("Invalid file location");
+    }
+
     std::shared_ptr<std::iostream> FileHandle::open(std::ios_base::openmode ios)
     {
         auto final_path = path;
@@ -29,6 +132,7 @@ namespace dz {
                 return cached_mem_stream;
             #else
                 final_path = (getProgramDirectoryPath() / "assets" / path).string();
+                [[fallthrough]];
             #endif
             }
             case PATH:
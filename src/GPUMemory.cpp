@@ -0,0 +1,358 @@
+#include <dz/GPUMemory.hpp>
+#include "Directz.cpp.hpp"
+#include "BufferGroup.cpp.hpp"
+#include "Shader.cpp.hpp"
+
+namespace dz {
+
+    uint32_t gpu_memory_order_count(VkDeviceSize block_size) {
+        uint32_t order_count = 1;
+        while ((VkDeviceSize(DZ_GPU_MEMORY_MIN_ALLOCATION) << (order_count - 1)) < block_size)
+            order_count++;
+        return order_count;
+    }
+
+    /**
+    * @brief Splits the smallest free node able to hold size at alignment, returns false if the block has none
+    */
+    bool gpu_memory_block_allocate(GPUMemoryBlock& block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset) {
+        // buddy nodes are aligned to their own size, so a node at least as large as the alignment satisfies it
+        auto needed = (std::max)((std::max)(size, alignment), VkDeviceSize(DZ_GPU_MEMORY_MIN_ALLOCATION));
+        uint32_t order = 0;
+        while ((VkDeviceSize(DZ_GPU_MEMORY_MIN_ALLOCATION) << order) < needed)
+            order++;
+        auto order_count = uint32_t(block.free_lists.size());
+        auto found = order;
+        while (found < order_count && block.free_lists[found].empty())
+            found++;
+        if (found >= order_count)
+            return false;
+        auto node = *block.free_lists[found].begin();
+        block.free_lists[found].erase(block.free_lists[found].begin());
+        while (found > order) {
+            found--;
+            block.free_lists[found].insert(node + (VkDeviceSize(DZ_GPU_MEMORY_MIN_ALLOCATION) << found));
+        }
+        block.allocated_orders[node] = order;
+        block.used += VkDeviceSize(DZ_GPU_MEMORY_MIN_ALLOCATION) << order;
+        block.requested += size;
+        block.allocation_count++;
+        offset = node;
+        return true;
+    }
+
+    /**
+    * @brief Returns a node to the block, merging it with its buddy while the buddy is free
+    */
+    void gpu_memory_block_free(GPUMemoryBlock& block, VkDeviceSize offset, VkDeviceSize size) {
+        auto it = block.allocated_orders.find(offset);
+        if (it == block.allocated_orders.end())
+            throw std::runtime_error("gpu_memory_free: offset was not allocated from this block");
+        auto order = it->second;
+        block.allocated_orders.erase(it);
+        block.used -= VkDeviceSize(DZ_GPU_MEMORY_MIN_ALLOCATION) << order;
+        block.requested -= size;
+        block.allocation_count--;
+        auto order_count = uint32_t(block.free_lists.size());
+        while (order + 1 < order_count) {
+            auto buddy = offset ^ (VkDeviceSize(DZ_GPU_MEMORY_MIN_ALLOCATION) << order);
+            auto buddy_it = block.free_lists[order].find(buddy);
+            if (buddy_it == block.free_lists[order].end())
+                break;
+            block.free_lists[order].erase(buddy_it);
+            offset = (std::min)(offset, buddy);
+            order++;
+        }
+        block.free_lists[order].insert(offset);
+    }
+
+    void gpu_memory_ensure() {
+        auto& gpu_memory = dr.gpu_memory;
+        if (gpu_memory.initialized)
+            return;
+        vkGetPhysicalDeviceMemoryProperties(dr.physicalDevice, &gpu_memory.memory_properties);
+        auto type_count = gpu_memory.memory_properties.memoryTypeCount;
+        gpu_memory.pools.resize(type_count * 2);
+        gpu_memory.dedicated_counts.assign(type_count, 0);
+        gpu_memory.dedicated_bytes.assign(type_count, 0);
+        gpu_memory.initialized = true;
+    }
+
+    uint32_t gpu_memory_find_type(uint32_t type_filter, VkMemoryPropertyFlags properties) {
+        std::lock_guard lock(dr.gpu_memory.mutex);
+        gpu_memory_ensure();
+        auto& memory_properties = dr.gpu_memory.memory_properties;
+        for (uint32_t i = 0; i < memory_properties.memoryTypeCount; i++)
+            if ((type_filter & (1 << i)) && (memory_properties.memoryTypes[i].propertyFlags & properties) == properties)
+                return i;
+        throw std::runtime_error("Failed to find suitable memory type.");
+    }
+
+    bool gpu_memory_type_is_host_visible(uint32_t memory_type) {
+        return dr.gpu_memory.memory_properties.memoryTypes[memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    }
+
+    GPUMemoryPool& gpu_memory_get_pool(uint32_t memory_type, bool linear) {
+        auto& gpu_memory = dr.gpu_memory;
+        auto& pool = gpu_memory.pools[memory_type * 2 + (linear ? 1 : 0)];
+        if (!pool) {
+            pool = std::make_unique<GPUMemoryPool>();
+            pool->memory_type = memory_type;
+            pool->linear = linear;
+            // keep blocks to an eighth of small heaps, block sizes stay powers of two for the buddy allocator
+            auto heap_index = gpu_memory.memory_properties.memoryTypes[memory_type].heapIndex;
+            auto heap_size = gpu_memory.memory_properties.memoryHeaps[heap_index].size;
+            while (pool->block_size > DZ_GPU_MEMORY_MIN_ALLOCATION * 64 && pool->block_size > heap_size / 8)
+                pool->block_size /= 2;
+        }
+        return *pool;
+    }
+
+    /**
+    * @brief Calls vkAllocateMemory and maps host visible memory, returns VK_NULL_HANDLE if the device is out of memory
+    */
+    VkDeviceMemory gpu_memory_allocate_device(VkDeviceSize size, uint32_t memory_type, VkImage dedicated_image, char*& mapped) {
+        VkMemoryAllocateInfo alloc_info{};
+        alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        alloc_info.allocationSize = size;
+        alloc_info.memoryTypeIndex = memory_type;
+        VkMemoryDedicatedAllocateInfo dedicated_info{};
+        if (dedicated_image) {
+            dedicated_info.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+            dedicated_info.image = dedicated_image;
+            alloc_info.pNext = &dedicated_info;
+        }
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        auto result = vkAllocateMemory(dr.device, &alloc_info, nullptr, &memory);
+        if (result == VK_ERROR_OUT_OF_DEVICE_MEMORY || result == VK_ERROR_OUT_OF_HOST_MEMORY)
+            return VK_NULL_HANDLE;
+        vk_check("vkAllocateMemory", result);
+        dr.gpu_memory.device_allocation_count++;
+        mapped = nullptr;
+        if (gpu_memory_type_is_host_visible(memory_type))
+            vk_check("vkMapMemory", vkMapMemory(dr.device, memory, 0, VK_WHOLE_SIZE, 0, (void**)&mapped));
+        return memory;
+    }
+
+    void gpu_memory_free_device(VkDeviceMemory memory, bool mapped) {
+        if (mapped)
+            vkUnmapMemory(dr.device, memory);
+        vkFreeMemory(dr.device, memory, nullptr);
+        dr.gpu_memory.device_allocation_count--;
+    }
+
+    GPUMemoryBlock* gpu_memory_create_block(GPUMemoryPool& pool) {
+        auto block = std::make_unique<GPUMemoryBlock>();
+        block->pool = &pool;
+        block->size = pool.block_size;
+        block->memory = gpu_memory_allocate_device(block->size, pool.memory_type, VK_NULL_HANDLE, block->mapped);
+        if (!block->memory)
+            return nullptr;
+        block->free_lists.resize(gpu_memory_order_count(block->size));
+        block->free_lists.back().insert(0);
+        pool.blocks.push_back(std::move(block));
+        return pool.blocks.back().get();
+    }
+
+    void gpu_memory_destroy_block(GPUMemoryPool& pool, GPUMemoryBlock* block) {
+        gpu_memory_free_device(block->memory, block->mapped);
+        auto it = std::find_if(pool.blocks.begin(), pool.blocks.end(), [block](auto& pool_block) { return pool_block.get() == block; });
+        pool.blocks.erase(it);
+    }
+
+    void gpu_memory_track(GPUAllocation& allocation) {
+        auto& category = dr.gpu_memory.categories[size_t(allocation.category)];
+        category.allocation_count++;
+        category.bytes += allocation.size;
+    }
+
+    /**
+    * @brief Tries blocks fullest first so sparse blocks drain and can be released, returns false if none has room
+    */
+    bool gpu_memory_allocate_from_blocks(GPUMemoryPool& pool, const VkMemoryRequirements& requirements, const GPUMemoryBlock* skip, VkDeviceSize min_used, GPUAllocation& allocation) {
+        std::vector<GPUMemoryBlock*> blocks;
+        blocks.reserve(pool.blocks.size());
+        for (auto& block : pool.blocks)
+            if (block.get() != skip && block->used >= min_used)
+                blocks.push_back(block.get());
+        std::sort(blocks.begin(), blocks.end(), [](auto a, auto b) { return a->used > b->used; });
+        for (auto block : blocks) {
+            VkDeviceSize offset = 0;
+            if (!gpu_memory_block_allocate(*block, requirements.size, requirements.alignment, offset))
+                continue;
+            allocation.memory = block->memory;
+            allocation.offset = offset;
+            allocation.mapped = block->mapped ? block->mapped + offset : nullptr;
+            allocation.block = block;
+            return true;
+        }
+        return false;
+    }
+
+    GPUAllocation gpu_memory_allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, GPUMemoryCategory category, bool linear, bool dedicated, VkImage dedicated_image) {
+        auto memory_type = gpu_memory_find_type(requirements.memoryTypeBits, properties);
+        std::lock_guard lock(dr.gpu_memory.mutex);
+        auto& gpu_memory = dr.gpu_memory;
+        auto& pool = gpu_memory_get_pool(memory_type, linear);
+        GPUAllocation allocation;
+        allocation.size = requirements.size;
+        allocation.memory_type = memory_type;
+        allocation.category = category;
+        if (!dedicated && requirements.size <= pool.block_size / 2) {
+            if (gpu_memory_allocate_from_blocks(pool, requirements, nullptr, 0, allocation) ||
+                (gpu_memory_create_block(pool) && gpu_memory_allocate_from_blocks(pool, requirements, nullptr, 0, allocation))) {
+                gpu_memory_track(allocation);
+                return allocation;
+            }
+            // no room for another block, a smaller dedicated allocation may still fit
+        }
+        char* mapped = nullptr;
+        allocation.memory = gpu_memory_allocate_device(requirements.size, memory_type, dedicated_image, mapped);
+        if (!allocation.memory)
+            throw std::runtime_error("Failed to allocate device memory, the heap is exhausted.");
+        allocation.mapped = mapped;
+        gpu_memory.dedicated_counts[memory_type]++;
+        gpu_memory.dedicated_bytes[memory_type] += requirements.size;
+        gpu_memory_track(allocation);
+        return allocation;
+    }
+
+    GPUAllocation gpu_memory_allocate_buffer(VkBuffer buffer, VkMemoryPropertyFlags properties, GPUMemoryCategory category) {
+        VkMemoryRequirements requirements;
+        vkGetBufferMemoryRequirements(dr.device, buffer, &requirements);
+        auto allocation = gpu_memory_allocate(requirements, properties, category, true);
+        vk_check("vkBindBufferMemory", vkBindBufferMemory(dr.device, buffer, allocation.memory, allocation.offset));
+        return allocation;
+    }
+
+    GPUAllocation gpu_memory_allocate_image(VkImage image, VkMemoryPropertyFlags properties, GPUMemoryCategory category, bool linear) {
+        VkMemoryRequirements requirements;
+        vkGetImageMemoryRequirements(dr.device, image, &requirements);
+        auto dedicated = category == GPUMemoryCategory::Attachment || requirements.size >= DZ_GPU_MEMORY_DEDICATED_IMAGE_SIZE;
+        auto allocation = gpu_memory_allocate(requirements, properties, category, linear, dedicated, image);
+        vk_check("vkBindImageMemory", vkBindImageMemory(dr.device, image, allocation.memory, allocation.offset));
+        return allocation;
+    }
+
+    void gpu_memory_free(GPUAllocation& allocation) {
+        if (!allocation.memory)
+            return;
+        auto& gpu_memory = dr.gpu_memory;
+        std::lock_guard lock(gpu_memory.mutex);
+        if (!gpu_memory.initialized || dr.device == VK_NULL_HANDLE) {
+            allocation = {};
+            return;
+        }
+        auto& category = gpu_memory.categories[size_t(allocation.category)];
+        category.allocation_count--;
+        category.bytes -= allocation.size;
+        if (auto block = allocation.block) {
+            gpu_memory_block_free(*block, allocation.offset, allocation.size);
+            auto& pool = *block->pool;
+            // keep one empty block per pool so a resource freed and recreated every frame does not thrash the device
+            if (!block->allocation_count) {
+                auto empty_blocks = std::count_if(pool.blocks.begin(), pool.blocks.end(), [](auto& pool_block) { return !pool_block->allocation_count; });
+                if (empty_blocks > 1)
+                    gpu_memory_destroy_block(pool, block);
+            }
+        }
+        else {
+            gpu_memory_free_device(allocation.memory, allocation.mapped);
+            gpu_memory.dedicated_counts[allocation.memory_type]--;
+            gpu_memory.dedicated_bytes[allocation.memory_type] -= allocation.size;
+        }
+        allocation = {};
+    }
+
+    bool gpu_memory_should_relocate(const GPUAllocation& allocation) {
+        auto block = allocation.block;
+        if (!block)
+            return false;
+        std::lock_guard lock(dr.gpu_memory.mutex);
+        return block->pool->blocks.size() > 1 && float(block->used) < float(block->size) * DZ_GPU_MEMORY_DEFRAGMENT_USAGE;
+    }
+
+    bool gpu_memory_relocate(const VkMemoryRequirements& requirements, const GPUAllocation& current, GPUAllocation& out) {
+        if (!current.block)
+            return false;
+        std::lock_guard lock(dr.gpu_memory.mutex);
+        auto& pool = *current.block->pool;
+        if (!(requirements.memoryTypeBits & (1 << pool.memory_type)))
+            return false;
+        out = {};
+        out.size = requirements.size;
+        out.memory_type = pool.memory_type;
+        out.category = current.category;
+        // only move into blocks at least as full, otherwise two sparse blocks would trade places
+        if (!gpu_memory_allocate_from_blocks(pool, requirements, current.block, current.block->used, out))
+            return false;
+        gpu_memory_track(out);
+        return true;
+    }
+
+    void gpu_memory_destroy() {
+        auto& gpu_memory = dr.gpu_memory;
+        std::lock_guard lock(gpu_memory.mutex);
+        for (auto& pool : gpu_memory.pools) {
+            if (!pool)
+                continue;
+            for (auto& block : pool->blocks)
+                gpu_memory_free_device(block->memory, block->mapped);
+            pool->blocks.clear();
+        }
+        gpu_memory.pools.clear();
+        gpu_memory.initialized = false;
+    }
+
+    GPUMemoryStats gpu_memory_get_stats() {
+        auto& gpu_memory = dr.gpu_memory;
+        GPUMemoryStats stats;
+        stats.max_device_allocation_count = dr.physicalDevice ? dr.physicalDeviceProperties.limits.maxMemoryAllocationCount : 0;
+        std::lock_guard lock(gpu_memory.mutex);
+        if (!gpu_memory.initialized)
+            return stats;
+        auto& memory_properties = gpu_memory.memory_properties;
+        stats.heaps.resize(memory_properties.memoryHeapCount);
+        for (uint32_t heap_index = 0; heap_index < memory_properties.memoryHeapCount; heap_index++) {
+            auto& heap = stats.heaps[heap_index];
+            heap.heap_size = memory_properties.memoryHeaps[heap_index].size;
+            heap.device_local = memory_properties.memoryHeaps[heap_index].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+        }
+        for (uint32_t memory_type = 0; memory_type < memory_properties.memoryTypeCount; memory_type++) {
+            auto& heap = stats.heaps[memory_properties.memoryTypes[memory_type].heapIndex];
+            heap.dedicated_count += gpu_memory.dedicated_counts[memory_type];
+            heap.bytes_reserved += gpu_memory.dedicated_bytes[memory_type];
+            heap.bytes_used += gpu_memory.dedicated_bytes[memory_type];
+            for (auto linear : {false, true}) {
+                auto& pool = gpu_memory.pools[memory_type * 2 + (linear ? 1 : 0)];
+                if (!pool)
+                    continue;
+                for (auto& block : pool->blocks) {
+                    heap.block_count++;
+                    heap.bytes_reserved += block->size;
+                    heap.bytes_used += block->requested;
+                }
+            }
+        }
+        for (size_t index = 0; index < size_t(GPUMemoryCategory::Count); index++)
+            stats.categories[index] = gpu_memory.categories[index];
+        stats.device_allocation_count = gpu_memory.device_allocation_count;
+        return stats;
+    }
+
+    size_t gpu_memory_defragment(size_t max_bytes) {
+        if (dr.device == VK_NULL_HANDLE)
+            return 0;
+        vkDeviceWaitIdle(dr.device);
+        size_t moved_bytes = 0;
+        for (auto& [group_name, buffer_group] : dr.buffer_groups) {
+            if (moved_bytes >= max_bytes)
+                break;
+            if (!buffer_group_defragment(buffer_group.get(), max_bytes - moved_bytes, moved_bytes))
+                continue;
+            for (auto& [shader, _] : buffer_group->shaders)
+                shader_update_descriptor_sets(shader);
+        }
+        return moved_bytes;
+    }
+}
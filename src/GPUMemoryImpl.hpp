@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Directz.cpp.hpp"
+#include <mutex>
+
+#define DZ_GPU_MEMORY_BLOCK_SIZE (64ull * 1024ull * 1024ull)
+#define DZ_GPU_MEMORY_MIN_ALLOCATION 256
+#define DZ_GPU_MEMORY_DEDICATED_IMAGE_SIZE (16ull * 1024ull * 1024ull)
+#define DZ_GPU_MEMORY_DEFRAGMENT_USAGE 0.25f
+
+namespace dz {
+    struct GPUMemoryPool;
+
+    /**
+     * @brief One vkAllocateMemory block carved up with a buddy allocator, host visible blocks stay mapped
+     */
+    struct GPUMemoryBlock
+    {
+        GPUMemoryPool* pool = nullptr;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        char* mapped = nullptr;
+        VkDeviceSize used = 0;              /**< Bytes of the buddy nodes handed out. */
+        VkDeviceSize requested = 0;         /**< Bytes asked for by the resources. */
+        uint32_t allocation_count = 0;
+        std::vector<std::set<VkDeviceSize>> free_lists;     /**< Free node offsets per order, order k spans DZ_GPU_MEMORY_MIN_ALLOCATION << k bytes. */
+        std::unordered_map<VkDeviceSize, uint32_t> allocated_orders;
+    };
+
+    /**
+     * @brief Blocks of one memory type, linear and optimal resources use separate pools to respect bufferImageGranularity
+     */
+    struct GPUMemoryPool
+    {
+        uint32_t memory_type = 0;
+        bool linear = true;
+        VkDeviceSize block_size = DZ_GPU_MEMORY_BLOCK_SIZE;
+        std::vector<std::unique_ptr<GPUMemoryBlock>> blocks;
+    };
+
+    struct GPUAllocation
+    {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        void* mapped = nullptr;
+        GPUMemoryBlock* block = nullptr;    /**< nullptr for dedicated allocations. */
+        uint32_t memory_type = 0;
+        GPUMemoryCategory category = GPUMemoryCategory::Buffer;
+    };
+
+    struct GPUMemoryRegistry
+    {
+        bool initialized = false;
+        VkPhysicalDeviceMemoryProperties memory_properties = {};
+        std::vector<std::unique_ptr<GPUMemoryPool>> pools;  /**< Indexed by memory_type * 2 + linear. */
+        std::vector<uint32_t> dedicated_counts;             /**< Per memory type. */
+        std::vector<VkDeviceSize> dedicated_bytes;
+        GPUMemoryCategoryStats categories[size_t(GPUMemoryCategory::Count)];
+        uint32_t device_allocation_count = 0;
+        std::mutex mutex;
+    };
+
+    /**
+     * @brief Finds a memory type in type_filter holding every property, throws if there is none
+     */
+    uint32_t gpu_memory_find_type(uint32_t type_filter, VkMemoryPropertyFlags properties);
+
+    /**
+     * @brief Places a resource in a pooled block, or in its own allocation when dedicated is set or it would fill half a block
+     *
+     * @param dedicated_image passed to VkMemoryDedicatedAllocateInfo when the allocation ends up dedicated
+     */
+    GPUAllocation gpu_memory_allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, GPUMemoryCategory category, bool linear, bool dedicated = false, VkImage dedicated_image = VK_NULL_HANDLE);
+
+    /**
+     * @brief Allocates and binds memory for buffer
+     */
+    GPUAllocation gpu_memory_allocate_buffer(VkBuffer buffer, VkMemoryPropertyFlags properties, GPUMemoryCategory category);
+
+    /**
+     * @brief Allocates and binds memory for image, large images and attachments are given dedicated allocations
+     */
+    GPUAllocation gpu_memory_allocate_image(VkImage image, VkMemoryPropertyFlags properties, GPUMemoryCategory category, bool linear);
+
+    /**
+     * @brief Returns the allocation to its block or the device and clears it, empty allocations are ignored
+     */
+    void gpu_memory_free(GPUAllocation& allocation);
+
+    /**
+     * @brief returns true if allocation sits in a block used below DZ_GPU_MEMORY_DEFRAGMENT_USAGE while its pool has other blocks
+     */
+    bool gpu_memory_should_relocate(const GPUAllocation& allocation);
+
+    /**
+     * @brief Allocates room for a copy of current in a fuller existing block of the same pool, never creates a block
+     */
+    bool gpu_memory_relocate(const VkMemoryRequirements& requirements, const GPUAllocation& current, GPUAllocation& out);
+
+    /**
+     * @brief Frees every block, called when the device is destroyed
+     */
+    void gpu_memory_destroy();
+}
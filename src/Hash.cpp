@@ -0,0 +1,75 @@
+#include <dz/Hash.hpp>
+#include <cstring>
+
+namespace dz {
+    static constexpr uint64_t HASH_PRIME_0 = 0x9E3779B185EBCA87ull;
+    static constexpr uint64_t HASH_PRIME_1 = 0xC2B2AE3D27D4EB4Full;
+    static constexpr uint64_t HASH_PRIME_2 = 0x165667B19E3779F9ull;
+
+    inline uint64_t hash_rotl(uint64_t value, int bits) {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    inline uint64_t hash_read_u64(const uint8_t* bytes) {
+        uint64_t value;
+        memcpy(&value, bytes, sizeof(value));
+        return value;
+    }
+
+    inline uint64_t hash_round(uint64_t accumulator, uint64_t lane) {
+        accumulator += lane * HASH_PRIME_1;
+        accumulator = hash_rotl(accumulator, 31);
+        return accumulator * HASH_PRIME_0;
+    }
+
+    inline uint64_t hash_avalanche(uint64_t value) {
+        value ^= value >> 33;
+        value *= HASH_PRIME_1;
+        value ^= value >> 29;
+        value *= HASH_PRIME_2;
+        value ^= value >> 32;
+        return value;
+    }
+
+    uint64_t hash_bytes(const void* data, size_t size, uint64_t seed) {
+        auto bytes = (const uint8_t*)data;
+        auto end = bytes + size;
+        uint64_t hash;
+        if (size >= 32) {
+            // four independent lanes keep the multiplies from serializing on large buffers
+            uint64_t lanes[4] = {
+                seed + HASH_PRIME_0 + HASH_PRIME_1,
+                seed + HASH_PRIME_1,
+                seed,
+                seed - HASH_PRIME_0
+            };
+            auto limit = end - 32;
+            do {
+                lanes[0] = hash_round(lanes[0], hash_read_u64(bytes));
+                lanes[1] = hash_round(lanes[1], hash_read_u64(bytes + 8));
+                lanes[2] = hash_round(lanes[2], hash_read_u64(bytes + 16));
+                lanes[3] = hash_round(lanes[3], hash_read_u64(bytes + 24));
+                bytes += 32;
+            } while (bytes <= limit);
+            hash = hash_rotl(lanes[0], 1) + hash_rotl(lanes[1], 7) + hash_rotl(lanes[2], 12) + hash_rotl(lanes[3], 18);
+            for (auto lane : lanes)
+                hash = (hash ^ hash_round(0, lane)) * HASH_PRIME_0 + HASH_PRIME_2;
+        }
+        else
+            hash = seed + HASH_PRIME_2;
+        hash += uint64_t(size);
+        for (; bytes + 8 <= end; bytes += 8)
+            hash = hash_rotl(hash ^ hash_round(0, hash_read_u64(bytes)), 27) * HASH_PRIME_0 + HASH_PRIME_2;
+        for (; bytes < end; bytes++)
+            hash = hash_rotl(hash ^ (uint64_t(*bytes) * HASH_PRIME_2), 11) * HASH_PRIME_0;
+        return hash_avalanche(hash);
+    }
+
+    std::string hash_to_string(uint64_t hash) {
+        static const char digits[] = "0123456789abcdef";
+        std::string result(16, '0');
+        for (int i = 15; i >= 0; i--, hash >>= 4)
+            result[i] = digits[hash & 0xF];
+        return result;
+    }
+}
@@ -171,19 +171,13 @@ namespace dz {
 
         vkCreateImage(dr.device, &imageInfo, nullptr, &image.image);
 
-        // Allocate memory
-        VkMemoryRequirements memRequirements;
-        vkGetImageMemoryRequirements(dr.device, image.image, &memRequirements);
-
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = find_memory_type(memRequirements.memoryTypeBits, image.memory_properties);
-
-        vkAllocateMemory(dr.device, &allocInfo, nullptr, &image.memory);
-        vkBindImageMemory(dr.device, image.image, image.memory, 0);
+        // Allocate memory, attachments and large images get their own allocation
+        image.allocation = gpu_memory_allocate_image(image.image, image.memory_properties,
+            image.is_framebuffer_attachment ? GPUMemoryCategory::Attachment : GPUMemoryCategory::Image,
+            image.tiling == VK_IMAGE_TILING_LINEAR);
 
         image.datas.resize(image.mip_levels);
+        transfer_batch_begin();
         for (auto mip = 0; mip < image.mip_levels; mip++) {
             // Upload data if provided
             if (!image.datas[mip]) {
@@ -192,6 +186,7 @@ namespace dz {
             image_upload_data(image_ptr, mip);
             image.datas[mip].reset();
         }
+        transfer_batch_end();
         image_ptr->data_is_cpu_side = false;
 
         // Create ImageView
@@ -240,15 +235,12 @@ namespace dz {
     
     void init_empty_image_data(Image* image_ptr, uint32_t mip) {
         auto& image = *image_ptr;
-        auto channels = image_get_channels_size_of_t(image_ptr);
-        auto pixel_stride = image_get_sizeof_channels(channels);
         uint32_t mipWidth = (std::max)(1u, image.width >> mip);
         uint32_t mipHeight = (std::max)(1u, image.height >> mip);
         uint32_t mipDepth = (std::max)(1u, image.depth >> mip);
-        auto image_size = mipWidth * mipHeight * mipDepth * pixel_stride;
+        auto image_size = format_get_mip_byte_size(image.format, mipWidth, mipHeight, mipDepth);
         auto& ptr = image.datas[mip];
-        ptr = std::shared_ptr<char>((char*)malloc(image_size), free);
-        memset(ptr.get(), 0, image_size);
+        ptr = allocator_make_shared_buffer<char>(image_size);
     }
 
     uint32_t image_get_aspect_mask(Image* image_ptr) {
@@ -269,6 +261,22 @@ namespace dz {
         case VK_FORMAT_R32G32_SFLOAT:
         case VK_FORMAT_R32G32B32_SFLOAT:
         case VK_FORMAT_R32G32B32A32_SFLOAT:
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        case VK_FORMAT_BC2_UNORM_BLOCK:
+        case VK_FORMAT_BC2_SRGB_BLOCK:
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+        case VK_FORMAT_BC4_UNORM_BLOCK:
+        case VK_FORMAT_BC4_SNORM_BLOCK:
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+        case VK_FORMAT_BC5_SNORM_BLOCK:
+        case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+        case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
             return VK_IMAGE_ASPECT_COLOR_BIT;
             break;
         case VK_FORMAT_D32_SFLOAT:
@@ -289,121 +297,10 @@ namespace dz {
     void image_upload_data(Image* image_ptr, uint32_t mip, void* new_data)
     {
         auto& image = *image_ptr;
-        auto channels = image_get_channels_size_of_t(image_ptr);
-        auto pixel_stride = image_get_sizeof_channels(channels);
-        auto image_mip_width = (std::max)(1u, uint32_t(image.width) >> mip);
-        auto image_mip_height = (std::max)(1u, uint32_t(image.height) >> mip);
-        auto image_mip_depth = (std::max)(1u, uint32_t(image.depth) >> mip);
-        VkDeviceSize image_size = image_mip_width * image_mip_height * image_mip_depth * pixel_stride;
-
-        VkBuffer staging_buffer;
-        VkDeviceMemory staging_buffer_memory;
-
-        VkBufferCreateInfo buffer_info{};
-        buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-        buffer_info.size = image_size;
-        buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-        buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-        vkCreateBuffer(dr.device, &buffer_info, nullptr, &staging_buffer);
-
-        VkMemoryRequirements mem_requirements;
-        vkGetBufferMemoryRequirements(dr.device, staging_buffer, &mem_requirements);
-
-        VkMemoryAllocateInfo alloc_info{};
-        alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        alloc_info.allocationSize = mem_requirements.size;
-        alloc_info.memoryTypeIndex = find_memory_type(mem_requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-        vkAllocateMemory(dr.device, &alloc_info, nullptr, &staging_buffer_memory);
-        vkBindBufferMemory(dr.device, staging_buffer, staging_buffer_memory, 0);
-
-        auto& sh_ptr = image.datas[mip];
-        auto ptr = sh_ptr.get();
-        if (new_data) {
-            memcpy(new_data, ptr, image_size);
-        }
-
-        void* mapped_data;
-        vkMapMemory(dr.device, staging_buffer_memory, 0, image_size, 0, &mapped_data);
-        memcpy(mapped_data, ptr, static_cast<size_t>(image_size));
-        vkUnmapMemory(dr.device, staging_buffer_memory);
-
-        VkCommandBuffer command_buffer = begin_single_time_commands();
-
-        auto new_layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-        auto& current_layout = image.current_layouts[mip];
-
-        VkImageMemoryBarrier barrier_to_transfer{};
-        barrier_to_transfer.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        barrier_to_transfer.oldLayout = current_layout;
-        barrier_to_transfer.newLayout = new_layout;
-        barrier_to_transfer.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier_to_transfer.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier_to_transfer.image = image.image;
-        barrier_to_transfer.subresourceRange.aspectMask = image_get_aspect_mask(image_ptr);
-        barrier_to_transfer.subresourceRange.baseMipLevel = mip;
-        barrier_to_transfer.subresourceRange.levelCount = 1;
-        barrier_to_transfer.subresourceRange.baseArrayLayer = 0;
-        barrier_to_transfer.subresourceRange.layerCount = 1;
-        barrier_to_transfer.srcAccessMask = 0;
-        barrier_to_transfer.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-        vkCmdPipelineBarrier(
-            command_buffer,
-            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-            VK_PIPELINE_STAGE_TRANSFER_BIT,
-            0,
-            0, nullptr,
-            0, nullptr,
-            1, &barrier_to_transfer
-        );
-
-        current_layout = new_layout;
-
-        VkBufferImageCopy region{};
-        region.bufferOffset = 0;
-        region.bufferRowLength = 0;
-        region.bufferImageHeight = 0;
-        region.imageSubresource.aspectMask = image_get_aspect_mask(image_ptr);
-        region.imageSubresource.mipLevel = mip;
-        region.imageSubresource.baseArrayLayer = 0;
-        region.imageSubresource.layerCount = 1;
-        region.imageOffset = {0, 0, 0};
-        region.imageExtent = {image_mip_width, image_mip_height, image_mip_depth};
-
-        vkCmdCopyBufferToImage(command_buffer, staging_buffer, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-        VkImageMemoryBarrier barrier_to_shader{};
-        barrier_to_shader.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        barrier_to_shader.oldLayout = current_layout;
-        new_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        barrier_to_shader.newLayout = new_layout;
-        barrier_to_shader.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier_to_shader.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier_to_shader.image = image.image;
-        barrier_to_shader.subresourceRange = barrier_to_transfer.subresourceRange;
-        barrier_to_shader.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        barrier_to_shader.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-        vkCmdPipelineBarrier(
-            command_buffer,
-            VK_PIPELINE_STAGE_TRANSFER_BIT,
-            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-            0,
-            0, nullptr,
-            0, nullptr,
-            1, &barrier_to_shader
-        );
-
-        current_layout = new_layout;
-
-        end_single_time_commands(command_buffer);
-
-        vkDestroyBuffer(dr.device, staging_buffer, nullptr);
-        vkFreeMemory(dr.device, staging_buffer_memory, nullptr);
-
-        image.data_is_gpu_side = true;
+        auto data = new_data ? new_data : image.datas[mip].get();
+        image_upload_data_async(image_ptr, mip, data);
+        if (dr.transfer.batch_depth == 0)
+            transfer_wait_idle();
     }
     
     void image_free_internal(Image* image_ptr) {
@@ -413,20 +310,19 @@ namespace dz {
         auto& device = dr.device;
         if (device == VK_NULL_HANDLE)
             return;
-        if (image.image != VK_NULL_HANDLE) {
-            vkDestroyImage(device, image.image, 0);
-            image.image = nullptr;
-        }
         for (auto& imageView : image.imageViews) {
             if (!imageView)
                 continue;
             vkDestroyImageView(device, imageView, 0);
             imageView = nullptr;
         }
-        if (image.memory != VK_NULL_HANDLE) {
-            vkFreeMemory(device, image.memory, 0);
-            image.memory = nullptr;
+        // an image with a queued or running copy is destroyed once that copy retires instead of waiting on it
+        if (image.image != VK_NULL_HANDLE) {
+            if (!transfer_defer_image_free(image.image, image.allocation))
+                vkDestroyImage(device, image.image, 0);
+            image.image = nullptr;
         }
+        gpu_memory_free(image.allocation);
         if(image.sampler != VK_NULL_HANDLE) {
             vkDestroySampler(device, image.sampler, 0);
             image.sampler = nullptr;
@@ -647,6 +543,42 @@ namespace dz {
         return vec;
     }
     
+    size_t format_get_mip_byte_size(VkFormat format, uint32_t width, uint32_t height, uint32_t depth) {
+        size_t block_bytes = 0;
+        switch (format)
+        {
+            case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+            case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+            case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+            case VK_FORMAT_BC4_UNORM_BLOCK:
+            case VK_FORMAT_BC4_SNORM_BLOCK:
+                block_bytes = 8;
+                break;
+            case VK_FORMAT_BC2_UNORM_BLOCK:
+            case VK_FORMAT_BC2_SRGB_BLOCK:
+            case VK_FORMAT_BC3_UNORM_BLOCK:
+            case VK_FORMAT_BC3_SRGB_BLOCK:
+            case VK_FORMAT_BC5_UNORM_BLOCK:
+            case VK_FORMAT_BC5_SNORM_BLOCK:
+            case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+            case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+            case VK_FORMAT_BC7_UNORM_BLOCK:
+            case VK_FORMAT_BC7_SRGB_BLOCK:
+                block_bytes = 16;
+                break;
+            default:
+                break;
+        }
+        if (block_bytes) {
+            size_t blocks_x = (size_t(width) + 3) / 4;
+            size_t blocks_y = (size_t(height) + 3) / 4;
+            return blocks_x * blocks_y * size_t(depth) * block_bytes;
+        }
+        auto pixel_stride = image_get_sizeof_channels(format_get_channels_size_of_t(format));
+        return size_t(width) * size_t(height) * size_t(depth) * pixel_stride;
+    }
+    
     std::vector<float> image_get_channels_size_of_t(Image* image)
     {
         return format_get_channels_size_of_t(image->format);
@@ -746,6 +678,8 @@ namespace dz {
     }
 
     void image_copy_begin() {
+        transfer_flush();
+
         static VkCommandBufferBeginInfo beginInfo{
             .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
             .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
@@ -835,8 +769,6 @@ namespace dz {
                << info.view_type << info.tiling << info.memory_properties
                << info.multisampling << info.is_framebuffer_attachment
                << info.surfaceType << info.mip_levels;
-        auto channels = format_get_channels_size_of_t(info.format);
-        auto pixel_stride = image_get_sizeof_channels(channels);
         assert(info.datas.size() == info.mip_levels);
         auto info_datas_data = info.datas.data();
         auto mip = 0;
@@ -844,7 +776,7 @@ namespace dz {
             uint32_t mipWidth = (std::max)(1u, info.width >> mip);
             uint32_t mipHeight = (std::max)(1u, info.height >> mip);
             uint32_t mipDepth = (std::max)(1u, info.depth >> mip);
-            auto mip_byte_size = mipWidth * mipHeight * mipDepth * pixel_stride;
+            auto mip_byte_size = format_get_mip_byte_size(info.format, mipWidth, mipHeight, mipDepth);
             auto& bytes = info_datas_data[mip];
             // use info.format and mip sizes to determine parameters to pass to stbi_write
             serial.writeBytes((char*)(bytes.get()), mip_byte_size);
@@ -860,8 +792,6 @@ namespace dz {
                >> info.view_type >> info.tiling >> info.memory_properties
                >> info.multisampling >> info.is_framebuffer_attachment
                >> info.surfaceType >> info.mip_levels;
-        auto channels = format_get_channels_size_of_t(info.format);
-        auto pixel_stride = image_get_sizeof_channels(channels);
         info.datas.resize(info.mip_levels);
         auto info_datas_data = info.datas.data();
         auto mip = 0;
@@ -869,8 +799,8 @@ namespace dz {
             uint32_t mipWidth = (std::max)(1u, info.width >> mip);
             uint32_t mipHeight = (std::max)(1u, info.height >> mip);
             uint32_t mipDepth = (std::max)(1u, info.depth >> mip);
-            auto mip_byte_size = mipWidth * mipHeight * mipDepth * pixel_stride;
-            auto compressed_bytes = std::shared_ptr<void>(malloc(mip_byte_size), free);
+            auto mip_byte_size = format_get_mip_byte_size(info.format, mipWidth, mipHeight, mipDepth);
+            auto compressed_bytes = allocator_make_shared_buffer<void>(mip_byte_size, false);
             serial.readBytes((char*)(compressed_bytes.get()), mip_byte_size);
             // use info.format and mip sizes to determine parameters to pass to stbi_load
             info_datas_data[mip] = compressed_bytes;
@@ -879,11 +809,49 @@ namespace dz {
         return info;
     }
 
+    bool image_serialize_snapshot(Image* image_ptr, Serial& serial, StateSnapshot& snapshot) {
+        auto& image = *image_ptr;
+        serial << image.width << image.height << image.depth
+               << image.format << image.usage << image.image_type
+               << image.view_type << image.tiling << image.memory_properties
+               << image.multisampling << image.is_framebuffer_attachment
+               << image.surfaceType << image.mip_levels;
+        // mip bytes are read back without waiting and written as blobs beside the stream, only their ids go inline
+        for (int mip = 0; mip < (int)image.mip_levels; mip++)
+            serial << state_snapshot_capture_image_mip(snapshot, image_ptr, mip);
+        return true;
+    }
+
+    ImageCreateInfo deserialize_ImageCreateInfo_blobs(Serial& serial, StateChunkReader& reader) {
+        ImageCreateInfo info;
+        serial >> info.width >> info.height >> info.depth
+               >> info.format >> info.usage >> info.image_type
+               >> info.view_type >> info.tiling >> info.memory_properties
+               >> info.multisampling >> info.is_framebuffer_attachment
+               >> info.surfaceType >> info.mip_levels;
+        info.datas.resize(info.mip_levels);
+        for (uint32_t mip = 0; mip < info.mip_levels; mip++) {
+            uint64_t blob_id = 0;
+            serial >> blob_id;
+            uint32_t mipWidth = (std::max)(1u, info.width >> mip);
+            uint32_t mipHeight = (std::max)(1u, info.height >> mip);
+            uint32_t mipDepth = (std::max)(1u, info.depth >> mip);
+            auto mip_byte_size = format_get_mip_byte_size(info.format, mipWidth, mipHeight, mipDepth);
+            auto bytes = allocator_make_shared_buffer<void>(mip_byte_size, false);
+            if (!state_reader_read_blob(reader, blob_id, bytes.get(), mip_byte_size))
+                throw std::runtime_error("State image blob is missing or corrupt");
+            info.datas[mip] = bytes;
+        }
+        return info;
+    }
+
     bool image_serialize(Image* image_ptr, Serial& serial) {
         bool valid_image = image_ptr;
         serial << valid_image;
         if (!valid_image)
             return true;
+        if (auto snapshot = state_get_capturing(serial))
+            return image_serialize_snapshot(image_ptr, serial, *snapshot);
         auto info = image_to_info(image_ptr);
         return serialize_ImageCreateInfo(serial, info);
     }
@@ -893,6 +861,8 @@ namespace dz {
         serial >> valid_image;
         if (!valid_image)
             return nullptr;
+        if (auto reader = state_get_restoring(serial))
+            return image_create(deserialize_ImageCreateInfo_blobs(serial, *reader));
         auto info = deserialize_ImageCreateInfo(serial);
         return image_create(info);
     }
@@ -913,145 +883,30 @@ namespace dz {
             .surfaceType = image_ptr->surfaceType,
             .mip_levels = image_ptr->mip_levels
         };
-        info.datas.reserve(info.mip_levels);
+        info.datas.resize(info.mip_levels);
         for (auto mip = 0; mip < info.mip_levels; mip++) {
-            auto mip_data = image_get_data(image_ptr, mip);
-            info.datas.push_back(std::shared_ptr<void>(mip_data, image_free_copied_data));
+            image_get_data_async(image_ptr, mip, [&info, mip](void* data, size_t size) {
+                auto mip_data = allocator_make_shared_buffer<void>(size, false);
+                memcpy(mip_data.get(), data, size);
+                info.datas[mip] = mip_data;
+            });
         }
+        transfer_wait_idle();
         return info;
     }
 
     void* image_get_data(Image* image_ptr, int mip)
     {
-        VkBuffer stagingBuffer = VK_NULL_HANDLE;
-        VkDeviceMemory stagingBufferMemory = VK_NULL_HANDLE;
-        VkMemoryRequirements imageMemRequirements;
-        vkGetImageMemoryRequirements(dr.device, image_ptr->image, &imageMemRequirements);
-        VkDeviceSize bufferSize = imageMemRequirements.size;
-        char* imageData = (char*)malloc(bufferSize);
-
-        // 2. Create staging buffer
-        VkBufferCreateInfo bufferInfo{};
-        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-        bufferInfo.size = bufferSize;
-        bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT; // We copy from image TO this buffer
-        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-        vk_check("vkCreateBuffer", vkCreateBuffer(dr.device, &bufferInfo, nullptr, &stagingBuffer));
-
-        // 3. Allocate memory for staging buffer
-        VkMemoryRequirements stagingMemRequirements;
-        vkGetBufferMemoryRequirements(dr.device, stagingBuffer, &stagingMemRequirements);
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = stagingMemRequirements.size; // Use actual requirements for staging buffer
-        allocInfo.memoryTypeIndex = find_memory_type(stagingMemRequirements.memoryTypeBits,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-        vk_check("vkAllocateMemory", vkAllocateMemory(dr.device, &allocInfo, nullptr, &stagingBufferMemory));
-
-        // 4. Bind staging buffer memory
-        vk_check("vkBindBufferMemory", vkBindBufferMemory(dr.device, stagingBuffer, stagingBufferMemory, 0));
-
-        // 5. Record and execute copy commands
-        VkCommandBuffer commandBuffer = begin_single_time_commands();
-
-        auto aspect_mask = image_get_aspect_mask(image_ptr);
-
-        auto& current_layout = image_ptr->current_layouts[mip];
-        auto originalLayout = current_layout;
-        auto transferLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-
-        VkImageMemoryBarrier copyBarrier{};
-        copyBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        copyBarrier.oldLayout = current_layout;
-        copyBarrier.newLayout = transferLayout;
-        copyBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-        copyBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-        copyBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        copyBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        copyBarrier.image = image_ptr->image;
-        copyBarrier.subresourceRange.aspectMask = aspect_mask;
-        copyBarrier.subresourceRange.baseMipLevel = mip;
-        copyBarrier.subresourceRange.levelCount = 1;
-        copyBarrier.subresourceRange.baseArrayLayer = 0;
-        copyBarrier.subresourceRange.layerCount = 1;
-
-        vkCmdPipelineBarrier(
-            commandBuffer,
-            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-            VK_PIPELINE_STAGE_TRANSFER_BIT,
-            0,
-            0, nullptr,
-            0, nullptr,
-            1, &copyBarrier
-        );
-
-        current_layout = transferLayout;
-
-        transferLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-
-        copyBarrier.oldLayout = current_layout;
-        copyBarrier.newLayout = transferLayout;
-        copyBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-        copyBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-        copyBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        copyBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        copyBarrier.image = image_ptr->image;
-        copyBarrier.subresourceRange.aspectMask = aspect_mask;
-        copyBarrier.subresourceRange.baseMipLevel = mip;
-        copyBarrier.subresourceRange.levelCount = 1;
-        copyBarrier.subresourceRange.baseArrayLayer = 0;
-        copyBarrier.subresourceRange.layerCount = 1;
-
-        vkCmdPipelineBarrier(
-            commandBuffer,
-            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-            VK_PIPELINE_STAGE_TRANSFER_BIT,
-            0,
-            0, nullptr,
-            0, nullptr,
-            1, &copyBarrier
-        );
-
-        current_layout = transferLayout;
-
-        // Setup the copy region for base mip level, all array layers
-        VkBufferImageCopy region{};
-        region.bufferOffset = 0;
-        region.bufferRowLength = 0;   // 0 indicates tightly packed
-        region.bufferImageHeight = 0; // 0 indicates tightly packed
-        region.imageSubresource.aspectMask = aspect_mask;
-        region.imageSubresource.mipLevel = mip;
-        region.imageSubresource.baseArrayLayer = 0;
-        region.imageSubresource.layerCount = 1;
-        region.imageOffset = {0, 0, 0};
-
-        uint32_t mip_width  = std::max(1u, image_ptr->width >> mip);
-        uint32_t mip_height = std::max(1u, image_ptr->height >> mip);
-        uint32_t mip_depth = std::max(1u, image_ptr->depth >> mip);
-        region.imageExtent = {mip_width, mip_height, mip_depth};
-
-        vkCmdCopyImageToBuffer(commandBuffer, image_ptr->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                                stagingBuffer, 1, &region);
-
-                                
-        end_single_time_commands(commandBuffer);
-        commandBuffer = VK_NULL_HANDLE;
-
-        transition_image_layout(image_ptr, originalLayout, mip);
-        
-        void* mappedMemory = nullptr;
-        vk_check("vkMapMemory", vkMapMemory(dr.device, stagingBufferMemory, 0, bufferSize, 0, &mappedMemory));
-
-        memcpy(imageData, mappedMemory, bufferSize);
-
-        vkUnmapMemory(dr.device, stagingBufferMemory);
-        vkFreeMemory(dr.device, stagingBufferMemory, 0);
-        vkDestroyBuffer(dr.device, stagingBuffer, 0);
-        mappedMemory = nullptr;
-        return imageData;
+        void* image_data = nullptr;
+        image_get_data_async(image_ptr, mip, [&](void* data, size_t size) {
+            image_data = allocator_large_alloc(size);
+            memcpy(image_data, data, size);
+        });
+        transfer_wait_idle();
+        return image_data;
     }
     void image_free_copied_data(void* ptr)
     {
-        free(ptr);
+        allocator_large_free(ptr);
     }
 }
\ No newline at end of file
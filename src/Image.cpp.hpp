@@ -16,7 +16,7 @@ namespace dz {
         VkImage image = VK_NULL_HANDLE;
         // VkImageView imageView = VK_NULL_HANDLE;
         VkBuffer buffer = VK_NULL_HANDLE;
-        VkDeviceMemory memory = VK_NULL_HANDLE;
+        GPUAllocation allocation;
         VkSampler sampler = VK_NULL_HANDLE;
         std::vector<VkImageLayout> current_layouts;
         VkSampleCountFlagBits multisampling;
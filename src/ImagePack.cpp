@@ -92,7 +92,7 @@ void dz::ImagePack::repack()
 			auto& atlas_buffer_size = atlas_buffer_sizes[mip];
 			auto& atlas_buffer = atlas_buffers[mip];
 			if (atlas_buffer_size != byte_size) {
-				auto new_buffer = std::shared_ptr<void>(malloc(byte_size), free);
+				auto new_buffer = allocator_make_shared_buffer<void>(byte_size, false);
 				if (atlas_buffer) {
 					memcpy(new_buffer.get(), atlas_buffer.get(), (std::min)(atlas_buffer_size, byte_size));
 				}
@@ -1,42 +1,133 @@
 #include <dz/Loaders/Assimp_Loader.hpp>
 #include "../Assimp/Assimp.hpp"
 #include <dz/Loaders/STB_Image_Loader.hpp>
+#include <dz/ThreadPool.hpp>
 #include "../Image.cpp.hpp"
+#include <dz/Hash.hpp>
+#include <dz/AssetPack.hpp>
+#include <dz/Allocator.hpp>
 #include <iostream>
+#include <fstream>
+#include <cstring>
 #include <unordered_map>
+#include <algorithm>
+
+// channel counts STB_Image_Loader decodes to on the current device, see STB_Image_Loader.cpp
+int STB_Image_minChannelsu();
+int STB_Image_minChannelsf();
 
 namespace dz::loaders::assimp_loader {
-    Assimp::Importer importer;
+    /**
+    * @brief Forwards the importer's parse progress to Assimp_Info::progress_function
+    */
+    struct AssimpParseProgress : Assimp::ProgressHandler {
+        const ProgressFunction* progress_function = nullptr;
+        bool cancelled = false;
+        bool Update(float percentage) override {
+            if (!progress_function || !*progress_function)
+                return true;
+            if (!(*progress_function)(Assimp_Stage::Parse, (std::clamp)(percentage, 0.f, 1.f)))
+                cancelled = true;
+            return !cancelled;
+        }
+    };
+
+    /**
+    * @brief A material with its textures decoded and ready to create Images from
+    */
+    struct CookedMaterial {
+        std::string name;
+        TColor albedo_color = TColor(0.0, 0.0, 0.0, 0.0);
+        TMetalness metalness = 0;
+        TRoughness roughness = 0;
+        std::vector<ImageCreateInfo> textures; // surfaceType set, datas[0] holds the pixels
+    };
+
+    struct CookedNode {
+        std::string name;
+        TPosition position;
+        TRotation rotation;
+        TScale scale;
+        std::vector<uint32_t> mesh_indexes;
+        uint32_t child_count = 0;
+    };
+
+    /**
+    * @brief Everything needed to commit an imported scene, either built from Assimp or read back from a cooked file
+    */
+    struct CookedModel {
+        std::string scene_name;
+        std::vector<CookedMaterial> materials;
+        std::vector<Assimp_Mesh> meshes; // material_index refers to materials
+        std::vector<CookedNode> nodes; // depth first, each followed by its children
+        std::shared_ptr<const FileMapping> mapping; // cooked file the texture datas point into, if read from one
+    };
+
     struct AssimpContext {
+        // one importer per load so imports do not share (and free) each others scenes
+        Assimp::Importer importer;
+        AssimpParseProgress* parse_progress = nullptr;
         const aiScene* scene_ptr = 0;
         size_t totalNodes = 0;
-        std::unordered_map<uint32_t, MeshPair> mesh_index_pair_map;
+        CookedModel model;
+        std::unordered_map<uint32_t, STB_Image_Future> embedded_image_futures;
+        std::vector<std::vector<uint32_t>> material_embedded_images; // compressed embedded images each material references
+        std::unordered_map<uint32_t, uint32_t> embedded_image_last_material; // highest material index referencing each embedded image
+
+        AssimpContext() {
+            // the importer owns and deletes the handler
+            parse_progress = new AssimpParseProgress;
+            importer.SetProgressHandler(parse_progress);
+        }
+
+        ~AssimpContext() {
+            // decodes read straight out of the importer's scene, drop the ones still queued and let running ones finish before it is freed
+            for (auto& [_, future] : embedded_image_futures) {
+                if (STB_Image_Loader::Cancel(future))
+                    continue;
+                try {
+                    STB_Image_Loader::Wait(future);
+                }
+                catch (...) { }
+            }
+        }
     };
 
+    void ReportProgress(const Assimp_Info& info, Assimp_Stage stage, float progress) {
+        if (info.progress_function && !info.progress_function(stage, progress))
+            throw Assimp_Cancelled("Assimp import was cancelled");
+    }
+
     #define ASSIMP_FLAGS aiProcess_Triangulate | aiProcessPreset_TargetRealtime_Fast | aiProcess_FlipUVs | aiProcess_CalcTangentSpace | aiProcess_ConvertToLeftHanded
 
     void InitContext(AssimpContext& context, const Assimp_Info& info) {
-        if (!info.path.empty()) {
-            auto info_path_string = info.path.string();
-            const aiScene *scene_ptr = importer.ReadFile(info_path_string.c_str(), ASSIMP_FLAGS);
-            if (!scene_ptr || scene_ptr->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene_ptr->mRootNode)
-            {
-                std::cerr << importer.GetErrorString() << std::endl;
-                return;
-            }
-            context.scene_ptr = scene_ptr;
+        auto& importer = context.importer;
+        context.parse_progress->progress_function = &info.progress_function;
+        const aiScene *scene_ptr = nullptr;
+        if (info.mapping && info.mapping->size) {
+            std::string hint;
+            if (info.path.has_extension())
+                hint = info.path.extension().string().substr(1);
+            scene_ptr = importer.ReadFileFromMemory(info.mapping->data, info.mapping->size, ASSIMP_FLAGS, hint.c_str());
         }
-        else if (info.bytes && info.bytes_length) {
-            const aiScene *scene_ptr = importer.ReadFileFromMemory(info.bytes.get(), info.bytes_length, ASSIMP_FLAGS, nullptr);
-            if (!scene_ptr || scene_ptr->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene_ptr->mRootNode)
-            {
-                std::cerr << importer.GetErrorString() << std::endl;
-                return;
-            }
-            context.scene_ptr = scene_ptr;
+        else if (!info.path.empty()) {
+            auto info_path_string = info.path.string();
+            scene_ptr = importer.ReadFile(info_path_string.c_str(), ASSIMP_FLAGS);
         }
+        else if (info.bytes && info.bytes_length)
+            scene_ptr = importer.ReadFileFromMemory(info.bytes.get(), info.bytes_length, ASSIMP_FLAGS, nullptr);
         else
             throw std::runtime_error("Neither bytes nor path were provided to info!");
+        context.parse_progress->progress_function = nullptr;
+        if (context.parse_progress->cancelled)
+            throw Assimp_Cancelled("Assimp import was cancelled");
+        if (!scene_ptr || scene_ptr->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene_ptr->mRootNode)
+        {
+            std::cerr << importer.GetErrorString() << std::endl;
+            throw std::runtime_error("Failed to import scene!");
+        }
+        context.scene_ptr = scene_ptr;
+        ReportProgress(info, Assimp_Stage::Parse, 1.f);
     }
 
     void CountNodes(AssimpContext& context, aiNode* node) {
@@ -47,6 +138,50 @@ namespace dz::loaders::assimp_loader {
         }
     }
 
+    /**
+    * @brief Lists the compressed embedded textures each material references and the last material using each of them
+    */
+    void IndexEmbeddedImages(AssimpContext& context) {
+        auto aiscene = context.scene_ptr;
+        context.material_embedded_images.resize(aiscene->mNumMaterials);
+        for (uint32_t material_index = 0; material_index < aiscene->mNumMaterials; material_index++) {
+            auto material = aiscene->mMaterials[material_index];
+            auto& images = context.material_embedded_images[material_index];
+            for (int type = aiTextureType_NONE + 1; type <= AI_TEXTURE_TYPE_MAX; type++) {
+                auto count = material->GetTextureCount(aiTextureType(type));
+                for (uint32_t i = 0; i < count; i++) {
+                    aiString str;
+                    material->GetTexture(aiTextureType(type), i, &str);
+                    if (str.data[0] != '*')
+                        continue;
+                    uint32_t imageIndex = atoi(&str.data[1]);
+                    if (imageIndex >= aiscene->mNumTextures || aiscene->mTextures[imageIndex]->mHeight != 0)
+                        continue;
+                    if (std::find(images.begin(), images.end(), imageIndex) == images.end())
+                        images.push_back(imageIndex);
+                    context.embedded_image_last_material[imageIndex] = material_index;
+                }
+            }
+        }
+    }
+
+    /**
+    * @brief Queues the embedded textures of a material that are not queued yet for decoding on the loader pool
+    */
+    void PrefetchMaterialImages(AssimpContext& context, uint32_t material_index) {
+        if (material_index >= context.material_embedded_images.size())
+            return;
+        for (auto imageIndex : context.material_embedded_images[material_index]) {
+            if (context.embedded_image_futures.count(imageIndex))
+                continue;
+            aiTexture *aiTex = context.scene_ptr->mTextures[imageIndex];
+            context.embedded_image_futures[imageIndex] = STB_Image_Loader::LoadAsync({
+                .bytes = std::shared_ptr<char>((char*)aiTex->pcData, [](auto p) {}),
+                .bytes_length = aiTex->mWidth
+            });
+        }
+    }
+
     bool IsCombinedImage(
         const aiScene* aiscene,
         aiMaterial* material,
@@ -71,20 +206,19 @@ namespace dz::loaders::assimp_loader {
         return (has_x && has_y && x_index == y_index);
     }
 
-    std::vector<Image*> LoadMaterialImages(
-        const aiScene *aiscene,
+    std::vector<ImageCreateInfo> LoadMaterialTextures(
+        AssimpContext& context,
         aiMaterial *material,
         const aiTextureType &type,
         SurfaceType surfaceType
     )
     {
-        std::vector<Image*> images;
+        auto aiscene = context.scene_ptr;
+        std::vector<ImageCreateInfo> textures;
         for (uint32_t i = 0; i < material->GetTextureCount(type); i++)
         {
             aiString str;
             material->GetTexture(type, i, &str);
-            Image* image_ptr = nullptr;
-            int32_t imageWidth = 0, imageHeight = 0;
             // Check if the image is embedded
             if (str.data[0] == '*')
             {
@@ -93,11 +227,15 @@ namespace dz::loaders::assimp_loader {
                 if (aiTex->mHeight == 0)
                 {
                     // The embedded image is compressed (e.g., PNG or JPG in memory)
-                    image_ptr = STB_Image_Loader::Load({
-                        .bytes = std::shared_ptr<char>((char*)aiTex->pcData, [](auto p) {}),
-                        .bytes_length = aiTex->mWidth
-                    });
-                    image_ptr->surfaceType = surfaceType;
+                    auto future_it = context.embedded_image_futures.find(imageIndex);
+                    if (future_it == context.embedded_image_futures.end())
+                        future_it = context.embedded_image_futures.emplace(imageIndex, STB_Image_Loader::LoadAsync({
+                            .bytes = std::shared_ptr<char>((char*)aiTex->pcData, [](auto p) {}),
+                            .bytes_length = aiTex->mWidth
+                        })).first;
+                    auto texture = STB_Image_Loader::GetCreateInfo(future_it->second);
+                    texture.surfaceType = surfaceType;
+                    textures.push_back(std::move(texture));
                 }
                 else
                 {
@@ -110,199 +248,621 @@ namespace dz::loaders::assimp_loader {
                 // External image
                 throw std::runtime_error("A image is an external image, we currently only support compressed embedded images such as PNG or JPG");
             }
-            images.push_back(image_ptr);
         }
-        return images;
+        return textures;
     }
 
-    void AddNode(AssimpContext& context, const Assimp_Info& info, aiNode* node, size_t parent_id) {
-	    mat<float, 4, 4> transformation = AssimpConvert<aiMatrix4x4, mat<float, 4, 4>>(node->mTransformation);
-        vec<float, 4> position;
-        quat<float> rotation_quat;
-        vec<float, 4> scale;
-        transformation.decompose(position, rotation_quat, scale);
-        auto rotation = quat_to_euler_xyz(rotation_quat);
-        std::vector<int> mesh_indexes;
-        for (uint32_t i = 0; i < node->mNumMeshes; i++)
+    void CookMaterial(AssimpContext& context, uint32_t material_index, CookedMaterial& cooked) {
+        aiMaterial *material = context.scene_ptr->mMaterials[material_index];
+        auto& textures = cooked.textures;
+        auto append = [&](std::vector<ImageCreateInfo>&& maps) {
+            for (auto& texture : maps)
+                textures.push_back(std::move(texture));
+        };
+        cooked.name = material->GetName().C_Str();
+        // Load base color (albedo) image
+        append(LoadMaterialTextures(context, material, aiTextureType_BASE_COLOR, SurfaceType::BaseColor));
+        // Load diffuse images
+        if (textures.empty())
+            append(LoadMaterialTextures(context, material, aiTextureType_DIFFUSE, SurfaceType::Diffuse));
+        // Load specular textures
+        append(LoadMaterialTextures(context, material, aiTextureType_SPECULAR, SurfaceType::Specular));
+        // Load normal maps
+        append(LoadMaterialTextures(context, material, aiTextureType_NORMALS, SurfaceType::Normal));
+        // Load height maps
+        append(LoadMaterialTextures(context, material, aiTextureType_HEIGHT, SurfaceType::Height));
+        // Load ambient occlusion maps
+        append(LoadMaterialTextures(context, material, aiTextureType_AMBIENT_OCCLUSION, SurfaceType::AmbientOcclusion));
+        bool is_combined_metal_rough = IsCombinedImage(context.scene_ptr, material, aiTextureType_DIFFUSE_ROUGHNESS, aiTextureType_METALNESS);
+        if (is_combined_metal_rough) {
+            // Load MetalnessRoughness maps
+            append(LoadMaterialTextures(context, material, aiTextureType_DIFFUSE_ROUGHNESS, SurfaceType::MetalnessRoughness));
+        }
+        else {
+            // Load Roughness maps
+            append(LoadMaterialTextures(context, material, aiTextureType_DIFFUSE_ROUGHNESS, SurfaceType::DiffuseRoughness));
+            // Load Metal maps
+            append(LoadMaterialTextures(context, material, aiTextureType_METALNESS, SurfaceType::Metalness));
+        }
+        // Load Shininess maps
+        append(LoadMaterialTextures(context, material, aiTextureType_SHININESS, SurfaceType::Shininess));
+        // Load Albedo Color
+        aiColor4D aicolor;
+        if (AI_SUCCESS == aiGetMaterialColor(material, AI_MATKEY_COLOR_DIFFUSE, &aicolor))
         {
-            uint32_t aiMeshIndex = node->mMeshes[i];
-            auto pair_it = context.mesh_index_pair_map.find(aiMeshIndex);
-            if (pair_it != context.mesh_index_pair_map.end()) {
-                mesh_indexes.push_back(pair_it->second.second);
-            }
-            auto& ai_mesh = context.scene_ptr->mMeshes[aiMeshIndex];
-            vec<float, 4> albedo_color;
-            // image data
-            std::vector<Image*> images_vec;
-            MaterialPair material_pair(0, -1);
-            if (ai_mesh->mMaterialIndex >= 0)
-            {
-                aiMaterial *material = context.scene_ptr->mMaterials[ai_mesh->mMaterialIndex];
-                std::string material_name(material->GetName().C_Str());
-                // Load base color (albedo) image
-                {
-                std::vector<Image*> baseColorMaps = LoadMaterialImages(context.scene_ptr, material, aiTextureType_BASE_COLOR, SurfaceType::BaseColor);
-                auto count = 0;
-                for (auto& image_ptr : baseColorMaps) {
-                    images_vec.push_back(image_ptr);
-                }
-                }
-                // Load diffuse images
-                {
-                std::vector<Image*> diffuseMaps;
-                if (images_vec.empty())
-                {
-                    diffuseMaps = LoadMaterialImages(context.scene_ptr, material, aiTextureType_DIFFUSE, SurfaceType::Diffuse);
-                    auto count = 0;
-                    for (auto& image_ptr : diffuseMaps) {
-                        images_vec.push_back(image_ptr);
-                    }
-                }
-                }
-                // Load specular textures
-                {
-                auto specularMaps = LoadMaterialImages(context.scene_ptr, material, aiTextureType_SPECULAR, SurfaceType::Specular);
-                auto count = 0;
-                for (auto& image_ptr : specularMaps) {
-                    images_vec.push_back(image_ptr);
-                }
-                }
-                // Load normal maps
-                {
-                auto normalMaps = LoadMaterialImages(context.scene_ptr, material, aiTextureType_NORMALS, SurfaceType::Normal);
-                auto count = 0;
-                for (auto& image_ptr : normalMaps) {
-                    images_vec.push_back(image_ptr);
-                }
-                }
-                // Load height maps
-                {
-                auto heightMaps = LoadMaterialImages(context.scene_ptr, material, aiTextureType_HEIGHT, SurfaceType::Height);
-                auto count = 0;
-                for (auto& image_ptr : heightMaps) {
-                    images_vec.push_back(image_ptr);
-                }
-                }
-                // Load ambient occlusion maps
-                {
-                auto aoMaps = LoadMaterialImages(context.scene_ptr, material, aiTextureType_AMBIENT_OCCLUSION, SurfaceType::AmbientOcclusion);
-                auto count = 0;
-                for (auto& image_ptr : aoMaps) {
-                    images_vec.push_back(image_ptr);
-                }
-                }
-                bool is_combined_metal_rough = IsCombinedImage(context.scene_ptr, material, aiTextureType_DIFFUSE_ROUGHNESS, aiTextureType_METALNESS);
-                if (is_combined_metal_rough) {
-                    // Load MetalnessRoughness maps
-                    {
-                    auto metalnessRoughnessMaps = LoadMaterialImages(context.scene_ptr, material, aiTextureType_DIFFUSE_ROUGHNESS, SurfaceType::MetalnessRoughness);
-                    auto count = 0;
-                    for (auto& image_ptr : metalnessRoughnessMaps) {
-                        images_vec.push_back(image_ptr);
-                    }
-                    }
+            cooked.albedo_color = AssimpConvert<aiColor4D, vec<float, 4>>(aicolor);
+        }
+        if (AI_SUCCESS == aiGetMaterialFloat(material, AI_MATKEY_METALLIC_FACTOR, &cooked.metalness)) { }
+        if (AI_SUCCESS == aiGetMaterialFloat(material, AI_MATKEY_ROUGHNESS_FACTOR, &cooked.roughness)) { }
+    }
+
+    /**
+    * @brief Builds the de-indexed vertex streams of a single mesh, only reads the scene so it may run on any thread
+    */
+    void BuildMesh(const aiMesh* ai_mesh, Assimp_Mesh& mesh) {
+        mesh.name = ai_mesh->mName.C_Str();
+        mesh.material_index = ai_mesh->mMaterialIndex;
+
+        auto vertex_count = size_t(ai_mesh->mNumFaces) * 3;
+        auto has_uv2s = ai_mesh->HasTextureCoords(0);
+        auto has_normals = ai_mesh->HasNormals();
+        auto has_tangents = ai_mesh->HasTangentsAndBitangents();
+
+        mesh.positions.resize(vertex_count);
+        if (has_uv2s)
+            mesh.uv2s.resize(vertex_count);
+        if (has_normals)
+            mesh.normals.resize(vertex_count);
+        if (has_tangents) {
+            mesh.tangents.resize(vertex_count);
+            mesh.bitangents.resize(vertex_count);
+        }
+
+        size_t vertex_index = 0;
+        for (uint32_t fi = 0; fi < ai_mesh->mNumFaces; ++fi) {
+            auto& face = ai_mesh->mFaces[fi];
+            if (face.mNumIndices != 3)
+                throw std::runtime_error("expected number of indices in face to equal 3");
+            for (uint32_t corner = 0; corner < 3; ++corner, ++vertex_index) {
+                auto i_c = face.mIndices[corner];
+                mesh.positions[vertex_index] = AssimpConvert<aiVector3D, vec<float, 4>>(ai_mesh->mVertices[i_c]);
+                if (has_uv2s)
+                    mesh.uv2s[vertex_index] = AssimpConvert<aiVector3D, vec<float, 2>>(ai_mesh->mTextureCoords[0][i_c]);
+                if (has_normals)
+                    mesh.normals[vertex_index] = AssimpConvert<aiVector3D, vec<float, 4>>(ai_mesh->mNormals[i_c]);
+                if (has_tangents) {
+                    mesh.tangents[vertex_index] = AssimpConvert<aiVector3D, vec<float, 4>>(ai_mesh->mTangents[i_c]);
+                    mesh.bitangents[vertex_index] = AssimpConvert<aiVector3D, vec<float, 4>>(ai_mesh->mBitangents[i_c]);
                 }
-                else {
-                    // Load Roughness maps
-                    {
-                    auto roughnessMaps = LoadMaterialImages(context.scene_ptr, material, aiTextureType_DIFFUSE_ROUGHNESS, SurfaceType::DiffuseRoughness);
-                    auto count = 0;
-                    for (auto& image_ptr : roughnessMaps) {
-                        images_vec.push_back(image_ptr);
-                    }
-                    }
-                    // Load Metal maps
-                    {
-                    auto metalMaps = LoadMaterialImages(context.scene_ptr, material, aiTextureType_METALNESS, SurfaceType::Metalness);
-                    auto count = 0;
-                    for (auto& image_ptr : metalMaps) {
-                        images_vec.push_back(image_ptr);
-                    }
+            }
+        }
+    }
+
+    /**
+    * @brief Builds every mesh across the loader pool, in chunks so progress and cancellation are handled on the loading thread
+    */
+    void BuildMeshes(AssimpContext& context, const Assimp_Info& info) {
+        auto aiscene = context.scene_ptr;
+        auto mesh_count = size_t(aiscene->mNumMeshes);
+        auto& meshes = context.model.meshes;
+        meshes.resize(mesh_count);
+        auto pool = thread_pool_default();
+        auto chunk_size = (std::max)(size_t(1), (thread_pool_get_thread_count(pool) + 1) * 2);
+        ReportProgress(info, Assimp_Stage::Build, 0.f);
+        for (size_t chunk_start = 0; chunk_start < mesh_count; chunk_start += chunk_size) {
+            auto chunk_count = (std::min)(chunk_size, mesh_count - chunk_start);
+            thread_pool_parallel_for(pool, chunk_count, [&](size_t index) {
+                auto mesh_index = chunk_start + index;
+                BuildMesh(aiscene->mMeshes[mesh_index], meshes[mesh_index]);
+            });
+            ReportProgress(info, Assimp_Stage::Build, float(chunk_start + chunk_count) / float(mesh_count));
+        }
+    }
+
+    /**
+    * @brief Sizes the cooked materials and drops mesh references to materials the scene does not have
+    */
+    void PrepareMaterials(AssimpContext& context) {
+        auto& materials = context.model.materials;
+        materials.resize(context.scene_ptr->mNumMaterials);
+        for (auto& mesh : context.model.meshes)
+            if (mesh.material_index >= int(materials.size()))
+                mesh.material_index = -1;
+    }
+
+    /**
+    * @brief Drops the futures of embedded images no material after material_index references, their pixels then live only in the cooked textures
+    */
+    void ReleaseEmbeddedImages(AssimpContext& context, uint32_t material_index) {
+        if (material_index >= context.material_embedded_images.size())
+            return;
+        for (auto imageIndex : context.material_embedded_images[material_index])
+            if (context.embedded_image_last_material[imageIndex] == material_index)
+                context.embedded_image_futures.erase(imageIndex);
+    }
+
+    /**
+    * @brief Cooks one material, queueing the next material's textures first and releasing this material's once cooked
+    *
+    * @note materials must be cooked in order, so at most two materials' textures are queued or decoded at once
+    */
+    void CookMaterialInOrder(AssimpContext& context, const Assimp_Info& info, uint32_t material_index, CookedMaterial& cooked) {
+        PrefetchMaterialImages(context, material_index);
+        PrefetchMaterialImages(context, material_index + 1);
+        CookMaterial(context, material_index, cooked);
+        ReleaseEmbeddedImages(context, material_index);
+        ReportProgress(info, Assimp_Stage::Decode, float(material_index + 1) / float(context.model.materials.size()));
+    }
+
+    /**
+    * @brief Cooks the materials in order, see CookMaterialInOrder
+    */
+    void CookMaterials(AssimpContext& context, const Assimp_Info& info) {
+        auto& materials = context.model.materials;
+        ReportProgress(info, Assimp_Stage::Decode, 0.f);
+        for (uint32_t material_index = 0; material_index < materials.size(); material_index++)
+            CookMaterialInOrder(context, info, material_index, materials[material_index]);
+    }
+
+    void CookNode(AssimpContext& context, aiNode* node) {
+        auto& nodes = context.model.nodes;
+        auto node_index = nodes.size();
+        nodes.emplace_back();
+        {
+            auto& cooked = nodes.back();
+            mat<float, 4, 4> transformation = AssimpConvert<aiMatrix4x4, mat<float, 4, 4>>(node->mTransformation);
+            vec<float, 4> position;
+            quat<float> rotation_quat;
+            vec<float, 4> scale;
+            transformation.decompose(position, rotation_quat, scale);
+            cooked.name = node->mName.C_Str();
+            cooked.position = position;
+            cooked.rotation = quat_to_euler_xyz(rotation_quat);
+            cooked.scale = scale;
+            cooked.mesh_indexes.assign(node->mMeshes, node->mMeshes + node->mNumMeshes);
+            cooked.child_count = node->mNumChildren;
+        }
+        for (uint32_t i = 0; i < node->mNumChildren; i++)
+            CookNode(context, node->mChildren[i]);
+    }
+
+    /**
+    * @brief Runs the parse independent stages of an import, leaving a CookedModel ready to commit or write out
+    *
+    * @param cook_materials false leaves the materials sized but empty, for a writer that cooks and frees them one at a time
+    */
+    void CookScene(AssimpContext& context, const Assimp_Info& info, bool cook_materials = true) {
+        CountNodes(context, context.scene_ptr->mRootNode);
+        IndexEmbeddedImages(context);
+        // the first material's textures decode while the meshes are built
+        PrefetchMaterialImages(context, 0);
+        BuildMeshes(context, info);
+        PrepareMaterials(context);
+        if (cook_materials)
+            CookMaterials(context, info);
+        context.model.scene_name = context.scene_ptr->mName.C_Str();
+        context.model.nodes.reserve(context.totalNodes);
+        CookNode(context, context.scene_ptr->mRootNode);
+    }
+
+    #define DZ_COOKED_MODEL_MAGIC "DZMODEL"
+    #define DZ_COOKED_MODEL_VERSION 2
+    #define DZ_COOKED_MODEL_ALIGNMENT 16
+
+    struct CookedModelHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved;
+        uint64_t source_hash;
+        uint32_t material_count;
+        uint32_t mesh_count;
+        uint32_t node_count;
+        uint32_t reserved2;
+    };
+
+    struct CookedModelWriter {
+        std::ofstream& stream;
+        uint64_t offset = 0;
+        void write(const void* data, size_t size) {
+            stream.write((const char*)data, size);
+            offset += size;
+        }
+        template<typename T>
+        void write(const T& value) {
+            write(&value, sizeof(T));
+        }
+        void write_string(const std::string& value) {
+            write(uint32_t(value.size()));
+            write(value.data(), value.size());
+        }
+        // bulk data is aligned so it can be copied straight out of a mapping
+        void align() {
+            static const char zeros[DZ_COOKED_MODEL_ALIGNMENT] = {};
+            auto padding = (DZ_COOKED_MODEL_ALIGNMENT - offset % DZ_COOKED_MODEL_ALIGNMENT) % DZ_COOKED_MODEL_ALIGNMENT;
+            write(zeros, padding);
+        }
+        template<typename T>
+        void write_vector(const std::vector<T>& values) {
+            write(uint64_t(values.size()));
+            align();
+            write(values.data(), values.size() * sizeof(T));
+        }
+    };
+
+    struct CookedModelReader {
+        const char* data;
+        size_t size;
+        size_t offset = 0;
+        const char* read(size_t length) {
+            if (length > size - offset)
+                throw std::runtime_error("Cooked model is truncated!");
+            auto result = data + offset;
+            offset += length;
+            return result;
+        }
+        template<typename T>
+        T read() {
+            T value;
+            memcpy(&value, read(sizeof(T)), sizeof(T));
+            return value;
+        }
+        std::string read_string() {
+            auto length = read<uint32_t>();
+            return std::string(read(length), length);
+        }
+        void align() {
+            read((DZ_COOKED_MODEL_ALIGNMENT - offset % DZ_COOKED_MODEL_ALIGNMENT) % DZ_COOKED_MODEL_ALIGNMENT);
+        }
+        template<typename T>
+        void read_vector(std::vector<T>& values) {
+            auto count = read<uint64_t>();
+            align();
+            if (count > (size - offset) / sizeof(T))
+                throw std::runtime_error("Cooked model is truncated!");
+            values.resize(count);
+            memcpy(values.data(), read(count * sizeof(T)), count * sizeof(T));
+        }
+    };
+
+    /**
+    * @brief How texture payloads are stored, compressed ones go through the AssetPack block codec
+    */
+    struct CookedTextureEncoding {
+        AssetCompression compression = AssetCompression::None;
+        int level = -1;
+        uint32_t block_size = DZ_ASSET_BLOCK_SIZE;
+    };
+
+    using CookMaterialFunction = std::function<void(uint32_t, CookedMaterial&)>;
+
+    /**
+    * @brief Writes model as a cooked file, replacing out_path once complete
+    *
+    * @param cook_material when set, called to fill each material right before it is written, its textures are freed once written
+    */
+    void WriteCookedModel(CookedModel& model, uint64_t source_hash, const std::filesystem::path& out_path, const CookedTextureEncoding& encoding = {}, const CookMaterialFunction& cook_material = {}) {
+        if (out_path.has_parent_path())
+            std::filesystem::create_directories(out_path.parent_path());
+        // written beside the destination and renamed so a reader never maps a partial file
+        auto temp_path = out_path;
+        temp_path += ".tmp";
+        {
+            std::ofstream stream(temp_path, std::ios::binary | std::ios::trunc);
+            if (!stream)
+                throw std::runtime_error("Failed to open cooked model for writing: " + temp_path.string());
+            CookedModelWriter writer{stream};
+            CookedModelHeader header{};
+            memcpy(header.magic, DZ_COOKED_MODEL_MAGIC, sizeof(DZ_COOKED_MODEL_MAGIC));
+            header.version = DZ_COOKED_MODEL_VERSION;
+            header.source_hash = source_hash;
+            header.material_count = model.materials.size();
+            header.mesh_count = model.meshes.size();
+            header.node_count = model.nodes.size();
+            writer.write(header);
+            writer.write_string(model.scene_name);
+            for (uint32_t material_index = 0; material_index < model.materials.size(); material_index++) {
+                auto& material = model.materials[material_index];
+                if (cook_material)
+                    cook_material(material_index, material);
+                writer.write_string(material.name);
+                writer.write(material.albedo_color);
+                writer.write(material.metalness);
+                writer.write(material.roughness);
+                writer.write(uint32_t(material.textures.size()));
+                for (auto& texture : material.textures) {
+                    auto byte_size = format_get_mip_byte_size(texture.format, texture.width, texture.height, texture.depth);
+                    auto pixels = (const char*)texture.datas[0].get();
+                    // a payload compression does not shrink is kept raw so it can still be uploaded straight from the mapping
+                    std::string encoded;
+                    if (encoding.compression != AssetCompression::None) {
+                        encoded = encode_asset_bytes(pixels, byte_size, encoding.compression, encoding.level, encoding.block_size);
+                        if (encoded.size() >= byte_size)
+                            encoded.clear();
                     }
+                    writer.write(uint32_t(texture.surfaceType));
+                    writer.write(uint32_t(texture.format));
+                    writer.write(texture.width);
+                    writer.write(texture.height);
+                    writer.write(texture.depth);
+                    writer.write(uint64_t(byte_size));
+                    writer.write(uint64_t(encoded.size()));
+                    writer.align();
+                    if (encoded.empty())
+                        writer.write(pixels, byte_size);
+                    else
+                        writer.write(encoded.data(), encoded.size());
                 }
-                // Load Shininess maps
-                {
-                auto shininessMaps = LoadMaterialImages(context.scene_ptr, material, aiTextureType_SHININESS, SurfaceType::Shininess);
-                auto count = 0;
-                for (auto& image_ptr : shininessMaps) {
-                    images_vec.push_back(image_ptr);
-                }
-                }
-                float metalness = 0, roughness = 0;
-                // Load Albedo Color
-                {
-                aiColor4D aicolor;
-                if (AI_SUCCESS == aiGetMaterialColor(material, AI_MATKEY_COLOR_DIFFUSE, &aicolor))
-                {
-                    albedo_color = AssimpConvert<aiColor4D, vec<float, 4>>(aicolor);
-                }
-                if (AI_SUCCESS == aiGetMaterialFloat(material, AI_MATKEY_METALLIC_FACTOR, &metalness)) { }
-                if (AI_SUCCESS == aiGetMaterialFloat(material, AI_MATKEY_ROUGHNESS_FACTOR, &roughness)) { }
-                }
-                material_pair = info.add_material_function(material_name, images_vec, albedo_color, metalness, roughness);
+                if (cook_material)
+                    material.textures = {};
             }
-            // vertex data
-            std::vector<TPosition> positions;
-            positions.reserve(ai_mesh->mNumFaces * 3);
-
-            std::vector<TUV2> uv2s;
-            uv2s.reserve(ai_mesh->mNumFaces * 3);
-
-            std::vector<TNormal> normals;
-            normals.reserve(ai_mesh->mNumFaces * 3);
-
-            std::vector<TTangent> tangents;
-            tangents.reserve(ai_mesh->mNumFaces * 3);
-
-            std::vector<TBitangent> bitangents;
-            bitangents.reserve(ai_mesh->mNumFaces * 3);
-
-            static constexpr auto i0 = 0;
-            static constexpr auto i1 = 1;
-            static constexpr auto i2 = 2;
-            // ai_mesh->mTangents
-            for (auto fi = 0; fi < ai_mesh->mNumFaces; ++fi) {
-                auto& face = ai_mesh->mFaces[fi];
-                if (face.mNumIndices == 3) {
-                    auto i_0 = face.mIndices[i0];
-                    auto i_1 = face.mIndices[i1];
-                    auto i_2 = face.mIndices[i2];
-                    positions.push_back(AssimpConvert<aiVector3D, vec<float, 4>>(ai_mesh->mVertices[i_0]));
-                    positions.push_back(AssimpConvert<aiVector3D, vec<float, 4>>(ai_mesh->mVertices[i_1]));
-                    positions.push_back(AssimpConvert<aiVector3D, vec<float, 4>>(ai_mesh->mVertices[i_2]));
-                    uv2s.push_back(AssimpConvert<aiVector3D, vec<float, 2>>(ai_mesh->mTextureCoords[0][i_0]));
-                    uv2s.push_back(AssimpConvert<aiVector3D, vec<float, 2>>(ai_mesh->mTextureCoords[0][i_1]));
-                    uv2s.push_back(AssimpConvert<aiVector3D, vec<float, 2>>(ai_mesh->mTextureCoords[0][i_2]));
-                    normals.push_back(AssimpConvert<aiVector3D, vec<float, 4>>(ai_mesh->mNormals[i_0]));
-                    normals.push_back(AssimpConvert<aiVector3D, vec<float, 4>>(ai_mesh->mNormals[i_1]));
-                    normals.push_back(AssimpConvert<aiVector3D, vec<float, 4>>(ai_mesh->mNormals[i_2]));
-                    tangents.push_back(AssimpConvert<aiVector3D, vec<float, 4>>(ai_mesh->mTangents[i_0]));
-                    tangents.push_back(AssimpConvert<aiVector3D, vec<float, 4>>(ai_mesh->mTangents[i_1]));
-                    tangents.push_back(AssimpConvert<aiVector3D, vec<float, 4>>(ai_mesh->mTangents[i_2]));
-                    bitangents.push_back(AssimpConvert<aiVector3D, vec<float, 4>>(ai_mesh->mBitangents[i_0]));
-                    bitangents.push_back(AssimpConvert<aiVector3D, vec<float, 4>>(ai_mesh->mBitangents[i_1]));
-                    bitangents.push_back(AssimpConvert<aiVector3D, vec<float, 4>>(ai_mesh->mBitangents[i_2]));
+            for (auto& mesh : model.meshes) {
+                writer.write_string(mesh.name);
+                writer.write(int32_t(mesh.material_index));
+                writer.write_vector(mesh.positions);
+                writer.write_vector(mesh.uv2s);
+                writer.write_vector(mesh.normals);
+                writer.write_vector(mesh.tangents);
+                writer.write_vector(mesh.bitangents);
+            }
+            for (auto& node : model.nodes) {
+                writer.write_string(node.name);
+                writer.write(node.position);
+                writer.write(node.rotation);
+                writer.write(node.scale);
+                writer.write(node.child_count);
+                writer.write_vector(node.mesh_indexes);
+            }
+            if (!stream)
+                throw std::runtime_error("Failed to write cooked model: " + temp_path.string());
+        }
+        std::filesystem::rename(temp_path, out_path);
+    }
+
+    /**
+    * @brief Reads a cooked model, raw texture datas alias the mapping so they upload without another copy, compressed ones are decoded
+    *
+    * @returns false if the file is not a cooked model of the current version or was cooked from another source
+    */
+    bool ReadCookedModel(const std::shared_ptr<const FileMapping>& mapping, const uint64_t* expected_hash, CookedModel& model) {
+        CookedModelReader reader{mapping->data, mapping->size};
+        if (mapping->size < sizeof(CookedModelHeader))
+            return false;
+        auto header = reader.read<CookedModelHeader>();
+        if (memcmp(header.magic, DZ_COOKED_MODEL_MAGIC, sizeof(DZ_COOKED_MODEL_MAGIC)) != 0 ||
+            header.version != DZ_COOKED_MODEL_VERSION ||
+            (expected_hash && header.source_hash != *expected_hash))
+            return false;
+        model.mapping = mapping;
+        model.scene_name = reader.read_string();
+        model.materials.resize(header.material_count);
+        for (auto& material : model.materials) {
+            material.name = reader.read_string();
+            material.albedo_color = reader.read<TColor>();
+            material.metalness = reader.read<TMetalness>();
+            material.roughness = reader.read<TRoughness>();
+            material.textures.resize(reader.read<uint32_t>());
+            for (auto& texture : material.textures) {
+                texture.surfaceType = SurfaceType(reader.read<uint32_t>());
+                texture.format = VkFormat(reader.read<uint32_t>());
+                texture.width = reader.read<uint32_t>();
+                texture.height = reader.read<uint32_t>();
+                texture.depth = reader.read<uint32_t>();
+                auto byte_size = reader.read<uint64_t>();
+                auto stored_size = reader.read<uint64_t>();
+                reader.align();
+                if (byte_size != format_get_mip_byte_size(texture.format, texture.width, texture.height, texture.depth))
+                    throw std::runtime_error("Cooked model texture size does not match its format!");
+                if (!stored_size) {
+                    auto pixels = reader.read(byte_size);
+                    texture.datas = {std::shared_ptr<void>(std::const_pointer_cast<FileMapping>(mapping), (void*)pixels)};
+                    continue;
                 }
-                else
-			        throw std::runtime_error("expected number of indices in face to equal 3");
+                auto stored = reader.read(stored_size);
+                auto pixels = allocator_make_shared_buffer(byte_size, false);
+                if (!decode_asset_bytes(stored, stored_size, (char*)pixels.get(), byte_size))
+                    throw std::runtime_error("Cooked model texture failed to decode!");
+                texture.datas = {std::shared_ptr<void>(std::move(pixels))};
             }
-            auto mesh_pair = info.add_mesh_function(ai_mesh->mName.C_Str(), material_pair.second, positions, uv2s, normals, tangents, bitangents);
-            context.mesh_index_pair_map[aiMeshIndex] = mesh_pair;
-            mesh_indexes.push_back(mesh_pair.second);
         }
-        auto entity_id = info.add_entity_function(parent_id, node->mName.C_Str(), mesh_indexes, position, rotation, scale);
+        model.meshes.resize(header.mesh_count);
+        for (auto& mesh : model.meshes) {
+            mesh.name = reader.read_string();
+            mesh.material_index = reader.read<int32_t>();
+            reader.read_vector(mesh.positions);
+            reader.read_vector(mesh.uv2s);
+            reader.read_vector(mesh.normals);
+            reader.read_vector(mesh.tangents);
+            reader.read_vector(mesh.bitangents);
+        }
+        model.nodes.resize(header.node_count);
+        for (auto& node : model.nodes) {
+            node.name = reader.read_string();
+            node.position = reader.read<TPosition>();
+            node.rotation = reader.read<TRotation>();
+            node.scale = reader.read<TScale>();
+            node.child_count = reader.read<uint32_t>();
+            reader.read_vector(node.mesh_indexes);
+            for (auto mesh_index : node.mesh_indexes)
+                if (mesh_index >= model.meshes.size())
+                    throw std::runtime_error("Cooked model node references a missing mesh!");
+        }
+        if (model.nodes.empty())
+            throw std::runtime_error("Cooked model has no root node!");
+        return true;
     }
 
-    dz::loaders::SceneID AssimpLoad(AssimpContext& context, const Assimp_Info& info) {
-        CountNodes(context, context.scene_ptr->mRootNode);
-        auto scene_id = info.add_scene_function(info.parent_id, context.scene_ptr->mName.C_Str(), info.root_position, info.root_rotation, info.root_scale);
-        AddNode(context, info, context.scene_ptr->mRootNode, scene_id);
+    /**
+    * @brief Maps (or borrows) the source bytes of info, used to key the cooked model cache
+    */
+    std::shared_ptr<const FileMapping> SourceMapping(const Assimp_Info& info, const char*& data, size_t& size) {
+        if (info.mapping && info.mapping->size) {
+            data = info.mapping->data;
+            size = info.mapping->size;
+            return info.mapping;
+        }
+        if (!info.path.empty()) {
+            FileHandle handle{FileHandle::PATH, info.path.string()};
+            auto mapping = handle.map();
+            data = mapping ? mapping->data : nullptr;
+            size = mapping ? mapping->size : 0;
+            return mapping;
+        }
+        data = info.bytes.get();
+        size = info.bytes ? info.bytes_length : 0;
+        return nullptr;
+    }
+
+    /**
+    * @brief Keys a cooked model by its source and the texture channel counts decoded for this device
+    */
+    uint64_t CookedModelSourceHash(const char* source_data, size_t source_size) {
+        int32_t key[] = {DZ_COOKED_MODEL_VERSION, STB_Image_minChannelsu(), STB_Image_minChannelsf()};
+        return hash_bytes(source_data, source_size, hash_bytes(key, sizeof(key)));
+    }
+
+    struct CommitContext {
+        std::vector<MeshPair> mesh_pairs;
+        std::unordered_map<int, MaterialPair> material_pair_map;
+    };
+
+    /**
+    * @brief Adds a material the first time a mesh references it, later meshes reuse the same MaterialPair
+    */
+    MaterialPair CommitMaterial(CommitContext& commit, const CookedModel& model, const Assimp_Info& info, int material_index) {
+        auto pair_it = commit.material_pair_map.find(material_index);
+        if (pair_it != commit.material_pair_map.end())
+            return pair_it->second;
+        auto& material = model.materials[material_index];
+        std::vector<Image*> images_vec;
+        images_vec.reserve(material.textures.size());
+        for (auto& texture : material.textures)
+            images_vec.push_back(image_create(texture));
+        auto material_pair = info.add_material_function(material.name, images_vec, material.albedo_color, material.metalness, material.roughness);
+        commit.material_pair_map[material_index] = material_pair;
+        return material_pair;
+    }
+
+    void CommitMeshes(CommitContext& commit, CookedModel& model, const Assimp_Info& info) {
+        // resolve cooked material indexes to the added materials before the meshes are handed over
+        for (auto& mesh : model.meshes) {
+            MaterialPair material_pair(0, -1);
+            if (mesh.material_index >= 0 && mesh.material_index < int(model.materials.size()))
+                material_pair = CommitMaterial(commit, model, info, mesh.material_index);
+            mesh.material_index = material_pair.second;
+        }
+        if (info.add_meshes_function) {
+            commit.mesh_pairs = info.add_meshes_function(model.meshes);
+            if (commit.mesh_pairs.size() != model.meshes.size())
+                throw std::runtime_error("add_meshes_function must return one MeshPair per mesh");
+        }
+        else {
+            commit.mesh_pairs.reserve(model.meshes.size());
+            for (auto& mesh : model.meshes)
+                commit.mesh_pairs.push_back(info.add_mesh_function(mesh.name, mesh.material_index, mesh.positions, mesh.uv2s, mesh.normals, mesh.tangents, mesh.bitangents));
+        }
+        // the streams have been copied into the scene, release them before the nodes are added
+        model.meshes = {};
+    }
+
+    size_t CommitNode(CommitContext& commit, const CookedModel& model, const Assimp_Info& info, size_t node_index, size_t parent_id) {
+        auto& node = model.nodes[node_index];
+        std::vector<int> mesh_indexes;
+        mesh_indexes.reserve(node.mesh_indexes.size());
+        for (auto mesh_index : node.mesh_indexes)
+            mesh_indexes.push_back(commit.mesh_pairs[mesh_index].second);
+        auto entity_id = info.add_entity_function(parent_id, node.name, mesh_indexes, node.position, node.rotation, node.scale);
+        auto next_index = node_index + 1;
+        for (uint32_t i = 0; i < node.child_count; i++) {
+            if (next_index >= model.nodes.size())
+                throw std::runtime_error("Cooked model node hierarchy is truncated!");
+            next_index = CommitNode(commit, model, info, next_index, entity_id);
+        }
+        return next_index;
+    }
+
+    dz::loaders::SceneID CommitModel(CookedModel& model, const Assimp_Info& info) {
+        CommitContext commit;
+        ReportProgress(info, Assimp_Stage::Commit, 0.f);
+        auto scene_id = info.add_scene_function(info.parent_id, model.scene_name, info.root_position, info.root_rotation, info.root_scale);
+        // every texture upload made while committing goes out in one submission
+        transfer_batch_begin();
+        try {
+            CommitMeshes(commit, model, info);
+            CommitNode(commit, model, info, 0, scene_id);
+        }
+        catch (...) {
+            transfer_batch_end();
+            throw;
+        }
+        transfer_batch_end();
+        if (info.progress_function)
+            info.progress_function(Assimp_Stage::Commit, 1.f);
         return scene_id;
     }
 }
 dz::loaders::SceneID dz::loaders::Assimp_Loader::Load(const info_type& info) {
     using namespace dz::loaders::assimp_loader;
+    // a cooked model given directly skips the cache lookup and Assimp altogether
+    if (info.path.extension() == ".dzm") {
+        FileHandle handle{FileHandle::PATH, info.path.string()};
+        auto mapping = handle.map();
+        CookedModel model;
+        if (!mapping || !ReadCookedModel(mapping, nullptr, model))
+            throw std::runtime_error("Not a cooked model of the current version: " + info.path.string());
+        return CommitModel(model, info);
+    }
+    uint64_t source_hash = 0;
+    std::filesystem::path cache_path;
+    if (!info.cache_directory.empty()) {
+        const char* source_data = nullptr;
+        size_t source_size = 0;
+        auto source_mapping = SourceMapping(info, source_data, source_size);
+        if (source_data && source_size) {
+            source_hash = CookedModelSourceHash(source_data, source_size);
+            cache_path = info.cache_directory / (hash_to_string(source_hash) + ".dzm");
+            FileHandle cache_handle{FileHandle::PATH, cache_path.string()};
+            std::shared_ptr<const FileMapping> cache_mapping;
+            if (std::filesystem::exists(cache_path))
+                cache_mapping = cache_handle.map();
+            CookedModel model;
+            bool cached = false;
+            try {
+                cached = cache_mapping && ReadCookedModel(cache_mapping, &source_hash, model);
+            }
+            catch (const std::exception& e) {
+                // a damaged cache entry is cooked again below
+                std::cerr << "Ignoring cooked model " << cache_path << ": " << e.what() << std::endl;
+            }
+            if (cached)
+                return CommitModel(model, info);
+        }
+    }
+    AssimpContext context;
+    InitContext(context, info);
+    CookScene(context, info);
+    if (!cache_path.empty()) {
+        try {
+            WriteCookedModel(context.model, source_hash, cache_path);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Failed to cache cooked model " << cache_path << ": " << e.what() << std::endl;
+        }
+    }
+    return CommitModel(context.model, info);
+}
+
+void dz::loaders::Assimp_Loader::Cook(const info_type& info, const std::filesystem::path& out_path, AssetCompression compression, int level, uint32_t block_size) {
+    using namespace dz::loaders::assimp_loader;
+    const char* source_data = nullptr;
+    size_t source_size = 0;
+    auto source_mapping = SourceMapping(info, source_data, source_size);
+    auto source_hash = source_size ? CookedModelSourceHash(source_data, source_size) : 0;
     AssimpContext context;
     InitContext(context, info);
-    return AssimpLoad(context, info);
-}
\ No newline at end of file
+    // materials are queued, cooked and written one at a time, so only this material's and the next one's textures are alive
+    CookScene(context, info, false);
+    ReportProgress(info, Assimp_Stage::Decode, 0.f);
+    WriteCookedModel(context.model, source_hash, out_path, {compression, level, block_size}, [&](uint32_t material_index, CookedMaterial& material) {
+        CookMaterialInOrder(context, info, material_index, material);
+    });
+}
@@ -0,0 +1,96 @@
+#include <dz/Loaders/KTX2_Loader.hpp>
+#include <dz/Image.hpp>
+#include <cstring>
+
+namespace dz::loaders {
+    static const uint8_t KTX2_IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+    struct KTX2_Header {
+        uint8_t identifier[12];
+        uint32_t vkFormat;
+        uint32_t typeSize;
+        uint32_t pixelWidth;
+        uint32_t pixelHeight;
+        uint32_t pixelDepth;
+        uint32_t layerCount;
+        uint32_t faceCount;
+        uint32_t levelCount;
+        uint32_t supercompressionScheme;
+        uint32_t dfdByteOffset;
+        uint32_t dfdByteLength;
+        uint32_t kvdByteOffset;
+        uint32_t kvdByteLength;
+        uint64_t sgdByteOffset;
+        uint64_t sgdByteLength;
+    };
+    static_assert(sizeof(KTX2_Header) == 80, "KTX2 header must be 80 bytes");
+
+    struct KTX2_Level {
+        uint64_t byteOffset;
+        uint64_t byteLength;
+        uint64_t uncompressedByteLength;
+    };
+
+    bool KTX2_Loader::IsKTX2(const char* bytes, size_t bytes_length) {
+        return bytes && bytes_length >= sizeof(KTX2_IDENTIFIER) &&
+            memcmp(bytes, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0;
+    }
+
+    // owner keeps the source bytes alive, each mip data aliases it so no copy is made before staging
+    Image* KTX2_load_bytes(const std::shared_ptr<const void>& owner, const char* bytes, size_t bytes_length) {
+        if (!KTX2_Loader::IsKTX2(bytes, bytes_length) || bytes_length < sizeof(KTX2_Header))
+            throw std::runtime_error("Bytes are not a KTX2 file!");
+        KTX2_Header header;
+        memcpy(&header, bytes, sizeof(KTX2_Header));
+        if (header.supercompressionScheme != 0)
+            throw std::runtime_error("KTX2 supercompression is not supported!");
+        if (header.layerCount > 1 || header.faceCount != 1)
+            throw std::runtime_error("KTX2 arrays and cubemaps are not supported!");
+        if (header.vkFormat == VK_FORMAT_UNDEFINED)
+            throw std::runtime_error("KTX2 files without a Vulkan format (Basis Universal) are not supported!");
+        auto level_count = (std::max)(1u, header.levelCount);
+        if (sizeof(KTX2_Header) + level_count * sizeof(KTX2_Level) > bytes_length)
+            throw std::runtime_error("KTX2 level index is truncated!");
+
+        ImageCreateInfo info{
+            .width = header.pixelWidth,
+            .height = (std::max)(1u, header.pixelHeight),
+            .depth = (std::max)(1u, header.pixelDepth),
+            .format = VkFormat(header.vkFormat),
+            .image_type = header.pixelDepth > 1 ? VK_IMAGE_TYPE_3D : (header.pixelHeight > 0 ? VK_IMAGE_TYPE_2D : VK_IMAGE_TYPE_1D),
+            .view_type = header.pixelDepth > 1 ? VK_IMAGE_VIEW_TYPE_3D : (header.pixelHeight > 0 ? VK_IMAGE_VIEW_TYPE_2D : VK_IMAGE_VIEW_TYPE_1D),
+            .mip_levels = level_count
+        };
+        info.datas.resize(level_count);
+        for (uint32_t mip = 0; mip < level_count; mip++) {
+            KTX2_Level level;
+            memcpy(&level, bytes + sizeof(KTX2_Header) + mip * sizeof(KTX2_Level), sizeof(KTX2_Level));
+            auto expected = format_get_mip_byte_size(
+                info.format,
+                (std::max)(1u, info.width >> mip),
+                (std::max)(1u, info.height >> mip),
+                (std::max)(1u, info.depth >> mip));
+            if (expected == 0 || level.byteLength < expected)
+                throw std::runtime_error("KTX2 level is smaller than its format requires!");
+            if (level.byteOffset > bytes_length || level.byteLength > bytes_length - level.byteOffset)
+                throw std::runtime_error("KTX2 level lies outside of the file!");
+            info.datas[mip] = std::shared_ptr<void>(std::const_pointer_cast<void>(owner), (void*)(bytes + level.byteOffset));
+        }
+        return image_create(info);
+    }
+
+    Image* KTX2_Loader::Load(const KTX2_Info& info) {
+        if (info.mapping && info.mapping->size)
+            return KTX2_load_bytes(info.mapping, info.mapping->data, info.mapping->size);
+        if (!info.path.empty()) {
+            FileHandle handle{FileHandle::PATH, info.path.string()};
+            auto mapping = handle.map();
+            if (!mapping || !mapping->size)
+                throw std::runtime_error("Failed to map KTX2 file!");
+            return KTX2_load_bytes(mapping, mapping->data, mapping->size);
+        }
+        if (info.bytes && info.bytes_length)
+            return KTX2_load_bytes(info.bytes, info.bytes.get(), info.bytes_length);
+        throw std::runtime_error("Neither mapping, bytes nor path were provided to info!");
+    }
+}
@@ -4,6 +4,10 @@
 #define STB_IMAGE_STATIC
 #include <stb_image.h>
 #include "../Directz.cpp.hpp"
+#include <dz/ThreadPool.hpp>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
 
 int STB_Image_minChannelsu() {
     int minChannels = 4;
@@ -23,7 +27,7 @@ int STB_Image_minChannelsf() {
     return minChannels;
 }
 
-dz::Image* STB_Image_load_image_uf(const std::vector<std::shared_ptr<void>>& datas, int width, int height, int nrChannels, bool load_float) {
+dz::ImageCreateInfo STB_Image_create_info_uf(const std::vector<std::shared_ptr<void>>& datas, int width, int height, int nrChannels, bool load_float) {
     VkFormat format;
     switch (nrChannels) {
     case 1:
@@ -45,7 +49,11 @@ dz::Image* STB_Image_load_image_uf(const std::vector<std::shared_ptr<void>>& dat
         .format = format,
         .datas = datas
     };
-    return dz::image_create(info);
+    return info;
+}
+
+dz::Image* STB_Image_load_image_uf(const std::vector<std::shared_ptr<void>>& datas, int width, int height, int nrChannels, bool load_float) {
+    return dz::image_create(STB_Image_create_info_uf(datas, width, height, nrChannels, load_float));
 }
 
 dz::Image* STB_Image_load_pathu(const std::filesystem::path& path) {
@@ -100,7 +108,16 @@ dz::Image* STB_Image_load_bytesf(const std::shared_ptr<char>& bytes, size_t byte
     }, width, height, (std::max)(nrChannels, minChannels), true);
 }
 
+std::shared_ptr<char> STB_Image_mapping_bytes(const std::shared_ptr<const dz::FileMapping>& mapping) {
+    // aliases the mapping so the encoded bytes stay mapped for as long as they are referenced
+    return std::shared_ptr<char>(std::const_pointer_cast<dz::FileMapping>(mapping), const_cast<char*>(mapping->data));
+}
+
 dz::Image* dz::loaders::STB_Image_Loader::Load(const dz::loaders::STB_Image_Info& info) {
+    if (info.mapping && info.mapping->size)
+        return (info.load_float) ?
+            STB_Image_load_bytesf(STB_Image_mapping_bytes(info.mapping), info.mapping->size) :
+            STB_Image_load_bytesu(STB_Image_mapping_bytes(info.mapping), info.mapping->size);
     if (!info.path.empty())
         return (info.load_float) ? STB_Image_load_pathf(info.path) : STB_Image_load_pathu(info.path);
     if (info.bytes && info.bytes_length)
@@ -108,6 +125,285 @@ dz::Image* dz::loaders::STB_Image_Loader::Load(const dz::loaders::STB_Image_Info
     throw std::runtime_error("Neither bytes nor path were provided to info!");
 }
 
+struct dz::loaders::STB_Image_Request {
+    STB_Image_Info info;
+    int minChannels = 0;
+    size_t decoded_size = 0;
+    bool dispatched = false;        // guarded by the budget mutex, set once the request has its share of the budget
+    bool cancelled = false;         // guarded by the budget mutex, set when Cancel took the request out of the queue
+    std::shared_ptr<std::atomic<size_t>> budget_held = std::make_shared<std::atomic<size_t>>(0);
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool ready = false;
+    std::exception_ptr error;
+    std::shared_ptr<void> pixels;
+    int width = 0;
+    int height = 0;
+    int nrChannels = 0;
+};
+
+using STB_Image_Request_Ptr = std::shared_ptr<dz::loaders::STB_Image_Request>;
+
+struct STB_Image_Budget {
+    std::mutex mutex;
+    size_t bytes_in_flight = 0;
+    size_t max_bytes_in_flight = 512ull * 1024ull * 1024ull;
+    std::deque<STB_Image_Request_Ptr> pending;     // requests waiting for room, they never occupy a worker
+};
+
+STB_Image_Budget& STB_Image_get_budget() {
+    static STB_Image_Budget budget;
+    return budget;
+}
+
+void STB_Image_run_request(const STB_Image_Request_Ptr& request);
+
+void STB_Image_dispatch(const STB_Image_Request_Ptr& request) {
+    dz::thread_pool_enqueue(dz::thread_pool_default(), [request]() {
+        STB_Image_run_request(request);
+    });
+}
+
+/**
+ * @brief Charges the request's decoded size to the budget, called with the budget mutex held
+ */
+void STB_Image_budget_acquire(STB_Image_Budget& budget, dz::loaders::STB_Image_Request& request) {
+    budget.bytes_in_flight += request.decoded_size;
+    request.budget_held->store(request.decoded_size);
+    request.dispatched = true;
+}
+
+bool STB_Image_budget_fits(const STB_Image_Budget& budget, size_t decoded_size) {
+    return budget.bytes_in_flight == 0 || budget.bytes_in_flight + decoded_size <= budget.max_bytes_in_flight;
+}
+
+/**
+ * @brief Moves pending requests that now fit out of the queue in submission order, called with the budget mutex held
+ */
+void STB_Image_budget_take_pending(STB_Image_Budget& budget, std::vector<STB_Image_Request_Ptr>& out) {
+    while (!budget.pending.empty() && STB_Image_budget_fits(budget, budget.pending.front()->decoded_size)) {
+        STB_Image_budget_acquire(budget, *budget.pending.front());
+        out.push_back(std::move(budget.pending.front()));
+        budget.pending.pop_front();
+    }
+}
+
+void STB_Image_budget_release(size_t bytes) {
+    auto& budget = STB_Image_get_budget();
+    std::vector<STB_Image_Request_Ptr> dispatch;
+    {
+        std::lock_guard lock(budget.mutex);
+        budget.bytes_in_flight -= bytes;
+        STB_Image_budget_take_pending(budget, dispatch);
+    }
+    for (auto& request : dispatch)
+        STB_Image_dispatch(request);
+}
+
+/**
+ * @brief Returns a request's share of the budget, only the first call releases anything
+ */
+void STB_Image_budget_release_held(const std::shared_ptr<std::atomic<size_t>>& budget_held) {
+    auto bytes = budget_held->exchange(0);
+    if (bytes)
+        STB_Image_budget_release(bytes);
+}
+
+size_t STB_Image_query_decoded_size(const dz::loaders::STB_Image_Info& info, int minChannels) {
+    int width = 0, height = 0, nrChannels = 0;
+    int ok = 0;
+    if (info.mapping && info.mapping->size)
+        ok = stbi_info_from_memory((stbi_uc const *)info.mapping->data, info.mapping->size, &width, &height, &nrChannels);
+    else if (!info.path.empty()) {
+        std::string path_string = info.path.string();
+        ok = stbi_info(path_string.c_str(), &width, &height, &nrChannels);
+    }
+    else
+        ok = stbi_info_from_memory((stbi_uc const *)info.bytes.get(), info.bytes_length, &width, &height, &nrChannels);
+    if (!ok)
+        return 0;
+    auto channels = minChannels ? minChannels : nrChannels;
+    return size_t(width) * size_t(height) * size_t(channels) * (info.load_float ? sizeof(float) : sizeof(uint8_t));
+}
+
+void STB_Image_decode_request(dz::loaders::STB_Image_Request& request) {
+    auto& info = request.info;
+    void* imageData = nullptr;
+    int nrChannels = 0, width = 0, height = 0;
+    auto desiredChannels = request.minChannels;
+    if (info.mapping && info.mapping->size) {
+        auto mapped = (stbi_uc const *)info.mapping->data;
+        auto mapped_length = int(info.mapping->size);
+        imageData = info.load_float ?
+            (void*)stbi_loadf_from_memory(mapped, mapped_length, &width, &height, &nrChannels, desiredChannels) :
+            (void*)stbi_load_from_memory(mapped, mapped_length, &width, &height, &nrChannels, desiredChannels);
+    }
+    else if (!info.path.empty()) {
+        std::string path_string = info.path.string();
+        imageData = info.load_float ?
+            (void*)stbi_loadf(path_string.c_str(), &width, &height, &nrChannels, desiredChannels) :
+            (void*)stbi_load(path_string.c_str(), &width, &height, &nrChannels, desiredChannels);
+    }
+    else if (info.bytes && info.bytes_length) {
+        imageData = info.load_float ?
+            (void*)stbi_loadf_from_memory((stbi_uc const *)info.bytes.get(), info.bytes_length, &width, &height, &nrChannels, desiredChannels) :
+            (void*)stbi_load_from_memory((stbi_uc const *)info.bytes.get(), info.bytes_length, &width, &height, &nrChannels, desiredChannels);
+    }
+    if (!imageData) {
+        STB_Image_budget_release_held(request.budget_held);
+        throw std::runtime_error("Failed to load image from memory.");
+    }
+    // pixels dropped without being handed off still give their share back
+    request.pixels = std::shared_ptr<void>(imageData, [budget_held = request.budget_held](auto ptr) {
+        stbi_image_free(ptr);
+        STB_Image_budget_release_held(budget_held);
+    });
+    request.width = width;
+    request.height = height;
+    request.nrChannels = (std::max)(nrChannels, desiredChannels);
+}
+
+void STB_Image_run_request(const STB_Image_Request_Ptr& request) {
+    try {
+        STB_Image_decode_request(*request);
+    }
+    catch (...) {
+        request->error = std::current_exception();
+    }
+    // the encoded bytes are no longer needed once decoded
+    request->info.bytes.reset();
+    request->info.mapping.reset();
+    {
+        std::lock_guard lock(request->mutex);
+        request->ready = true;
+    }
+    request->cv.notify_all();
+}
+
+dz::loaders::STB_Image_Future dz::loaders::STB_Image_Loader::LoadAsync(const dz::loaders::STB_Image_Info& info) {
+    if (info.path.empty() && !(info.bytes && info.bytes_length) && !(info.mapping && info.mapping->size))
+        throw std::runtime_error("Neither bytes nor path were provided to info!");
+    auto request = std::make_shared<STB_Image_Request>();
+    request->info = info;
+    // format support lives in the DirectRegistry, resolve it here rather than on a worker
+    request->minChannels = info.load_float ? STB_Image_minChannelsf() : STB_Image_minChannelsu();
+    // the budget is taken before the decode is queued, requests that do not fit wait in order without holding a worker
+    request->decoded_size = STB_Image_query_decoded_size(info, request->minChannels);
+    auto& budget = STB_Image_get_budget();
+    bool dispatch = false;
+    {
+        std::lock_guard lock(budget.mutex);
+        if (budget.pending.empty() && STB_Image_budget_fits(budget, request->decoded_size)) {
+            STB_Image_budget_acquire(budget, *request);
+            dispatch = true;
+        }
+        else
+            budget.pending.push_back(request);
+    }
+    if (dispatch)
+        STB_Image_dispatch(request);
+    return request;
+}
+
+bool dz::loaders::STB_Image_Loader::IsReady(const dz::loaders::STB_Image_Future& future) {
+    std::lock_guard lock(future->mutex);
+    return future->ready;
+}
+
+void dz::loaders::STB_Image_Loader::Wait(const dz::loaders::STB_Image_Future& future) {
+    auto& request = *future;
+    // a request still queued for budget is taken out of the queue and decoded on this thread, over budget if need be
+    bool decode_here = false;
+    {
+        auto& budget = STB_Image_get_budget();
+        std::lock_guard lock(budget.mutex);
+        if (!request.dispatched && !request.cancelled) {
+            auto pending_it = std::find(budget.pending.begin(), budget.pending.end(), future);
+            if (pending_it != budget.pending.end())
+                budget.pending.erase(pending_it);
+            STB_Image_budget_acquire(budget, request);
+            decode_here = true;
+        }
+    }
+    if (decode_here)
+        STB_Image_run_request(future);
+    {
+        std::unique_lock lock(request.mutex);
+        request.cv.wait(lock, [&]() { return request.ready; });
+    }
+    if (request.error)
+        std::rethrow_exception(request.error);
+}
+
+bool dz::loaders::STB_Image_Loader::Cancel(const dz::loaders::STB_Image_Future& future) {
+    auto& request = *future;
+    auto& budget = STB_Image_get_budget();
+    std::vector<STB_Image_Request_Ptr> dispatch;
+    {
+        std::lock_guard lock(budget.mutex);
+        if (request.dispatched || request.cancelled)
+            return false;
+        auto pending_it = std::find(budget.pending.begin(), budget.pending.end(), future);
+        if (pending_it != budget.pending.end())
+            budget.pending.erase(pending_it);
+        request.cancelled = true;
+        // the cancelled request may have been the one holding back the queue
+        STB_Image_budget_take_pending(budget, dispatch);
+    }
+    for (auto& next : dispatch)
+        STB_Image_dispatch(next);
+    request.info.bytes.reset();
+    request.info.mapping.reset();
+    {
+        std::lock_guard lock(request.mutex);
+        request.error = std::make_exception_ptr(std::runtime_error("Image decode was cancelled."));
+        request.ready = true;
+    }
+    request.cv.notify_all();
+    return true;
+}
+
+dz::ImageCreateInfo dz::loaders::STB_Image_Loader::GetCreateInfo(const dz::loaders::STB_Image_Future& future) {
+    Wait(future);
+    auto& request = *future;
+    auto info = STB_Image_create_info_uf({request.pixels}, request.width, request.height, request.nrChannels, request.info.load_float);
+    // the pixels are the caller's once handed off, they no longer hold back queued decodes
+    STB_Image_budget_release_held(request.budget_held);
+    return info;
+}
+
+dz::Image* dz::loaders::STB_Image_Loader::Get(const dz::loaders::STB_Image_Future& future) {
+    return dz::image_create(GetCreateInfo(future));
+}
+
+std::vector<dz::Image*> dz::loaders::STB_Image_Loader::GetAll(const std::vector<dz::loaders::STB_Image_Future>& futures) {
+    std::vector<dz::Image*> images;
+    images.reserve(futures.size());
+    dz::transfer_batch_begin();
+    try {
+        for (auto& future : futures)
+            images.push_back(Get(future));
+    }
+    catch (...) {
+        dz::transfer_batch_end();
+        throw;
+    }
+    dz::transfer_batch_end();
+    return images;
+}
+
+void dz::loaders::STB_Image_Loader::SetMaxBytesInFlight(size_t max_bytes) {
+    auto& budget = STB_Image_get_budget();
+    std::vector<STB_Image_Request_Ptr> dispatch;
+    {
+        std::lock_guard lock(budget.mutex);
+        budget.max_bytes_in_flight = max_bytes;
+        STB_Image_budget_take_pending(budget, dispatch);
+    }
+    for (auto& request : dispatch)
+        STB_Image_dispatch(request);
+}
+
 template <>
 Serial& deserialize(Serial& serial, dz::loaders::STB_Image_Info& info)
 {
@@ -116,7 +412,7 @@ Serial& deserialize(Serial& serial, dz::loaders::STB_Image_Info& info)
     serial >> info.bytes_length;
     if (info.bytes_length) {
         info.bytes = std::shared_ptr<char>((char*)malloc(info.bytes_length), free);
-        serial.readBytes(info.bytes.get(), info.bytes_length);
+        dz::state_read_bytes(serial, info.bytes.get(), info.bytes_length);
     }
     return serial;
 }
@@ -125,8 +421,14 @@ Serial& serialize(Serial& serial, const dz::loaders::STB_Image_Info& info)
 {
     serial << info.load_float;
     serial << info.path;
+    // a mapping is written out as plain bytes, it is remapped from its source when next loaded
+    if (info.mapping && info.mapping->size) {
+        serial << info.mapping->size;
+        dz::state_write_bytes(serial, info.mapping->data, info.mapping->size);
+        return serial;
+    }
     serial << info.bytes_length;
     if (info.bytes_length)
-        serial.writeBytes(info.bytes.get(), info.bytes_length);
+        dz::state_write_bytes(serial, info.bytes.get(), info.bytes_length);
     return serial;
 }
\ No newline at end of file
@@ -582,14 +582,38 @@ namespace dz {
 		return indices;
 	}
 
+	int32_t find_transfer_queue_family(VkPhysicalDevice device)
+	{
+		uint32_t queueFamilyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, 0);
+		std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
+		// prefer a pure transfer (DMA) family, then any non graphics family that can transfer
+		int32_t fallback = -1;
+		for (int32_t index = 0; index < int32_t(queueFamilyCount); index++)
+		{
+			auto flags = queueFamilies[index].queueFlags;
+			if (!(flags & VK_QUEUE_TRANSFER_BIT) || (flags & VK_QUEUE_GRAPHICS_BIT))
+				continue;
+			if (!(flags & VK_QUEUE_COMPUTE_BIT))
+				return index;
+			if (fallback == -1)
+				fallback = index;
+		}
+		return fallback;
+	}
+
 	void direct_registry_ensure_logical_device(DirectRegistry* direct_registry, Renderer* renderer)
 	{
 		if (dr.device)
 			return;
 
 		QueueFamilyIndices indices = find_queue_families(dr_ptr, renderer, dr.physicalDevice);
+		auto transferFamily = find_transfer_queue_family(dr.physicalDevice);
 		std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 		std::vector<int32_t> uniqueQueueFamilies({indices.graphicsAndComputeFamily, indices.presentFamily});
+		if (transferFamily > -1)
+			uniqueQueueFamilies.push_back(transferFamily);
 		float queuePriority = 1.0f;
 		std::unordered_set<int32_t> seen;
 		for (auto& queueFamily : uniqueQueueFamilies)
@@ -696,6 +720,17 @@ namespace dz {
 		vkGetDeviceQueue(dr.device, dr.presentFamily, 0, &dr.presentQueue);
 		vkGetDeviceQueue(dr.device, dr.graphicsAndComputeFamily, 0, &dr.computeQueue);
 		vkGetDeviceQueue(dr.device, dr.graphicsAndComputeFamily, 0, &dr.copyQueue);
+
+		if (transferFamily > -1)
+		{
+			dr.transferFamily = transferFamily;
+			vkGetDeviceQueue(dr.device, dr.transferFamily, 0, &dr.transferQueue);
+		}
+		else
+		{
+			dr.transferFamily = dr.graphicsAndComputeFamily;
+			dr.transferQueue = dr.graphicsQueue;
+		}
 	}
 
 	bool create_swap_chain(Renderer* renderer)
@@ -1124,12 +1159,12 @@ _aquire:
 		for (auto& drawPair : renderer->drawBuffers)
 		{
 			vkDestroyBuffer(device, drawPair.second.first, 0);
-			vkFreeMemory(device, drawPair.second.second, 0);
+			gpu_memory_free(drawPair.second.second);
 		}
 		for (auto& countPair : renderer->countBuffers)
 		{
 			vkDestroyBuffer(device, countPair.second.first, 0);
-			vkFreeMemory(device, countPair.second.second, 0);
+			gpu_memory_free(countPair.second.second);
 		}
 		destroy_swap_chain(renderer);
 		for (auto& imageAvailableSemaphore : renderer->imageAvailableSemaphores)
@@ -1170,21 +1205,9 @@ _aquire:
 		}
 	}
 
-	uint32_t FindMemoryType(VkPhysicalDevice physicalDevice, uint32_t type_filter, VkMemoryPropertyFlags properties) {
-		VkPhysicalDeviceMemoryProperties mem_properties;
-		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &mem_properties);
-
-		for (uint32_t i = 0; i < mem_properties.memoryTypeCount; i++) {
-			if ((type_filter & (1 << i)) && (mem_properties.memoryTypes[i].propertyFlags & properties) == properties) {
-				return i;
-			}
-		}
-		throw std::runtime_error("failed to find suitable memory type!");
-	}
-
 	void createBuffer(Renderer* renderer,
 		VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
-		VkBuffer& buffer, VkDeviceMemory& bufferMemory)
+		VkBuffer& buffer, GPUAllocation& allocation, GPUMemoryCategory category)
 	{
 		VkBufferCreateInfo bufferInfo{};
 		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -1197,20 +1220,7 @@ _aquire:
 			throw std::runtime_error("failed to create buffer!");
 		}
 
-		VkMemoryRequirements memRequirements;
-		vkGetBufferMemoryRequirements(dr.device, buffer, &memRequirements);
-
-		VkMemoryAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.allocationSize = memRequirements.size;
-		allocInfo.memoryTypeIndex = FindMemoryType(dr.physicalDevice, memRequirements.memoryTypeBits, properties);
-
-		if (!vk_check("vkAllocateMemory", vkAllocateMemory(dr.device, &allocInfo, 0, &bufferMemory)))
-		{
-			throw std::runtime_error("failed to allocate buffer memory!");
-		}
-
-		vkBindBufferMemory(dr.device, buffer, bufferMemory, 0);
+		allocation = gpu_memory_allocate_buffer(buffer, properties, category);
 	}
 
 	std::string vk_result_string(VkResult result)
@@ -1388,22 +1398,13 @@ _aquire:
 
 	uint32_t find_memory_type(uint32_t type_filter, VkMemoryPropertyFlags properties)
 	{
-		VkPhysicalDeviceMemoryProperties mem_properties;
-		vkGetPhysicalDeviceMemoryProperties(dr.physicalDevice, &mem_properties);
-
-		for (uint32_t i = 0; i < mem_properties.memoryTypeCount; i++)
-		{
-			if ((type_filter & (1 << i)) && (mem_properties.memoryTypes[i].propertyFlags & properties) == properties)
-			{
-				return i;
-			}
-		}
-
-		throw std::runtime_error("Failed to find suitable memory type.");
+		return gpu_memory_find_type(type_filter, properties);
 	}
 
 	VkCommandBuffer begin_single_time_commands()
 	{
+		transfer_flush();
+
 		VkCommandBufferAllocateInfo alloc_info{};
 		alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 		alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
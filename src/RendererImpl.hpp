@@ -29,8 +29,8 @@ namespace dz {
         VkPresentInfoKHR presentInfo;
         VkPipelineStageFlags waitStages[1];
         VkSemaphore signalSemaphores[1];
-        std::map<size_t, std::pair<VkBuffer, VkDeviceMemory>> drawBuffers;
-        std::map<size_t, std::pair<VkBuffer, VkDeviceMemory>> countBuffers;
+        std::map<size_t, std::pair<VkBuffer, GPUAllocation>> drawBuffers;
+        std::map<size_t, std::pair<VkBuffer, GPUAllocation>> countBuffers;
         VkSurfaceTransformFlagBitsKHR currentTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
         bool recreate_swapchain_deferred = false;
         std::vector<DrawInformation*> vec_draw_information;
@@ -37,12 +37,19 @@ namespace dz {
             Asset glsl;
             auto asset_available = get_asset(asset_pack, requested_source, glsl);
 
-            if (!asset_available || !glsl.ptr || glsl.size == 0)
+            if (!asset_available || !glsl.ptr || glsl.get_size() == 0)
             {
                 return MakeErrorInclude(std::string("Failed to resolve include: ") + requested_source);
             }
 
-            std::string source_string((const char*)(glsl.ptr));
+            // packed files carry a trailing terminator, mapped assets are not otherwise null terminated
+            auto source_length = strnlen(glsl.get(), glsl.get_size());
+            if (glsl.is_borrowed())
+            {
+                // a view into a mapped pack stays valid while the pack is open, hand it to shaderc as is
+                return MakeBorrowedInclude(glsl.get(), source_length, requested_source);
+            }
+            std::string source_string(glsl.get(), source_length);
             return MakeSuccessInclude(source_string, requested_source);
         }
 
@@ -51,12 +58,29 @@ namespace dz {
             if (result)
             {
                 delete[] result->source_name;
-                delete[] result->content;
+                if (result->user_data != borrowed_content)
+                    delete[] result->content;
                 delete result;
             }
         }
 
     private:
+        inline static char borrowed_content_tag = 0;
+        inline static void* const borrowed_content = &borrowed_content_tag;
+
+        shaderc_include_result* MakeBorrowedInclude(const char* content, size_t content_length, const std::string& fullPath) {
+            shaderc_include_result* result = new shaderc_include_result();
+
+            result->source_name = CopyString(fullPath);
+            result->source_name_length = fullPath.size();
+
+            result->content = content;
+            result->content_length = content_length;
+
+            result->user_data = borrowed_content;
+
+            return result;
+        }
 
         shaderc_include_result* MakeSuccessInclude(const std::string& content, const std::string& fullPath) {
             shaderc_include_result* result = new shaderc_include_result();
@@ -1207,9 +1231,8 @@ namespace dz {
                         continue;
                     }
                     auto index = shader->push_constants.size();
-                    void* pc = malloc(member.type.size_in_bytes);
                     shader->push_constants[index] = PushConstant{
-                        std::shared_ptr<void>(pc, free), member.type.size_in_bytes,
+                        allocator_make_shared_buffer<void>(member.type.size_in_bytes, false), member.type.size_in_bytes,
                         member.offset,
                         GetShaderStageFromModuleType(module_type)
                     };
@@ -1506,14 +1529,21 @@ namespace dz {
         vkCreateShaderModule(dr.device, &create_info, 0, &shader_module.vk_module);
     }
 
+    void buffer_group_clear_canonical_structs(BufferGroup* buffer_group) {
+        for (auto& [name, buffer] : buffer_group->buffers)
+            buffer.canonical_struct = nullptr;
+    }
+
     void shader_add_buffer_group(Shader* shader, BufferGroup* buffer_group) {
         buffer_group->shaders[shader] = true;
         shader->buffer_groups[buffer_group] = true;
+        buffer_group_clear_canonical_structs(buffer_group);
     }
 
     void shader_remove_buffer_group(Shader* shader, BufferGroup* buffer_group) {
         buffer_group->shaders.erase(shader);
         shader->buffer_groups.erase(buffer_group);
+        buffer_group_clear_canonical_structs(buffer_group);
     }
 
     struct TransitionInfo {
@@ -1628,6 +1658,8 @@ namespace dz {
     void shader_dispatch(Shader* shader, uint32_t x, uint32_t y, uint32_t z, void(*shader_pre_dispatch)(Shader*, void*), void(*shader_post_dispatch)(Shader*, void*), void* user_data) {
         shader_ensure_image_layouts(shader);
 
+        transfer_flush();
+
         dr.commandBuffer = &dr.computeCommandBuffer;
 
         VkCommandBufferBeginInfo beginInfo{};
@@ -1955,6 +1987,9 @@ namespace dz {
 
         dr.currentRenderer = renderer;
 
+        transfer_flush();
+        transfer_poll();
+
         if (renderer->recreate_swapchain_deferred) {
             recreate_swap_chain(renderer);
             renderer->recreate_swapchain_deferred = false;
@@ -2126,7 +2161,8 @@ namespace dz {
                 VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
                 drawBufferPair.first,
-                drawBufferPair.second
+                drawBufferPair.second,
+                GPUMemoryCategory::Indirect
             );
         }
 
@@ -2138,25 +2174,20 @@ namespace dz {
                 VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
                 countBufferPair.first,
-                countBufferPair.second
+                countBufferPair.second,
+                GPUMemoryCategory::Indirect
             );
         }
 
         std::vector<VkDrawIndirectCommand> i_commands(drawsSize, VkDrawIndirectCommand{});
         memcpy(i_commands.data(), commands.data(), i_commands.size() * sizeof(VkDrawIndirectCommand));
 
-        // Write draw commands to GPU-visible indirect buffer
-        void* drawBufferData;
-        vkMapMemory(dr.device, drawBufferPair.second, 0, VK_WHOLE_SIZE, 0, &drawBufferData);
-        memcpy(drawBufferData, i_commands.data(), drawBufferSize);
-        vkUnmapMemory(dr.device, drawBufferPair.second);
+        // Write draw commands to GPU-visible indirect buffer, its block stays mapped
+        memcpy(drawBufferPair.second.mapped, i_commands.data(), drawBufferSize);
 
         // Write draw count to count buffer
         uint32_t drawCount = static_cast<uint32_t>(drawsSize);
-        void* countBufferData;
-        vkMapMemory(dr.device, countBufferPair.second, 0, VK_WHOLE_SIZE, 0, &countBufferData);
-        memcpy(countBufferData, &drawCount, sizeof(uint32_t));
-        vkUnmapMemory(dr.device, countBufferPair.second);
+        memcpy(countBufferPair.second.mapped, &drawCount, sizeof(uint32_t));
 
         // Descriptor sets
         std::vector<VkDescriptorSet> sets;
@@ -2193,10 +2224,7 @@ namespace dz {
         {
             // Manually read count from mapped memory
             uint32_t fallbackDrawCount = 0;
-            void* mappedCount = nullptr;
-            vkMapMemory(dr.device, countBufferPair.second, 0, sizeof(uint32_t), 0, &mappedCount);
-            memcpy(&fallbackDrawCount, mappedCount, sizeof(uint32_t));
-            vkUnmapMemory(dr.device, countBufferPair.second);
+            memcpy(&fallbackDrawCount, countBufferPair.second.mapped, sizeof(uint32_t));
             fallbackDrawCount = std::min(drawCount, fallbackDrawCount);
 
             for (uint32_t i = 0; i < fallbackDrawCount; ++i)
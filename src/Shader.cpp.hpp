@@ -57,6 +57,7 @@ namespace dz {
         std::map<std::string, SpvReflectTypeDescription> member_type_descs; // Maps member name (e.g., "model") to its SpvReflectTypeDescription
         std::map<std::string, uint32_t> member_offsets_map; // Maps member name to its offset within the struct
         std::map<std::string, uint32_t> member_sizes_map;   // Maps member name to its reflected size
+        std::unordered_map<std::string, MemberHandle> member_handles; // Offset, size and type per member, one lookup per access by name
 
         ReflectedStruct() = default;
         ReflectedStruct(std::string n, uint32_t i, SpvReflectTypeDescription td) : name(std::move(n)), id(i), type(td) {
@@ -69,6 +70,7 @@ namespace dz {
                     member_type_descs[name] = type_desc;
                     member_offsets_map[name] = offset;
                     member_sizes_map[name] = size;
+                    member_handles[name] = MemberHandle{offset, uint32_t(size), uint32_t(type_desc.op)};
                     offset += size;
                 }
             }
@@ -85,47 +87,64 @@ namespace dz {
         }
     }
 
-    void ReflectedStructView::set_member(const std::string& member_name, const void* data_ptr, size_t data_size_bytes) {
-        auto offset_it = m_struct_def.member_offsets_map.find(member_name);
-        auto size_it = m_struct_def.member_sizes_map.find(member_name);
-
-        if (offset_it == m_struct_def.member_offsets_map.end() ||
-            size_it == m_struct_def.member_sizes_map.end()) {
+    const MemberHandle& reflected_struct_find_member(const ReflectedStruct& struct_def, const std::string& member_name) {
+        auto it = struct_def.member_handles.find(member_name);
+        if (it == struct_def.member_handles.end()) {
             throw std::runtime_error("ReflectedStructView Error: Member '" + member_name + "' not found in struct '"
-                        + m_struct_def.name + "'.");
+                        + struct_def.name + "'.");
         }
+        return it->second;
+    }
 
-        uint32_t member_offset = offset_it->second;
-        uint32_t reflected_size = size_it->second;
-
-        if (!(reflected_size == data_size_bytes)) {
+    const MemberHandle& reflected_struct_find_member(const ReflectedStruct& struct_def, const std::string& member_name, size_t data_size_bytes) {
+        auto& member = reflected_struct_find_member(struct_def, member_name);
+        if (!(member.size == data_size_bytes)) {
             throw std::runtime_error("ReflectedSize does not match data_size (bytes)");
         }
+        return member;
+    }
 
-        uint8_t* target_addr = m_base_ptr + member_offset;
-        size_t bytes_to_copy = std::min(data_size_bytes, (size_t)reflected_size);
-
-        memcpy(target_addr, data_ptr, bytes_to_copy);
+    void ReflectedStructView::set_member(const std::string& member_name, const void* data_ptr, size_t data_size_bytes) {
+        auto& member = reflected_struct_find_member(m_struct_def, member_name, data_size_bytes);
+        memcpy(m_base_ptr + member.offset, data_ptr, member.size);
     }
 
     uint8_t* ReflectedStructView::get_member(const std::string& member_name, size_t data_size_bytes) {
-        auto offset_it = m_struct_def.member_offsets_map.find(member_name);
-        auto size_it = m_struct_def.member_sizes_map.find(member_name);
-        
-        if (offset_it == m_struct_def.member_offsets_map.end() ||
-            size_it == m_struct_def.member_sizes_map.end()) {
-            throw std::runtime_error("ReflectedStructView Error: Member '" + member_name + "' not found in struct '"
-                        + m_struct_def.name + "'.");
-        }
+        return m_base_ptr + reflected_struct_find_member(m_struct_def, member_name, data_size_bytes).offset;
+    }
 
-        uint32_t member_offset = offset_it->second;
-        uint32_t reflected_size = size_it->second;
+    MemberHandle ReflectedStructView::get_member_handle(const std::string& member_name) const {
+        return reflected_struct_find_member(m_struct_def, member_name);
+    }
 
-        if (!(reflected_size == data_size_bytes)) {
-            throw std::runtime_error("ReflectedSize does not match data_size (bytes)");
+    MemberHandle ReflectedStructView::get_member_handle(const std::string& member_name, size_t data_size_bytes) const {
+        return reflected_struct_find_member(m_struct_def, member_name, data_size_bytes);
+    }
+
+    ReflectedBufferView::ReflectedBufferView(uint8_t* base_ptr, size_t stride, size_t count, const ReflectedStruct& struct_def)
+        : m_base_ptr(base_ptr), m_stride(stride), m_count(count), m_struct_def(&struct_def) {
+        if (!m_base_ptr) {
+            throw std::runtime_error("ReflectedBufferView: Base pointer for buffer is null.");
         }
+        if (m_struct_def->type.op != SpvOpTypeStruct) {
+            throw std::runtime_error("ReflectedBufferView: Provided ReflectedType is not a struct.");
+        }
+    }
 
-        return m_base_ptr + member_offset;
+    ReflectedStructView ReflectedBufferView::element(size_t index) const {
+        if (index >= m_count) {
+            throw std::out_of_range("ReflectedBufferView: Index " + std::to_string(index) +
+                                    " is out of bounds (element count: " + std::to_string(m_count) + ").");
+        }
+        return ReflectedStructView(m_base_ptr + index * m_stride, *m_struct_def);
+    }
+
+    MemberHandle ReflectedBufferView::get_member_handle(const std::string& member_name) const {
+        return reflected_struct_find_member(*m_struct_def, member_name);
+    }
+
+    MemberHandle ReflectedBufferView::get_member_handle(const std::string& member_name, size_t data_size_bytes) const {
+        return reflected_struct_find_member(*m_struct_def, member_name, data_size_bytes);
     }
 
     struct SPIRVReflection {
@@ -154,7 +173,7 @@ namespace dz {
 
     struct GpuBuffer {
         VkBuffer buffer = VK_NULL_HANDLE;
-        VkDeviceMemory memory = VK_NULL_HANDLE;
+        GPUAllocation allocation;
         void* mapped_memory = nullptr; // Persistently mapped pointer
         VkDeviceSize size = 0;
     };
@@ -178,6 +197,9 @@ namespace dz {
         // The custom deleter will be empty for GPU memory, preventing crashes.
         std::shared_ptr<uint8_t> data_ptr = nullptr;
 
+        // Struct definition of element_type, resolved on first view and cleared when the group's shaders change
+        const ReflectedStruct* canonical_struct = nullptr;
+
         // The final Vulkan resource
         GpuBuffer gpu_buffer;
     };
@@ -1,6 +1,666 @@
 #include <dz/State.hpp>
 #include <dz/ECS.hpp>
+#include <dz/ThreadPool.hpp>
+#include <dz/AssetPack.hpp>
+#include <dz/Hash.hpp>
 #include "Directz.cpp.hpp"
+#include <zlib.h>
+
+#define DZ_STATE_MAGIC "DZST"
+#define DZ_STATE_VERSION 2
+#define DZ_STATE_CHUNK_SIZE (4ull * 1024ull * 1024ull)
+#define DZ_STATE_DELTA_MAGIC "DZSD"
+#define DZ_STATE_DELTA_VERSION 1
+
+namespace dz {
+    enum class StateChunkCompression : uint32_t {
+        None = 0,
+        Zlib = 1
+    };
+
+    struct StateFileHeader {
+        char magic[4];
+        uint32_t version;
+    };
+
+    struct StateChunk {
+        uint64_t offset = 0;
+        uint64_t raw_size = 0;
+        uint64_t stored_size = 0;
+        StateChunkCompression compression = StateChunkCompression::None;
+        uint32_t padding = 0;
+    };
+
+    struct StateBlob {
+        uint64_t first_chunk = 0;
+        uint64_t chunk_count = 0;
+        uint64_t raw_size = 0;
+    };
+
+    struct StateFileTrailer {
+        uint64_t index_offset = 0;
+        uint64_t stream_chunk_count = 0;
+        uint64_t chunk_count = 0;
+        uint64_t blob_count = 0;
+        char magic[4];
+        uint32_t version;
+    };
+
+    struct EncodedStateChunk {
+        std::string bytes;
+        uint64_t raw_size = 0;
+        StateChunkCompression compression = StateChunkCompression::None;
+    };
+
+    EncodedStateChunk state_encode_chunk(const char* data, size_t size, int level) {
+        EncodedStateChunk chunk;
+        chunk.raw_size = size;
+        if (level == 0) {
+            chunk.bytes.assign(data, size);
+            return chunk;
+        }
+        auto bound = compressBound(uLong(size));
+        chunk.bytes.resize(bound);
+        auto stored_size = uLongf(bound);
+        if (compress2((Bytef*)chunk.bytes.data(), &stored_size, (const Bytef*)data, uLong(size), level) == Z_OK && stored_size < size) {
+            chunk.bytes.resize(stored_size);
+            chunk.compression = StateChunkCompression::Zlib;
+            return chunk;
+        }
+        chunk.bytes.assign(data, size);
+        return chunk;
+    }
+
+    void state_decode_chunk(const StateChunk& chunk, const std::string& stored, char* out) {
+        if (chunk.compression == StateChunkCompression::None) {
+            if (stored.size() != chunk.raw_size)
+                throw std::runtime_error("State chunk size mismatch");
+            memcpy(out, stored.data(), stored.size());
+            return;
+        }
+        auto raw_size = uLongf(chunk.raw_size);
+        if (uncompress((Bytef*)out, &raw_size, (const Bytef*)stored.data(), uLong(stored.size())) != Z_OK || raw_size != chunk.raw_size)
+            throw std::runtime_error("State chunk is corrupt");
+    }
+
+    /**
+    * @brief streambuf that Serial writes into during capture, each filled chunk is compressed on the ThreadPool while capture continues
+    */
+    struct StateChunkWriter : std::streambuf {
+        std::vector<char> current;
+        uint64_t written = 0;
+        int compression_level = DZ_STATE_COMPRESSION_LEVEL;
+        std::vector<std::future<EncodedStateChunk>> chunks;
+
+        StateChunkWriter() {
+            current.reserve(DZ_STATE_CHUNK_SIZE);
+        }
+
+        void seal() {
+            if (current.empty())
+                return;
+            chunks.push_back(thread_pool_submit(thread_pool_default(), [bytes = std::move(current), level = compression_level]() {
+                return state_encode_chunk(bytes.data(), bytes.size(), level);
+            }));
+            current = {};
+            current.reserve(DZ_STATE_CHUNK_SIZE);
+        }
+
+        std::streamsize xsputn(const char* data, std::streamsize count) override {
+            auto remaining = size_t(count);
+            while (remaining) {
+                auto take = (std::min)(remaining, size_t(DZ_STATE_CHUNK_SIZE) - current.size());
+                current.insert(current.end(), data, data + take);
+                data += take;
+                remaining -= take;
+                if (current.size() == DZ_STATE_CHUNK_SIZE)
+                    seal();
+            }
+            written += count;
+            return count;
+        }
+
+        int_type overflow(int_type ch) override {
+            if (traits_type::eq_int_type(ch, traits_type::eof()))
+                return traits_type::not_eof(ch);
+            auto c = traits_type::to_char_type(ch);
+            xsputn(&c, 1);
+            return ch;
+        }
+
+        pos_type seekoff(off_type offset, std::ios_base::seekdir dir, std::ios_base::openmode) override {
+            if (offset == 0 && dir == std::ios_base::cur)
+                return pos_type(off_type(written));
+            return pos_type(off_type(-1));
+        }
+    };
+
+    /**
+    * @brief An AssetPack that State blobs may reference instead of embedding, indexed by content hash on first use
+    */
+    struct StateAssetPack {
+        std::string path;
+        FileHandle file_handle;
+        AssetPack* asset_pack = nullptr;
+        std::unordered_multimap<uint64_t, AssetInfo> infos;
+        bool indexed = false;
+        std::mutex mutex;
+
+        ~StateAssetPack() {
+            free_asset_pack(asset_pack);
+        }
+    };
+
+    std::shared_ptr<StateAssetPack> state_open_asset_pack(const std::string& path) {
+        auto pack = std::make_shared<StateAssetPack>();
+        pack->path = path;
+        pack->file_handle = {FileHandle::PATH, path};
+        pack->asset_pack = open_asset_pack(pack->file_handle);
+        return pack;
+    }
+
+    bool state_asset_pack_find(StateAssetPack& pack, const char* data, size_t size, uint64_t hash, std::string& out_path) {
+        std::lock_guard lock(pack.mutex);
+        if (!pack.indexed) {
+            for (auto& info : get_asset_infos(pack.asset_pack))
+                pack.infos.emplace(info.content_hash, info);
+            pack.indexed = true;
+        }
+        auto [begin, end] = pack.infos.equal_range(hash);
+        for (auto it = begin; it != end; ++it) {
+            auto& info = it->second;
+            if (info.size != size)
+                continue;
+            Asset asset;
+            // the stored asset may carry trailing bytes past its source, only the source range is compared
+            if (get_asset_range(pack.asset_pack, info.path, 0, size, asset) && asset.get_size() == size && memcmp(asset.get(), data, size) == 0) {
+                out_path = info.path;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+    * @brief A captured State waiting on its readbacks, once the last one lands it is compressed and written on the ThreadPool
+    */
+    struct StateSnapshot {
+        StateChunkWriter stream_buffer;
+        std::ostream stream{&stream_buffer};
+        Serial* serial_ptr = nullptr;
+        std::vector<std::shared_ptr<void>> blob_datas;
+        std::vector<size_t> blob_sizes;
+        std::map<std::pair<Image*, int>, uint64_t> image_blobs;
+        std::vector<std::shared_ptr<StateAssetPack>> asset_packs;
+        // one reference is held by the capture itself and released once every Restorable has been backed up
+        std::atomic<size_t> pending = 1;
+        std::filesystem::path path;
+        std::ostream* ostream_ptr = nullptr;
+        std::promise<bool> written_promise;
+        std::shared_future<bool> written = written_promise.get_future().share();
+        bool captured = false;
+    };
+
+    bool state_write_snapshot(StateSnapshot& snapshot, std::ostream& out) {
+        uint64_t offset = 0;
+        auto write = [&](const void* data, size_t size) {
+            out.write((const char*)data, std::streamsize(size));
+            offset += size;
+        };
+        StateFileHeader header;
+        memcpy(header.magic, DZ_STATE_MAGIC, 4);
+        header.version = DZ_STATE_VERSION;
+        write(&header, sizeof(header));
+
+        std::vector<StateChunk> chunks;
+        auto emit = [&](const EncodedStateChunk& encoded) {
+            chunks.push_back({offset, encoded.raw_size, encoded.bytes.size(), encoded.compression});
+            write(encoded.bytes.data(), encoded.bytes.size());
+        };
+        // stream chunks were compressed during capture, write them out in order as they finish
+        for (auto& future : snapshot.stream_buffer.chunks)
+            emit(future.get());
+        auto stream_chunk_count = chunks.size();
+
+        auto blob_count = snapshot.blob_datas.size();
+        auto blob_data = [&](size_t blob_index) {
+            return (const char*)snapshot.blob_datas[blob_index].get();
+        };
+        std::vector<uint64_t> hashes(blob_count);
+        thread_pool_parallel_for(thread_pool_default(), blob_count, [&](size_t blob_index) {
+            hashes[blob_index] = hash_bytes(blob_data(blob_index), snapshot.blob_sizes[blob_index]);
+        });
+        // identical blobs are stored once, later ones reuse the entry of the first
+        std::vector<size_t> owners(blob_count);
+        std::unordered_multimap<uint64_t, size_t> unique_blobs;
+        for (size_t blob_index = 0; blob_index < blob_count; blob_index++) {
+            owners[blob_index] = blob_index;
+            auto size = snapshot.blob_sizes[blob_index];
+            auto [begin, end] = unique_blobs.equal_range(hashes[blob_index]);
+            for (auto it = begin; it != end; ++it) {
+                if (snapshot.blob_sizes[it->second] == size && memcmp(blob_data(it->second), blob_data(blob_index), size) == 0) {
+                    owners[blob_index] = it->second;
+                    break;
+                }
+            }
+            if (owners[blob_index] == blob_index)
+                unique_blobs.emplace(hashes[blob_index], blob_index);
+        }
+        // unique blobs already stored in a referenced AssetPack are written as a reference to that asset
+        struct BlobReference {
+            uint64_t pack_index;
+            std::string path;
+        };
+        std::map<size_t, BlobReference> references;
+        for (size_t blob_index = 0; blob_index < blob_count; blob_index++) {
+            auto size = snapshot.blob_sizes[blob_index];
+            if (owners[blob_index] != blob_index || !size)
+                continue;
+            for (size_t pack_index = 0; pack_index < snapshot.asset_packs.size(); pack_index++) {
+                std::string path;
+                if (state_asset_pack_find(*snapshot.asset_packs[pack_index], blob_data(blob_index), size, hashes[blob_index], path)) {
+                    references[blob_index] = {pack_index, path};
+                    break;
+                }
+            }
+        }
+
+        struct BlobPiece {
+            size_t blob;
+            size_t offset;
+            size_t size;
+        };
+        std::vector<BlobPiece> pieces;
+        std::vector<StateBlob> blobs(blob_count);
+        for (size_t blob_index = 0; blob_index < blob_count; blob_index++) {
+            auto size = snapshot.blob_sizes[blob_index];
+            auto& blob = blobs[blob_index];
+            blob.raw_size = size;
+            if (owners[blob_index] != blob_index || references.count(blob_index))
+                continue;
+            blob.first_chunk = stream_chunk_count + pieces.size();
+            for (size_t piece_offset = 0; piece_offset < size; piece_offset += DZ_STATE_CHUNK_SIZE) {
+                pieces.push_back({blob_index, piece_offset, (std::min)(size_t(DZ_STATE_CHUNK_SIZE), size - piece_offset)});
+                blob.chunk_count++;
+            }
+        }
+        for (size_t blob_index = 0; blob_index < blob_count; blob_index++)
+            blobs[blob_index] = blobs[owners[blob_index]];
+        std::vector<EncodedStateChunk> encoded_pieces(pieces.size());
+        auto level = snapshot.stream_buffer.compression_level;
+        thread_pool_parallel_for(thread_pool_default(), pieces.size(), [&](size_t piece_index) {
+            auto& piece = pieces[piece_index];
+            encoded_pieces[piece_index] = state_encode_chunk(blob_data(piece.blob) + piece.offset, piece.size, level);
+        });
+        for (auto& encoded : encoded_pieces)
+            emit(encoded);
+
+        StateFileTrailer trailer;
+        trailer.index_offset = offset;
+        trailer.stream_chunk_count = stream_chunk_count;
+        trailer.chunk_count = chunks.size();
+        trailer.blob_count = blobs.size();
+        memcpy(trailer.magic, DZ_STATE_MAGIC, 4);
+        trailer.version = DZ_STATE_VERSION;
+        write(chunks.data(), chunks.size() * sizeof(StateChunk));
+        write(blobs.data(), blobs.size() * sizeof(StateBlob));
+        auto write_string = [&](const std::string& string) {
+            uint64_t size = string.size();
+            write(&size, sizeof(size));
+            write(string.data(), string.size());
+        };
+        uint64_t pack_count = snapshot.asset_packs.size();
+        write(&pack_count, sizeof(pack_count));
+        for (auto& pack : snapshot.asset_packs)
+            write_string(pack->path);
+        uint64_t reference_count = 0;
+        for (size_t blob_index = 0; blob_index < blob_count; blob_index++)
+            reference_count += references.count(owners[blob_index]);
+        write(&reference_count, sizeof(reference_count));
+        for (size_t blob_index = 0; blob_index < blob_count; blob_index++) {
+            auto reference_it = references.find(owners[blob_index]);
+            if (reference_it == references.end())
+                continue;
+            uint64_t blob_id = blob_index;
+            write(&blob_id, sizeof(blob_id));
+            write(&reference_it->second.pack_index, sizeof(uint64_t));
+            write_string(reference_it->second.path);
+        }
+        write(&trailer, sizeof(trailer));
+        out.flush();
+        return bool(out);
+    }
+
+    void state_snapshot_write(const std::shared_ptr<StateSnapshot>& snapshot) {
+        thread_pool_enqueue(thread_pool_default(), [snapshot]() {
+            bool written = false;
+            try {
+                if (!snapshot->captured)
+                    written = false;
+                else if (snapshot->ostream_ptr)
+                    written = state_write_snapshot(*snapshot, *snapshot->ostream_ptr);
+                else {
+                    auto temp_path = snapshot->path;
+                    temp_path += ".tmp";
+                    {
+                        std::ofstream out(temp_path, std::ios::out | std::ios::binary | std::ios::trunc);
+                        written = out && state_write_snapshot(*snapshot, out);
+                    }
+                    std::error_code ec;
+                    if (written)
+                        std::filesystem::rename(temp_path, snapshot->path, ec);
+                    if (!written || ec) {
+                        std::filesystem::remove(temp_path, ec);
+                        written = false;
+                    }
+                }
+            }
+            catch (...) {
+                written = false;
+            }
+            snapshot->blob_datas.clear();
+            snapshot->written_promise.set_value(written);
+        });
+    }
+
+    void state_snapshot_release(const std::shared_ptr<StateSnapshot>& snapshot) {
+        if (snapshot->pending.fetch_sub(1) == 1)
+            state_snapshot_write(snapshot);
+    }
+
+    uint64_t state_snapshot_capture_bytes(StateSnapshot& snapshot, const void* data, size_t size) {
+        auto blob_id = uint64_t(snapshot.blob_datas.size());
+        auto blob_data = malloc((std::max)(size, size_t(1)));
+        memcpy(blob_data, data, size);
+        snapshot.blob_datas.emplace_back(blob_data, free);
+        snapshot.blob_sizes.push_back(size);
+        return blob_id;
+    }
+
+    uint64_t state_snapshot_capture_image_mip(StateSnapshot& snapshot, Image* image_ptr, int mip) {
+        // an Image shared between several owners is read back once
+        auto [image_blob_it, inserted] = snapshot.image_blobs.emplace(std::make_pair(image_ptr, mip), snapshot.blob_datas.size());
+        if (!inserted)
+            return image_blob_it->second;
+        auto blob_id = uint64_t(snapshot.blob_datas.size());
+        snapshot.blob_datas.emplace_back();
+        snapshot.blob_sizes.push_back(0);
+        snapshot.pending++;
+        auto snapshot_ptr = dr.stateHolder.capturing;
+        image_get_data_async(image_ptr, mip, [snapshot_ptr, blob_id](void* data, size_t size) {
+            auto blob_data = malloc(size);
+            memcpy(blob_data, data, size);
+            snapshot_ptr->blob_datas[blob_id] = std::shared_ptr<void>(blob_data, free);
+            snapshot_ptr->blob_sizes[blob_id] = size;
+            state_snapshot_release(snapshot_ptr);
+        });
+        return blob_id;
+    }
+
+    /**
+    * @brief streambuf over a chunked State file, decodes one stream chunk at a time and decodes the next on the ThreadPool
+    */
+    struct StateChunkReader : std::streambuf {
+        std::istream& source;
+        std::vector<StateChunk> chunks;
+        std::vector<StateBlob> blobs;
+        std::vector<std::string> pack_paths;
+        std::vector<std::shared_ptr<StateAssetPack>> packs;
+        std::unordered_map<uint64_t, std::pair<uint64_t, std::string>> references;
+        std::vector<uint64_t> stream_offsets;
+        size_t stream_chunk_count = 0;
+        uint64_t stream_size = 0;
+        std::vector<char> buffer;
+        size_t current_chunk = SIZE_MAX;
+        size_t prefetch_chunk = SIZE_MAX;
+        std::future<std::vector<char>> prefetch;
+        Serial* serial_ptr = nullptr;
+
+        explicit StateChunkReader(std::istream& source):
+            source(source)
+        {}
+
+        ~StateChunkReader() override {
+            if (prefetch.valid())
+                prefetch.wait();
+        }
+
+        bool open() {
+            StateFileHeader header{};
+            source.seekg(0, std::ios::beg);
+            if (!source.read((char*)&header, sizeof(header)) || memcmp(header.magic, DZ_STATE_MAGIC, 4) != 0)
+                return false;
+            if (header.version == 0 || header.version > DZ_STATE_VERSION)
+                throw std::runtime_error("Unsupported State file version");
+            StateFileTrailer trailer{};
+            source.seekg(-off_type(sizeof(trailer)), std::ios::end);
+            if (!source.read((char*)&trailer, sizeof(trailer)) || memcmp(trailer.magic, DZ_STATE_MAGIC, 4) != 0)
+                throw std::runtime_error("State file is truncated");
+            chunks.resize(trailer.chunk_count);
+            blobs.resize(trailer.blob_count);
+            source.seekg(off_type(trailer.index_offset), std::ios::beg);
+            source.read((char*)chunks.data(), std::streamsize(chunks.size() * sizeof(StateChunk)));
+            source.read((char*)blobs.data(), std::streamsize(blobs.size() * sizeof(StateBlob)));
+            // version 1 files end the index after the blobs, they never reference AssetPacks
+            if (header.version >= 2) {
+                auto read_u64 = [&]() {
+                    uint64_t value = 0;
+                    source.read((char*)&value, sizeof(value));
+                    return value;
+                };
+                auto read_string = [&]() {
+                    std::string string(read_u64(), '\0');
+                    source.read(string.data(), std::streamsize(string.size()));
+                    return string;
+                };
+                pack_paths.resize(read_u64());
+                for (auto& pack_path : pack_paths)
+                    pack_path = read_string();
+                packs.resize(pack_paths.size());
+                auto reference_count = read_u64();
+                for (uint64_t reference = 0; source && reference < reference_count; reference++) {
+                    auto blob_id = read_u64();
+                    auto pack_index = read_u64();
+                    references[blob_id] = {pack_index, read_string()};
+                }
+            }
+            if (!source || trailer.stream_chunk_count > chunks.size())
+                throw std::runtime_error("State file index is corrupt");
+            stream_chunk_count = trailer.stream_chunk_count;
+            stream_offsets.resize(stream_chunk_count + 1);
+            for (size_t chunk_index = 0; chunk_index < stream_chunk_count; chunk_index++)
+                stream_offsets[chunk_index + 1] = stream_offsets[chunk_index] + chunks[chunk_index].raw_size;
+            stream_size = stream_offsets.back();
+            return true;
+        }
+
+        std::string read_stored(size_t chunk_index) {
+            auto& chunk = chunks[chunk_index];
+            std::string stored(chunk.stored_size, '\0');
+            source.clear();
+            source.seekg(off_type(chunk.offset), std::ios::beg);
+            if (!source.read(stored.data(), std::streamsize(stored.size())))
+                throw std::runtime_error("State file is truncated");
+            return stored;
+        }
+
+        void start_prefetch(size_t chunk_index) {
+            if (chunk_index >= stream_chunk_count || chunk_index == prefetch_chunk)
+                return;
+            if (prefetch.valid())
+                prefetch.wait();
+            prefetch_chunk = chunk_index;
+            prefetch = thread_pool_submit(thread_pool_default(), [this, chunk_index, stored = read_stored(chunk_index)]() {
+                std::vector<char> decoded(chunks[chunk_index].raw_size);
+                state_decode_chunk(chunks[chunk_index], stored, decoded.data());
+                return decoded;
+            });
+        }
+
+        bool load_chunk(size_t chunk_index) {
+            if (chunk_index >= stream_chunk_count)
+                return false;
+            if (chunk_index != current_chunk) {
+                start_prefetch(chunk_index);
+                buffer = prefetch.get();
+                prefetch_chunk = SIZE_MAX;
+                current_chunk = chunk_index;
+                start_prefetch(chunk_index + 1);
+            }
+            setg(buffer.data(), buffer.data(), buffer.data() + buffer.size());
+            return true;
+        }
+
+        int_type underflow() override {
+            if (gptr() && gptr() < egptr())
+                return traits_type::to_int_type(*gptr());
+            auto next_chunk = current_chunk == SIZE_MAX ? 0 : current_chunk + 1;
+            while (load_chunk(next_chunk)) {
+                if (gptr() < egptr())
+                    return traits_type::to_int_type(*gptr());
+                next_chunk++;
+            }
+            return traits_type::eof();
+        }
+
+        pos_type seekpos(pos_type position, std::ios_base::openmode which) override {
+            auto target = uint64_t(off_type(position));
+            if (!(which & std::ios_base::in) || target > stream_size)
+                return pos_type(off_type(-1));
+            if (target == stream_size) {
+                current_chunk = stream_chunk_count ? stream_chunk_count - 1 : SIZE_MAX;
+                buffer.clear();
+                setg(nullptr, nullptr, nullptr);
+                return position;
+            }
+            auto chunk_index = size_t(std::upper_bound(stream_offsets.begin(), stream_offsets.end(), target) - stream_offsets.begin()) - 1;
+            load_chunk(chunk_index);
+            setg(eback(), eback() + (target - stream_offsets[chunk_index]), egptr());
+            return position;
+        }
+
+        pos_type seekoff(off_type offset, std::ios_base::seekdir dir, std::ios_base::openmode which) override {
+            off_type base = 0;
+            if (dir == std::ios_base::cur) {
+                if (current_chunk == SIZE_MAX)
+                    base = 0;
+                else if (!gptr())
+                    base = off_type(stream_size);
+                else
+                    base = off_type(stream_offsets[current_chunk] + (gptr() - eback()));
+            }
+            else if (dir == std::ios_base::end)
+                base = off_type(stream_size);
+            return seekpos(pos_type(base + offset), which);
+        }
+    };
+
+    bool state_reader_read_blob(StateChunkReader& reader, uint64_t blob_id, void* out, size_t size) {
+        if (blob_id >= reader.blobs.size())
+            return false;
+        auto& blob = reader.blobs[blob_id];
+        if (blob.raw_size != size)
+            return false;
+        auto reference_it = reader.references.find(blob_id);
+        if (reference_it != reader.references.end()) {
+            auto& [pack_index, path] = reference_it->second;
+            if (pack_index >= reader.packs.size())
+                return false;
+            auto& pack = reader.packs[pack_index];
+            if (!pack)
+                pack = state_open_asset_pack(reader.pack_paths[pack_index]);
+            Asset asset;
+            if (!get_asset_range(pack->asset_pack, path, 0, size, asset) || asset.get_size() != size)
+                return false;
+            memcpy(out, asset.get(), size);
+            return true;
+        }
+        if (blob.first_chunk + blob.chunk_count > reader.chunks.size())
+            return false;
+        size_t total_size = 0;
+        for (size_t piece = 0; piece < blob.chunk_count; piece++)
+            total_size += reader.chunks[blob.first_chunk + piece].raw_size;
+        if (total_size != size)
+            return false;
+        // uncompressed chunks are read straight into out, compressed ones are decoded in parallel once read
+        std::vector<std::string> stored(blob.chunk_count);
+        std::vector<size_t> offsets(blob.chunk_count);
+        size_t offset = 0;
+        for (size_t piece = 0; piece < blob.chunk_count; piece++) {
+            auto& chunk = reader.chunks[blob.first_chunk + piece];
+            offsets[piece] = offset;
+            if (chunk.compression == StateChunkCompression::None) {
+                reader.source.clear();
+                reader.source.seekg(std::streamoff(chunk.offset), std::ios::beg);
+                if (chunk.stored_size != chunk.raw_size || !reader.source.read((char*)out + offset, std::streamsize(chunk.raw_size)))
+                    throw std::runtime_error("State file is truncated");
+            }
+            else
+                stored[piece] = reader.read_stored(blob.first_chunk + piece);
+            offset += chunk.raw_size;
+        }
+        thread_pool_parallel_for(thread_pool_default(), blob.chunk_count, [&](size_t piece) {
+            auto& chunk = reader.chunks[blob.first_chunk + piece];
+            if (chunk.compression != StateChunkCompression::None)
+                state_decode_chunk(chunk, stored[piece], (char*)out + offsets[piece]);
+        });
+        return true;
+    }
+
+    StateSnapshot* state_get_capturing(Serial& serial) {
+        auto& capturing = dr.stateHolder.capturing;
+        return capturing && capturing->serial_ptr == &serial ? capturing.get() : nullptr;
+    }
+
+    StateChunkReader* state_get_restoring(Serial& serial) {
+        auto restoring = dr.stateHolder.restoring;
+        return restoring && restoring->serial_ptr == &serial ? restoring : nullptr;
+    }
+}
+
+void dz::set_state_compression_level(int level) {
+    dr.stateHolder.compression_level = level;
+}
+
+void dz::state_reference_asset_pack(const std::filesystem::path& pack_path) {
+    dr.stateHolder.asset_packs.push_back(state_open_asset_pack(pack_path.string()));
+}
+
+void dz::state_write_bytes(Serial& serial, const void* data, size_t size) {
+    auto snapshot = state_get_capturing(serial);
+    if (!snapshot) {
+        serial.writeBytes((const char*)data, size);
+        return;
+    }
+    serial << state_snapshot_capture_bytes(*snapshot, data, size);
+}
+
+void dz::state_read_bytes(Serial& serial, void* data, size_t size) {
+    auto reader = state_get_restoring(serial);
+    if (!reader) {
+        serial.readBytes((char*)data, size);
+        return;
+    }
+    uint64_t blob_id = 0;
+    serial >> blob_id;
+    if (!state_reader_read_blob(*reader, blob_id, data, size))
+        throw std::runtime_error("State blob is missing or corrupt");
+}
+
+void dz::state_skip_bytes(Serial& serial, size_t size) {
+    // blobs live outside the stream, skipping one only consumes its id
+    if (state_get_restoring(serial)) {
+        uint64_t blob_id = 0;
+        serial >> blob_id;
+        return;
+    }
+    char scratch[64 * 1024];
+    while (size) {
+        auto read_size = (std::min)(size, sizeof(scratch));
+        serial.readBytes(scratch, read_size);
+        size -= read_size;
+    }
+}
 
 void dz::track_static_state(
     int sid,
@@ -29,45 +689,52 @@ void dz::register_restorable_constructor(int c_id, const std::function<Restorabl
     StateHolder::c_id_fn_map[c_id] = constructor_fn;
 }
 
-std::tuple<Serial*, std::istream*, bool> get_owned_iserial() {
+struct OwnedStateInput {
     Serial* serial_ptr = nullptr;
-    bool own_local_istream = dr.stateHolder.use_istream;
-    auto local_istream = dr.stateHolder.istream_ptr;
-    if (!own_local_istream)
-        local_istream = new std::ifstream(dr.stateHolder.path, std::ios::in | std::ios::binary);
-    serial_ptr = new Serial(*local_istream);
-    return {serial_ptr, local_istream, own_local_istream};
-}
+    std::istream* istream_ptr = nullptr;
+    bool owned = false;
+    std::unique_ptr<StateChunkReader> reader;
+    std::unique_ptr<std::istream> reader_stream;
+};
 
-std::tuple<Serial*, std::ostream*, bool> get_owned_oserial() {
-    Serial* serial_ptr = nullptr;
-    bool own_local_ostream = dr.stateHolder.use_ostream;
-    auto local_ostream = dr.stateHolder.ostream_ptr;
-    if (!own_local_ostream)
-        local_ostream = new std::ofstream(dr.stateHolder.path, std::ios::out | std::ios::binary | std::ios::trunc);
-    serial_ptr = new Serial(*local_ostream);
-    return {serial_ptr, local_ostream, own_local_ostream};
-}
-
-void disown_iserial(Serial* serial_ptr, std::istream* istream_ptr, bool owned) {
-    serial_ptr->synchronize();
-    delete serial_ptr;
-    if (owned)
-        delete istream_ptr;
+OwnedStateInput get_owned_iserial() {
+    OwnedStateInput input;
+    input.owned = !dr.stateHolder.use_istream;
+    input.istream_ptr = dr.stateHolder.istream_ptr;
+    if (input.owned)
+        input.istream_ptr = new std::ifstream(dr.stateHolder.path, std::ios::in | std::ios::binary);
+    // chunked State files are decoded through a StateChunkReader, older files are plain Serial streams
+    if (*input.istream_ptr) {
+        input.reader = std::make_unique<StateChunkReader>(*input.istream_ptr);
+        if (input.reader->open())
+            input.reader_stream = std::make_unique<std::istream>(input.reader.get());
+        else {
+            input.reader.reset();
+            input.istream_ptr->clear();
+            input.istream_ptr->seekg(0, std::ios::beg);
+        }
+    }
+    input.serial_ptr = new Serial(input.reader_stream ? *input.reader_stream : *input.istream_ptr);
+    if (input.reader)
+        input.reader->serial_ptr = input.serial_ptr;
+    return input;
 }
 
-void disown_oserial(Serial* serial_ptr, std::ostream* ostream_ptr, bool owned) {
-    serial_ptr->synchronize();
-    delete serial_ptr;
-    if (owned)
-        delete ostream_ptr;
+void disown_iserial(OwnedStateInput& input) {
+    input.serial_ptr->synchronize();
+    delete input.serial_ptr;
+    input.reader_stream.reset();
+    input.reader.reset();
+    if (input.owned)
+        delete input.istream_ptr;
 }
 
 bool dz::has_state() {
-    auto [serial_ptr, istream_ptr, owned] = get_owned_iserial();
-    auto& serial = *serial_ptr;
+    state_wait_saved();
+    auto input = get_owned_iserial();
+    auto& serial = *input.serial_ptr;
     auto state_has = serial.canRead() && serial.getReadLength() > 0;
-    disown_iserial(serial_ptr, istream_ptr, owned);
+    disown_iserial(input);
     return state_has;
 }
 
@@ -79,74 +746,188 @@ bool dz::is_state_loaded() {
     return dr.stateHolder.loaded;
 }
 
+void state_commit_delta_baselines() {
+    for (auto& restorer : dr.stateHolder.restorables)
+        restorer.restorable_ptr->commit_delta_baseline();
+}
+
 bool dz::save_state() {
+    return save_state_async() && state_wait_saved();
+}
+
+bool dz::save_state_async() {
+    // snapshots are written in the order they were captured
+    state_wait_saved();
+    auto& sh = dr.stateHolder;
+    auto snapshot = std::make_shared<StateSnapshot>();
+    if (sh.use_ostream)
+        snapshot->ostream_ptr = sh.ostream_ptr;
+    else
+        snapshot->path = sh.path;
+    snapshot->stream_buffer.compression_level = sh.compression_level;
+    snapshot->asset_packs = sh.asset_packs;
+    sh.capturing = snapshot;
+    sh.saving = snapshot;
     bool _saved = true;
-    auto [serial_ptr, ostream_ptr, owned] = get_owned_oserial();
+    auto serial_ptr = new Serial(snapshot->stream);
+    snapshot->serial_ptr = serial_ptr;
     auto& serial = *serial_ptr;
-    auto& sh = dr.stateHolder;
     auto static_backups_size = sh.static_backups.size();
     serial << static_backups_size;
     for (auto& [sid, static_backup] : sh.static_backups) {
         serial << sid;
-        if (!static_backup(serial))
-            return false;
-    }
-    auto restorables_size = sh.restorables.size();
-    serial << restorables_size;
-    for (auto& restorer : sh.restorables) {
-        serial << restorer.cid;
-        auto& restorable = *restorer.restorable_ptr;
-        if (!restorable.backup(serial)) {
+        if (!static_backup(serial)) {
             _saved = false;
             goto _return;
         }
     }
+    {
+        auto restorables_size = sh.restorables.size();
+        serial << restorables_size;
+        for (auto& restorer : sh.restorables) {
+            serial << restorer.cid;
+            auto& restorable = *restorer.restorable_ptr;
+            if (!restorable.backup(serial)) {
+                _saved = false;
+                goto _return;
+            }
+        }
+    }
 _return:
-    disown_oserial(serial_ptr, ostream_ptr, owned);
+    serial_ptr->synchronize();
+    delete serial_ptr;
+    sh.capturing.reset();
+    snapshot->stream_buffer.seal();
+    snapshot->captured = _saved;
+    if (!_saved) {
+        // readbacks already queued still hold the snapshot, the partial capture is discarded once they land
+        sh.saving.reset();
+    }
+    else {
+        transfer_flush();
+        if (sh.track_deltas)
+            state_commit_delta_baselines();
+    }
+    state_snapshot_release(snapshot);
     return _saved;
 }
 
+bool dz::is_state_saving() {
+    auto& saving = dr.stateHolder.saving;
+    return saving && saving->written.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+}
+
+bool dz::state_wait_saved() {
+    auto saving = dr.stateHolder.saving;
+    if (!saving)
+        return true;
+    // readback callbacks are delivered by the transfer queue on this thread
+    if (saving->pending.load())
+        transfer_wait_idle();
+    auto written = saving->written.get();
+    if (dr.stateHolder.saving == saving)
+        dr.stateHolder.saving.reset();
+    return written;
+}
+
 bool dz::load_state() {
+    state_wait_saved();
     bool _loaded = true;
-    auto [serial_ptr, istream_ptr, owned] = get_owned_iserial();
-    auto& serial = *serial_ptr;
+    auto input = get_owned_iserial();
+    auto& serial = *input.serial_ptr;
     auto& sh = dr.stateHolder;
+    sh.restoring = input.reader.get();
     auto static_restores_size = sh.static_restores.size();
     serial >> static_restores_size;
     for (size_t restore_count = 1; restore_count <= static_restores_size; ++restore_count) {
         int sid = 0;
         serial >> sid;
         auto static_restore_it = sh.static_restores.find(sid);
-        if (static_restore_it == sh.static_restores.end())
-            return false;
-        auto& static_restore = static_restore_it->second;
-        if (!static_restore(serial))
-            return false;
-    }
-    auto restorables_size = sh.restorables.size();
-    serial >> restorables_size;
-    for (size_t restorer_count = 1; restorer_count <= restorables_size; ++restorer_count) {
-        int cid = 0;
-        serial >> cid;
-        auto c_fn_it = sh.c_id_fn_map.find(cid);
-        if (c_fn_it == sh.c_id_fn_map.end()) {
+        if (static_restore_it == sh.static_restores.end() || !static_restore_it->second(serial)) {
             _loaded = false;
             goto _return;
         }
-        auto restorable_ptr = c_fn_it->second(serial);
-        StateHolder::Restorer restorer{
-            restorable_ptr,
-            cid == CID_WINDOW ? false : true,
-            cid
-        };
-        sh.restorables.push_back(restorer);
+    }
+    {
+        auto restorables_size = sh.restorables.size();
+        serial >> restorables_size;
+        for (size_t restorer_count = 1; restorer_count <= restorables_size; ++restorer_count) {
+            int cid = 0;
+            serial >> cid;
+            auto c_fn_it = sh.c_id_fn_map.find(cid);
+            if (c_fn_it == sh.c_id_fn_map.end()) {
+                _loaded = false;
+                goto _return;
+            }
+            auto restorable_ptr = c_fn_it->second(serial);
+            StateHolder::Restorer restorer{
+                restorable_ptr,
+                cid == CID_WINDOW ? false : true,
+                cid
+            };
+            sh.restorables.push_back(restorer);
+        }
     }
 _return:
-    disown_iserial(serial_ptr, istream_ptr, owned);
+    sh.restoring = nullptr;
+    disown_iserial(input);
     dr.stateHolder.loaded = _loaded;
+    if (_loaded && sh.track_deltas)
+        state_commit_delta_baselines();
     return _loaded;
 }
 
+void dz::state_track_deltas(bool enable) {
+    dr.stateHolder.track_deltas = enable;
+    if (enable)
+        state_commit_delta_baselines();
+}
+
+bool dz::save_state_delta(std::ostream& ostream, bool reversible) {
+    auto& sh = dr.stateHolder;
+    if (!sh.track_deltas)
+        return false;
+    Serial serial(ostream);
+    serial << std::string(DZ_STATE_DELTA_MAGIC) << DZ_STATE_DELTA_VERSION << reversible;
+    auto restorables_size = sh.restorables.size();
+    serial << restorables_size;
+    std::map<int, int> cid_indices;
+    bool _saved = true;
+    for (auto& restorer : sh.restorables) {
+        serial << restorer.cid << cid_indices[restorer.cid]++;
+        if (!restorer.restorable_ptr->backup_delta(serial, reversible)) {
+            _saved = false;
+            break;
+        }
+    }
+    serial.synchronize();
+    return _saved;
+}
+
+bool dz::apply_state_delta(std::istream& istream, bool reverse) {
+    Serial serial(istream);
+    std::string magic;
+    int version = 0;
+    bool reversible = false;
+    serial >> magic >> version >> reversible;
+    if (magic != DZ_STATE_DELTA_MAGIC || version != DZ_STATE_DELTA_VERSION || (reverse && !reversible))
+        return false;
+    size_t restorables_size = 0;
+    serial >> restorables_size;
+    bool _applied = true;
+    for (size_t restorer_count = 1; restorer_count <= restorables_size; ++restorer_count) {
+        int cid = 0, index = 0;
+        serial >> cid >> index;
+        auto restorable_ptr = state_get_restorable_ptr(cid, index);
+        if (!restorable_ptr || !restorable_ptr->restore_delta(serial, reversible, reverse)) {
+            _applied = false;
+            break;
+        }
+    }
+    serial.synchronize();
+    return _applied;
+}
+
 bool dz::free_state() {
     try {
         for (auto& restorer : dr.stateHolder.restorables) {
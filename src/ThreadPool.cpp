@@ -0,0 +1,125 @@
+#include <dz/ThreadPool.hpp>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <atomic>
+#include <exception>
+#include <algorithm>
+
+namespace dz {
+    struct ThreadPool
+    {
+        std::vector<std::thread> threads;
+        std::deque<std::function<void()>> tasks;
+        std::mutex tasks_mutex;
+        std::condition_variable tasks_cv;
+        bool stopping = false;
+    };
+
+    void thread_pool_worker(ThreadPool* pool) {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock lock(pool->tasks_mutex);
+                pool->tasks_cv.wait(lock, [pool]() { return pool->stopping || !pool->tasks.empty(); });
+                if (pool->tasks.empty())
+                    return;
+                task = std::move(pool->tasks.front());
+                pool->tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    ThreadPool* thread_pool_create(size_t thread_count) {
+        if (thread_count == 0) {
+            auto hardware_count = std::thread::hardware_concurrency();
+            thread_count = hardware_count > 1 ? hardware_count - 1 : 1;
+        }
+        auto pool = new ThreadPool;
+        pool->threads.reserve(thread_count);
+        for (size_t index = 0; index < thread_count; index++)
+            pool->threads.emplace_back(thread_pool_worker, pool);
+        return pool;
+    }
+
+    void thread_pool_free(ThreadPool* pool) {
+        if (!pool)
+            return;
+        {
+            std::lock_guard lock(pool->tasks_mutex);
+            pool->stopping = true;
+        }
+        pool->tasks_cv.notify_all();
+        for (auto& thread : pool->threads)
+            thread.join();
+        delete pool;
+    }
+
+    ThreadPool* thread_pool_default() {
+        static std::unique_ptr<ThreadPool, void(*)(ThreadPool*)> default_pool(thread_pool_create(), thread_pool_free);
+        return default_pool.get();
+    }
+
+    size_t thread_pool_get_thread_count(ThreadPool* pool) {
+        return pool->threads.size();
+    }
+
+    void thread_pool_enqueue(ThreadPool* pool, std::function<void()> task) {
+        {
+            std::lock_guard lock(pool->tasks_mutex);
+            pool->tasks.push_back(std::move(task));
+        }
+        pool->tasks_cv.notify_one();
+    }
+
+    void thread_pool_parallel_for(ThreadPool* pool, size_t count, const std::function<void(size_t)>& fn) {
+        if (count == 0)
+            return;
+        if (count == 1) {
+            fn(0);
+            return;
+        }
+        struct ParallelState
+        {
+            std::atomic<size_t> next = 0;
+            std::atomic<size_t> done = 0;
+            size_t count = 0;
+            const std::function<void(size_t)>* fn = nullptr;
+            std::exception_ptr error;
+            std::mutex done_mutex;
+            std::condition_variable done_cv;
+        };
+        auto state = std::make_shared<ParallelState>();
+        state->count = count;
+        state->fn = &fn;
+        // helpers may start after every index is claimed, they only touch fn for indices they claim
+        auto run = [](ParallelState& state) {
+            size_t index;
+            while ((index = state.next.fetch_add(1)) < state.count) {
+                try {
+                    (*state.fn)(index);
+                }
+                catch (...) {
+                    std::lock_guard lock(state.done_mutex);
+                    if (!state.error)
+                        state.error = std::current_exception();
+                }
+                if (state.done.fetch_add(1) + 1 == state.count) {
+                    std::lock_guard lock(state.done_mutex);
+                    state.done_cv.notify_all();
+                }
+            }
+        };
+        auto helper_count = (std::min)(count - 1, pool->threads.size());
+        for (size_t index = 0; index < helper_count; index++)
+            thread_pool_enqueue(pool, [state, run]() { run(*state); });
+        run(*state);
+        std::unique_lock lock(state->done_mutex);
+        state->done_cv.wait(lock, [&]() { return state->done.load() == count; });
+        if (state->error)
+            std::rethrow_exception(state->error);
+    }
+}
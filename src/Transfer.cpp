@@ -0,0 +1,453 @@
+#include <dz/Transfer.hpp>
+#include "Directz.cpp.hpp"
+#include "Image.cpp.hpp"
+
+namespace dz {
+
+    VkDeviceSize transfer_align_up(VkDeviceSize value, VkDeviceSize alignment) {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    bool transfer_uses_dedicated_queue() {
+        return dr.transferFamily > -1 && dr.transferFamily != dr.graphicsAndComputeFamily;
+    }
+
+    bool transfer_has_dedicated_queue() {
+        return transfer_uses_dedicated_queue();
+    }
+
+    void transfer_set_staging_size(size_t size) {
+        auto& transfer = dr.transfer;
+        if (transfer.initialized)
+            throw std::runtime_error("transfer_set_staging_size must be called before the first transfer");
+        transfer.ring.capacity = transfer_align_up(size, DZ_TRANSFER_STAGING_ALIGNMENT);
+    }
+
+    void transfer_create_staging_buffer(VkDeviceSize size, VkBuffer& buffer, GPUAllocation& allocation, char*& mapped) {
+        uint32_t family_indices[] = {uint32_t(dr.graphicsAndComputeFamily), uint32_t(dr.transferFamily)};
+
+        VkBufferCreateInfo buffer_info{};
+        buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        buffer_info.size = size;
+        buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        if (transfer_uses_dedicated_queue()) {
+            buffer_info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+            buffer_info.queueFamilyIndexCount = 2;
+            buffer_info.pQueueFamilyIndices = family_indices;
+        }
+        else
+            buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        vk_check("vkCreateBuffer", vkCreateBuffer(dr.device, &buffer_info, nullptr, &buffer));
+
+        allocation = gpu_memory_allocate_buffer(buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, GPUMemoryCategory::Staging);
+        mapped = (char*)allocation.mapped;
+    }
+
+    VkCommandPool transfer_create_command_pool(int32_t family) {
+        VkCommandPoolCreateInfo pool_info{};
+        pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        pool_info.queueFamilyIndex = family;
+        VkCommandPool pool = VK_NULL_HANDLE;
+        vk_check("vkCreateCommandPool", vkCreateCommandPool(dr.device, &pool_info, 0, &pool));
+        return pool;
+    }
+
+    void transfer_ensure() {
+        auto& transfer = dr.transfer;
+        if (transfer.initialized)
+            return;
+        if (dr.device == VK_NULL_HANDLE)
+            throw std::runtime_error("transfer requires a logical device, create a window first");
+        if (dr.transferFamily == -1) {
+            dr.transferFamily = dr.graphicsAndComputeFamily;
+            dr.transferQueue = dr.graphicsQueue;
+        }
+        transfer.graphics_command_pool = transfer_create_command_pool(dr.graphicsAndComputeFamily);
+        if (transfer_uses_dedicated_queue())
+            transfer.transfer_command_pool = transfer_create_command_pool(dr.transferFamily);
+        auto& ring = transfer.ring;
+        transfer_create_staging_buffer(ring.capacity, ring.buffer, ring.allocation, ring.mapped);
+        transfer.initialized = true;
+    }
+
+    VkCommandBuffer transfer_allocate_command_buffer(VkCommandPool pool) {
+        VkCommandBufferAllocateInfo alloc_info{};
+        alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        alloc_info.commandPool = pool;
+        alloc_info.commandBufferCount = 1;
+        VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+        vk_check("vkAllocateCommandBuffers", vkAllocateCommandBuffers(dr.device, &alloc_info, &command_buffer));
+        return command_buffer;
+    }
+
+    TransferSubmission& transfer_get_pending() {
+        auto& transfer = dr.transfer;
+        if (transfer.pending)
+            return *transfer.pending;
+
+        if (!transfer.recycled.empty()) {
+            transfer.pending.emplace(std::move(transfer.recycled.back()));
+            transfer.recycled.pop_back();
+        }
+        else {
+            transfer.pending.emplace();
+            auto& submission = *transfer.pending;
+            submission.graphics_command_buffer = transfer_allocate_command_buffer(transfer.graphics_command_pool);
+            if (transfer_uses_dedicated_queue()) {
+                submission.transfer_command_buffer = transfer_allocate_command_buffer(transfer.transfer_command_pool);
+                VkSemaphoreCreateInfo semaphore_info{};
+                semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+                vk_check("vkCreateSemaphore", vkCreateSemaphore(dr.device, &semaphore_info, 0, &submission.semaphore));
+            }
+            VkFenceCreateInfo fence_info{};
+            fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+            vk_check("vkCreateFence", vkCreateFence(dr.device, &fence_info, 0, &submission.fence));
+        }
+
+        auto& submission = *transfer.pending;
+        VkCommandBufferBeginInfo begin_info{};
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vk_check("vkBeginCommandBuffer", vkBeginCommandBuffer(submission.graphics_command_buffer, &begin_info));
+        if (submission.transfer_command_buffer)
+            vk_check("vkBeginCommandBuffer", vkBeginCommandBuffer(submission.transfer_command_buffer, &begin_info));
+        return submission;
+    }
+
+    void transfer_retire(TransferSubmission& submission) {
+        auto& transfer = dr.transfer;
+        for (auto& completion : submission.completions)
+            completion();
+        submission.completions.clear();
+        for (auto& [buffer, allocation] : submission.dedicated_buffers) {
+            vkDestroyBuffer(dr.device, buffer, 0);
+            gpu_memory_free(allocation);
+        }
+        submission.dedicated_buffers.clear();
+        for (auto& [image, allocation] : submission.freed_images) {
+            vkDestroyImage(dr.device, image, 0);
+            gpu_memory_free(allocation);
+        }
+        submission.freed_images.clear();
+        submission.images.clear();
+        transfer.ring.tail = submission.ring_end;
+        if (transfer.in_flight.empty() && !transfer.pending)
+            transfer.ring.head = transfer.ring.tail = 0;
+        vkResetFences(dr.device, 1, &submission.fence);
+        vkResetCommandBuffer(submission.graphics_command_buffer, 0);
+        if (submission.transfer_command_buffer)
+            vkResetCommandBuffer(submission.transfer_command_buffer, 0);
+        submission.has_transfer_commands = false;
+        transfer.recycled.push_back(std::move(submission));
+    }
+
+    void transfer_retire_oldest(bool wait) {
+        auto& transfer = dr.transfer;
+        if (transfer.in_flight.empty())
+            return;
+        auto fence = transfer.in_flight.front().fence;
+        if (wait)
+            vk_check("vkWaitForFences", vkWaitForFences(dr.device, 1, &fence, VK_TRUE, UINT64_MAX));
+        else if (vkGetFenceStatus(dr.device, fence) != VK_SUCCESS)
+            return;
+        // pop before running completions so they may queue further transfers
+        auto submission = std::move(transfer.in_flight.front());
+        transfer.in_flight.pop_front();
+        transfer_retire(submission);
+    }
+
+    bool transfer_ring_allocate(VkDeviceSize size, VkDeviceSize& offset) {
+        auto& ring = dr.transfer.ring;
+        auto aligned = transfer_align_up(ring.head, DZ_TRANSFER_STAGING_ALIGNMENT);
+        if (ring.head >= ring.tail) {
+            if (aligned + size <= ring.capacity) {
+                offset = aligned;
+                ring.head = aligned + size;
+                return true;
+            }
+            // wrap, strictly below tail so a full ring is never mistaken for an empty one
+            if (size < ring.tail) {
+                offset = 0;
+                ring.head = size;
+                return true;
+            }
+            return false;
+        }
+        if (aligned + size < ring.tail) {
+            offset = aligned;
+            ring.head = aligned + size;
+            return true;
+        }
+        return false;
+    }
+
+    /**
+    * @brief Reserves staging memory for a request, waiting on the oldest submissions while the ring is full
+    */
+    void transfer_allocate_staging(VkDeviceSize size, VkBuffer& buffer, VkDeviceSize& offset, char*& mapped) {
+        auto& transfer = dr.transfer;
+        auto& ring = transfer.ring;
+        if (size > ring.capacity) {
+            GPUAllocation allocation;
+            transfer_create_staging_buffer(size, buffer, allocation, mapped);
+            transfer_get_pending().dedicated_buffers.push_back({buffer, allocation});
+            offset = 0;
+            return;
+        }
+        while (!transfer_ring_allocate(size, offset)) {
+            if (transfer.pending)
+                transfer_flush();
+            if (transfer.in_flight.empty()) {
+                ring.head = ring.tail = 0;
+                continue;
+            }
+            transfer_retire_oldest(true);
+        }
+        buffer = ring.buffer;
+        mapped = ring.mapped + offset;
+    }
+
+    VkDeviceSize image_get_mip_byte_size(Image* image_ptr, uint32_t mip, VkExtent3D& extent) {
+        auto& image = *image_ptr;
+        extent.width = (std::max)(1u, image.width >> mip);
+        extent.height = (std::max)(1u, image.height >> mip);
+        extent.depth = (std::max)(1u, image.depth >> mip);
+        return format_get_mip_byte_size(image.format, extent.width, extent.height, extent.depth);
+    }
+
+    VkBufferImageCopy transfer_make_copy_region(Image* image_ptr, uint32_t mip, VkDeviceSize offset, VkExtent3D extent) {
+        VkBufferImageCopy region{};
+        region.bufferOffset = offset;
+        region.bufferRowLength = 0;
+        region.bufferImageHeight = 0;
+        region.imageSubresource.aspectMask = image_get_aspect_mask(image_ptr);
+        region.imageSubresource.mipLevel = mip;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset = {0, 0, 0};
+        region.imageExtent = extent;
+        return region;
+    }
+
+    VkImageMemoryBarrier transfer_make_image_barrier(Image* image_ptr, uint32_t mip, VkImageLayout old_layout, VkImageLayout new_layout, VkAccessFlags src_access, VkAccessFlags dst_access) {
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = old_layout;
+        barrier.newLayout = new_layout;
+        barrier.srcAccessMask = src_access;
+        barrier.dstAccessMask = dst_access;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image_ptr->image;
+        barrier.subresourceRange.aspectMask = image_get_aspect_mask(image_ptr);
+        barrier.subresourceRange.baseMipLevel = mip;
+        barrier.subresourceRange.levelCount = 1;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+        return barrier;
+    }
+
+    void image_upload_data_async(Image* image_ptr, uint32_t mip, const void* data, TransferUploadCallback on_complete) {
+        transfer_ensure();
+        auto& image = *image_ptr;
+        VkExtent3D extent;
+        auto image_size = image_get_mip_byte_size(image_ptr, mip, extent);
+
+        VkBuffer staging_buffer;
+        VkDeviceSize staging_offset;
+        char* staging_mapped;
+        transfer_allocate_staging(image_size, staging_buffer, staging_offset, staging_mapped);
+        memcpy(staging_mapped, data, size_t(image_size));
+
+        auto& submission = transfer_get_pending();
+        submission.images.push_back(image.image);
+        auto region = transfer_make_copy_region(image_ptr, mip, staging_offset, extent);
+        auto& current_layout = image.current_layouts[mip];
+        auto final_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+        // Only freshly created mips go through the dedicated queue, anything the graphics queue
+        // may still be reading stays on the graphics queue so ordering is implicit
+        if (transfer_uses_dedicated_queue() && current_layout == VK_IMAGE_LAYOUT_UNDEFINED) {
+            auto to_transfer = transfer_make_image_barrier(image_ptr, mip, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT);
+            vkCmdPipelineBarrier(submission.transfer_command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &to_transfer);
+            vkCmdCopyBufferToImage(submission.transfer_command_buffer, staging_buffer, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+            // queue family ownership release (transfer) / acquire (graphics)
+            auto ownership = transfer_make_image_barrier(image_ptr, mip, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, final_layout, VK_ACCESS_TRANSFER_WRITE_BIT, 0);
+            ownership.srcQueueFamilyIndex = dr.transferFamily;
+            ownership.dstQueueFamilyIndex = dr.graphicsAndComputeFamily;
+            vkCmdPipelineBarrier(submission.transfer_command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &ownership);
+            ownership.srcAccessMask = 0;
+            ownership.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            vkCmdPipelineBarrier(submission.graphics_command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &ownership);
+            submission.has_transfer_commands = true;
+        }
+        else {
+            auto to_transfer = transfer_make_image_barrier(image_ptr, mip, current_layout, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT);
+            vkCmdPipelineBarrier(submission.graphics_command_buffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &to_transfer);
+            vkCmdCopyBufferToImage(submission.graphics_command_buffer, staging_buffer, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+            auto to_shader = transfer_make_image_barrier(image_ptr, mip, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, final_layout, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT);
+            vkCmdPipelineBarrier(submission.graphics_command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &to_shader);
+        }
+
+        current_layout = final_layout;
+        image.data_is_gpu_side = true;
+
+        if (on_complete)
+            submission.completions.push_back(std::move(on_complete));
+    }
+
+    void image_get_data_async(Image* image_ptr, int mip, TransferReadbackCallback on_complete) {
+        transfer_ensure();
+        auto& image = *image_ptr;
+        VkExtent3D extent;
+        auto image_size = image_get_mip_byte_size(image_ptr, mip, extent);
+
+        VkBuffer staging_buffer;
+        VkDeviceSize staging_offset;
+        char* staging_mapped;
+        transfer_allocate_staging(image_size, staging_buffer, staging_offset, staging_mapped);
+
+        auto& submission = transfer_get_pending();
+        submission.images.push_back(image.image);
+        auto command_buffer = submission.graphics_command_buffer;
+        auto& current_layout = image.current_layouts[mip];
+        auto original_layout = current_layout;
+
+        auto to_transfer = transfer_make_image_barrier(image_ptr, mip, current_layout, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &to_transfer);
+        current_layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+        auto region = transfer_make_copy_region(image_ptr, mip, staging_offset, extent);
+        vkCmdCopyImageToBuffer(command_buffer, image.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, staging_buffer, 1, &region);
+
+        if (original_layout != VK_IMAGE_LAYOUT_UNDEFINED && original_layout != VK_IMAGE_LAYOUT_PREINITIALIZED) {
+            auto to_original = transfer_make_image_barrier(image_ptr, mip, current_layout, original_layout, VK_ACCESS_TRANSFER_READ_BIT,
+                VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+            vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1, &to_original);
+            current_layout = original_layout;
+        }
+
+        VkMemoryBarrier host_barrier{};
+        host_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        host_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        host_barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &host_barrier, 0, nullptr, 0, nullptr);
+
+        submission.completions.push_back([staging_mapped, image_size, on_complete = std::move(on_complete)]() {
+            if (on_complete)
+                on_complete(staging_mapped, size_t(image_size));
+        });
+    }
+
+    void transfer_flush() {
+        auto& transfer = dr.transfer;
+        if (!transfer.pending)
+            return;
+        auto submission = std::move(*transfer.pending);
+        transfer.pending.reset();
+        submission.ring_end = transfer.ring.head;
+
+        VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+        if (submission.transfer_command_buffer) {
+            vk_check("vkEndCommandBuffer", vkEndCommandBuffer(submission.transfer_command_buffer));
+            if (submission.has_transfer_commands) {
+                VkSubmitInfo transfer_submit{};
+                transfer_submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+                transfer_submit.commandBufferCount = 1;
+                transfer_submit.pCommandBuffers = &submission.transfer_command_buffer;
+                transfer_submit.signalSemaphoreCount = 1;
+                transfer_submit.pSignalSemaphores = &submission.semaphore;
+                vk_check("vkQueueSubmit", vkQueueSubmit(dr.transferQueue, 1, &transfer_submit, VK_NULL_HANDLE));
+            }
+        }
+
+        vk_check("vkEndCommandBuffer", vkEndCommandBuffer(submission.graphics_command_buffer));
+        VkSubmitInfo graphics_submit{};
+        graphics_submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        graphics_submit.commandBufferCount = 1;
+        graphics_submit.pCommandBuffers = &submission.graphics_command_buffer;
+        if (submission.has_transfer_commands) {
+            graphics_submit.waitSemaphoreCount = 1;
+            graphics_submit.pWaitSemaphores = &submission.semaphore;
+            graphics_submit.pWaitDstStageMask = &wait_stage;
+        }
+        vk_check("vkQueueSubmit", vkQueueSubmit(dr.graphicsQueue, 1, &graphics_submit, submission.fence));
+
+        transfer.in_flight.push_back(std::move(submission));
+    }
+
+    void transfer_poll() {
+        auto& transfer = dr.transfer;
+        while (!transfer.in_flight.empty()) {
+            auto in_flight_count = transfer.in_flight.size();
+            transfer_retire_oldest(false);
+            if (transfer.in_flight.size() == in_flight_count)
+                break;
+        }
+    }
+
+    void transfer_wait_idle() {
+        auto& transfer = dr.transfer;
+        transfer_flush();
+        while (!transfer.in_flight.empty())
+            transfer_retire_oldest(true);
+    }
+
+    bool transfer_defer_image_free(VkImage image, GPUAllocation& allocation) {
+        auto& transfer = dr.transfer;
+        auto uses_image = [&](TransferSubmission& submission) {
+            return std::find(submission.images.begin(), submission.images.end(), image) != submission.images.end();
+        };
+        // the newest submission using the image retires last, in_flight retires in order behind pending
+        TransferSubmission* last_use = nullptr;
+        if (transfer.pending && uses_image(*transfer.pending))
+            last_use = &*transfer.pending;
+        for (auto it = transfer.in_flight.rbegin(); !last_use && it != transfer.in_flight.rend(); ++it)
+            if (uses_image(*it))
+                last_use = &*it;
+        if (!last_use)
+            return false;
+        last_use->freed_images.push_back({image, allocation});
+        allocation = {};
+        return true;
+    }
+
+    void transfer_batch_begin() {
+        dr.transfer.batch_depth++;
+    }
+
+    void transfer_batch_end() {
+        auto& transfer = dr.transfer;
+        if (transfer.batch_depth == 0)
+            return;
+        if (--transfer.batch_depth == 0)
+            transfer_wait_idle();
+    }
+
+    void transfer_destroy() {
+        auto& transfer = dr.transfer;
+        if (!transfer.initialized || dr.device == VK_NULL_HANDLE)
+            return;
+        transfer_wait_idle();
+        for (auto& submission : transfer.recycled) {
+            vkDestroyFence(dr.device, submission.fence, 0);
+            if (submission.semaphore)
+                vkDestroySemaphore(dr.device, submission.semaphore, 0);
+        }
+        transfer.recycled.clear();
+        vkDestroyCommandPool(dr.device, transfer.graphics_command_pool, 0);
+        if (transfer.transfer_command_pool)
+            vkDestroyCommandPool(dr.device, transfer.transfer_command_pool, 0);
+        auto& ring = transfer.ring;
+        vkDestroyBuffer(dr.device, ring.buffer, 0);
+        gpu_memory_free(ring.allocation);
+        ring = {.capacity = ring.capacity};
+        transfer.initialized = false;
+    }
+}
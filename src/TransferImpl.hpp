@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Directz.cpp.hpp"
+
+#define DZ_TRANSFER_STAGING_SIZE (64ull * 1024ull * 1024ull)
+#define DZ_TRANSFER_STAGING_ALIGNMENT 16
+
+namespace dz {
+    struct StagingRing
+    {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        GPUAllocation allocation;
+        char* mapped = nullptr;
+        VkDeviceSize capacity = DZ_TRANSFER_STAGING_SIZE;
+        VkDeviceSize head = 0;
+        VkDeviceSize tail = 0;
+    };
+
+    struct TransferSubmission
+    {
+        VkCommandBuffer transfer_command_buffer = VK_NULL_HANDLE;
+        VkCommandBuffer graphics_command_buffer = VK_NULL_HANDLE;
+        VkSemaphore semaphore = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        VkDeviceSize ring_end = 0;
+        bool has_transfer_commands = false;
+        std::vector<std::function<void()>> completions;
+        std::vector<std::pair<VkBuffer, GPUAllocation>> dedicated_buffers;
+        std::vector<VkImage> images;                                    /**< Images copied to or from by this submission. */
+        std::vector<std::pair<VkImage, GPUAllocation>> freed_images;    /**< Images freed while this submission used them, destroyed when it retires. */
+    };
+
+    struct TransferRegistry
+    {
+        bool initialized = false;
+        StagingRing ring;
+        VkCommandPool graphics_command_pool = VK_NULL_HANDLE;
+        VkCommandPool transfer_command_pool = VK_NULL_HANDLE;
+        std::optional<TransferSubmission> pending;
+        std::deque<TransferSubmission> in_flight;
+        std::vector<TransferSubmission> recycled;
+        uint32_t batch_depth = 0;
+    };
+
+    /**
+     * @brief Hands image and its memory to the newest submission still copying to or from it, to be destroyed when that submission retires
+     *
+     * @returns false if no pending or in flight submission uses image, the caller destroys it right away
+     */
+    bool transfer_defer_image_free(VkImage image, GPUAllocation& allocation);
+
+    void transfer_destroy();
+}
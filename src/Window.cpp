@@ -27,7 +27,7 @@ namespace dz {
 
 	WindowMetaReflectable::WindowMetaReflectable(WINDOW* window_ptr):
 		window_ptr(window_ptr),
-		uid(GlobalUID::GetNew("Reflectable")),
+		uid(Reflectable::NewUID()),
 		name("Window Meta") {}
 
 	int WindowMetaReflectable::GetID() {
@@ -56,7 +56,7 @@ namespace dz {
 	
 	WindowViewportReflectable::WindowViewportReflectable(WINDOW* window_ptr):
 		window_ptr(window_ptr),
-		uid(GlobalUID::GetNew("Reflectable")),
+		uid(Reflectable::NewUID()),
 		name("Window Viewport") {}
 
 	int WindowViewportReflectable::GetID() {
@@ -252,6 +252,8 @@ namespace dz {
 	}
 
 	void window_render(WINDOW* window, bool multi_window_render) {
+		if (!multi_window_render)
+			allocator_begin_frame();
 		for (auto& [priority, shader_dispatches] : window->priority_shader_dispatches) {
 			for (auto& [shader, dispatch_fn] : shader_dispatches) {
 				auto count = dispatch_fn();
@@ -263,6 +265,7 @@ namespace dz {
 	}
 
 	void windows_render() {
+		allocator_begin_frame();
 		for (size_t index = 0; index < dr.window_ptrs.size(); index++)
 			window_render(dr.window_ptrs[index], true);
 	}
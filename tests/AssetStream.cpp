@@ -15,6 +15,15 @@
 // #include <algorithm>
 
 #include <DirectZ.hpp>
+#include "Check.hpp"
+
+static std::string memory_contents(FileHandle& handle) {
+    return std::dynamic_pointer_cast<memory_stream>(handle.open(std::ios::in | std::ios::out | std::ios::binary))->str();
+}
+
+static void set_memory_contents(FileHandle& handle, const std::string& contents) {
+    std::dynamic_pointer_cast<memory_stream>(handle.open(std::ios::in | std::ios::out | std::ios::binary))->str(contents);
+}
 
 int main() {
     const char* filename = "kvstore.bin";
@@ -25,7 +34,8 @@ int main() {
         KeyValueStream<int, std::string> kv(handle);
         kv.write(1, "hello");
         std::string out;
-        if (kv.read(1, out)) std::cout << "Key 1: " << out << std::endl;
+        check(kv.read(1, out) && out == "hello", "key 1 readable after write");
+        std::cout << "Key 1: " << out << std::endl;
         kv.write(2, "world");
         kv.write(3, "foo");
         kv.write(2, "updated");
@@ -33,10 +43,47 @@ int main() {
     {
         KeyValueStream<int, std::string> kv(handle);
         std::string out;
-        if (kv.read(2, out)) std::cout << "Key 2: " << out << std::endl;
-        if (kv.read(1, out)) std::cout << "Key 1: " << out << std::endl;
-        if (kv.read(3, out)) std::cout << "Key 3: " << out << std::endl;
+        check(kv.read(2, out) && out == "updated", "key 2 holds the overwrite after reopen");
+        std::cout << "Key 2: " << out << std::endl;
+        check(kv.read(1, out) && out == "hello", "key 1 survives reopen");
+        check(kv.read(3, out) && out == "foo", "key 3 survives reopen");
+        check(kv.erase(1), "erase of key 1");
+        check(!kv.read(1, out), "erased key 1 is unreadable");
+        std::cout << "Dead bytes: " << kv.dead_bytes() << std::endl;
+        check(kv.dead_bytes() != 0, "overwrite and erase leave dead bytes");
+        kv.compact();
+        std::cout << "Dead bytes after compact: " << kv.dead_bytes() << std::endl;
+        check(kv.dead_bytes() == 0, "no dead bytes after compact");
+        check(kv.read(2, out) && out == "updated", "key 2 unchanged by compact");
+        check(kv.read(3, out) && out == "foo", "key 3 unchanged by compact");
+    }
+    {
+        KeyValueStream<int, std::string> kv(handle);
+        std::string out;
+        check(!kv.read(1, out), "erased key 1 stays erased after compact and reopen");
+        check(kv.read(2, out) && out == "updated", "key 2 unchanged after compact and reopen");
+        check(kv.read(3, out) && out == "foo", "key 3 unchanged after compact and reopen");
+        check(kv.dead_bytes() == 0, "no dead bytes after compact and reopen");
     }
-    // kv.erase(1);
-    return 0;
-}
\ No newline at end of file
+
+    // a write interrupted after the last commit leaves a torn tail that must replay to that commit
+    auto committed = memory_contents(handle);
+    {
+        KeyValueStream<int, std::string> kv(handle);
+        kv.write(4, "interrupted");
+        kv.write(2, "overwritten");
+    }
+    auto torn = memory_contents(handle);
+    check(torn.size() > committed.size() + 32, "uncommitted writes were appended");
+    set_memory_contents(handle, torn.substr(0, committed.size() + 32));
+    {
+        KeyValueStream<int, std::string> kv(handle);
+        std::string out;
+        check(!kv.read(4, out), "torn write of key 4 is dropped");
+        check(kv.read(2, out) && out == "updated", "key 2 replays to the last commit");
+        check(kv.read(3, out) && out == "foo", "key 3 replays to the last commit");
+        check(!kv.read(1, out), "key 1 stays erased after replay");
+    }
+
+    return check_result("KeyValueStream");
+}
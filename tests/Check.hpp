@@ -0,0 +1,30 @@
+#pragma once
+
+#include <iostream>
+
+/**
+ * @brief Number of failed checks so far in this test
+ */
+inline int check_failures = 0;
+
+/**
+ * @brief Reports what when condition does not hold, the test then exits non-zero through check_result
+ */
+inline void check(bool condition, const char* what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << std::endl;
+        check_failures++;
+    }
+}
+
+/**
+ * @brief Prints a summary of the checks and returns the exit code for main
+ */
+inline int check_result(const char* name) {
+    if (check_failures) {
+        std::cerr << check_failures << " " << name << " checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << name << " checks passed" << std::endl;
+    return 0;
+}
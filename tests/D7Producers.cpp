@@ -0,0 +1,60 @@
+#include <dz/D7Stream.hpp>
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include "Check.hpp"
+
+using namespace dz;
+
+int main()
+{
+    const size_t thread_count = 8;
+    const size_t points_per_thread = 50000;
+    auto start = std::chrono::steady_clock::now();
+
+    // producers record while this thread keeps merging, uid names the producer and x counts its points
+    D7Stream stream;
+    std::atomic<size_t> finished = 0;
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < thread_count; t++)
+        threads.emplace_back([&, t]() {
+            for (size_t i = 0; i < points_per_thread; i++)
+                stream.recordStreamPoint(std::make_tuple(float(i), 0.f, 0.f, start + std::chrono::microseconds(i * thread_count + t), StreamIdentifier(i), StreamInteger(t), StreamString("record")));
+            finished++;
+        });
+    size_t merged = 0;
+    size_t merges = 0;
+    while (finished < thread_count) {
+        merged += stream.mergeRecordedPoints();
+        merges++;
+    }
+    for (auto& thread : threads)
+        thread.join();
+    merged += stream.mergeRecordedPoints();
+    std::cout << "Merged " << merged << " points from " << thread_count << " producers over " << merges + 1 << " merges" << std::endl;
+
+    check(merged == thread_count * points_per_thread, "every recorded point is merged");
+    check(stream.size() == merged, "merged points are in the history");
+    check(stream.mergeRecordedPoints() == 0, "a merge with nothing queued adds nothing");
+    for (size_t t = 0; t < thread_count; t++) {
+        auto slots = stream.findStreamPoints(D7Type::u, "", StreamInteger(t));
+        check(slots.size() == points_per_thread, "each producer's points are all present");
+        auto in_order = true;
+        for (size_t i = 0; i < slots.size(); i++) {
+            auto point = stream.getStreamPoint(slots[i]);
+            in_order = in_order && point && std::get<0>(*point) == float(i);
+        }
+        check(in_order, "each producer's points keep their order");
+    }
+
+    // a thread's cached producer of a destroyed stream is dropped, later streams get their own
+    for (size_t round = 0; round < 64; round++) {
+        D7Stream short_lived;
+        short_lived.recordStreamPoint(std::make_tuple(0.f, 0.f, 0.f, start, StreamIdentifier(round), StreamInteger(0), StreamString("short")));
+        check(short_lived.mergeRecordedPoints() == 1, "a new stream on a thread with retired producers records");
+    }
+    stream.recordStreamPoint(std::make_tuple(0.f, 0.f, 0.f, start, StreamIdentifier(0), StreamInteger(-1), StreamString("after")));
+    check(stream.mergeRecordedPoints() == 1, "a surviving stream still records after others are destroyed");
+
+    return check_result("D7Stream producer");
+}
@@ -0,0 +1,95 @@
+#include <dz/D7Stream.hpp>
+#include <iostream>
+#include <filesystem>
+#include <chrono>
+#include "Check.hpp"
+
+using namespace dz;
+
+static const std::vector<std::string> actions = {"spawn", "jump", "move"};
+
+static StreamPoint make_point(StreamTimestamp start, size_t i) {
+    auto n = int64_t(i);
+    return std::make_tuple(float(i), 1.5f, -2.f, start + std::chrono::milliseconds(i), StreamIdentifier(i * 977), StreamInteger(i % 2 ? -n : n), actions[i % actions.size()]);
+}
+
+static bool matches(const StreamPoint& point, StreamTimestamp start, size_t i) {
+    return point == make_point(start, i);
+}
+
+int main()
+{
+    const char* path = "d7_recording.d7";
+    const size_t point_count = 100000;
+    auto start = std::chrono::steady_clock::now();
+
+    D7Stream stream;
+    for (size_t i = 0; i < point_count; i++)
+        stream.addStreamPoint(make_point(start, i));
+
+    auto recording = d7_recording_create(path);
+    check(d7_recording_write_stream(recording, stream) == point_count, "write_stream returns the next slot to write");
+    d7_recording_close(recording);
+
+    // timestamp deltas, ids and action indices are varints, only xyz is stored raw
+    auto file_size = std::filesystem::file_size(path);
+    auto bytes_per_point = double(file_size) / double(point_count);
+    std::cout << "Recorded " << point_count << " points in " << file_size << " B, " << bytes_per_point << " B per point" << std::endl;
+    check(bytes_per_point < 24.0, "the synthetic stream encodes to about 23 bytes per point");
+
+    auto playback = d7_playback_open(path);
+    check(d7_playback_get_point_count(playback) == point_count, "the index lists every point");
+    StreamTimestamp first, last;
+    check(d7_playback_get_time_range(playback, first, last), "the recording has a time range");
+    check(first == start && last == start + std::chrono::milliseconds(point_count - 1), "the time range spans the recording");
+
+    // a window in the middle of a segment, decoded from its seek block
+    size_t expected = 50000;
+    auto queried = d7_playback_query(playback, start + std::chrono::milliseconds(50000), start + std::chrono::milliseconds(50100), [&](const StreamPoint& point) {
+        check(matches(point, start, expected++), "a queried point round trips");
+    });
+    check(queried == 100 && expected == 50100, "the query returns exactly the window");
+
+    D7Stream loaded;
+    check(d7_playback_load(playback, first, last + std::chrono::nanoseconds(1), loaded) == point_count, "load copies the whole recording");
+    check(loaded.findStreamPoints(D7Type::a, "jump").size() == point_count / actions.size(), "loaded points are indexed by action");
+    d7_playback_close(playback);
+
+    // a recording that tore inside its last segment, so it has no index either, keeps every complete segment
+    const size_t complete_count = 2 * DZ_D7_SEGMENT_POINTS;
+    recording = d7_recording_create(path);
+    for (size_t i = 0; i < complete_count; i++)
+        d7_recording_write(recording, make_point(start, i));
+    d7_recording_flush(recording);
+    auto complete_size = std::filesystem::file_size(path);
+    for (size_t i = complete_count; i < complete_count + 1000; i++)
+        d7_recording_write(recording, make_point(start, i));
+    d7_recording_flush(recording);
+    auto torn_size = (complete_size + std::filesystem::file_size(path)) / 2;
+    d7_recording_close(recording);
+    std::filesystem::resize_file(path, torn_size);
+
+    playback = d7_playback_open(path);
+    check(d7_playback_get_point_count(playback) == complete_count, "a torn recording keeps its complete segments");
+    expected = complete_count - 10;
+    queried = d7_playback_query(playback, start + std::chrono::milliseconds(expected), start + std::chrono::milliseconds(complete_count + 1000), [&](const StreamPoint& point) {
+        check(matches(point, start, expected++), "a point before the tear round trips");
+    });
+    check(queried == 10, "nothing past the tear is returned");
+    d7_playback_close(playback);
+
+    // a file that is not a recording is rejected without leaking the playback
+    std::filesystem::resize_file(path, 0);
+    auto rejected = false;
+    try {
+        d7_playback_close(d7_playback_open(path));
+    }
+    catch (const std::exception&) {
+        rejected = true;
+    }
+    check(rejected, "opening an empty file throws");
+
+    std::filesystem::remove(path);
+
+    return check_result("D7Stream recording");
+}
@@ -36,15 +36,8 @@ int main()
     std::cout << "Simulated 1000 stream points.\n";
 
     // Remove all "shoot" events
-    for (int i = static_cast<int>(d7stream.stream_points.size()) - 1; i >= 0; --i)
-    {
-        const auto& point = d7stream.stream_points[i];
-        if (std::get<D7TypeToIndex<D7Type::a>()>(point) == "shoot")
-        {
-            size_t* ptr = d7stream.stream_indexes[i];
-            d7stream.removeStreamPoint(ptr);
-        }
-    }
+    for (auto slot : d7stream.findStreamPoints(D7Type::a, "shoot"))
+        d7stream.removeStreamPoint(slot);
 
     std::cout << "Removed all 'shoot' actions.\n";
 
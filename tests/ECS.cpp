@@ -146,6 +146,15 @@ int main() {
                     .roughness = roughness
                 }, out_index, name, images_vec);
                 return {out_id, out_index};
+            },
+            .add_meshes_function = [&](const auto& meshes) {
+                std::vector<int> out_indexes;
+                auto out_ids = ecs.AddMeshes(meshes, out_indexes);
+                std::vector<MeshPair> mesh_pairs;
+                mesh_pairs.reserve(out_ids.size());
+                for (size_t i = 0; i < out_ids.size(); i++)
+                    mesh_pairs.emplace_back(out_ids[i], out_indexes[i]);
+                return mesh_pairs;
             }
         };
         
@@ -0,0 +1,74 @@
+#include <DirectZ.hpp>
+#include <sstream>
+#include "Check.hpp"
+using namespace dz::ecs;
+
+using DeltaECS = ECS<
+    CID_MIN,
+    Scene,
+    Entity,
+    Mesh,
+    SubMesh,
+    Camera,
+    Material,
+    HDRI,
+    SkyBox,
+    Light,
+    PhysicallyBasedLighting,
+    GammaCorrection
+>;
+
+int main() {
+    DeltaECS::RegisterStateCID();
+
+    auto window = window_create({
+        .title = "ECS Delta Test",
+        .width = 320.f,
+        .height = 240.f,
+        .borderless = true,
+        .vsync = false
+    });
+    track_window_state(window);
+    auto ecs_ptr = std::make_shared<DeltaECS>(window);
+    track_state(ecs_ptr.get());
+    auto& ecs = *ecs_ptr;
+
+    auto scene_id = ecs.AddScene(Scene{}, "Delta Scene");
+    auto camera_id = ecs.AddCamera(scene_id, Camera::DefaultPerspective, "Delta Camera");
+    ecs.MarkReady();
+
+    state_track_deltas();
+
+    // one buffer element and one group name change between baseline and delta
+    ecs.GetScene(scene_id).position[0] = 4.f;
+    ecs.GetScene(scene_id).position[1] = 2.f;
+    ecs.GetGenericGroupByID(camera_id).GetName() = "Renamed Camera";
+
+    std::stringstream delta;
+    check(save_state_delta(delta, true), "save_state_delta writes the ECS changes");
+    auto delta_bytes = delta.str();
+
+    std::stringstream empty_delta;
+    check(save_state_delta(empty_delta, true), "save_state_delta with no changes");
+    check(empty_delta.str().size() < delta_bytes.size(), "an unchanged ECS writes no runs");
+
+    std::stringstream revert(delta_bytes);
+    check(apply_state_delta(revert, true), "apply_state_delta reverts the delta");
+    check(ecs.GetScene(scene_id).position[0] == 0.f && ecs.GetScene(scene_id).position[1] == 0.f, "reverting restores the scene position");
+    check(ecs.GetGenericGroupByID(camera_id).GetName() == "Delta Camera", "reverting restores the camera name");
+
+    std::stringstream apply(delta_bytes);
+    check(apply_state_delta(apply), "apply_state_delta applies the delta");
+    check(ecs.GetScene(scene_id).position[0] == 4.f && ecs.GetScene(scene_id).position[1] == 2.f, "applying sets the scene position");
+    check(ecs.GetGenericGroupByID(camera_id).GetName() == "Renamed Camera", "applying renames the camera");
+
+    // the baseline followed the applied delta, so nothing is left to write
+    std::stringstream after_apply;
+    check(save_state_delta(after_apply, true), "save_state_delta after apply");
+    check(after_apply.str() == empty_delta.str(), "applying a delta moves the baseline forward");
+
+    free_state();
+    ecs_ptr.reset();
+
+    return check_result("ECS delta");
+}
@@ -509,12 +509,9 @@ void main()
         {(window_width / 2.f) - (window_width / 3.f), (window_height / 2.f) - (window_height / 3.f)}, // min
         {(window_width / 2.f) + (window_width / 3.f), (window_height / 2.f) + (window_height / 3.f)} // max
     );
-    for (uint32_t i = 0; i < TOTAL_PARTICLES; ++i)
-    {
-        auto particles_view = buffer_group_get_buffer_element_view(particle_group, "Particles", i);
-        auto& p = particles_view.template as_struct<Particle>();
+    auto particles_view = buffer_group_get_buffer_view(particle_group, "Particles");
+    for (auto& p : particles_view.as_structs<Particle>())
         p.reset(bounds);
-    }
 
     auto state_view = buffer_group_get_buffer_element_view(window_group, "WindowStates", 0);
     auto& state = state_view.template as_struct<WindowState>();
@@ -0,0 +1,74 @@
+#include <DirectZ.hpp>
+#include <sstream>
+#include <fstream>
+#include <random>
+#include "Check.hpp"
+
+int main() {
+    const char* source_path = "state_dedup_source.bin";
+    const char* pack_path = "state_dedup.dzp";
+
+    std::mt19937 rng(7);
+    std::string source(256 * 1024, '\0');
+    for (auto& c : source)
+        c = char(rng() % 16);
+    std::ofstream(source_path, std::ios::binary).write(source.data(), std::streamsize(source.size()));
+
+    // packed the way dzp packs a file, read_asset_file's terminator is stored but not part of the recorded source
+    std::error_code ec;
+    std::filesystem::remove(pack_path, ec);
+    {
+        FileHandle pack_handle{FileHandle::PATH, pack_path};
+        auto asset_pack = create_asset_pack(pack_handle);
+        asset_pack_set_compression(asset_pack, AssetCompression::Zlib, -1, DZ_ASSET_BLOCK_SIZE);
+        FileHandle source_handle{FileHandle::PATH, source_path};
+        auto asset = read_asset_file(source_handle);
+        auto size = asset.get_size() - 1;
+        add_encoded_asset(asset_pack, source_path, encode_asset(asset_pack, asset.get(), asset.get_size(), hash_bytes(asset.get(), size), 1));
+        free_asset_pack(asset_pack);
+    }
+    {
+        FileHandle pack_handle{FileHandle::PATH, pack_path};
+        auto asset_pack = open_asset_pack(pack_handle);
+        auto infos = get_asset_infos(asset_pack);
+        check(infos.size() == 1, "the pack lists its asset");
+        check(!infos.empty() && infos[0].size == source.size(), "the pack records the source length");
+        check(!infos.empty() && infos[0].content_hash == hash_bytes(source.data(), source.size()), "the pack records the source hash");
+        free_asset_pack(asset_pack);
+    }
+
+    std::string restored;
+    track_static_state(1,
+        [&](Serial& serial) {
+            size_t size = 0;
+            serial >> size;
+            restored.resize(size);
+            state_read_bytes(serial, restored.data(), size);
+            return true;
+        },
+        [&](Serial& serial) {
+            auto size = source.size();
+            serial << size;
+            state_write_bytes(serial, source.data(), size);
+            return true;
+        });
+
+    std::stringstream embedded;
+    set_state_ostream(embedded);
+    check(save_state(), "save_state without a pack");
+
+    state_reference_asset_pack(pack_path);
+    std::stringstream referenced;
+    set_state_ostream(referenced);
+    check(save_state(), "save_state referencing the pack");
+    std::cout << "State with the blob embedded: " << embedded.str().size() << " B, referencing the pack: " << referenced.str().size() << " B" << std::endl;
+    check(referenced.str().size() < 4096, "the blob is written as a reference to the packed asset");
+    check(referenced.str().size() < embedded.str().size(), "referencing the pack is smaller than embedding");
+
+    std::stringstream load_stream(referenced.str());
+    set_state_istream(load_stream);
+    check(load_state(), "load_state resolves the pack reference");
+    check(restored == source, "the referenced blob restores the source bytes");
+
+    return check_result("State AssetPack");
+}